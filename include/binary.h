@@ -0,0 +1,85 @@
+#ifndef __LETT_BINARY_H__
+#define __LETT_BINARY_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Lett {
+
+    // 按小端序写入，用于编译器的各种缓存文件
+    inline void put32(std::string &out, std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+    }
+
+    inline void put64(std::string &out, std::uint64_t value) {
+        put32(out, static_cast<std::uint32_t>(value));
+        put32(out, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    inline void putString(std::string &out, std::string_view value) {
+        put32(out, static_cast<std::uint32_t>(value.size()));
+        out.append(value.data(), value.size());
+    }
+
+    // 按小端序读取，越界时置失败标志，之后的读取都返回0
+    class InputBuffer {
+    private:
+        std::string_view _data;
+        std::size_t _pos;
+        bool _failed;
+    public:
+        InputBuffer(std::string_view data) : _data(data), _pos(0), _failed(false) {}
+
+        bool failed() const { return _failed; }
+        bool atEnd() const { return _pos == _data.size(); }
+
+        std::uint32_t get32() {
+            if (_failed || _data.size() - _pos < 4) {
+                _failed = true;
+                return 0;
+            }
+            std::uint32_t value = 0;
+            for (int i = 0; i < 4; ++i) {
+                value |= static_cast<std::uint32_t>(static_cast<unsigned char>(_data[_pos++])) << (i * 8);
+            }
+            return value;
+        }
+
+        std::uint64_t get64() {
+            std::uint64_t low = get32();
+            return low | (static_cast<std::uint64_t>(get32()) << 32);
+        }
+
+        std::string getString() {
+            std::string_view value = getBytes(get32());
+            return std::string(value);
+        }
+
+        // 读取size个字节，返回的视图指向原数据
+        std::string_view getBytes(std::size_t size) {
+            if (_failed || _data.size() - _pos < size) {
+                _failed = true;
+                return std::string_view();
+            }
+            std::string_view value = _data.substr(_pos, size);
+            _pos += size;
+            return value;
+        }
+
+        // 元素个数不可能超过剩余的字节数，防止损坏的数据导致巨大的内存分配
+        std::uint32_t getCount() {
+            std::uint32_t count = get32();
+            if (count > _data.size() - _pos) {
+                _failed = true;
+                return 0;
+            }
+            return count;
+        }
+    };
+
+}   // namespace Lett
+
+#endif // __LETT_BINARY_H__
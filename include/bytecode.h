@@ -0,0 +1,296 @@
+#ifndef __LETT_BYTECODE_H__
+#define __LETT_BYTECODE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+
+// 虚拟机指令：名称、格式
+// 指令为32位，低8位为操作码，其余为操作数：
+//   ABC:  op:8 A:8 B:8 C:8
+//   ABx:  op:8 A:8 Bx:16      Bx为无符号数
+//   AsBx: op:8 A:8 sBx:16     sBx为有符号数
+// 虚拟机是基于寄存器的，A、B、C为当前栈帧中的寄存器编号。
+// 寄存器中是不带类型标记的64位值，指令本身决定如何解释操作数：
+//   _I64为64位有符号整数，_U64为64位无符号整数，_F64为双精度浮点数，_STR为字符串，
+//   _BIG为大整数：最低位为1时是63位的小整数（值左移一位再加1），否则是堆上的BigData的地址。
+// 数组指令的数组操作数是堆上的ArrayData的地址，下标越界时抛出运行时错误。
+// 比int64窄的整数在寄存器中总是符号扩展(有符号)或零扩展(无符号)到64位，float32按双精度保存。
+#define LETT_OPCODES \
+        OPCODE(NOP, ABC)            /* 空指令 */                                  \
+        OPCODE(MOVE, ABC)           /* R[A] = R[B] */                            \
+        OPCODE(LOADI, AsBx)         /* R[A] = sBx */                             \
+        OPCODE(LOADK, ABx)          /* R[A] = K[Bx] */                           \
+        OPCODE(LOADS, ABx)          /* R[A] = 字符串表中偏移为K[Bx]的字符串 */      \
+        OPCODE(ADD_I64, ABC)        /* R[A] = R[B] + R[C] */                     \
+        OPCODE(SUB_I64, ABC)        /* R[A] = R[B] - R[C] */                     \
+        OPCODE(MUL_I64, ABC)        /* R[A] = R[B] * R[C] */                     \
+        OPCODE(DIV_I64, ABC)        /* R[A] = R[B] / R[C] */                     \
+        OPCODE(MOD_I64, ABC)        /* R[A] = R[B] % R[C] */                     \
+        OPCODE(DIV_U64, ABC)        /* R[A] = R[B] / R[C] */                     \
+        OPCODE(MOD_U64, ABC)        /* R[A] = R[B] % R[C] */                     \
+        OPCODE(ADDI_I64, ABC)       /* R[A] = R[B] + sC，sC为8位有符号数 */        \
+        OPCODE(NEG_I64, ABC)        /* R[A] = -R[B] */                           \
+        OPCODE(BAND, ABC)           /* R[A] = R[B] & R[C] */                     \
+        OPCODE(BOR, ABC)            /* R[A] = R[B] | R[C] */                     \
+        OPCODE(BXOR, ABC)           /* R[A] = R[B] ^ R[C] */                     \
+        OPCODE(BNOT, ABC)           /* R[A] = ~R[B] */                           \
+        OPCODE(SHL, ABC)            /* R[A] = R[B] << R[C] */                    \
+        OPCODE(SHR_I64, ABC)        /* R[A] = R[B] >> R[C]，算术右移 */            \
+        OPCODE(SHR_U64, ABC)        /* R[A] = R[B] >> R[C]，逻辑右移 */            \
+        OPCODE(TRUNC_I, ABC)        /* R[A] = R[B]的低C位符号扩展 */               \
+        OPCODE(TRUNC_U, ABC)        /* R[A] = R[B]的低C位零扩展 */                 \
+        OPCODE(ADD_F64, ABC)        /* R[A] = R[B] + R[C] */                     \
+        OPCODE(SUB_F64, ABC)        /* R[A] = R[B] - R[C] */                     \
+        OPCODE(MUL_F64, ABC)        /* R[A] = R[B] * R[C] */                     \
+        OPCODE(DIV_F64, ABC)        /* R[A] = R[B] / R[C] */                     \
+        OPCODE(NEG_F64, ABC)        /* R[A] = -R[B] */                           \
+        OPCODE(F64_TO_F32, ABC)     /* R[A] = 舍入到单精度的R[B] */                \
+        OPCODE(I64_TO_F64, ABC)     /* R[A] = double(int64 R[B]) */              \
+        OPCODE(U64_TO_F64, ABC)     /* R[A] = double(uint64 R[B]) */             \
+        OPCODE(F64_TO_I64, ABC)     /* R[A] = int64(R[B]) */                     \
+        OPCODE(F64_TO_U64, ABC)     /* R[A] = uint64(R[B]) */                    \
+        OPCODE(EQ, ABC)             /* R[A] = R[B] == R[C]，按位比较 */            \
+        OPCODE(NE, ABC)             /* R[A] = R[B] != R[C]，按位比较 */            \
+        OPCODE(LT_I64, ABC)         /* R[A] = R[B] < R[C] */                     \
+        OPCODE(LE_I64, ABC)         /* R[A] = R[B] <= R[C] */                    \
+        OPCODE(LT_U64, ABC)         /* R[A] = R[B] < R[C] */                     \
+        OPCODE(LE_U64, ABC)         /* R[A] = R[B] <= R[C] */                    \
+        OPCODE(EQ_F64, ABC)         /* R[A] = R[B] == R[C] */                    \
+        OPCODE(NE_F64, ABC)         /* R[A] = R[B] != R[C] */                    \
+        OPCODE(LT_F64, ABC)         /* R[A] = R[B] < R[C] */                     \
+        OPCODE(LE_F64, ABC)         /* R[A] = R[B] <= R[C] */                    \
+        OPCODE(EQ_STR, ABC)         /* R[A] = R[B] == R[C] */                    \
+        OPCODE(NE_STR, ABC)         /* R[A] = R[B] != R[C] */                    \
+        OPCODE(LT_STR, ABC)         /* R[A] = R[B] < R[C]，按字节比较 */           \
+        OPCODE(LE_STR, ABC)         /* R[A] = R[B] <= R[C] */                    \
+        OPCODE(NOT, ABC)            /* R[A] = !R[B] */                           \
+        OPCODE(CONCAT, ABC)         /* R[A] = R[B] + R[C]，字符串拼接 */           \
+        OPCODE(ADD_BIG, ABC)        /* R[A] = R[B] + R[C]，大整数 */              \
+        OPCODE(SUB_BIG, ABC)        /* R[A] = R[B] - R[C] */                     \
+        OPCODE(MUL_BIG, ABC)        /* R[A] = R[B] * R[C] */                     \
+        OPCODE(DIV_BIG, ABC)        /* R[A] = R[B] / R[C]，向零取整 */             \
+        OPCODE(MOD_BIG, ABC)        /* R[A] = R[B] % R[C]，与被除数同号 */          \
+        OPCODE(NEG_BIG, ABC)        /* R[A] = -R[B] */                           \
+        OPCODE(I64_TO_BIG, ABC)     /* R[A] = bigint(int64 R[B]) */              \
+        OPCODE(U64_TO_BIG, ABC)     /* R[A] = bigint(uint64 R[B]) */             \
+        OPCODE(BIG_TO_I64, ABC)     /* R[A] = R[B]的低64位（补码） */              \
+        OPCODE(EQ_BIG, ABC)         /* R[A] = R[B] == R[C] */                    \
+        OPCODE(NE_BIG, ABC)         /* R[A] = R[B] != R[C] */                    \
+        OPCODE(LT_BIG, ABC)         /* R[A] = R[B] < R[C] */                     \
+        OPCODE(LE_BIG, ABC)         /* R[A] = R[B] <= R[C] */                    \
+        OPCODE(NEWARR, ABC)         /* R[A] = 长度为R[B]、元素类型为C的数组，元素为0 */ \
+        OPCODE(LEN, ABC)            /* R[A] = 数组R[B]的长度 */                    \
+        OPCODE(GETARR, ABC)         /* R[A] = R[B][R[C]]，元素扩展到64位 */         \
+        OPCODE(SETARR, ABC)         /* R[A][R[B]] = R[C]，按元素类型截断 */          \
+        OPCODE(JMP, AsBx)           /* pc += sBx */                              \
+        OPCODE(JMPT, AsBx)          /* if (R[A]) pc += sBx */                    \
+        OPCODE(JMPF, AsBx)          /* if (!R[A]) pc += sBx */                   \
+        OPCODE(CALL, ABx)           /* R[A] = F[Bx](R[A], R[A+1], ...) */        \
+        OPCODE(TAILCALL, ABx)       /* return F[Bx](R[A], R[A+1], ...)，复用当前栈帧 */ \
+        OPCODE(NATIVE, ABx)         /* R[A] = 内置函数Bx(R[A], R[A+1], ...) */    \
+        OPCODE(SPAWN, ABx)          /* R[A] = 执行F[Bx](R[A], R[A+1], ...)的新纤程，立即切换到该纤程 */ \
+        OPCODE(SPAWN_STR, ABx)      /* 同SPAWN，纤程的返回值为字符串或大整数 */       \
+        OPCODE(AWAIT, ABC)          /* R[A] = 纤程R[B]的返回值，未完成时挂起当前纤程 */ \
+        OPCODE(RET, ABC)            /* return R[A] */                            \
+        OPCODE(RET0, ABC)           /* return */                                 \
+        LETT_SUPERINSTRUCTIONS
+
+// 超级指令：由链接时的窥孔优化把连续的几条指令融合而成，根据lett --pairs统计的指令对执行次数选择。
+// 融合只替换第一条指令的操作码，其后的指令保持不变并作为超级指令的操作数：
+// 跳转到序列中间的代码仍然执行原来的指令，所以融合不改变程序的行为，也不需要修改跳转的偏移。
+// 超级指令的格式为第一条指令的格式，注释中的I1、I2表示其后的第一、二条指令。
+#define LETT_SUPERINSTRUCTIONS \
+        OPCODE(EQ_JMPF, ABC)            /* EQ; JMPF，I1.A == A */                    \
+        OPCODE(NE_JMPF, ABC)            /* NE; JMPF，I1.A == A */                    \
+        OPCODE(LT_I64_JMPF, ABC)        /* LT_I64; JMPF，I1.A == A */                \
+        OPCODE(LE_I64_JMPF, ABC)        /* LE_I64; JMPF，I1.A == A */                \
+        OPCODE(LOADI_LT_I64_JMPF, AsBx) /* LOADI; LT_I64; JMPF，I1.C == A, I2.A == I1.A */ \
+        OPCODE(LOADI_LE_I64_JMPF, AsBx) /* LOADI; LE_I64; JMPF，I1.C == A, I2.A == I1.A */ \
+        OPCODE(ADDI_I64_JMP, ABC)       /* ADDI_I64; JMP */                          \
+        OPCODE(ADD_I64_RET, ABC)        /* ADD_I64; RET，I1.A == A */
+
+namespace Lett {
+
+    typedef dword Instruction;
+
+    enum class OpFormat {
+        ABC,
+        ABx,
+        AsBx
+    };
+
+    #define OPCODE(name, format) name,
+    enum class Opcode : byte {
+        LETT_OPCODES
+        COUNT
+    };
+    #undef OPCODE
+
+    // 数组的元素类型，NEWARR的C操作数
+    enum ElementType : byte {
+        ELEMENT_INT8,
+        ELEMENT_INT16,
+        ELEMENT_INT32,
+        ELEMENT_INT64,
+        ELEMENT_UINT8,
+        ELEMENT_UINT16,
+        ELEMENT_UINT32,
+        ELEMENT_UINT64,
+        ELEMENT_FLOAT32,
+        ELEMENT_FLOAT64,
+        ELEMENT_COUNT
+    };
+
+    const char *getOpcodeName(Opcode op);
+    OpFormat getOpFormat(Opcode op);
+    // 指令占用的字数，超级指令包括作为其操作数的指令
+    unsigned getOpLength(Opcode op);
+
+    // 指令的编码与解码。跳转的偏移相对于下一条指令
+    inline Instruction encodeABC(Opcode op, unsigned a, unsigned b, unsigned c) {
+        return static_cast<Instruction>(op) | (a << 8) | (b << 16) | (c << 24);
+    }
+    inline Instruction encodeABx(Opcode op, unsigned a, unsigned bx) {
+        return static_cast<Instruction>(op) | (a << 8) | (bx << 16);
+    }
+    inline Instruction encodeAsBx(Opcode op, unsigned a, int sbx) {
+        return encodeABx(op, a, static_cast<std::uint16_t>(sbx));
+    }
+    inline Opcode opOf(Instruction i)   { return static_cast<Opcode>(i & 0xFF); }
+    inline unsigned argA(Instruction i) { return (i >> 8) & 0xFF; }
+    inline unsigned argB(Instruction i) { return (i >> 16) & 0xFF; }
+    inline unsigned argC(Instruction i) { return i >> 24; }
+    inline int argSC(Instruction i)     { return static_cast<std::int8_t>(i >> 24); }
+    inline unsigned argBx(Instruction i) { return i >> 16; }
+    inline int argSBx(Instruction i)    { return static_cast<std::int16_t>(i >> 16); }
+
+    constexpr unsigned MAX_REGISTERS = 256;
+    constexpr int MAX_JUMP = 32767;
+
+    /*
+     * 字节码文件(.ltc)的格式
+     *
+     * 文件由固定大小的文件头和六个区组成，每个区的起始位置都按8字节对齐，
+     * 虚拟机将文件映射(mmap)到内存后直接在映射的内存上执行，不需要反序列化：
+     *   - 函数表：FunctionEntry数组
+     *   - 指令区：Instruction数组
+     *   - 常量池：64位常量数组，整数、浮点数以及字符串在字符串表中的偏移
+     *   - 栈映射：各函数的栈映射（见stackMapWords），垃圾回收据此找到栈帧中的对象
+     *   - 行号表：LineEntry数组，各函数的指令对应的源代码行号
+     *   - 字符串表：StringData依次排列，每项按8字节对齐，可以直接作为运行时的字符串对象使用
+     * 所有多字节数据都使用本机字节序，文件头中的字节序标记不符时拒绝加载。
+     */
+    constexpr char LTC_MAGIC[4] = {'L', 'T', 'C', '\0'};
+    constexpr word LTC_VERSION_MAJOR = 8;     // 格式不兼容时增加
+    constexpr word LTC_VERSION_MINOR = 1;     // 兼容的扩展时增加
+    constexpr dword LTC_BYTE_ORDER = 0x01020304;
+
+    struct ImageHeader {
+        char magic[4];
+        word version_major;
+        word version_minor;
+        dword byte_order;
+        dword header_size;
+        dword file_size;
+        dword entry;                // main函数在函数表中的下标
+        dword function_count;
+        dword functions_offset;
+        dword code_count;           // 指令条数
+        dword code_offset;
+        dword constant_count;
+        dword constants_offset;
+        dword strings_size;
+        dword strings_offset;
+        dword stack_maps_size;      // 栈映射区的qword个数
+        dword stack_maps_offset;
+        dword line_count;           // 行号表的项数
+        dword lines_offset;
+    };
+    static_assert(sizeof(ImageHeader) == 72, "unexpected ImageHeader size");
+
+    struct FunctionEntry {
+        dword name;                 // 函数名在字符串表中的偏移
+        dword code;                 // 第一条指令在指令区中的下标
+        dword code_size;            // 指令条数
+        word param_count;           // 参数占用的寄存器个数
+        word register_count;        // 栈帧需要的寄存器个数
+        dword stack_maps;           // 第一项栈映射在栈映射区中的下标(qword)
+        dword stack_map_count;      // 栈映射的项数
+        dword lines;                // 第一项行号在行号表中的下标
+        dword line_count;           // 行号的项数
+    };
+    static_assert(sizeof(FunctionEntry) == 32, "unexpected FunctionEntry size");
+
+    // 行号表的一项：从函数的第pc条指令开始（直到下一项）对应源代码的第line行。每个函数的项按pc严格递增
+    struct LineEntry {
+        dword pc;
+        dword line;
+    };
+    static_assert(sizeof(LineEntry) == 8, "unexpected LineEntry size");
+
+    // 栈映射：函数在可能进行垃圾回收的指令（CONCAT、NEWARR、可能分配大整数的ADD_BIG等，被调用者可能分配对象的CALL，
+    // 以及切换纤程的SPAWN、AWAIT和NATIVE）处，哪些寄存器保存堆上的对象。
+    // 每一项为指令在函数中的下标，其后是register_count位的位图，按指令的下标排序；没有对象的位置不生成栈映射。
+    // 返回每一项占用的qword个数
+    inline std::size_t stackMapWords(unsigned register_count) { return 1 + (register_count + 63) / 64; }
+
+    // 字符串：长度、哈希值之后紧跟以'\0'结尾的字符
+    struct StringData {
+        dword length;
+        dword hash;
+
+        const char *chars() const { return reinterpret_cast<const char *>(this + 1); }
+        // 包括'\0'以及对齐填充在内占用的字节数
+        static std::size_t sizeFor(std::size_t length) {
+            return (sizeof(StringData) + length + 1 + 7) & ~static_cast<std::size_t>(7);
+        }
+        static dword hashOf(const char *chars, std::size_t length) {
+            // FNV-1a
+            dword h = 2166136261u;
+            for (std::size_t i = 0; i < length; ++i) {
+                h ^= static_cast<unsigned char>(chars[i]);
+                h *= 16777619u;
+            }
+            return h;
+        }
+    };
+
+    /*
+     * 快照：lett --snapshot加载并校验字节码文件后写出，lett --from-snapshot映射后直接执行
+     *
+     * 快照由快照头、校验过的字节码文件以及字符串表的索引（每8字节是否为一项的开始，按位保存）组成，
+     * 各部分按8字节对齐。快照头中是以生成快照的用户的密钥计算的消息认证码，没有密钥无法伪造快照。
+     * 加载时检查快照头、认证码和字节码文件的结构，不再检查字符串的哈希值和唯一性，也不再校验指令。
+     * 字节码文件中只有偏移没有指针，映射到任何地址都不需要重定位。
+     * 版本号与字节码文件相同，快照只在生成它的lett的版本之间使用。
+     */
+    constexpr char LTS_MAGIC[4] = {'L', 'T', 'S', '\0'};
+
+    struct SnapshotHeader {
+        char magic[4];
+        word version_major;         // 字节码文件的版本
+        word version_minor;
+        dword byte_order;
+        dword header_size;
+        qword file_size;
+        qword mac;                  // 快照头之后所有数据的消息认证码，见snapshotMac
+        dword image_offset;
+        dword image_size;
+        dword index_offset;         // 字符串表的索引
+        dword index_size;           // 索引的qword个数
+    };
+    static_assert(sizeof(SnapshotHeader) == 48, "unexpected SnapshotHeader size");
+
+    // 快照的128位密钥
+    struct SnapshotKey {
+        qword k0;
+        qword k1;
+    };
+
+    // 以key计算count个qword的SipHash-2-4，作为快照的消息认证码。计算的开销远小于重新校验
+    qword snapshotMac(const SnapshotKey &key, const qword *data, std::size_t count);
+
+}   // namespace Lett
+
+#endif // __LETT_BYTECODE_H__
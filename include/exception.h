@@ -1,5 +1,6 @@
 #ifndef __LETT_EXCEPTION_H__
 #define __LETT_EXCEPTION_H__
+#include <cstddef>
 #include <exception>
 #include <string>
 
@@ -34,6 +35,40 @@ namespace Lett {
         InvalidOption(const std::string &option_name, const std::string &msg);
     };
 
+    // 语法错误类，记录出错的行列号
+    class SyntaxError : public LettException {
+    private:
+        std::size_t _line;
+        std::size_t _column;
+    public:
+        SyntaxError(std::size_t line, std::size_t column, const std::string &msg);
+        std::size_t line() const { return _line; }
+        std::size_t column() const { return _column; }
+    };
+
+    // 语义错误类，如未定义的名字、重复定义、类型不匹配等
+    class SemanticError : public LettException {
+    private:
+        std::size_t _line;
+        std::size_t _column;
+    public:
+        SemanticError(std::size_t line, std::size_t column, const std::string &msg);
+        std::size_t line() const { return _line; }
+        std::size_t column() const { return _column; }
+    };
+
+    // 字节码文件格式错误，如魔数、版本不符或数据越界
+    class InvalidImage : public LettException {
+    public:
+        InvalidImage(const std::string &fileName, const std::string &msg);
+    };
+
+    // 运行时错误，如整数除以零、栈溢出
+    class RuntimeError : public LettException {
+    public:
+        RuntimeError(const std::string &msg);
+    };
+
 }   // namespace Lett
 
 #endif // __LETT_EXCEPTION_H__
\ No newline at end of file
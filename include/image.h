@@ -0,0 +1,117 @@
+#ifndef __LETT_IMAGE_H__
+#define __LETT_IMAGE_H__
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "bytecode.h"
+
+namespace Lett {
+
+    // 生成字节码文件：依次添加函数、常量和字符串，最后按文件格式排列
+    class ImageBuilder {
+    private:
+        std::vector<FunctionEntry> _functions;
+        std::vector<Instruction> _code;
+        std::vector<qword> _constants;
+        std::vector<qword> _stack_maps;
+        std::vector<LineEntry> _lines;
+        std::string _strings;
+        std::unordered_map<std::string, dword> _string_offsets;     // 相同的字符串只保存一份
+        std::unordered_map<qword, dword> _constant_index;
+        dword _entry;
+    public:
+        ImageBuilder();
+
+        // 返回字符串在字符串表中的偏移
+        dword addString(std::string_view value);
+        // 返回常量在常量池中的下标
+        dword addConstant(qword value);
+        dword addStringConstant(std::string_view value) { return addConstant(addString(value)); }
+        // 返回函数在函数表中的下标。stack_maps为函数的栈映射，每项stackMapWords(register_count)个qword
+        dword addFunction(std::string_view name, word param_count, word register_count,
+                          const std::vector<Instruction> &code, const std::vector<qword> &stack_maps = {},
+                          const std::vector<LineEntry> &lines = {});
+        void setEntry(dword function) { _entry = function; }
+
+        std::size_t constantCount() const { return _constants.size(); }
+        std::string build() const;
+    };  // class ImageBuilder
+
+    // 加载后的字节码文件
+    // 从文件加载时使用只读的内存映射，指令、常量和字符串都直接指向映射的内存
+    class Image {
+    private:
+        std::string _name;
+        const byte *_data;
+        std::size_t _size;
+        void *_mapping;                 // mmap得到的地址，从内存加载时为空
+        std::size_t _mapping_size;      // 映射的大小，加载快照时大于字节码文件
+        std::vector<qword> _buffer;     // 从内存加载时持有数据，保证8字节对齐
+        std::vector<qword> _string_index;   // 字符串表的索引：每个8字节是否为一项的起始位置，按位保存
+
+        void _map(const std::string &path);
+        void _validate(bool verified = false);
+        void _unload();
+        [[noreturn]] void _fail(const std::string &msg) const;
+    public:
+        Image();
+        ~Image();
+        Image(const Image&) = delete;
+        Image& operator=(const Image&) = delete;
+
+        // 加载时检查文件结构并校验字节码（见verifier.h），失败时抛出FileNotExsit或InvalidImage
+        void load(const std::string &path);
+        void loadFromMemory(std::string_view data, const std::string &name = "<memory>");
+        // 加载snapshot以同一密钥生成的快照（见bytecode.h），检查认证码和文件结构，不再校验字节码
+        void loadSnapshot(const std::string &path, const SnapshotKey &key);
+        // 已加载的字节码文件的快照，以key计算认证码
+        std::string snapshot(const SnapshotKey &key) const;
+
+        const std::string &name() const { return _name; }
+        std::size_t size() const { return _size; }
+        bool mapped() const { return _mapping != nullptr; }
+        const ImageHeader &header() const { return *reinterpret_cast<const ImageHeader *>(_data); }
+
+        dword functionCount() const { return header().function_count; }
+        const FunctionEntry &function(dword index) const {
+            return reinterpret_cast<const FunctionEntry *>(_data + header().functions_offset)[index];
+        }
+        const FunctionEntry &entry() const { return function(header().entry); }
+        const Instruction *code() const { return reinterpret_cast<const Instruction *>(_data + header().code_offset); }
+        const qword *constants() const { return reinterpret_cast<const qword *>(_data + header().constants_offset); }
+        const StringData *string(dword offset) const {
+            return reinterpret_cast<const StringData *>(_data + header().strings_offset + offset);
+        }
+        // 偏移是否为字符串表中一项的起始位置
+        bool isString(qword offset) const {
+            return offset % 8 == 0 && offset < header().strings_size && (_string_index[offset / 512] >> (offset / 8 % 64) & 1) != 0;
+        }
+        std::string_view stringView(dword offset) const {
+            const StringData *s = string(offset);
+            return std::string_view(s->chars(), s->length);
+        }
+        // 函数第pc条指令处的栈映射位图，没有时返回nullptr
+        const qword *stackMap(const FunctionEntry &fn, dword pc) const;
+        // 函数第pc条指令对应的源代码行号，没有行号表时返回0
+        dword line(const FunctionEntry &fn, dword pc) const;
+        // 地址是否在字节码文件中，如字符串表中的字符串
+        bool contains(const void *p) const {
+            const byte *b = static_cast<const byte *>(p);
+            return b >= _data && b < _data + _size;
+        }
+    };  // class Image
+
+    // 以文本形式打印字节码，用于调试和测试
+    void disassemble(const Image &image, std::ostream &os);
+
+    // 读取快照的密钥文件（16字节）。文件不存在且create为真时生成随机密钥，创建只有所有者可以读写的文件。
+    // 无法读取或创建时抛出RuntimeError
+    SnapshotKey readSnapshotKey(const std::string &path, bool create);
+
+}   // namespace Lett
+
+#endif // __LETT_IMAGE_H__
@@ -0,0 +1,98 @@
+#ifndef __LETT_NATIVES_H__
+#define __LETT_NATIVES_H__
+
+#include <cstdint>
+#include <string_view>
+
+// 虚拟机提供的内置函数：编号、模块名、函数名、参数个数、返回值类型、第一个参数的类型、其余参数的类型
+// 编译器据此解析sys.println之类的成员访问，虚拟机据此分派调用，两者必须使用同一份列表。
+// sleep、read和write是阻塞的I/O，在纤程中调用时只挂起当前纤程。
+// print和println写入解释器的输出缓冲区，flush立即写出缓冲区
+// array模块的函数对所有数组类型通用，第一个参数为数组，由向量化的内核执行（见docs/syntax/data_type.md）
+#define LETT_NATIVES \
+        NATIVE_MEMBER(SYS_PRINT, sys, print, 1, VOID, ANY, VOID)            \
+        NATIVE_MEMBER(SYS_PRINTLN, sys, println, 1, VOID, ANY, VOID)        \
+        NATIVE_MEMBER(SYS_SLEEP, sys, sleep, 1, VOID, INT, VOID)            \
+        NATIVE_MEMBER(SYS_READ, sys, read, 1, STRING, STRING, VOID)         \
+        NATIVE_MEMBER(SYS_WRITE, sys, write, 2, VOID, STRING, STRING)       \
+        NATIVE_MEMBER(SYS_FLUSH, sys, flush, 0, VOID, VOID, VOID)           \
+        NATIVE_MEMBER(ARRAY_LENGTH, array, length, 1, INT, ARRAY, VOID)     \
+        NATIVE_MEMBER(ARRAY_SUM, array, sum, 1, WIDE, ARRAY, VOID)          \
+        NATIVE_MEMBER(ARRAY_MIN, array, min, 1, ELEMENT, ARRAY, VOID)       \
+        NATIVE_MEMBER(ARRAY_MAX, array, max, 1, ELEMENT, ARRAY, VOID)       \
+        NATIVE_MEMBER(ARRAY_DOT, array, dot, 2, WIDE, ARRAY, ARRAY)         \
+        NATIVE_MEMBER(ARRAY_ADD, array, add, 2, ARRAY, ARRAY, ARRAY)        \
+        NATIVE_MEMBER(ARRAY_MUL, array, mul, 2, ARRAY, ARRAY, ARRAY)        \
+        NATIVE_MEMBER(ARRAY_SCALE, array, scale, 2, ARRAY, ARRAY, ELEMENT)  \
+        NATIVE_MEMBER(ARRAY_OFFSET, array, offset, 2, ARRAY, ARRAY, ELEMENT) \
+        NATIVE_MEMBER(ARRAY_SORT, array, sort, 1, VOID, ARRAY, VOID)
+
+namespace Lett {
+
+    #define NATIVE_MEMBER(id, m, f, n, r, p, q) NATIVE_##id,
+    enum NativeId : std::uint32_t {
+        LETT_NATIVES
+        NATIVE_COUNT
+    };
+    #undef NATIVE_MEMBER
+
+    // 内置函数的返回值和参数的类型，ANY为任意可打印的值。
+    // ARRAY为任意的数组，同一次调用中的数组类型相同；ELEMENT为数组的元素类型；
+    // WIDE为元素类型拓宽后的类型：有符号整数为int，无符号整数为uint，浮点数为float64
+    enum NativeType : std::uint32_t {
+        NATIVE_VOID,
+        NATIVE_ANY,
+        NATIVE_INT,
+        NATIVE_STRING,
+        NATIVE_ARRAY,
+        NATIVE_ELEMENT,
+        NATIVE_WIDE
+    };
+
+    struct NativeInfo {
+        const char *module;
+        const char *name;
+        std::uint32_t arity;
+        NativeType ret;
+        NativeType param;       // 第一个参数的类型
+        NativeType rest;        // 其余参数的类型
+
+        NativeType paramType(std::uint32_t i) const { return i == 0 ? param : rest; }
+    };
+
+    #define NATIVE_MEMBER(id, m, f, n, r, p, q) NativeInfo{#m, #f, n, NATIVE_##r, NATIVE_##p, NATIVE_##q},
+    inline const NativeInfo &nativeInfo(NativeId id) {
+        static const NativeInfo natives[] = {
+            LETT_NATIVES
+        };
+        return natives[id];
+    }
+    #undef NATIVE_MEMBER
+
+    // 内置函数参数的类型标记，调用时紧跟在每个参数值之后的寄存器中
+    enum NativeTag : std::uint32_t {
+        TAG_BOOL,
+        TAG_CHAR,
+        TAG_INT,        // 有符号整数，已符号扩展到64位
+        TAG_UINT,       // 无符号整数，已零扩展到64位
+        TAG_FLOAT32,
+        TAG_FLOAT64,
+        TAG_STRING,
+        TAG_BIGINT,     // 大整数，小整数或堆上的BigData
+        TAG_ARRAY       // 堆上的ArrayData
+    };
+
+    // 查找内置函数，未找到返回NATIVE_COUNT
+    inline NativeId findNative(std::string_view module, std::string_view name) {
+        for (std::uint32_t i = 0; i < NATIVE_COUNT; ++i) {
+            const NativeInfo &info = nativeInfo(static_cast<NativeId>(i));
+            if (module == info.module && name == info.name) {
+                return static_cast<NativeId>(i);
+            }
+        }
+        return NATIVE_COUNT;
+    }
+
+}   // namespace Lett
+
+#endif // __LETT_NATIVES_H__
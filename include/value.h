@@ -0,0 +1,72 @@
+#ifndef __LETT_VALUE_H__
+#define __LETT_VALUE_H__
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "types.h"
+#include "bytecode.h"
+
+namespace Lett {
+
+    // 虚拟机的值：寄存器、栈和常量表中的一个64位字
+    // Lett是静态类型的语言，值的类型由使用它的指令决定（如ADD_I64与ADD_F64），值本身不带类型标记：
+    //   - 整数、bool、char：64位整数，比int64窄的整数符号扩展或零扩展，qword的整个范围都可以表示
+    //   - float、float32：double的位模式，float32舍入到单精度后按double保存
+    //   - 字符串等堆上的对象：对象的地址
+    //   - bigint：在63位之内时为小整数，值左移一位再加1，最低位总是1；否则为堆上的BigData的地址，最低位总是0
+    // 所有的值都直接保存在寄存器中，不需要在堆上分配，寄存器数组中每个值正好占8字节。
+    // NaN-boxing或指针标记需要占用值中的若干位作为类型标记，整数就不能是完整的64位。
+    class Value {
+    private:
+        qword _bits;
+
+        explicit constexpr Value(qword bits) : _bits(bits) {}
+    public:
+        // 小整数的范围
+        static constexpr std::int64_t SMALL_MIN = -(static_cast<std::int64_t>(1) << 62);
+        static constexpr std::int64_t SMALL_MAX = (static_cast<std::int64_t>(1) << 62) - 1;
+
+        Value() = default;
+
+        static constexpr Value fromBits(qword bits) { return Value(bits); }
+        static constexpr Value fromInt(std::int64_t value) { return Value(static_cast<qword>(value)); }
+        static constexpr Value fromUint(qword value) { return Value(value); }
+        static constexpr Value fromBool(bool value) { return Value(value ? 1 : 0); }
+        static Value fromFloat(double value) {
+            qword bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return Value(bits);
+        }
+        static Value fromString(const StringData *value) {
+            return Value(static_cast<qword>(reinterpret_cast<std::uintptr_t>(value)));
+        }
+        // value在SMALL_MIN到SMALL_MAX之间
+        static constexpr Value fromSmall(std::int64_t value) { return Value(static_cast<qword>(value) << 1 | 1); }
+        static constexpr bool fitsSmall(std::int64_t value) { return value >= SMALL_MIN && value <= SMALL_MAX; }
+
+        constexpr qword bits() const { return _bits; }
+        constexpr std::int64_t asInt() const { return static_cast<std::int64_t>(_bits); }
+        constexpr qword asUint() const { return _bits; }
+        constexpr bool asBool() const { return _bits != 0; }
+        double asFloat() const {
+            double value;
+            std::memcpy(&value, &_bits, sizeof(value));
+            return value;
+        }
+        const StringData *asString() const {
+            return reinterpret_cast<const StringData *>(static_cast<std::uintptr_t>(_bits));
+        }
+        constexpr bool isSmall() const { return (_bits & 1) != 0; }
+        constexpr std::int64_t asSmall() const { return static_cast<std::int64_t>(_bits) >> 1; }
+
+        constexpr bool operator==(Value other) const { return _bits == other._bits; }
+        constexpr bool operator!=(Value other) const { return _bits != other._bits; }
+    };  // class Value
+
+    static_assert(sizeof(Value) == sizeof(qword), "Value must be a single 64-bit word");
+    static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable");
+
+}   // namespace Lett
+
+#endif // __LETT_VALUE_H__
@@ -0,0 +1,29 @@
+#ifndef __LETT_VERIFIER_H__
+#define __LETT_VERIFIER_H__
+
+#include "image.h"
+
+namespace Lett {
+
+    // 字节码校验：加载时对每个函数检查一次，通过后解释器不再逐条检查指令。
+    //   - 操作码有效，超级指令之后是它融合的指令
+    //   - 寄存器编号在栈帧内，调用的参数窗口不超出栈帧
+    //   - 跳转目标在函数内，除跳转和返回外的指令不会执行到函数末尾之后
+    //   - 常量池下标、函数下标、内置函数编号有效，LOADS的常量是字符串表中的字符串
+    //   - 截断的位数在1到63之间，NEWARR的元素类型有效
+    //   - 栈映射只在可能进行垃圾回收的指令处
+    // 之后在控制流上推导每个寄存器保存的是字符串、大整数、数组、纤程还是其他值，检查：
+    //   - 字符串指令的操作数、字符串参数是字符串，_BIG指令的操作数是大整数，数组指令和array模块的数组参数是数组，
+    //     算术、比较和条件跳转的操作数不是引用
+    //   - 只有SPAWN_STR创建的纤程的结果是引用，SPAWN_STR的函数返回字符串、大整数或数组
+    //   - 栈映射标记的寄存器都是引用，CONCAT和分配大整数的指令的操作数在栈映射中
+    //   - print、println的参数为字符串、大整数时类型标记为TAG_STRING、TAG_BIGINT，
+    //     否则参数不是引用，类型标记为已知的常量且不是引用的标记
+    // 函数参数和返回值的类型在所有调用之间合并，直到不再变化。
+    // 除以零、数组下标越界、栈溢出以及AWAIT的纤程编号（可能来自整数运算）仍然在执行时检查。
+    // 校验失败时抛出InvalidImage
+    void verify(const Image &image);
+
+}   // namespace Lett
+
+#endif // __LETT_VERIFIER_H__
@@ -0,0 +1,99 @@
+#include "binary.h"
+#include "bytecode_module.h"
+
+namespace Lett {
+
+    namespace {
+        // 魔数之后是字节码文件的主版本号。指令或内置函数的编号变化时主版本号随之增加，旧的缓存不再被读取
+        const char BYTECODE_MAGIC[4] = {'L', 'T', 'B', '\0'};
+    }   // namespace
+
+    std::string BytecodeModule::serialize() const {
+        std::string out(BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+        put32(out, LTC_VERSION_MAJOR);
+        put32(out, static_cast<std::uint32_t>(functions.size()));
+        for (const FunctionCode &fn : functions) {
+            putString(out, fn.name);
+            put32(out, fn.param_count);
+            put32(out, fn.register_count);
+            put32(out, static_cast<std::uint32_t>(fn.code.size()));
+            for (Instruction ins : fn.code) {
+                put32(out, ins);
+            }
+            put32(out, static_cast<std::uint32_t>(fn.stack_maps.size()));
+            for (qword word : fn.stack_maps) {
+                put64(out, word);
+            }
+            put32(out, static_cast<std::uint32_t>(fn.lines.size()));
+            for (const LineEntry &line : fn.lines) {
+                put32(out, line.pc);
+                put32(out, line.line);
+            }
+        }
+        put32(out, static_cast<std::uint32_t>(constants.size()));
+        for (qword value : constants) {
+            put64(out, value);
+        }
+        put32(out, static_cast<std::uint32_t>(strings.size()));
+        for (const std::string &value : strings) {
+            putString(out, value);
+        }
+        put32(out, static_cast<std::uint32_t>(calls.size()));
+        for (const CallTarget &call : calls) {
+            put32(out, call.module);
+            put32(out, call.function);
+            put32(out, call.arity);
+        }
+        return out;
+    }
+
+    bool BytecodeModule::deserialize(std::string_view data, BytecodeModule &out) {
+        if (data.size() < sizeof(BYTECODE_MAGIC)
+            || data.compare(0, sizeof(BYTECODE_MAGIC), std::string_view(BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC))) != 0) {
+            return false;
+        }
+        InputBuffer in(data.substr(sizeof(BYTECODE_MAGIC)));
+        if (in.get32() != LTC_VERSION_MAJOR || in.failed()) {
+            return false;
+        }
+        BytecodeModule result;
+        std::uint32_t function_count = in.getCount();
+        for (std::uint32_t i = 0; i < function_count && !in.failed(); ++i) {
+            FunctionCode fn{in.getString(), in.get32(), in.get32(), {}, {}, {}};
+            std::uint32_t size = in.getCount();
+            for (std::uint32_t j = 0; j < size && !in.failed(); ++j) {
+                fn.code.push_back(in.get32());
+            }
+            std::uint32_t words = in.getCount();
+            for (std::uint32_t j = 0; j < words && !in.failed(); ++j) {
+                fn.stack_maps.push_back(in.get64());
+            }
+            std::uint32_t lines = in.getCount();
+            for (std::uint32_t j = 0; j < lines && !in.failed(); ++j) {
+                dword pc = in.get32();
+                fn.lines.push_back(LineEntry{pc, in.get32()});
+            }
+            result.functions.push_back(std::move(fn));
+        }
+        std::uint32_t constant_count = in.getCount();
+        for (std::uint32_t i = 0; i < constant_count && !in.failed(); ++i) {
+            result.constants.push_back(in.get64());
+        }
+        std::uint32_t string_count = in.getCount();
+        for (std::uint32_t i = 0; i < string_count && !in.failed(); ++i) {
+            result.strings.push_back(in.getString());
+        }
+        std::uint32_t call_count = in.getCount();
+        for (std::uint32_t i = 0; i < call_count && !in.failed(); ++i) {
+            std::uint32_t module = in.get32();
+            std::uint32_t function = in.get32();
+            result.calls.push_back(CallTarget{module, function, in.get32()});
+        }
+        if (in.failed() || !in.atEnd()) {
+            return false;
+        }
+        out = std::move(result);
+        return true;
+    }
+
+}   // namespace Lett.
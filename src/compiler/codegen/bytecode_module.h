@@ -0,0 +1,44 @@
+#ifndef __LETT_CODEGEN_BYTECODE_MODULE_H__
+#define __LETT_CODEGEN_BYTECODE_MODULE_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bytecode.h"
+
+namespace Lett {
+
+    struct FunctionCode {
+        std::string name;
+        std::uint32_t param_count;
+        std::uint32_t register_count;
+        std::vector<Instruction> code;
+        std::vector<qword> stack_maps;      // 栈映射，格式与字节码文件相同（见stackMapWords）
+        std::vector<LineEntry> lines;       // 行号表
+    };
+
+    // CALL指令调用的函数
+    struct CallTarget {
+        std::uint32_t module;       // 0为本模块，i+1为第i条import导入的模块
+        std::uint32_t function;     // 函数在所在模块中的下标
+        std::uint32_t arity;        // 参数个数，即调用指令从A开始使用的寄存器数
+    };
+
+    // 一个模块的字节码，链接前的形式
+    // 指令中的常量、字符串和被调用函数都是模块内的编号，链接时改写为字节码文件中的编号：
+    //   LOADK Bx为constants的下标，LOADS Bx为strings的下标，CALL、TAILCALL、SPAWN与SPAWN_STR的Bx为calls的下标
+    // 不依赖语法树，可以与模块接口一起缓存
+    struct BytecodeModule {
+        std::vector<FunctionCode> functions;
+        std::vector<qword> constants;
+        std::vector<std::string> strings;
+        std::vector<CallTarget> calls;
+
+        std::string serialize() const;
+        static bool deserialize(std::string_view data, BytecodeModule &out);
+    };
+
+}   // namespace Lett.
+
+#endif // __LETT_CODEGEN_BYTECODE_MODULE_H__
@@ -0,0 +1,955 @@
+#include <algorithm>
+#include <cstring>
+#include "natives.h"
+#include "code_generator.h"
+
+namespace Lett {
+
+    namespace {
+        constexpr std::uint32_t MAX_OPERAND = 0xFFFF;   // Bx能表示的最大编号
+
+        bool isUnsigned(TypeId type) {
+            return type == TYPE_CHAR || (TypeTable::isInteger(type) && !TypeTable::isSigned(type));
+        }
+
+        // from类型的所有值都能用to类型表示，寄存器中的值不需要截断
+        bool fitsIn(TypeId from, TypeId to) {
+            unsigned wf = TypeTable::width(from), wt = TypeTable::width(to);
+            bool sf = TypeTable::isSigned(from), st = TypeTable::isSigned(to);
+            if (sf == st) {
+                return wf <= wt;
+            }
+            return !sf && wf < wt;
+        }
+
+        bool isLocal(const Expr *expr) {
+            if (expr->kind != ExprKind::NAME) {
+                return false;
+            }
+            SymbolKind binding = expr->as<NameExpr>()->binding;
+            return binding == SymbolKind::VARIABLE || binding == SymbolKind::PARAM;
+        }
+
+        // 表达式求值是否可能修改局部变量
+        bool hasSideEffects(const Expr *expr) {
+            switch (expr->kind) {
+                case ExprKind::LITERAL:
+                case ExprKind::NAME:
+                case ExprKind::MEMBER:
+                    return false;
+                case ExprKind::UNARY:
+                    return hasSideEffects(expr->as<UnaryExpr>()->operand);
+                case ExprKind::BINARY:
+                    return hasSideEffects(expr->as<BinaryExpr>()->left) || hasSideEffects(expr->as<BinaryExpr>()->right);
+                case ExprKind::CAST:
+                    return hasSideEffects(expr->as<CastExpr>()->operand);
+                case ExprKind::INDEX:
+                    return hasSideEffects(expr->as<IndexExpr>()->array) || hasSideEffects(expr->as<IndexExpr>()->index);
+                case ExprKind::NEW_ARRAY:
+                    return hasSideEffects(expr->as<NewArrayExpr>()->length);
+                case ExprKind::ASSIGN:
+                case ExprKind::INC_DEC:
+                case ExprKind::CALL:
+                case ExprKind::SPAWN:
+                case ExprKind::AWAIT:
+                    return true;
+            }
+            return true;
+        }
+
+        // 复合赋值对应的二元运算
+        TokenType binaryOf(TokenType op) {
+            switch (op) {
+                case TokenType::OP_ADD_ASSIGN:      return TokenType::OP_ADD;
+                case TokenType::OP_SUB_ASSIGN:      return TokenType::OP_SUB;
+                case TokenType::OP_MUL_ASSIGN:      return TokenType::OP_MUL;
+                case TokenType::OP_DIV_ASSIGN:      return TokenType::OP_DIV;
+                case TokenType::OP_MOD_ASSIGN:      return TokenType::OP_MOD;
+                case TokenType::OP_BIT_AND_ASSIGN:  return TokenType::OP_BIT_AND;
+                case TokenType::OP_BIT_OR_ASSIGN:   return TokenType::OP_BIT_OR;
+                default:                            return op;
+            }
+        }
+
+        NativeTag tagOf(TypeId type) {
+            if (TypeTable::isArray(type)) {
+                return TAG_ARRAY;
+            }
+            switch (type) {
+                case TYPE_BOOL:     return TAG_BOOL;
+                case TYPE_CHAR:     return TAG_CHAR;
+                case TYPE_FLOAT32:  return TAG_FLOAT32;
+                case TYPE_FLOAT64:  return TAG_FLOAT64;
+                case TYPE_STRING:   return TAG_STRING;
+                case TYPE_BIGINT:   return TAG_BIGINT;
+                default:            return TypeTable::isSigned(type) ? TAG_INT : TAG_UINT;
+            }
+        }
+
+        // 值在堆上分配的类型，保存它们的寄存器记录在栈映射中
+        bool isReference(TypeId type) {
+            return type == TYPE_STRING || type == TYPE_BIGINT || TypeTable::isArray(type);
+        }
+
+        // 数组元素的存储类型，int与int64相同
+        ElementType elementOf(TypeId array) {
+            switch (TypeTable::element(array)) {
+                case TYPE_INT8:     return ELEMENT_INT8;
+                case TYPE_INT16:    return ELEMENT_INT16;
+                case TYPE_INT32:    return ELEMENT_INT32;
+                case TYPE_UINT8:    return ELEMENT_UINT8;
+                case TYPE_UINT16:   return ELEMENT_UINT16;
+                case TYPE_UINT32:   return ELEMENT_UINT32;
+                case TYPE_UINT64:   return ELEMENT_UINT64;
+                case TYPE_FLOAT32:  return ELEMENT_FLOAT32;
+                case TYPE_FLOAT64:  return ELEMENT_FLOAT64;
+                default:            return ELEMENT_INT64;
+            }
+        }
+
+        qword bitsOf(double value) {
+            qword bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+    }   // namespace
+
+    CodeGenerator::CodeGenerator()
+        : _out(nullptr), _fn(nullptr), _decl(nullptr), _locals(0), _top(0), _overflow(false), _loops(),
+          _line(0), _refs(), _safepoints(), _constants(), _strings(), _calls(), _errors() {
+    }
+
+    void CodeGenerator::_error(const Node &node, const std::string &msg) {
+        _errors.emplace_back(node.line, node.column, msg);
+    }
+
+    bool CodeGenerator::generate(const Module &module, BytecodeModule &out) {
+        _errors.clear();
+        _constants.clear();
+        _strings.clear();
+        _calls.clear();
+        out = BytecodeModule();
+        _out = &out;
+        for (const FunctionDecl *fn : module.functions) {
+            _function(*fn);
+        }
+        _out = nullptr;
+        _fn = nullptr;
+        _decl = nullptr;
+        return _errors.empty();
+    }
+
+    /*
+     * 常量、字符串及被调用函数的编号，相同的值只保存一份
+     */
+    std::uint32_t CodeGenerator::_constant(const Node &node, qword value) {
+        auto it = _constants.find(value);
+        if (it != _constants.end()) {
+            return it->second;
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(_out->constants.size());
+        if (index > MAX_OPERAND) {
+            _error(node, "too many constants in module");
+            return 0;
+        }
+        _out->constants.push_back(value);
+        _constants.emplace(value, index);
+        return index;
+    }
+
+    std::uint32_t CodeGenerator::_string(const Node &node, std::string_view value) {
+        auto it = _strings.find(std::string(value));
+        if (it != _strings.end()) {
+            return it->second;
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(_out->strings.size());
+        if (index > MAX_OPERAND) {
+            _error(node, "too many string constants in module");
+            return 0;
+        }
+        _out->strings.emplace_back(value);
+        _strings.emplace(std::string(value), index);
+        return index;
+    }
+
+    std::uint32_t CodeGenerator::_call_target(const CallExpr &node, std::uint32_t module, std::uint32_t function) {
+        auto it = _calls.find(std::make_pair(module, function));
+        if (it != _calls.end()) {
+            return it->second;
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(_out->calls.size());
+        if (index > MAX_OPERAND) {
+            _error(node, "too many called functions in module");
+            return 0;
+        }
+        _out->calls.push_back(CallTarget{module, function, static_cast<std::uint32_t>(node.args.size())});
+        _calls.emplace(std::make_pair(module, function), index);
+        return index;
+    }
+
+    /*
+     * 寄存器与指令
+     */
+    unsigned CodeGenerator::_alloc(const Node &node) {
+        if (_top >= MAX_REGISTERS) {
+            if (!_overflow) {
+                _error(node, "function '" + std::string(_decl->name.name) + "' needs too many registers");
+                _overflow = true;
+            }
+            return MAX_REGISTERS - 1;
+        }
+        unsigned reg = _top++;
+        _fn->register_count = std::max<std::uint32_t>(_fn->register_count, _top);
+        _refs.reset(reg);
+        return reg;
+    }
+
+    // 行号表只在行号变化处增加一项
+    std::size_t CodeGenerator::_emit(Instruction ins) {
+        dword pc = static_cast<dword>(_fn->code.size());
+        if (_fn->lines.empty() || _fn->lines.back().line != _line) {
+            if (!_fn->lines.empty() && _fn->lines.back().pc == pc) {
+                _fn->lines.back().line = _line;
+            } else {
+                _fn->lines.push_back(LineEntry{pc, _line});
+            }
+        }
+        _fn->code.push_back(ins);
+        return _fn->code.size() - 1;
+    }
+
+    // 跳转的目标稍后由_patch填写
+    std::size_t CodeGenerator::_jump(Opcode op, unsigned a) {
+        return _emit(encodeAsBx(op, a, 0));
+    }
+
+    void CodeGenerator::_patch(std::size_t at, std::size_t target) {
+        if (at == NO_JUMP) {
+            return;
+        }
+        long offset = static_cast<long>(target) - static_cast<long>(at) - 1;
+        if (offset > MAX_JUMP || offset < -MAX_JUMP) {
+            if (!_overflow) {
+                _error(*_decl, "function '" + std::string(_decl->name.name) + "' is too large");
+                _overflow = true;
+            }
+            return;
+        }
+        Instruction ins = _fn->code[at];
+        _fn->code[at] = encodeAsBx(opOf(ins), argA(ins), static_cast<int>(offset));
+    }
+
+    void CodeGenerator::_move(unsigned dst, unsigned src) {
+        if (dst != src) {
+            _emit(encodeABC(Opcode::MOVE, dst, src, 0));
+        }
+    }
+
+    // 比int64窄的整数运算后截断到类型的位宽，保持寄存器中符号扩展或零扩展的形式
+    void CodeGenerator::_normalize(unsigned reg, TypeId type) {
+        if (!TypeTable::isInteger(type) && type != TYPE_CHAR) {
+            return;
+        }
+        unsigned width = TypeTable::width(type);
+        if (width < 64) {
+            _emit(encodeABC(TypeTable::isSigned(type) ? Opcode::TRUNC_I : Opcode::TRUNC_U, reg, reg, width));
+        }
+    }
+
+    void CodeGenerator::_load_int(const Node &node, unsigned dst, qword value) {
+        std::int64_t v = static_cast<std::int64_t>(value);
+        if (v >= -MAX_JUMP - 1 && v <= MAX_JUMP) {
+            _emit(encodeAsBx(Opcode::LOADI, dst, static_cast<int>(v)));
+        } else {
+            _emit(encodeABx(Opcode::LOADK, dst, _constant(node, value)));
+        }
+    }
+
+    // 把非负整数value转换为大整数保存到dst
+    void CodeGenerator::_big(const Node &node, unsigned dst, qword value) {
+        unsigned mark = _top;
+        unsigned reg = _alloc(node);
+        _load_int(node, reg, value);
+        _safepoint(_top);
+        _emit(encodeABC(static_cast<std::int64_t>(value) < 0 ? Opcode::U64_TO_BIG : Opcode::I64_TO_BIG, dst, reg, 0));
+        _top = mark;
+    }
+
+    // 下一条指令处的栈映射：编号小于live的寄存器中保存字符串的寄存器
+    void CodeGenerator::_safepoint(unsigned live) {
+        std::bitset<MAX_REGISTERS> refs = _refs;
+        for (unsigned reg = live; reg < MAX_REGISTERS; ++reg) {
+            refs.reset(reg);
+        }
+        if (refs.any()) {
+            _safepoints.emplace_back(static_cast<std::uint32_t>(_fn->code.size()), refs);
+        }
+    }
+
+    // 函数的寄存器个数确定后，按字节码文件的格式写入栈映射
+    void CodeGenerator::_stack_maps() {
+        std::size_t words = stackMapWords(_fn->register_count);
+        for (const auto &safepoint : _safepoints) {
+            std::size_t at = _fn->stack_maps.size();
+            _fn->stack_maps.resize(at + words, 0);
+            _fn->stack_maps[at] = safepoint.first;
+            for (unsigned reg = 0; reg < _fn->register_count; ++reg) {
+                if (safepoint.second.test(reg)) {
+                    _fn->stack_maps[at + 1 + reg / 64] |= 1ULL << (reg % 64);
+                }
+            }
+        }
+    }
+
+    /*
+     * 函数与语句
+     */
+    void CodeGenerator::_function(const FunctionDecl &fn) {
+        _out->functions.push_back(FunctionCode{std::string(fn.name.name),
+                                               static_cast<std::uint32_t>(fn.params.size()),
+                                               fn.local_count, {}, {}, {}});
+        _fn = &_out->functions.back();
+        _decl = &fn;
+        _locals = fn.local_count;
+        _top = _locals;
+        _line = fn.line;
+        _overflow = false;
+        _loops.clear();
+        _refs.reset();
+        _safepoints.clear();
+        if (_locals > MAX_REGISTERS) {
+            _error(fn, "function '" + std::string(fn.name.name) + "' has too many local variables");
+            _overflow = true;
+            return;
+        }
+        for (const Param *param : fn.params) {
+            _refs.set(param->slot, isReference(param->type->resolved));
+        }
+        _block(*fn.body);
+        _emit(encodeABC(Opcode::RET0, 0, 0, 0));
+        _stack_maps();
+    }
+
+    // 离开作用域后其中的变量不再是栈映射的一部分，其编号可能被其他类型的变量复用
+    void CodeGenerator::_block(const BlockStmt &block) {
+        std::bitset<MAX_REGISTERS> refs = _refs;
+        for (const Stmt *stmt : block.stmts) {
+            _stmt(stmt);
+        }
+        _refs = refs;
+    }
+
+    // 条件为false时跳转，返回待填写的跳转指令。条件恒为true时不跳转
+    std::size_t CodeGenerator::_branch_if_false(const Expr *cond) {
+        if (cond->kind == ExprKind::LITERAL && cond->as<LiteralExpr>()->token == TokenType::BOOL
+            && cond->as<LiteralExpr>()->boolean) {
+            return NO_JUMP;
+        }
+        unsigned mark = _top;
+        unsigned reg = _operand(cond);
+        _top = mark;
+        return _jump(Opcode::JMPF, reg);
+    }
+
+    void CodeGenerator::_loop_end(std::size_t continue_target, std::size_t exit) {
+        for (std::size_t jump : _loops.back().breaks) {
+            _patch(jump, exit);
+        }
+        for (std::size_t jump : _loops.back().continues) {
+            _patch(jump, continue_target);
+        }
+        _loops.pop_back();
+    }
+
+    void CodeGenerator::_stmt(const Stmt *stmt) {
+        if (stmt == nullptr) {
+            return;
+        }
+        if (stmt->kind != StmtKind::BLOCK) {
+            _line = stmt->line;
+        }
+        switch (stmt->kind) {
+            case StmtKind::BLOCK:
+                _block(*stmt->as<BlockStmt>());
+                break;
+            case StmtKind::VAR:
+                for (const VarDecl *decl : stmt->as<VarStmt>()->decls) {
+                    if (decl->init != nullptr) {
+                        _expr(decl->init, decl->slot);
+                    } else if (decl->value_type == TYPE_STRING) {
+                        _emit(encodeABx(Opcode::LOADS, decl->slot, _string(*decl, "")));
+                    } else if (decl->value_type == TYPE_BIGINT) {
+                        _big(*decl, decl->slot, 0);
+                    } else if (TypeTable::isArray(decl->value_type)) {
+                        _new_array(*decl, decl->slot, decl->value_type, nullptr);
+                    } else {
+                        // 未初始化的变量为0，浮点数0.0的位模式也是0
+                        _emit(encodeAsBx(Opcode::LOADI, decl->slot, 0));
+                    }
+                    _refs.set(decl->slot, isReference(decl->value_type));
+                }
+                break;
+            case StmtKind::EXPR:
+                _effect(stmt->as<ExprStmt>()->expr);
+                break;
+            case StmtKind::IF: {
+                const IfStmt *s = stmt->as<IfStmt>();
+                std::size_t otherwise = _branch_if_false(s->cond);
+                _block(*s->then);
+                if (s->otherwise != nullptr) {
+                    std::size_t end = _jump(Opcode::JMP, 0);
+                    _patch_here(otherwise);
+                    _stmt(s->otherwise);
+                    _patch_here(end);
+                } else {
+                    _patch_here(otherwise);
+                }
+                break;
+            }
+            case StmtKind::WHILE: {
+                const WhileStmt *s = stmt->as<WhileStmt>();
+                std::size_t start = _fn->code.size();
+                std::size_t exit = _branch_if_false(s->cond);
+                _loops.emplace_back();
+                _block(*s->body);
+                _line = s->line;
+                _patch(_jump(Opcode::JMP, 0), start);
+                _patch_here(exit);
+                _loop_end(start, _fn->code.size());
+                break;
+            }
+            case StmtKind::DO_WHILE: {
+                const DoWhileStmt *s = stmt->as<DoWhileStmt>();
+                std::size_t start = _fn->code.size();
+                _loops.emplace_back();
+                _block(*s->body);
+                _line = s->line;
+                std::size_t cond = _fn->code.size();
+                unsigned mark = _top;
+                unsigned reg = _operand(s->cond);
+                _top = mark;
+                _patch(_jump(Opcode::JMPT, reg), start);
+                _loop_end(cond, _fn->code.size());
+                break;
+            }
+            case StmtKind::FOR: {
+                const ForStmt *s = stmt->as<ForStmt>();
+                std::bitset<MAX_REGISTERS> refs = _refs;
+                _stmt(s->init);
+                std::size_t start = _fn->code.size();
+                std::size_t exit = s->cond != nullptr ? _branch_if_false(s->cond) : NO_JUMP;
+                _loops.emplace_back();
+                _block(*s->body);
+                _line = s->line;
+                std::size_t step = _fn->code.size();
+                if (s->step != nullptr) {
+                    _effect(s->step);
+                }
+                _patch(_jump(Opcode::JMP, 0), start);
+                _patch_here(exit);
+                _loop_end(step, _fn->code.size());
+                _refs = refs;
+                break;
+            }
+            case StmtKind::RETURN: {
+                const ReturnStmt *s = stmt->as<ReturnStmt>();
+                if (s->value == nullptr) {
+                    _emit(encodeABC(Opcode::RET0, 0, 0, 0));
+                } else if (s->value->kind == ExprKind::CALL) {
+                    // 尾调用：被调用者复用当前栈帧，递归的深度不受栈大小的限制
+                    _call(s->value->as<CallExpr>(), NO_REG, Opcode::TAILCALL);
+                } else {
+                    unsigned mark = _top;
+                    _emit(encodeABC(Opcode::RET, _operand(s->value), 0, 0));
+                    _top = mark;
+                }
+                break;
+            }
+            case StmtKind::BREAK:
+                _loops.back().breaks.push_back(_jump(Opcode::JMP, 0));
+                break;
+            case StmtKind::CONTINUE:
+                _loops.back().continues.push_back(_jump(Opcode::JMP, 0));
+                break;
+        }
+    }
+
+    /*
+     * 表达式
+     */
+    // 返回保存表达式值的寄存器：局部变量直接使用其寄存器，否则求值到新的临时寄存器
+    unsigned CodeGenerator::_operand(const Expr *expr) {
+        if (isLocal(expr)) {
+            return expr->as<NameExpr>()->slot;
+        }
+        return _temp(expr);
+    }
+
+    unsigned CodeGenerator::_temp(const Expr *expr) {
+        unsigned reg = _alloc(*expr);
+        _expr(expr, reg);
+        return reg;
+    }
+
+    // 只需要副作用的表达式，如表达式语句及for的步进
+    void CodeGenerator::_effect(const Expr *expr) {
+        unsigned mark = _top;
+        switch (expr->kind) {
+            case ExprKind::ASSIGN:
+                _assign(expr->as<AssignExpr>(), NO_REG);
+                break;
+            case ExprKind::INC_DEC:
+                _inc_dec(expr->as<IncDecExpr>(), NO_REG);
+                break;
+            case ExprKind::CALL:
+                _call(expr->as<CallExpr>(), NO_REG);
+                break;
+            default:
+                if (hasSideEffects(expr)) {
+                    _temp(expr);
+                }
+                break;
+        }
+        _top = mark;
+    }
+
+    // 求值到寄存器dst，使用的临时寄存器在返回前释放。dst为临时寄存器时记录其中是否为字符串
+    void CodeGenerator::_expr(const Expr *expr, unsigned dst) {
+        unsigned mark = _top;
+        switch (expr->kind) {
+            case ExprKind::LITERAL:
+                _literal(expr->as<LiteralExpr>(), dst);
+                break;
+            case ExprKind::NAME:
+                if (isLocal(expr)) {
+                    _move(dst, expr->as<NameExpr>()->slot);
+                }
+                break;
+            case ExprKind::UNARY:
+                _unary(expr->as<UnaryExpr>(), dst);
+                break;
+            case ExprKind::BINARY:
+                _binary(expr->as<BinaryExpr>(), dst);
+                break;
+            case ExprKind::ASSIGN:
+                _assign(expr->as<AssignExpr>(), dst);
+                break;
+            case ExprKind::INC_DEC:
+                _inc_dec(expr->as<IncDecExpr>(), dst);
+                break;
+            case ExprKind::CALL:
+                _call(expr->as<CallExpr>(), dst);
+                break;
+            case ExprKind::MEMBER:
+                break;  // 类型检查保证模块和函数不会作为值使用
+            case ExprKind::CAST: {
+                const CastExpr *cast = expr->as<CastExpr>();
+                _convert(dst, cast->type, _operand(cast->operand), cast->operand->type);
+                break;
+            }
+            case ExprKind::SPAWN: {
+                const CallExpr *call = expr->as<SpawnExpr>()->call;
+                _call(call, dst, isReference(call->type) ? Opcode::SPAWN_STR : Opcode::SPAWN);
+                break;
+            }
+            case ExprKind::AWAIT:
+                _await(expr->as<AwaitExpr>(), dst);
+                break;
+            case ExprKind::INDEX: {
+                const IndexExpr *index = expr->as<IndexExpr>();
+                unsigned array = hasSideEffects(index->index) ? _temp(index->array) : _operand(index->array);
+                _emit(encodeABC(Opcode::GETARR, dst, array, _operand(index->index)));
+                break;
+            }
+            case ExprKind::NEW_ARRAY:
+                _new_array(*expr, dst, expr->type, expr->as<NewArrayExpr>()->length);
+                break;
+        }
+        _top = mark;
+        if (dst != NO_REG && dst >= _locals) {
+            _refs.set(dst, isReference(expr->type));
+        }
+    }
+
+    void CodeGenerator::_literal(const LiteralExpr *expr, unsigned dst) {
+        switch (expr->token) {
+            case TokenType::BOOL:
+                _emit(encodeAsBx(Opcode::LOADI, dst, expr->boolean ? 1 : 0));
+                break;
+            case TokenType::FLOAT: {
+                double value = expr->type == TYPE_FLOAT32 ? static_cast<double>(static_cast<float>(expr->real)) : expr->real;
+                qword bits = bitsOf(value);
+                if (bits == 0) {
+                    _emit(encodeAsBx(Opcode::LOADI, dst, 0));
+                } else {
+                    _emit(encodeABx(Opcode::LOADK, dst, _constant(*expr, bits)));
+                }
+                break;
+            }
+            case TokenType::STRING:
+                _emit(encodeABx(Opcode::LOADS, dst, _string(*expr, expr->text)));
+                break;
+            default:
+                // 整数及字符，字面量的值已按其类型截断；bigint的字面量为非负数，负数由NEG_BIG得到
+                if (expr->type == TYPE_BIGINT) {
+                    _big(*expr, dst, expr->integer);
+                } else {
+                    _load_int(*expr, dst, expr->integer);
+                }
+                break;
+        }
+    }
+
+    void CodeGenerator::_unary(const UnaryExpr *expr, unsigned dst) {
+        unsigned src = _operand(expr->operand);
+        TypeId type = expr->type;
+        switch (expr->op) {
+            case TokenType::OP_SUB:
+                if (TypeTable::isFloat(type)) {
+                    _emit(encodeABC(Opcode::NEG_F64, dst, src, 0));
+                } else if (type == TYPE_BIGINT) {
+                    _safepoint(_top);
+                    _emit(encodeABC(Opcode::NEG_BIG, dst, src, 0));
+                } else {
+                    _emit(encodeABC(Opcode::NEG_I64, dst, src, 0));
+                    _normalize(dst, type);
+                }
+                break;
+            case TokenType::OP_NOT:
+                _emit(encodeABC(Opcode::NOT, dst, src, 0));
+                break;
+            case TokenType::OP_BIT_NOT:
+                _emit(encodeABC(Opcode::BNOT, dst, src, 0));
+                _normalize(dst, type);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void CodeGenerator::_binary(const BinaryExpr *expr, unsigned dst) {
+        if (expr->op == TokenType::OP_AND || expr->op == TokenType::OP_OR) {
+            _logical(expr, dst);
+            return;
+        }
+        // 右操作数可能修改左操作数中的变量时，先将左操作数复制到临时寄存器
+        unsigned left = hasSideEffects(expr->right) ? _temp(expr->left) : _operand(expr->left);
+        _operation(expr->op, expr->left->type, dst, left, expr->right);
+    }
+
+    // 短路求值。结果先写入临时寄存器，避免右操作数读到被提前修改的变量
+    void CodeGenerator::_logical(const BinaryExpr *expr, unsigned dst) {
+        unsigned reg = dst >= _locals ? dst : _alloc(*expr);
+        _expr(expr->left, reg);
+        std::size_t end = _jump(expr->op == TokenType::OP_AND ? Opcode::JMPF : Opcode::JMPT, reg);
+        _expr(expr->right, reg);
+        _patch_here(end);
+        _move(dst, reg);
+    }
+
+    // 二元运算dst = left op right，整数加减小常量时使用ADDI_I64
+    void CodeGenerator::_operation(TokenType op, TypeId type, unsigned dst, unsigned left, const Expr *right) {
+        if ((op == TokenType::OP_ADD || op == TokenType::OP_SUB) && TypeTable::isInteger(type)
+            && right->kind == ExprKind::LITERAL && right->as<LiteralExpr>()->isInteger()) {
+            std::int64_t value = static_cast<std::int64_t>(right->as<LiteralExpr>()->integer);
+            if (op == TokenType::OP_SUB) {
+                value = -value;
+            }
+            if (value >= -128 && value <= 127) {
+                _emit(encodeABC(Opcode::ADDI_I64, dst, left, static_cast<std::uint8_t>(value)));
+                _normalize(dst, type);
+                return;
+            }
+        }
+        _arith(op, type, dst, left, _operand(right));
+    }
+
+    void CodeGenerator::_arith(TokenType op, TypeId type, unsigned dst, unsigned left, unsigned right) {
+        bool f = TypeTable::isFloat(type);
+        bool u = isUnsigned(type);
+        bool s = type == TYPE_STRING;
+        bool b = type == TYPE_BIGINT;
+        bool normalize = false;     // 结果可能超出窄整数类型的范围
+        bool compare = false;
+        bool swap = false;
+        Opcode code = Opcode::NOP;
+        switch (op) {
+            case TokenType::OP_ADD:
+                code = s ? Opcode::CONCAT : b ? Opcode::ADD_BIG : f ? Opcode::ADD_F64 : Opcode::ADD_I64;
+                normalize = true;
+                break;
+            case TokenType::OP_SUB:
+                code = b ? Opcode::SUB_BIG : f ? Opcode::SUB_F64 : Opcode::SUB_I64;
+                normalize = true;
+                break;
+            case TokenType::OP_MUL:
+                code = b ? Opcode::MUL_BIG : f ? Opcode::MUL_F64 : Opcode::MUL_I64;
+                normalize = true;
+                break;
+            case TokenType::OP_DIV:
+                code = b ? Opcode::DIV_BIG : f ? Opcode::DIV_F64 : u ? Opcode::DIV_U64 : Opcode::DIV_I64;
+                normalize = true;   // 如int8的-128 / -1
+                break;
+            case TokenType::OP_MOD:
+                code = b ? Opcode::MOD_BIG : u ? Opcode::MOD_U64 : Opcode::MOD_I64;
+                break;
+            case TokenType::OP_BIT_AND:
+                code = Opcode::BAND;
+                break;
+            case TokenType::OP_BIT_OR:
+                code = Opcode::BOR;
+                break;
+            case TokenType::OP_BIT_XOR:
+                code = Opcode::BXOR;
+                break;
+            case TokenType::OP_BIT_SHIFT_LEFT:
+                code = Opcode::SHL;
+                normalize = true;
+                break;
+            case TokenType::OP_BIT_SHIFT_RIGHT:
+                code = u ? Opcode::SHR_U64 : Opcode::SHR_I64;
+                break;
+            case TokenType::OP_EQUAL:
+                code = f ? Opcode::EQ_F64 : s ? Opcode::EQ_STR : b ? Opcode::EQ_BIG : Opcode::EQ;
+                compare = true;
+                break;
+            case TokenType::OP_NOT_EQUAL:
+                code = f ? Opcode::NE_F64 : s ? Opcode::NE_STR : b ? Opcode::NE_BIG : Opcode::NE;
+                compare = true;
+                break;
+            case TokenType::OP_GREAT:
+                swap = true;
+                // fall through
+            case TokenType::OP_LESS:
+                code = f ? Opcode::LT_F64 : s ? Opcode::LT_STR : b ? Opcode::LT_BIG : u ? Opcode::LT_U64 : Opcode::LT_I64;
+                compare = true;
+                break;
+            case TokenType::OP_GREAT_EQUAL:
+                swap = true;
+                // fall through
+            case TokenType::OP_LESS_EQUAL:
+                code = f ? Opcode::LE_F64 : s ? Opcode::LE_STR : b ? Opcode::LE_BIG : u ? Opcode::LE_U64 : Opcode::LE_I64;
+                compare = true;
+                break;
+            default:
+                break;
+        }
+        if (code == Opcode::CONCAT || (b && !compare)) {
+            _safepoint(_top);
+        }
+        _emit(encodeABC(code, dst, swap ? right : left, swap ? left : right));
+        if (compare || s || b) {
+            return;
+        }
+        if (f) {
+            if (type == TYPE_FLOAT32) {
+                _emit(encodeABC(Opcode::F64_TO_F32, dst, dst, 0));
+            }
+        } else if (normalize) {
+            _normalize(dst, type);
+        }
+    }
+
+    void CodeGenerator::_assign(const AssignExpr *expr, unsigned dst) {
+        if (expr->target->kind == ExprKind::INDEX) {
+            _assign_element(expr, dst);
+            return;
+        }
+        unsigned mark = _top;
+        unsigned var = expr->target->as<NameExpr>()->slot;
+        if (expr->op == TokenType::OP_ASSIGN) {
+            _expr(expr->value, var);
+        } else {
+            _operation(binaryOf(expr->op), expr->target->type, var, var, expr->value);
+        }
+        if (dst != NO_REG) {
+            _move(dst, var);
+        }
+        _top = mark;
+    }
+
+    // 数组元素的赋值：数组和下标先求值，元素读到临时寄存器中运算后写回
+    void CodeGenerator::_assign_element(const AssignExpr *expr, unsigned dst) {
+        unsigned mark = _top;
+        const IndexExpr *target = expr->target->as<IndexExpr>();
+        bool effects = hasSideEffects(expr->value);
+        unsigned array = effects || hasSideEffects(target->index) ? _temp(target->array) : _operand(target->array);
+        unsigned index = effects ? _temp(target->index) : _operand(target->index);
+        unsigned value = _alloc(*expr);
+        if (expr->op == TokenType::OP_ASSIGN) {
+            _expr(expr->value, value);
+        } else {
+            _emit(encodeABC(Opcode::GETARR, value, array, index));
+            _operation(binaryOf(expr->op), target->type, value, value, expr->value);
+        }
+        _emit(encodeABC(Opcode::SETARR, array, index, value));
+        if (dst != NO_REG) {
+            _move(dst, value);
+        }
+        _top = mark;
+    }
+
+    void CodeGenerator::_inc_dec(const IncDecExpr *expr, unsigned dst) {
+        if (expr->target->kind == ExprKind::INDEX) {
+            // 元素读到临时寄存器中按变量的方式增减，再写回数组
+            unsigned mark = _top;
+            const IndexExpr *target = expr->target->as<IndexExpr>();
+            unsigned array = hasSideEffects(target->index) ? _temp(target->array) : _operand(target->array);
+            unsigned index = _operand(target->index);
+            unsigned value = _alloc(*expr);
+            _emit(encodeABC(Opcode::GETARR, value, array, index));
+            _step(expr, value, dst);
+            _emit(encodeABC(Opcode::SETARR, array, index, value));
+            _top = mark;
+            return;
+        }
+        _step(expr, expr->target->as<NameExpr>()->slot, dst);
+    }
+
+    // 变量var加一或减一，dst为表达式的值
+    void CodeGenerator::_step(const IncDecExpr *expr, unsigned var, unsigned dst) {
+        TypeId type = expr->target->type;
+        bool inc = expr->op == TokenType::OP_INC;
+        if (dst != NO_REG && !expr->prefix) {
+            _move(dst, var);
+            if (dst >= _locals) {
+                _refs.set(dst, isReference(type));    // 运算分配大整数时dst中的旧值仍在使用
+            }
+        }
+        if (type == TYPE_BIGINT) {
+            unsigned mark = _top;
+            unsigned one = _alloc(*expr);
+            _big(*expr, one, 1);
+            _refs.set(one);
+            _safepoint(_top);
+            _emit(encodeABC(inc ? Opcode::ADD_BIG : Opcode::SUB_BIG, var, var, one));
+            _top = mark;
+        } else if (TypeTable::isFloat(type)) {
+            unsigned mark = _top;
+            unsigned one = _alloc(*expr);
+            _emit(encodeABx(Opcode::LOADK, one, _constant(*expr, bitsOf(1.0))));
+            _emit(encodeABC(inc ? Opcode::ADD_F64 : Opcode::SUB_F64, var, var, one));
+            if (type == TYPE_FLOAT32) {
+                _emit(encodeABC(Opcode::F64_TO_F32, var, var, 0));
+            }
+            _top = mark;
+        } else {
+            _emit(encodeABC(Opcode::ADDI_I64, var, var, static_cast<std::uint8_t>(inc ? 1 : -1)));
+            _normalize(var, type);
+        }
+        if (dst != NO_REG && expr->prefix) {
+            _move(dst, var);
+        }
+    }
+
+    // 参数依次求值到从base开始的连续寄存器，结果保存在base中
+    // 内置函数的每个参数之后紧跟其类型标记，内置函数据此解释参数的值
+    // op为TAILCALL时是return语句中的调用，内置函数之外都生成TAILCALL；op为SPAWN或SPAWN_STR时在新纤程中调用，
+    // 结果为纤程的句柄。内置函数可能挂起当前纤程，与CALL和SPAWN一样需要栈映射
+    void CodeGenerator::_call(const CallExpr *expr, unsigned dst, Opcode op) {
+        unsigned mark = _top;
+        const Expr *callee = expr->callee;
+        bool native = callee->kind == ExprKind::MEMBER && callee->as<MemberExpr>()->binding == SymbolKind::NATIVE;
+        if (native && callee->as<MemberExpr>()->slot == NATIVE_ARRAY_LENGTH) {
+            // array.length直接生成LEN，不需要调用内置函数
+            unsigned array = _operand(expr->args[0]);
+            unsigned reg = dst != NO_REG ? dst : _alloc(*expr);
+            _emit(encodeABC(Opcode::LEN, reg, array, 0));
+            if (op == Opcode::TAILCALL) {
+                _emit(encodeABC(Opcode::RET, reg, 0, 0));
+            }
+            _top = mark;
+            return;
+        }
+        // dst是刚分配的临时寄存器时直接作为base，省去结果的复制
+        unsigned base = dst != NO_REG && dst >= _locals && dst + 1 == _top ? dst : _alloc(*expr);
+        for (std::size_t i = 0; i < expr->args.size(); ++i) {
+            const Expr *arg = expr->args[i];
+            _expr(arg, i == 0 ? base : _alloc(*arg));
+            if (native) {
+                _load_int(*arg, _alloc(*arg), tagOf(arg->type));
+            }
+        }
+        bool tail = op == Opcode::TAILCALL;
+        if (native) {
+            _safepoint(base);
+            _emit(encodeABx(Opcode::NATIVE, base, callee->as<MemberExpr>()->slot));
+            if (tail) {
+                _emit(encodeABC(Opcode::RET, base, 0, 0));
+            }
+        } else if (callee->kind == ExprKind::MEMBER) {
+            const MemberExpr *member = callee->as<MemberExpr>();
+            std::uint32_t module = member->object->as<NameExpr>()->slot + 1;
+            if (!tail) {
+                _safepoint(base);
+            }
+            _emit(encodeABx(op, base, _call_target(*expr, module, member->slot)));
+        } else {
+            if (!tail) {
+                _safepoint(base);
+            }
+            _emit(encodeABx(op, base, _call_target(*expr, 0, callee->as<NameExpr>()->slot)));
+        }
+        if (dst != NO_REG) {
+            _move(dst, base);
+        }
+        _top = mark;
+    }
+
+    // 长度为length的数组，length为nullptr时为空数组。分配可能触发回收，因此需要栈映射
+    void CodeGenerator::_new_array(const Node &node, unsigned dst, TypeId type, const Expr *length) {
+        unsigned mark = _top;
+        unsigned reg;
+        if (length != nullptr) {
+            reg = _operand(length);
+        } else {
+            reg = _alloc(node);
+            _emit(encodeAsBx(Opcode::LOADI, reg, 0));
+        }
+        _safepoint(_top);
+        _emit(encodeABC(Opcode::NEWARR, dst, reg, elementOf(type)));
+        _top = mark;
+    }
+
+    // 等待时当前纤程挂起，其他纤程可能触发回收，因此需要栈映射
+    void CodeGenerator::_await(const AwaitExpr *expr, unsigned dst) {
+        unsigned mark = _top;
+        unsigned task = _operand(expr->task);
+        _safepoint(_top);
+        _emit(encodeABC(Opcode::AWAIT, dst != NO_REG ? dst : _alloc(*expr), task, 0));
+        _top = mark;
+    }
+
+    // 类型转换，包括类型检查插入的隐式转换
+    void CodeGenerator::_convert(unsigned dst, TypeId to, unsigned src, TypeId from) {
+        bool ff = TypeTable::isFloat(from), tf = TypeTable::isFloat(to);
+        if (from == to || from == TYPE_ERROR || to == TYPE_ERROR) {
+            _move(dst, src);
+        } else if (to == TYPE_BIGINT) {
+            _safepoint(_top);
+            _emit(encodeABC(isUnsigned(from) ? Opcode::U64_TO_BIG : Opcode::I64_TO_BIG, dst, src, 0));
+        } else if (from == TYPE_BIGINT) {
+            _emit(encodeABC(Opcode::BIG_TO_I64, dst, src, 0));
+            _normalize(dst, to);
+        } else if (ff && tf) {
+            if (to == TYPE_FLOAT32) {
+                _emit(encodeABC(Opcode::F64_TO_F32, dst, src, 0));
+            } else {
+                _move(dst, src);
+            }
+        } else if (tf) {
+            _emit(encodeABC(isUnsigned(from) ? Opcode::U64_TO_F64 : Opcode::I64_TO_F64, dst, src, 0));
+            if (to == TYPE_FLOAT32) {
+                _emit(encodeABC(Opcode::F64_TO_F32, dst, dst, 0));
+            }
+        } else if (ff) {
+            _emit(encodeABC(isUnsigned(to) ? Opcode::F64_TO_U64 : Opcode::F64_TO_I64, dst, src, 0));
+            _normalize(dst, to);
+        } else if (fitsIn(from, to) || TypeTable::width(to) >= 64) {
+            _move(dst, src);    // 64位整数之间的转换不改变位模式
+        } else {
+            _emit(encodeABC(TypeTable::isSigned(to) ? Opcode::TRUNC_I : Opcode::TRUNC_U, dst, src, TypeTable::width(to)));
+        }
+    }
+
+}   // namespace Lett.
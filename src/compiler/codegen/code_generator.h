@@ -0,0 +1,101 @@
+#ifndef __LETT_CODEGEN_CODE_GENERATOR_H__
+#define __LETT_CODEGEN_CODE_GENERATOR_H__
+
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "exception.h"
+#include "ast.h"
+#include "bytecode_module.h"
+
+namespace Lett {
+
+    // 代码生成：将经过类型检查的语法树翻译为寄存器虚拟机的字节码
+    // 寄存器分配：
+    //   - 参数和局部变量使用名字解析分配的编号，即寄存器0到local_count-1
+    //   - 临时值按栈的方式分配在局部变量之上，表达式求值结束即释放
+    //   - 调用时参数依次放在调用者的临时寄存器中，被调用者的栈帧从第一个参数开始
+    // 栈映射：生成指令时记录哪些寄存器保存着字符串、大整数或数组，在CONCAT、NEWARR、大整数运算和CALL处生成栈映射，
+    // 只包括已初始化且仍在作用域中的字符串、bigint、数组变量，以及尚未释放的这些类型的临时值
+    // 行号表：每条语句生成的指令对应语句所在的行，循环末尾的跳转对应循环语句所在的行
+    class CodeGenerator {
+    private:
+        static constexpr unsigned NO_REG = static_cast<unsigned>(-1);   // 不需要表达式的值
+        static constexpr std::size_t NO_JUMP = static_cast<std::size_t>(-1);
+
+        struct Loop {
+            std::vector<std::size_t> breaks;
+            std::vector<std::size_t> continues;
+        };
+
+        BytecodeModule *_out;
+        FunctionCode *_fn;
+        const FunctionDecl *_decl;
+        unsigned _locals;           // 参数及局部变量占用的寄存器数
+        unsigned _top;              // 第一个空闲的临时寄存器
+        bool _overflow;             // 已报告寄存器不足
+        std::vector<Loop> _loops;
+        std::uint32_t _line;        // 正在生成的语句所在的行，记入行号表
+        std::bitset<MAX_REGISTERS> _refs;   // 保存字符串的寄存器
+        std::vector<std::pair<std::uint32_t, std::bitset<MAX_REGISTERS>>> _safepoints;    // 栈映射：指令的下标及位图
+        std::unordered_map<qword, std::uint32_t> _constants;
+        std::unordered_map<std::string, std::uint32_t> _strings;
+        std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> _calls;
+        std::vector<SemanticError> _errors;
+
+        void _error(const Node &node, const std::string &msg);
+        std::uint32_t _constant(const Node &node, qword value);
+        std::uint32_t _string(const Node &node, std::string_view value);
+        std::uint32_t _call_target(const CallExpr &node, std::uint32_t module, std::uint32_t function);
+
+        unsigned _alloc(const Node &node);
+        std::size_t _emit(Instruction ins);
+        std::size_t _jump(Opcode op, unsigned a);
+        void _patch(std::size_t at, std::size_t target);
+        void _patch_here(std::size_t at) { _patch(at, _fn->code.size()); }
+        void _move(unsigned dst, unsigned src);
+        void _normalize(unsigned reg, TypeId type);
+        void _load_int(const Node &node, unsigned dst, qword value);
+        void _big(const Node &node, unsigned dst, qword value);
+        void _safepoint(unsigned live);
+        void _stack_maps();
+
+        void _function(const FunctionDecl &fn);
+        void _block(const BlockStmt &block);
+        void _stmt(const Stmt *stmt);
+        std::size_t _branch_if_false(const Expr *cond);
+        void _loop_end(std::size_t continue_target, std::size_t exit);
+
+        unsigned _operand(const Expr *expr);
+        unsigned _temp(const Expr *expr);
+        void _effect(const Expr *expr);
+        void _expr(const Expr *expr, unsigned dst);
+        void _literal(const LiteralExpr *expr, unsigned dst);
+        void _unary(const UnaryExpr *expr, unsigned dst);
+        void _binary(const BinaryExpr *expr, unsigned dst);
+        void _logical(const BinaryExpr *expr, unsigned dst);
+        void _operation(TokenType op, TypeId type, unsigned dst, unsigned left, const Expr *right);
+        void _arith(TokenType op, TypeId type, unsigned dst, unsigned left, unsigned right);
+        void _assign(const AssignExpr *expr, unsigned dst);
+        void _assign_element(const AssignExpr *expr, unsigned dst);
+        void _inc_dec(const IncDecExpr *expr, unsigned dst);
+        void _step(const IncDecExpr *expr, unsigned var, unsigned dst);
+        void _new_array(const Node &node, unsigned dst, TypeId type, const Expr *length);
+        void _call(const CallExpr *expr, unsigned dst, Opcode op = Opcode::CALL);
+        void _await(const AwaitExpr *expr, unsigned dst);
+        void _convert(unsigned dst, TypeId to, unsigned src, TypeId from);
+    public:
+        CodeGenerator();
+
+        bool generate(const Module &module, BytecodeModule &out);
+        const std::vector<SemanticError> &getErrors() const { return _errors; }
+        bool hasErrors() const { return !_errors.empty(); }
+    };  // class CodeGenerator
+
+}   // namespace Lett.
+
+#endif // __LETT_CODEGEN_CODE_GENERATOR_H__
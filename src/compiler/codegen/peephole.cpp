@@ -0,0 +1,67 @@
+#include "peephole.h"
+
+namespace Lett {
+
+    namespace {
+        // 可以融合的指令序列，按lett --pairs统计的执行次数选择
+        struct Pattern {
+            Opcode fused;
+            Opcode ops[3];
+            std::size_t length;
+        };
+
+        const Pattern PATTERNS[] = {
+            // 先匹配较长的序列
+            {Opcode::LOADI_LT_I64_JMPF, {Opcode::LOADI, Opcode::LT_I64, Opcode::JMPF}, 3},
+            {Opcode::LOADI_LE_I64_JMPF, {Opcode::LOADI, Opcode::LE_I64, Opcode::JMPF}, 3},
+            {Opcode::EQ_JMPF, {Opcode::EQ, Opcode::JMPF, Opcode::NOP}, 2},
+            {Opcode::NE_JMPF, {Opcode::NE, Opcode::JMPF, Opcode::NOP}, 2},
+            {Opcode::LT_I64_JMPF, {Opcode::LT_I64, Opcode::JMPF, Opcode::NOP}, 2},
+            {Opcode::LE_I64_JMPF, {Opcode::LE_I64, Opcode::JMPF, Opcode::NOP}, 2},
+            {Opcode::ADDI_I64_JMP, {Opcode::ADDI_I64, Opcode::JMP, Opcode::NOP}, 2},
+            {Opcode::ADD_I64_RET, {Opcode::ADD_I64, Opcode::RET, Opcode::NOP}, 2},
+        };
+
+        // 超级指令的处理代码直接使用前一条指令的结果，要求寄存器之间满足bytecode.h中注释的关系
+        bool operandsMatch(Opcode fused, const Instruction *ins) {
+            switch (fused) {
+                case Opcode::LOADI_LT_I64_JMPF:
+                case Opcode::LOADI_LE_I64_JMPF:
+                    return argC(ins[1]) == argA(ins[0]) && argA(ins[2]) == argA(ins[1]);
+                case Opcode::EQ_JMPF:
+                case Opcode::NE_JMPF:
+                case Opcode::LT_I64_JMPF:
+                case Opcode::LE_I64_JMPF:
+                case Opcode::ADD_I64_RET:
+                    return argA(ins[1]) == argA(ins[0]);
+                default:
+                    return true;
+            }
+        }
+    }   // namespace
+
+    // 每个位置独立地按原来的指令进行匹配：序列中间的指令也可以是另一个超级指令的开始，
+    // 因为超级指令的处理代码只读取其后指令的操作数，不关心它们的操作码
+    std::size_t fuseSuperinstructions(std::vector<Instruction> &code) {
+        const std::vector<Instruction> original = code;
+        std::size_t count = 0;
+        for (std::size_t pc = 0; pc < original.size(); ++pc) {
+            for (const Pattern &pattern : PATTERNS) {
+                if (pc + pattern.length > original.size()) {
+                    continue;
+                }
+                bool match = true;
+                for (std::size_t i = 0; i < pattern.length && match; ++i) {
+                    match = opOf(original[pc + i]) == pattern.ops[i];
+                }
+                if (match && operandsMatch(pattern.fused, &original[pc])) {
+                    code[pc] = (original[pc] & ~static_cast<Instruction>(0xFF)) | static_cast<Instruction>(pattern.fused);
+                    count++;
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+
+}   // namespace Lett.
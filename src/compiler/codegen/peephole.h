@@ -0,0 +1,17 @@
+#ifndef __LETT_CODEGEN_PEEPHOLE_H__
+#define __LETT_CODEGEN_PEEPHOLE_H__
+
+#include <cstddef>
+#include <vector>
+#include "bytecode.h"
+
+namespace Lett {
+
+    // 窥孔优化：把一个函数中连续的指令序列融合为超级指令（见bytecode.h中的LETT_SUPERINSTRUCTIONS），
+    // 减少解释器每次循环分派指令的次数。只替换序列第一条指令的操作码，不改变指令的个数和位置。
+    // 在链接时调用，此时指令中的常量和函数编号都已确定。返回融合的序列个数
+    std::size_t fuseSuperinstructions(std::vector<Instruction> &code);
+
+}   // namespace Lett.
+
+#endif // __LETT_CODEGEN_PEEPHOLE_H__
@@ -0,0 +1,155 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "exception.h"
+#include "compile_server.h"
+
+namespace Lett {
+
+    CompileServer::CompileServer(const std::string &socket_path, Handler handler)
+        : _path(socket_path), _handler(std::move(handler)), _listen_fd(-1), _wakeup{-1, -1}, _mutex(), _idle(),
+          _active(0), _served(0) {
+    }
+
+    CompileServer::~CompileServer() {
+        if (_listen_fd >= 0) {
+            ::close(_listen_fd);
+            ::unlink(_path.c_str());
+        }
+        for (int fd : _wakeup) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    void CompileServer::listen() {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        if (_path.empty() || _path.size() >= sizeof(address.sun_path)) {
+            throw InvalidArgument(_path, "socket path is empty or too long.");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, _path.data(), _path.size());
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw RuntimeError("cannot create socket: " + std::string(std::strerror(errno)));
+        }
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0) {
+            ::close(fd);
+            throw RuntimeError("a compile server is already listening on " + _path);
+        }
+        // 之前的服务器没有正常退出时留下的套接字文件。路径上是其他文件时不删除
+        struct stat st;
+        if (::lstat(_path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                ::close(fd);
+                throw RuntimeError(_path + " exists and is not a socket");
+            }
+            ::unlink(_path.c_str());
+        }
+        // 套接字文件只允许所有者连接。在listen之前修改权限，此前的连接都会被拒绝，
+        // 不需要修改整个进程的umask
+        if (::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0
+            || ::chmod(_path.c_str(), S_IRUSR | S_IWUSR) != 0
+            || ::listen(fd, SOMAXCONN) != 0 || ::pipe2(_wakeup, O_CLOEXEC) != 0) {
+            std::string reason = std::strerror(errno);
+            ::close(fd);
+            throw RuntimeError("cannot listen on " + _path + ": " + reason);
+        }
+        _listen_fd = fd;
+    }
+
+    void CompileServer::serve() {
+        if (_listen_fd < 0) {
+            listen();
+        }
+        pollfd fds[2] = {{_listen_fd, POLLIN, 0}, {_wakeup[0], POLLIN, 0}};
+        while (true) {
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            if (fds[1].revents != 0) {
+                break;
+            }
+            if ((fds[0].revents & POLLIN) == 0) {
+                continue;
+            }
+            int client = ::accept4(_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _active++;
+            }
+            std::thread(&CompileServer::_handle, this, client).detach();
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this]() { return _active == 0; });
+    }
+
+    void CompileServer::stop() {
+        char c = 0;
+        if (_wakeup[1] >= 0) {
+            ssize_t ignored = ::write(_wakeup[1], &c, 1);
+            (void)ignored;
+        }
+    }
+
+    std::size_t CompileServer::served() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _served;
+    }
+
+    // 服务器以自己的身份读写文件，只接受与服务器同一用户的进程的请求
+    bool CompileServer::_trusted(int fd) {
+        ucred peer;
+        socklen_t size = sizeof(peer);
+        return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &size) == 0 && size == sizeof(peer)
+            && peer.uid == ::geteuid();
+    }
+
+    void CompileServer::_handle(int fd) {
+        std::string data;
+        CompileRequest request;
+        if (_trusted(fd) && receiveMessage(fd, data)) {
+            CompileResponse response;
+            if (decodeRequest(data, request)) {
+                std::ostringstream out;
+                std::ostringstream err;
+                try {
+                    response.status = _handler(request, out, err);
+                } catch (const std::exception &e) {
+                    err << e.what() << std::endl;
+                    response.status = -1;
+                }
+                response.out = out.str();
+                response.err = err.str();
+            } else {
+                response.err = "invalid compile request, the client and the server have different versions\n";
+                response.status = -1;
+            }
+            sendMessage(fd, encodeResponse(response));
+            std::lock_guard<std::mutex> lock(_mutex);
+            _served++;
+        }
+        ::close(fd);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_active == 0) {
+            _idle.notify_all();
+        }
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,53 @@
+#ifndef __LETT_DAEMON_COMPILE_SERVER_H__
+#define __LETT_DAEMON_COMPILE_SERVER_H__
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "protocol.h"
+
+namespace Lett {
+
+    // 编译服务器（lettc -D）：在Unix域套接字上接受lettc转发的编译请求。
+    // 进程常驻，词法分析器的状态转移表、记号表和内存中的模块缓存在请求之间保持，
+    // 每个请求只需要编译变化了的模块。每个连接在自己的线程中处理，多个请求可以同时编译。
+    // 套接字文件的权限为0600，并且只处理与服务器同一用户的进程的请求，其他用户的连接被直接关闭
+    class CompileServer {
+    public:
+        // 处理一个请求，输出写入out和err，返回退出码。会被多个线程同时调用
+        typedef std::function<int(const CompileRequest &request, std::ostream &out, std::ostream &err)> Handler;
+    private:
+        std::string _path;
+        Handler _handler;
+        int _listen_fd;
+        int _wakeup[2];             // stop()写入一个字节，唤醒serve()
+        std::mutex _mutex;
+        std::condition_variable _idle;
+        std::size_t _active;        // 正在处理的连接数
+        std::size_t _served;
+
+        static bool _trusted(int fd);
+        void _handle(int fd);
+    public:
+        CompileServer(const std::string &socket_path, Handler handler);
+        ~CompileServer();
+        CompileServer(const CompileServer &) = delete;
+        CompileServer &operator=(const CompileServer &) = delete;
+
+        // 创建并监听套接字。同一路径上已有服务器在监听或路径上是其他文件时抛出RuntimeError，残留的套接字文件被删除
+        void listen();
+        // 接受并处理连接，直到调用stop()。返回前等待正在处理的请求完成
+        void serve();
+        // 停止serve()，只调用write，可以在信号处理函数中调用
+        void stop();
+
+        const std::string &path() const { return _path; }
+        std::size_t served();
+    };  // class CompileServer
+
+}   // namespace Lett.
+
+#endif // __LETT_DAEMON_COMPILE_SERVER_H__
@@ -0,0 +1,126 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "binary.h"
+#include "protocol.h"
+
+namespace Lett {
+
+    namespace {
+        // 消息的长度上限，防止错误的数据导致巨大的内存分配
+        constexpr std::uint32_t MAX_MESSAGE = 256u << 20;
+
+        bool sendAll(int fd, const char *data, std::size_t size) {
+            while (size > 0) {
+                ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        bool receiveAll(int fd, char *data, std::size_t size) {
+            while (size > 0) {
+                ssize_t n = ::recv(fd, data, size, 0);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+    }   // namespace
+
+    std::string encodeRequest(const CompileRequest &request) {
+        std::string data;
+        put32(data, PROTOCOL_VERSION);
+        putString(data, request.cwd);
+        put32(data, static_cast<std::uint32_t>(request.args.size()));
+        for (const std::string &arg : request.args) {
+            putString(data, arg);
+        }
+        return data;
+    }
+
+    bool decodeRequest(const std::string &data, CompileRequest &request) {
+        InputBuffer in(data);
+        if (in.get32() != PROTOCOL_VERSION) {
+            return false;
+        }
+        request.cwd = in.getString();
+        std::uint32_t count = in.getCount();
+        request.args.clear();
+        for (std::uint32_t i = 0; i < count && !in.failed(); ++i) {
+            request.args.push_back(in.getString());
+        }
+        return !in.failed() && in.atEnd();
+    }
+
+    std::string encodeResponse(const CompileResponse &response) {
+        std::string data;
+        put32(data, static_cast<std::uint32_t>(response.status));
+        putString(data, response.out);
+        putString(data, response.err);
+        return data;
+    }
+
+    bool decodeResponse(const std::string &data, CompileResponse &response) {
+        InputBuffer in(data);
+        response.status = static_cast<int>(in.get32());
+        response.out = in.getString();
+        response.err = in.getString();
+        return !in.failed() && in.atEnd();
+    }
+
+    bool sendMessage(int fd, const std::string &data) {
+        std::string header;
+        put32(header, static_cast<std::uint32_t>(data.size()));
+        return data.size() <= MAX_MESSAGE && sendAll(fd, header.data(), header.size())
+            && sendAll(fd, data.data(), data.size());
+    }
+
+    bool receiveMessage(int fd, std::string &data) {
+        char header[4];
+        if (!receiveAll(fd, header, sizeof(header))) {
+            return false;
+        }
+        std::uint32_t size = InputBuffer(std::string_view(header, sizeof(header))).get32();
+        if (size > MAX_MESSAGE) {
+            return false;
+        }
+        data.resize(size);
+        return receiveAll(fd, &data[0], size);
+    }
+
+    bool requestCompile(const std::string &socket_path, const CompileRequest &request, CompileResponse &response) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        std::string data;
+        bool done = ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0
+            && sendMessage(fd, encodeRequest(request)) && receiveMessage(fd, data) && decodeResponse(data, response);
+        ::close(fd);
+        return done;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,45 @@
+#ifndef __LETT_DAEMON_PROTOCOL_H__
+#define __LETT_DAEMON_PROTOCOL_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Lett {
+
+    // lettc与编译服务器之间的协议：Unix域套接字上每个连接一问一答。
+    // 消息以32位长度开头，之后的内容按binary.h的格式编码：
+    //   请求：版本号、客户端的工作目录、命令行参数（不含程序名）
+    //   响应：退出码、标准输出、标准错误的内容
+    // 服务器在请求的工作目录下解释相对路径，自己写出字节码文件
+    constexpr std::uint32_t PROTOCOL_VERSION = 1;
+
+    struct CompileRequest {
+        std::string cwd;
+        std::vector<std::string> args;
+    };
+
+    struct CompileResponse {
+        int status;
+        std::string out;
+        std::string err;
+
+        CompileResponse() : status(0), out(), err() {}
+    };
+
+    std::string encodeRequest(const CompileRequest &request);
+    bool decodeRequest(const std::string &data, CompileRequest &request);
+    std::string encodeResponse(const CompileResponse &response);
+    bool decodeResponse(const std::string &data, CompileResponse &response);
+
+    // 在套接字上读写一条消息，连接断开或出错时返回false
+    bool sendMessage(int fd, const std::string &data);
+    bool receiveMessage(int fd, std::string &data);
+
+    // 连接socket_path上的编译服务器，发送请求并等待响应。
+    // 服务器不存在或在响应之前断开时返回false，调用者可以改为在本进程中编译
+    bool requestCompile(const std::string &socket_path, const CompileRequest &request, CompileResponse &response);
+
+}   // namespace Lett.
+
+#endif // __LETT_DAEMON_PROTOCOL_H__
@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include "natives.h"
+#include "reader.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "type_checker.h"
+#include "constant_folder.h"
+#include "code_generator.h"
+#include "peephole.h"
+#include "ssa_optimizer.h"
+#include "image.h"
+#include "driver.h"
+
+namespace Lett {
+
+    namespace {
+        // 词法分析器是单例，多个线程同时编译时需要串行地进行词法分析
+        std::mutex lexerMutex;
+
+        typedef std::chrono::steady_clock Clock;
+
+        std::uint64_t since(Clock::time_point start) {
+            return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+
+        // elapsed中累加的时间不包括等待其他线程的词法分析
+        std::vector<Token> tokenize(const std::string &source, std::uint64_t &elapsed) {
+            std::lock_guard<std::mutex> lock(lexerMutex);
+            Clock::time_point start = Clock::now();
+            StringReader reader(source);
+            LexicalAnalyzer &analyzer = LexicalAnalyzer::getInstance(&reader);
+            analyzer.analyze();
+            std::vector<Token> tokens = analyzer.getTokens();
+            elapsed += since(start);
+            return tokens;
+        }
+
+        // 在词法分析线程中执行，词法单元按批发布到stream，出错时由stream转交给语法分析线程
+        void streamTokens(const std::string &source, TokenStream &stream, std::uint64_t &elapsed) {
+            std::lock_guard<std::mutex> lock(lexerMutex);
+            Clock::time_point start = Clock::now();
+            try {
+                StringReader reader(source);
+                LexicalAnalyzer::getInstance(&reader).analyze(stream);
+                stream.close();
+            } catch (...) {
+                stream.fail(std::current_exception());
+            }
+            elapsed += since(start);
+        }
+
+        bool isNativeModule(const std::string &name) {
+            for (std::uint32_t i = 0; i < NATIVE_COUNT; ++i) {
+                if (name == nativeInfo(static_cast<NativeId>(i)).module) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }   // namespace
+
+    CompilationUnit::CompilationUnit()
+        : name(), path(), source(), source_hash(0), module(), interface(), code(), imports(), dependents(),
+          errors(), cached(false), optimized(false), failed(false), times() {
+    }
+
+    Driver::Driver(const DriverOptions &options)
+        : _options(options), _cache(options.cache_dir), _units(), _index(), _order(), _errors(), _mutex(),
+          _compiled(0), _cache_hits(0), _link_time(0) {
+        if (_options.jobs == 0) {
+            _options.jobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    bool Driver::compileFile(const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw FileNotExsit(path);
+        }
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::filesystem::path entry(path);
+        // 入口文件所在的目录优先于其它搜索目录
+        _options.search_paths.insert(_options.search_paths.begin(), entry.parent_path().string());
+        return _run(entry.stem().string(), path, std::move(source));
+    }
+
+    bool Driver::compileString(const std::string &source, const std::string &dir) {
+        _options.search_paths.insert(_options.search_paths.begin(), dir);
+        return _run("main", "<string>", source);
+    }
+
+    bool Driver::_run(const std::string &name, const std::string &path, std::string source) {
+        _add(name, path, std::move(source));
+        _discover();
+        if (_sort()) {
+            _compile_all();
+        }
+        return !hasErrors();
+    }
+
+    std::size_t Driver::_add(const std::string &name, const std::string &path, std::string source) {
+        std::unique_ptr<CompilationUnit> unit(new CompilationUnit());
+        unit->name = name;
+        unit->path = path;
+        unit->source = std::move(source);
+        unit->source_hash = ModuleInterface::hashOf(unit->source);
+        std::size_t index = _units.size();
+        _index.emplace(name, index);
+        _units.push_back(std::move(unit));
+        return index;
+    }
+
+    // 模块a.b对应搜索目录中的a/b.let
+    bool Driver::_find(const std::string &name, std::string &path) const {
+        std::string relative = name;
+        std::replace(relative.begin(), relative.end(), '.', '/');
+        relative += ".let";
+        for (const std::string &dir : _options.search_paths) {
+            std::filesystem::path candidate = std::filesystem::path(dir) / relative;
+            std::error_code ec;
+            if (std::filesystem::is_regular_file(candidate, ec)) {
+                path = candidate.string();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Driver::_parse(CompilationUnit &unit, std::size_t jobs) {
+        std::vector<Token> tokens;
+        std::unique_ptr<TokenStream> stream;
+        std::thread lexer;
+        if (_options.pipeline) {
+            stream.reset(new TokenStream());
+            lexer = std::thread(streamTokens, std::cref(unit.source), std::ref(*stream), std::ref(unit.times.lex));
+        } else {
+            tokens = tokenize(unit.source, unit.times.lex);
+        }
+        Clock::time_point start = Clock::now();
+        std::unique_ptr<Parser> parser(stream ? new Parser(*stream) : new Parser(tokens));
+        try {
+            unit.module = parser->parse(jobs);
+        } catch (...) {
+            if (lexer.joinable()) {
+                stream->cancel();
+                lexer.join();
+            }
+            throw;
+        }
+        if (lexer.joinable()) {
+            lexer.join();
+        }
+        unit.times.parse += since(start);
+        for (const SyntaxError &e : parser->getErrors()) {
+            unit.errors.push_back(unit.path + ": " + e.what());
+        }
+        if (parser->hasErrors()) {
+            unit.failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    // 依次查找内存中和磁盘上的缓存，磁盘上命中的模块同时放入内存中的缓存
+    bool Driver::_load_cached(CompilationUnit &unit) {
+        if (_options.modules != nullptr) {
+            bool optimized = _options.ssa;
+            if (_options.modules->load(unit.source_hash, unit.interface, unit.code, optimized)) {
+                unit.optimized = optimized;
+                return true;
+            }
+        }
+        if (!_cache.load(unit.source_hash, unit.interface, unit.code)) {
+            return false;
+        }
+        if (_options.modules != nullptr) {
+            _options.modules->store(unit.interface, unit.code);
+        }
+        return true;
+    }
+
+    // 从入口模块出发，广度优先地找到所有被导入的模块
+    void Driver::_discover() {
+        for (std::size_t i = 0; i < _units.size(); ++i) {
+            CompilationUnit &unit = *_units[i];
+            std::vector<std::string> names;
+            std::vector<const ImportDecl *> decls;
+            if (i > 0 && _load_cached(unit)) {
+                // 缓存命中，暂不进行语法分析
+                unit.cached = true;
+                unit.interface.name = unit.name;
+                names = unit.interface.imports;
+                decls.assign(names.size(), nullptr);
+            } else {
+                if (!_parse(unit, _options.jobs)) {
+                    continue;
+                }
+                for (const ImportDecl *imp : unit.module->imports) {
+                    names.push_back(moduleNameOf(*imp));
+                    decls.push_back(imp);
+                }
+            }
+            for (std::size_t j = 0; j < names.size(); ++j) {
+                const std::string &name = names[j];
+                if (isNativeModule(name)) {
+                    unit.imports.push_back(CompilationUnit::NATIVE);
+                    continue;
+                }
+                auto it = _index.find(name);
+                std::size_t target;
+                if (it != _index.end()) {
+                    target = it->second;
+                } else {
+                    std::string path;
+                    if (!_find(name, path)) {
+                        std::string msg = "module '" + name + "' not found";
+                        unit.errors.push_back(unit.path + ": "
+                            + (decls[j] != nullptr ? SemanticError(decls[j]->line, decls[j]->column, msg).what() : msg));
+                        unit.failed = true;
+                        continue;
+                    }
+                    std::ifstream file(path, std::ios::binary);
+                    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    target = _add(name, path, std::move(source));
+                }
+                unit.imports.push_back(target);
+                CompilationUnit &dependency = *_units[target];
+                if (std::find(dependency.dependents.begin(), dependency.dependents.end(), i) == dependency.dependents.end()) {
+                    dependency.dependents.push_back(i);
+                }
+            }
+        }
+    }
+
+    // 拓扑排序(Kahn算法)，存在循环导入时返回false
+    bool Driver::_sort() {
+        std::vector<std::size_t> pending(_units.size(), 0);
+        for (std::size_t i = 0; i < _units.size(); ++i) {
+            for (std::size_t dependent : _units[i]->dependents) {
+                pending[dependent]++;
+            }
+        }
+        std::vector<std::size_t> ready;
+        for (std::size_t i = 0; i < _units.size(); ++i) {
+            if (pending[i] == 0) {
+                ready.push_back(i);
+            }
+        }
+        while (!ready.empty()) {
+            std::size_t index = ready.back();
+            ready.pop_back();
+            _order.push_back(index);
+            for (std::size_t dependent : _units[index]->dependents) {
+                if (--pending[dependent] == 0) {
+                    ready.push_back(dependent);
+                }
+            }
+        }
+        if (_order.size() == _units.size()) {
+            return true;
+        }
+        // 剩下的模块都在环上或依赖环上的模块，沿着未完成的依赖找到一个环
+        std::size_t start = 0;
+        while (pending[start] == 0) {
+            start++;
+        }
+        std::vector<std::size_t> path;
+        std::vector<bool> visited(_units.size(), false);
+        std::size_t current = start;
+        while (!visited[current]) {
+            visited[current] = true;
+            path.push_back(current);
+            for (std::size_t dependency : _units[current]->imports) {
+                if (dependency != CompilationUnit::NATIVE && pending[dependency] > 0) {
+                    current = dependency;
+                    break;
+                }
+            }
+        }
+        std::string cycle;
+        for (auto it = std::find(path.begin(), path.end(), current); it != path.end(); ++it) {
+            cycle += _units[*it]->name + " -> ";
+        }
+        _errors.push_back("import cycle: " + cycle + _units[current]->name);
+        return false;
+    }
+
+    // 依赖都已完成的模块进入就绪队列，由多个线程并行编译
+    void Driver::_compile_all() {
+        std::vector<std::size_t> pending(_units.size(), 0);
+        std::vector<std::size_t> ready;
+        for (std::size_t i = 0; i < _units.size(); ++i) {
+            for (std::size_t dependent : _units[i]->dependents) {
+                pending[dependent]++;
+            }
+        }
+        // 按拓扑序的逆序入队，使先出队的模块在拓扑序中靠前
+        for (auto it = _order.rbegin(); it != _order.rend(); ++it) {
+            if (pending[*it] == 0) {
+                ready.push_back(*it);
+            }
+        }
+        std::size_t remaining = _units.size();
+        std::condition_variable cv;
+        auto worker = [&]() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                cv.wait(lock, [&]() { return !ready.empty() || remaining == 0; });
+                if (remaining == 0) {
+                    return;
+                }
+                std::size_t index = ready.back();
+                ready.pop_back();
+                lock.unlock();
+                _compile(*_units[index]);
+                lock.lock();
+                remaining--;
+                for (std::size_t dependent : _units[index]->dependents) {
+                    if (--pending[dependent] == 0) {
+                        ready.push_back(dependent);
+                    }
+                }
+                cv.notify_all();
+            }
+        };
+        std::size_t count = std::min(_options.jobs, _units.size());
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    void Driver::_compile(CompilationUnit &unit) {
+        for (std::size_t dependency : unit.imports) {
+            if (dependency != CompilationUnit::NATIVE && _units[dependency]->failed) {
+                unit.failed = true;     // 错误已在被导入的模块中报告
+                return;
+            }
+        }
+        if (unit.failed) {
+            return;
+        }
+        if (unit.cached) {
+            // 被导入模块的接口都没有变化时直接使用缓存的接口
+            bool valid = unit.imports.size() == unit.interface.dependencies.size();
+            for (std::size_t i = 0; valid && i < unit.imports.size(); ++i) {
+                std::size_t dependency = unit.imports[i];
+                std::uint64_t hash = dependency == CompilationUnit::NATIVE ? 0 : _units[dependency]->interface.hash();
+                valid = hash == unit.interface.dependencies[i];
+            }
+            if (valid) {
+                if (_options.ssa && !unit.optimized) {
+                    Clock::time_point start = Clock::now();
+                    SsaOptimizer().run(unit.code);
+                    unit.times.optimize += since(start);
+                    if (_options.modules != nullptr) {
+                        _options.modules->storeOptimized(unit.interface, unit.code);
+                    }
+                }
+                std::lock_guard<std::mutex> lock(_mutex);
+                _cache_hits++;
+                return;
+            }
+            unit.cached = false;
+            unit.optimized = false;
+            if (!_parse(unit, 1)) {
+                return;
+            }
+        }
+
+        Module &module = *unit.module;
+        for (std::size_t i = 0; i < module.imports.size(); ++i) {
+            std::size_t dependency = unit.imports[i];
+            module.imports[i]->interface = dependency == CompilationUnit::NATIVE ? nullptr : &_units[dependency]->interface;
+        }
+        Clock::time_point start = Clock::now();
+        Resolver resolver;
+        TypeChecker checker;
+        if (resolver.resolve(module)) {
+            checker.check(module);
+        }
+        unit.times.check += since(start);
+        for (const SemanticError &e : resolver.getErrors()) {
+            unit.errors.push_back(unit.path + ": " + e.what());
+        }
+        for (const SemanticError &e : checker.getErrors()) {
+            unit.errors.push_back(unit.path + ": " + e.what());
+        }
+        if (!unit.errors.empty()) {
+            unit.failed = true;
+            return;
+        }
+        start = Clock::now();
+        ConstantFolder folder;
+        folder.run(module);
+        CodeGenerator generator;
+        bool generated = generator.generate(module, unit.code);
+        unit.times.generate += since(start);
+        if (!generated) {
+            for (const SemanticError &e : generator.getErrors()) {
+                unit.errors.push_back(unit.path + ": " + e.what());
+            }
+            unit.failed = true;
+            return;
+        }
+        unit.interface = ModuleInterface::fromModule(module, unit.name, unit.source_hash);
+        _cache.store(unit.interface, unit.code);
+        if (_options.modules != nullptr) {
+            _options.modules->store(unit.interface, unit.code);
+        }
+        // 缓存中是未经SSA优化的字节码，命中时同样进行优化
+        if (_options.ssa) {
+            start = Clock::now();
+            SsaOptimizer().run(unit.code);
+            unit.times.optimize += since(start);
+            if (_options.modules != nullptr) {
+                _options.modules->storeOptimized(unit.interface, unit.code);
+            }
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _compiled++;
+    }
+
+    // 按拓扑序排列各模块的函数，改写指令中模块内的常量、字符串及函数编号
+    bool Driver::link(std::string &image) {
+        if (hasErrors()) {
+            return false;
+        }
+        Clock::time_point start = Clock::now();
+        std::vector<dword> base(_units.size(), 0);     // 模块的第一个函数在函数表中的下标
+        dword count = 0;
+        for (std::size_t index : _order) {
+            base[index] = count;
+            count += static_cast<dword>(_units[index]->code.functions.size());
+        }
+        if (count > 0xFFFF + 1) {
+            _errors.push_back("too many functions in program");
+            return false;
+        }
+        ImageBuilder builder;
+        bool has_main = false;
+        for (std::size_t index : _order) {
+            const CompilationUnit &unit = *_units[index];
+            const BytecodeModule &module = unit.code;
+            for (std::size_t i = 0; i < module.functions.size(); ++i) {
+                const FunctionCode &fn = module.functions[i];
+                std::vector<Instruction> code = fn.code;
+                for (Instruction &ins : code) {
+                    Opcode op = opOf(ins);
+                    dword bx = argBx(ins);
+                    if (op == Opcode::LOADK) {
+                        bx = builder.addConstant(module.constants[bx]);
+                    } else if (op == Opcode::LOADS) {
+                        bx = builder.addStringConstant(module.strings[bx]);
+                    } else if (op == Opcode::CALL || op == Opcode::TAILCALL || op == Opcode::SPAWN || op == Opcode::SPAWN_STR) {
+                        const CallTarget &target = module.calls[bx];
+                        std::size_t callee = target.module == 0 ? index : unit.imports[target.module - 1];
+                        bx = base[callee] + target.function;
+                    } else {
+                        continue;
+                    }
+                    ins = encodeABx(op, argA(ins), bx);
+                }
+                if (_options.superinstructions) {
+                    fuseSuperinstructions(code);
+                }
+                // 被导入模块的函数名带上模块名
+                std::string name = index == 0 ? fn.name : unit.name + "." + fn.name;
+                builder.addFunction(name, static_cast<word>(fn.param_count), static_cast<word>(fn.register_count), code,
+                                    fn.stack_maps, fn.lines);
+                if (index == 0 && fn.name == "main") {
+                    builder.setEntry(base[index] + static_cast<dword>(i));
+                    has_main = true;
+                }
+            }
+        }
+        if (builder.constantCount() > 0xFFFF + 1) {
+            _errors.push_back("too many constants in program");
+            return false;
+        }
+        if (!has_main) {
+            _errors.push_back(_units[0]->path + ": no function 'main' in entry module");
+            return false;
+        }
+        image = builder.build();
+        _link_time += since(start);
+        return true;
+    }
+
+    std::vector<const CompilationUnit *> Driver::units() const {
+        std::vector<const CompilationUnit *> result;
+        for (std::size_t index : _order) {
+            result.push_back(_units[index].get());
+        }
+        return result;
+    }
+
+    PhaseTimes Driver::phaseTimes() const {
+        PhaseTimes times;
+        for (const std::unique_ptr<CompilationUnit> &unit : _units) {
+            times += unit->times;
+        }
+        times.link = _link_time;
+        return times;
+    }
+
+    std::vector<std::string> Driver::getErrors() const {
+        std::vector<std::string> errors;
+        for (const std::unique_ptr<CompilationUnit> &unit : _units) {
+            errors.insert(errors.end(), unit->errors.begin(), unit->errors.end());
+        }
+        errors.insert(errors.end(), _errors.begin(), _errors.end());
+        return errors;
+    }
+
+    bool Driver::hasErrors() const {
+        if (!_errors.empty()) {
+            return true;
+        }
+        for (const std::unique_ptr<CompilationUnit> &unit : _units) {
+            if (unit->failed) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,128 @@
+#ifndef __LETT_DRIVER_DRIVER_H__
+#define __LETT_DRIVER_DRIVER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "module_interface.h"
+#include "bytecode_module.h"
+#include "interface_cache.h"
+#include "module_cache.h"
+
+namespace Lett {
+
+    struct DriverOptions {
+        std::vector<std::string> search_paths;  // 查找导入模块的目录，入口文件所在目录总是第一个
+        std::string cache_dir;                  // 接口缓存目录，为空表示不使用缓存
+        std::size_t jobs;                       // 编译线程数，0表示使用所有核心
+        bool superinstructions;                 // 链接时把常见的指令序列融合为超级指令
+        bool ssa;                               // 在SSA形式上优化每个函数的字节码
+        ModuleCache *modules;                   // 内存中的模块缓存，为空表示不使用。由调用者持有，可以被多个Driver共享
+        bool pipeline;                          // 词法分析在另一个线程中进行，语法分析边接收词法单元边解析
+
+        DriverOptions()
+            : search_paths(), cache_dir(), jobs(1), superinstructions(true), ssa(true), modules(nullptr),
+              pipeline(false) {}
+    };
+
+    // 编译各阶段的耗时(ns)。并行编译多个模块时为各线程的时间之和；
+    // 词法分析与语法分析流水线进行时两者的时间重叠，语法分析的时间包括等待词法单元的时间
+    struct PhaseTimes {
+        std::uint64_t lex;
+        std::uint64_t parse;
+        std::uint64_t check;        // 名字解析与类型检查
+        std::uint64_t generate;     // 常量折叠与代码生成
+        std::uint64_t optimize;     // SSA优化
+        std::uint64_t link;
+
+        PhaseTimes() : lex(0), parse(0), check(0), generate(0), optimize(0), link(0) {}
+        PhaseTimes &operator+=(const PhaseTimes &other) {
+            lex += other.lex;
+            parse += other.parse;
+            check += other.check;
+            generate += other.generate;
+            optimize += other.optimize;
+            link += other.link;
+            return *this;
+        }
+    };
+
+    // 编译单元：一个模块及其编译结果
+    struct CompilationUnit {
+        static constexpr std::size_t NATIVE = static_cast<std::size_t>(-1);
+
+        std::string name;                       // 模块名，如math.vector
+        std::string path;                       // 源文件路径
+        std::string source;
+        std::uint64_t source_hash;
+        std::unique_ptr<Module> module;         // 语法树，接口来自缓存时为空
+        ModuleInterface interface;
+        BytecodeModule code;                    // 链接前的字节码
+        std::vector<std::size_t> imports;       // 每条import对应的编译单元下标，内置模块为NATIVE
+        std::vector<std::size_t> dependents;    // 导入该模块的编译单元
+        std::vector<std::string> errors;
+        bool cached;                            // 接口和字节码来自缓存，没有重新编译
+        bool optimized;                         // 来自内存中的缓存的字节码已经过SSA优化
+        bool failed;
+        PhaseTimes times;                       // 该模块各阶段的耗时，link总为0
+
+        CompilationUnit();
+    };
+
+    // 编译驱动：从入口模块出发解析import，建立模块依赖图，按拓扑序并行编译
+    //   1. 发现：读入源代码并计算哈希值。缓存（先内存，后磁盘）命中的模块直接从接口中得到其导入的模块，否则进行语法分析。
+    //   2. 排序：检查循环导入，得到拓扑序。
+    //   3. 编译：所有依赖都已完成的模块可以并行编译。缓存命中且其依赖的接口都没有变化的模块不再编译。
+    //   4. 链接：按拓扑序合并所有模块的字节码，生成字节码文件。
+    // 入口模块总是从源代码编译。每个Driver对象只进行一次编译。
+    class Driver {
+    private:
+        DriverOptions _options;
+        InterfaceCache _cache;
+        std::vector<std::unique_ptr<CompilationUnit>> _units;   // 下标0为入口模块
+        std::unordered_map<std::string, std::size_t> _index;    // 模块名 -> 下标
+        std::vector<std::size_t> _order;                        // 拓扑序，被导入的模块在前
+        std::vector<std::string> _errors;                       // 与具体模块无关的错误，如循环导入
+        std::mutex _mutex;
+        std::size_t _compiled;
+        std::size_t _cache_hits;
+        std::uint64_t _link_time;
+
+        std::size_t _add(const std::string &name, const std::string &path, std::string source);
+        bool _find(const std::string &name, std::string &path) const;
+        bool _parse(CompilationUnit &unit, std::size_t jobs);
+        bool _load_cached(CompilationUnit &unit);
+        void _discover();
+        bool _sort();
+        void _compile_all();
+        void _compile(CompilationUnit &unit);
+        bool _run(const std::string &name, const std::string &path, std::string source);
+    public:
+        Driver(const DriverOptions &options);
+
+        bool compileFile(const std::string &path);
+        // 源代码中导入的模块首先在dir中查找
+        bool compileString(const std::string &source, const std::string &dir = ".");
+        // 编译成功后链接，生成字节码文件的内容。入口模块没有main函数时返回false
+        bool link(std::string &image);
+
+        const CompilationUnit &entry() const { return *_units[0]; }
+        // 按拓扑序排列的编译单元，入口模块在最后
+        std::vector<const CompilationUnit *> units() const;
+        std::vector<std::string> getErrors() const;
+        bool hasErrors() const;
+
+        std::size_t compiledCount() const { return _compiled; }
+        std::size_t cacheHits() const { return _cache_hits; }
+        // 所有模块各阶段的耗时之和，以及链接的耗时
+        PhaseTimes phaseTimes() const;
+    };  // class Driver
+
+}   // namespace Lett.
+
+#endif // __LETT_DRIVER_DRIVER_H__
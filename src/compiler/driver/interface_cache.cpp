@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "binary.h"
+#include "interface_cache.h"
+
+namespace Lett {
+
+    InterfaceCache::InterfaceCache(const std::string &dir)
+        : _dir(dir) {
+    }
+
+    std::string InterfaceCache::pathOf(std::uint64_t source_hash) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.lti", static_cast<unsigned long long>(source_hash));
+        return (std::filesystem::path(_dir) / name).string();
+    }
+
+    // 文件内容为带长度的接口，之后是字节码
+    bool InterfaceCache::load(std::uint64_t source_hash, ModuleInterface &interface, BytecodeModule &code) const {
+        if (!enabled()) {
+            return false;
+        }
+        std::ifstream file(pathOf(source_hash), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        InputBuffer in(data);
+        std::string_view interface_data = in.getBytes(in.get32());
+        if (in.failed()) {
+            return false;
+        }
+        ModuleInterface loaded_interface;
+        BytecodeModule loaded_code;
+        // 哈希值碰撞或文件损坏时视为未命中
+        if (!ModuleInterface::deserialize(interface_data, loaded_interface) || loaded_interface.source_hash != source_hash
+            || !BytecodeModule::deserialize(std::string_view(data).substr(interface_data.size() + 4), loaded_code)) {
+            return false;
+        }
+        interface = std::move(loaded_interface);
+        code = std::move(loaded_code);
+        return true;
+    }
+
+    bool InterfaceCache::store(const ModuleInterface &interface, const BytecodeModule &code) const {
+        if (!enabled()) {
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(_dir, ec);
+        std::string path = pathOf(interface.source_hash);
+        std::ostringstream tmp;
+        tmp << path << ".tmp." << ::getpid() << "." << std::hash<std::thread::id>()(std::this_thread::get_id());
+        {
+            std::ofstream file(tmp.str(), std::ios::binary | std::ios::trunc);
+            if (!file) {
+                return false;
+            }
+            std::string data;
+            putString(data, interface.serialize());
+            data += code.serialize();
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                std::filesystem::remove(tmp.str(), ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp.str(), path, ec);
+        if (ec) {
+            std::filesystem::remove(tmp.str(), ec);
+            return false;
+        }
+        return true;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,30 @@
+#ifndef __LETT_DRIVER_INTERFACE_CACHE_H__
+#define __LETT_DRIVER_INTERFACE_CACHE_H__
+
+#include <cstdint>
+#include <string>
+#include "module_interface.h"
+#include "bytecode_module.h"
+
+namespace Lett {
+
+    // 磁盘上的模块接口缓存，同时保存模块的字节码，命中缓存的模块不需要重新生成代码即可链接
+    // 以源代码的哈希值为键，每个模块一个文件(<目录>/<哈希值>.lti)。
+    // 写入时先写临时文件再重命名，多个编译进程共用同一个缓存目录时不会读到写了一半的文件。
+    class InterfaceCache {
+    private:
+        std::string _dir;       // 为空表示不使用缓存
+    public:
+        InterfaceCache(const std::string &dir);
+
+        bool enabled() const { return !_dir.empty(); }
+        std::string pathOf(std::uint64_t source_hash) const;
+
+        // 读取缓存的接口及字节码，不存在或已损坏时返回false
+        bool load(std::uint64_t source_hash, ModuleInterface &interface, BytecodeModule &code) const;
+        bool store(const ModuleInterface &interface, const BytecodeModule &code) const;
+    };  // class InterfaceCache
+
+}   // namespace Lett.
+
+#endif // __LETT_DRIVER_INTERFACE_CACHE_H__
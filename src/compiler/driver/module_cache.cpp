@@ -0,0 +1,71 @@
+#include "module_cache.h"
+
+namespace Lett {
+
+    ModuleCache::ModuleCache(std::size_t capacity)
+        : _capacity(capacity == 0 ? 1 : capacity), _entries(), _index(), _hits(0), _misses(0), _mutex() {
+    }
+
+    bool ModuleCache::load(std::uint64_t source_hash, ModuleInterface &interface, BytecodeModule &code, bool &optimized) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _index.find(source_hash);
+        if (it == _index.end()) {
+            _misses++;
+            optimized = false;
+            return false;
+        }
+        _hits++;
+        _entries.splice(_entries.begin(), _entries, it->second);
+        const Entry &entry = *it->second;
+        interface = entry.interface;
+        optimized = optimized && entry.has_optimized;
+        code = optimized ? entry.optimized : entry.code;
+        return true;
+    }
+
+    void ModuleCache::store(const ModuleInterface &interface, const BytecodeModule &code) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _index.find(interface.source_hash);
+        if (it != _index.end()) {
+            _entries.erase(it->second);
+            _index.erase(it);
+        }
+        _entries.push_front(Entry{interface, code, BytecodeModule(), false});
+        _index.emplace(interface.source_hash, _entries.begin());
+        while (_entries.size() > _capacity) {
+            _index.erase(_entries.back().interface.source_hash);
+            _entries.pop_back();
+        }
+    }
+
+    void ModuleCache::storeOptimized(const ModuleInterface &interface, const BytecodeModule &optimized) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _index.find(interface.source_hash);
+        if (it == _index.end()) {
+            return;
+        }
+        Entry &entry = *it->second;
+        // 源代码相同而依赖的接口不同时生成的字节码可能不同
+        if (entry.interface.dependencies != interface.dependencies || entry.has_optimized) {
+            return;
+        }
+        entry.optimized = optimized;
+        entry.has_optimized = true;
+    }
+
+    std::size_t ModuleCache::size() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+
+    std::size_t ModuleCache::hits() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _hits;
+    }
+
+    std::size_t ModuleCache::misses() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _misses;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,51 @@
+#ifndef __LETT_DRIVER_MODULE_CACHE_H__
+#define __LETT_DRIVER_MODULE_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "module_interface.h"
+#include "bytecode_module.h"
+
+namespace Lett {
+
+    // 内存中的模块缓存，由编译服务器中先后或同时进行的多次编译共享。
+    // 与磁盘上的接口缓存一样以源代码的哈希值为键，保存模块的接口和SSA优化之前的字节码；
+    // 另外保存SSA优化之后的字节码，命中时不需要重新优化。
+    // 超过容量时淘汰最久未使用的模块。所有方法都是线程安全的
+    class ModuleCache {
+    private:
+        struct Entry {
+            ModuleInterface interface;
+            BytecodeModule code;
+            BytecodeModule optimized;
+            bool has_optimized;
+        };
+
+        std::size_t _capacity;
+        std::list<Entry> _entries;                                              // 最近使用的在前
+        std::unordered_map<std::uint64_t, std::list<Entry>::iterator> _index;   // 源代码哈希值 -> 模块
+        std::size_t _hits;
+        std::size_t _misses;
+        mutable std::mutex _mutex;
+    public:
+        explicit ModuleCache(std::size_t capacity = 4096);
+
+        // 读取缓存的接口及字节码，未命中时返回false。optimized为真时取SSA优化之后的字节码（如果有），
+        // 返回后optimized表示code是否已经过优化
+        bool load(std::uint64_t source_hash, ModuleInterface &interface, BytecodeModule &code, bool &optimized);
+        // 保存重新编译的模块，替换同一源代码之前的结果
+        void store(const ModuleInterface &interface, const BytecodeModule &code);
+        // 保存模块SSA优化之后的字节码，模块已被淘汰，或已被针对其他依赖接口编译的结果替换时忽略
+        void storeOptimized(const ModuleInterface &interface, const BytecodeModule &optimized);
+
+        std::size_t size() const;
+        std::size_t hits() const;
+        std::size_t misses() const;
+    };  // class ModuleCache
+
+}   // namespace Lett.
+
+#endif // __LETT_DRIVER_MODULE_CACHE_H__
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include "ir.h"
+
+namespace Lett {
+
+    bool IrInst::defines() const {
+        if (kind != IrKind::INST) {
+            return true;
+        }
+        switch (op) {
+            case Opcode::NOP:
+            case Opcode::SETARR:
+            case Opcode::JMP:
+            case Opcode::JMPT:
+            case Opcode::JMPF:
+            case Opcode::TAILCALL:
+            case Opcode::RET:
+            case Opcode::RET0:
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    bool IrInst::isTerminator() const {
+        if (kind != IrKind::INST) {
+            return false;
+        }
+        switch (op) {
+            case Opcode::JMP:
+            case Opcode::JMPT:
+            case Opcode::JMPF:
+            case Opcode::TAILCALL:
+            case Opcode::RET:
+            case Opcode::RET0:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool IrInst::isCall() const {
+        if (kind != IrKind::INST) {
+            return false;
+        }
+        switch (op) {
+            case Opcode::CALL:
+            case Opcode::TAILCALL:
+            case Opcode::NATIVE:
+            case Opcode::SPAWN:
+            case Opcode::SPAWN_STR:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool IrInst::isConstant() const {
+        return kind == IrKind::INST && (op == Opcode::LOADI || op == Opcode::LOADK || op == Opcode::LOADS);
+    }
+
+    bool IrInst::isPure() const {
+        if (kind != IrKind::INST) {
+            return false;
+        }
+        // 数组的长度创建后不再改变；数组的元素可能被SETARR修改，GETARR不是纯的
+        return (op >= Opcode::MOVE && op <= Opcode::LE_BIG) || op == Opcode::LEN;
+    }
+
+    bool IrInst::mayThrow() const {
+        if (kind != IrKind::INST) {
+            return false;
+        }
+        switch (op) {
+            case Opcode::DIV_I64:
+            case Opcode::MOD_I64:
+            case Opcode::DIV_U64:
+            case Opcode::MOD_U64:
+            case Opcode::DIV_BIG:
+            case Opcode::MOD_BIG:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool IrInst::allocates() const {
+        return kind == IrKind::INST && (op == Opcode::CONCAT || op == Opcode::NEWARR
+                                        || (op >= Opcode::ADD_BIG && op <= Opcode::U64_TO_BIG));
+    }
+
+    bool IrInst::isSafepoint() const {
+        if (allocates()) {
+            return true;
+        }
+        if (kind != IrKind::INST) {
+            return false;
+        }
+        switch (op) {
+            case Opcode::CALL:
+            case Opcode::NATIVE:
+            case Opcode::SPAWN:
+            case Opcode::SPAWN_STR:
+            case Opcode::AWAIT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::uint32_t IrFunction::addBlock() {
+        blocks.emplace_back();
+        return static_cast<std::uint32_t>(blocks.size() - 1);
+    }
+
+    std::uint32_t IrFunction::addInst(IrKind kind, Opcode op, std::uint32_t block, std::uint32_t line, unsigned reg) {
+        insts.push_back(IrInst{kind, op, block, line, 0, reg, false, false, {}});
+        return static_cast<std::uint32_t>(insts.size() - 1);
+    }
+
+    std::vector<std::uint32_t> IrFunction::reversePostorder() const {
+        std::vector<std::uint32_t> order;
+        std::vector<bool> visited(blocks.size(), false);
+        // 显式的栈：基本块及下一个要访问的后继
+        std::vector<std::pair<std::uint32_t, std::size_t>> stack;
+        stack.emplace_back(0, 0);
+        visited[0] = true;
+        while (!stack.empty()) {
+            auto &[block, next] = stack.back();
+            if (next < blocks[block].succs.size()) {
+                std::uint32_t succ = blocks[block].succs[next++];
+                if (!visited[succ]) {
+                    visited[succ] = true;
+                    stack.emplace_back(succ, 0);
+                }
+            } else {
+                order.push_back(block);
+                stack.pop_back();
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    std::vector<std::uint32_t> IrFunction::dominators(const std::vector<std::uint32_t> &rpo) const {
+        std::vector<std::uint32_t> index(blocks.size(), IR_NONE);
+        for (std::size_t i = 0; i < rpo.size(); ++i) {
+            index[rpo[i]] = static_cast<std::uint32_t>(i);
+        }
+        std::vector<std::uint32_t> idom(blocks.size(), IR_NONE);
+        idom[0] = 0;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::size_t i = 1; i < rpo.size(); ++i) {
+                std::uint32_t block = rpo[i];
+                std::uint32_t result = IR_NONE;
+                for (std::uint32_t pred : blocks[block].preds) {
+                    if (idom[pred] == IR_NONE) {
+                        continue;
+                    }
+                    if (result == IR_NONE) {
+                        result = pred;
+                        continue;
+                    }
+                    // 两者在支配树上的最近公共祖先
+                    std::uint32_t a = pred, b = result;
+                    while (a != b) {
+                        while (index[a] > index[b]) {
+                            a = idom[a];
+                        }
+                        while (index[b] > index[a]) {
+                            b = idom[b];
+                        }
+                    }
+                    result = a;
+                }
+                if (idom[block] != result) {
+                    idom[block] = result;
+                    changed = true;
+                }
+            }
+        }
+        idom[0] = IR_NONE;
+        return idom;
+    }
+
+    bool dominates(const std::vector<std::uint32_t> &idom, std::uint32_t a, std::uint32_t b) {
+        while (b != IR_NONE && b != a) {
+            b = idom[b];
+        }
+        return b == a;
+    }
+
+    void IrFunction::compact() {
+        for (IrBlock &block : blocks) {
+            block.insts.erase(std::remove_if(block.insts.begin(), block.insts.end(),
+                                             [this](std::uint32_t inst) { return insts[inst].removed; }),
+                              block.insts.end());
+        }
+    }
+
+    void IrFunction::forwardArgs(std::vector<std::uint32_t> &forward) {
+        auto find = [&forward](std::uint32_t value) {
+            std::uint32_t root = value;
+            while (forward[root] != root) {
+                root = forward[root];
+            }
+            while (forward[value] != root) {
+                std::uint32_t next = forward[value];
+                forward[value] = root;
+                value = next;
+            }
+            return root;
+        };
+        for (IrInst &inst : insts) {
+            for (std::uint32_t &arg : inst.args) {
+                arg = find(arg);
+            }
+        }
+    }
+
+    void IrFunction::dump(std::ostream &os) const {
+        os << "function " << name << " (params " << param_count << ")\n";
+        for (std::uint32_t b : order) {
+            const IrBlock &block = blocks[b];
+            os << "b" << b << ":";
+            if (!block.preds.empty()) {
+                os << " ; preds";
+                for (std::uint32_t pred : block.preds) {
+                    os << " b" << pred;
+                }
+            }
+            os << "\n";
+            for (std::uint32_t i : block.insts) {
+                const IrInst &inst = insts[i];
+                os << "  ";
+                if (inst.defines()) {
+                    os << "v" << i << " = ";
+                }
+                switch (inst.kind) {
+                    case IrKind::PARAM:
+                        os << "PARAM " << inst.reg;
+                        break;
+                    case IrKind::UNDEF:
+                        os << "UNDEF";
+                        break;
+                    case IrKind::PHI:
+                        os << "PHI";
+                        break;
+                    case IrKind::INST:
+                        os << getOpcodeName(inst.op);
+                        if (inst.isConstant() || inst.isCall() || inst.op == Opcode::ADDI_I64
+                            || inst.op == Opcode::TRUNC_I || inst.op == Opcode::TRUNC_U || inst.op == Opcode::NEWARR) {
+                            os << " #" << inst.imm;
+                        }
+                        break;
+                }
+                for (std::uint32_t arg : inst.args) {
+                    os << " v" << arg;
+                }
+                for (std::uint32_t succ : inst.isTerminator() ? block.succs : std::vector<std::uint32_t>()) {
+                    os << " b" << succ;
+                }
+                if (inst.ref) {
+                    os << " ; string";
+                }
+                os << "\n";
+            }
+        }
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,82 @@
+#ifndef __LETT_IR_IR_H__
+#define __LETT_IR_IR_H__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "bytecode.h"
+
+namespace Lett {
+
+    constexpr std::uint32_t IR_NONE = static_cast<std::uint32_t>(-1);
+    constexpr unsigned IR_NO_REG = static_cast<unsigned>(-1);
+
+    enum class IrKind : std::uint8_t {
+        PARAM,      // 参数，在入口块中定义
+        UNDEF,      // 未写入过的寄存器的值，不生成代码
+        PHI,        // φ函数，args与所在基本块的preds一一对应
+        INST        // 虚拟机指令
+    };
+
+    // SSA形式的指令。每条指令至多定义一个值，值用定义它的指令在IrFunction::insts中的下标表示。
+    // 操作码沿用虚拟机的指令，寄存器操作数换成了值：
+    //   - SETARR不定义值，args为数组、下标和元素
+    //   - 调用指令（CALL、TAILCALL、NATIVE、SPAWN、SPAWN_STR）的args为全部参数，原来依次放在从A开始的寄存器中
+    //   - 跳转指令的目标由所在基本块的succs表示
+    struct IrInst {
+        IrKind kind;
+        Opcode op;
+        std::uint32_t block;
+        std::uint32_t line;             // 源代码的行号
+        std::int32_t imm;               // 不是寄存器的操作数：LOADI的sBx，ADDI_I64的sC，TRUNC_I/TRUNC_U/NEWARR的C，
+                                        // LOADK、LOADS、调用指令的Bx
+        unsigned reg;                   // 提升前定义该值的寄存器，调用指令为参数的第一个寄存器；优化时新增的值为IR_NO_REG
+        bool ref;                       // 值为字符串、大整数或数组，在安全点处活跃时写入栈映射
+        bool removed;
+        std::vector<std::uint32_t> args;
+
+        bool defines() const;           // 是否定义了一个值
+        bool isTerminator() const;      // 跳转与返回，是基本块的最后一条指令
+        bool isCall() const;            // 参数放在连续寄存器中的调用指令，调用会改写从A开始的所有寄存器
+        bool isConstant() const;        // LOADI、LOADK或LOADS，可以在需要的地方重新生成
+        bool isPure() const;            // 结果只取决于操作数，没有副作用（除零错误除外）
+        bool mayThrow() const;          // 整数除法与取余可能抛出除零错误
+        bool allocates() const;         // CONCAT、NEWARR与大整数运算在堆上分配结果，分配时操作数仍在使用
+        bool isSafepoint() const;       // 可能进行垃圾回收，需要栈映射
+    };
+
+    struct IrBlock {
+        std::vector<std::uint32_t> insts;   // φ函数在前，最后一条是终结指令；顺序执行到下一个块的以JMP结束
+        std::vector<std::uint32_t> preds;
+        std::vector<std::uint32_t> succs;   // 条件跳转为[跳转目标, 条件不成立时的后继]
+    };
+
+    // 一个函数的SSA形式：基本块组成的控制流图。块0为入口块，定义参数及唯一的未定义值，
+    // 顺序执行到原来的第一条指令所在的块
+    struct IrFunction {
+        std::string name;
+        std::uint32_t param_count;
+        std::uint32_t undef;                // 未定义值
+        std::vector<IrInst> insts;
+        std::vector<IrBlock> blocks;
+        std::vector<std::uint32_t> order;   // 生成字节码时基本块的排列顺序
+
+        std::uint32_t addBlock();
+        std::uint32_t addInst(IrKind kind, Opcode op, std::uint32_t block, std::uint32_t line, unsigned reg);
+        // 从入口块可以到达的基本块的逆后序
+        std::vector<std::uint32_t> reversePostorder() const;
+        // 各基本块的直接支配者（Cooper等人的迭代算法），入口块及不可到达的块为IR_NONE
+        std::vector<std::uint32_t> dominators(const std::vector<std::uint32_t> &rpo) const;
+        // 删除各基本块中标记为removed的指令
+        void compact();
+        // 把每条指令的参数替换为forward中的值，forward中的值可以再被替换
+        void forwardArgs(std::vector<std::uint32_t> &forward);
+        void dump(std::ostream &os) const;
+    };
+
+    bool dominates(const std::vector<std::uint32_t> &idom, std::uint32_t a, std::uint32_t b);
+
+}   // namespace Lett.
+
+#endif // __LETT_IR_IR_H__
@@ -0,0 +1,645 @@
+#include <algorithm>
+#include "register_allocator.h"
+
+namespace Lett {
+
+    namespace {
+        // 值的集合，用于活跃性分析
+        class ValueSet {
+        private:
+            std::vector<std::uint64_t> _words;
+        public:
+            explicit ValueSet(std::size_t size = 0) : _words((size + 63) / 64, 0) {}
+
+            bool test(std::uint32_t value) const { return (_words[value / 64] >> (value % 64) & 1) != 0; }
+            void set(std::uint32_t value) { _words[value / 64] |= 1ULL << (value % 64); }
+            void reset(std::uint32_t value) { _words[value / 64] &= ~(1ULL << (value % 64)); }
+            void unite(const ValueSet &other) {
+                for (std::size_t i = 0; i < _words.size(); ++i) {
+                    _words[i] |= other._words[i];
+                }
+            }
+            void subtract(const ValueSet &other) {
+                for (std::size_t i = 0; i < _words.size(); ++i) {
+                    _words[i] &= ~other._words[i];
+                }
+            }
+            bool operator!=(const ValueSet &other) const { return _words != other._words; }
+
+            template <typename F>
+            void each(F f) const {
+                for (std::size_t i = 0; i < _words.size(); ++i) {
+                    for (std::uint64_t word = _words[i]; word != 0; word &= word - 1) {
+                        f(static_cast<std::uint32_t>(i * 64 + static_cast<unsigned>(__builtin_ctzll(word))));
+                    }
+                }
+            }
+        };
+
+        bool hasPhi(const IrFunction &fn, std::uint32_t block) {
+            const IrBlock &b = fn.blocks[block];
+            return !b.insts.empty() && fn.insts[b.insts[0]].kind == IrKind::PHI;
+        }
+
+        std::size_t predIndex(const IrBlock &block, std::uint32_t pred) {
+            return static_cast<std::size_t>(std::find(block.preds.begin(), block.preds.end(), pred) - block.preds.begin());
+        }
+
+        // 不是跳转和调用的指令，a为结果的寄存器，b、c为参数的寄存器
+        Instruction encode(const IrInst &inst, unsigned a, unsigned b, unsigned c) {
+            switch (inst.op) {
+                case Opcode::LOADI:
+                    return encodeAsBx(inst.op, a, inst.imm);
+                case Opcode::LOADK:
+                case Opcode::LOADS:
+                    return encodeABx(inst.op, a, static_cast<unsigned>(inst.imm));
+                case Opcode::ADDI_I64:
+                case Opcode::TRUNC_I:
+                case Opcode::TRUNC_U:
+                case Opcode::NEWARR:
+                    return encodeABC(inst.op, a, b, static_cast<unsigned>(inst.imm) & 0xFF);
+                case Opcode::RET:
+                    return encodeABC(inst.op, b, 0, 0);
+                default:
+                    return encodeABC(inst.op, a, b, c);
+            }
+        }
+    }   // namespace
+
+    RegisterAllocator::RegisterAllocator()
+        : _fn(nullptr), _base(0), _extra(0), _scratch(IR_NO_REG), _cycle(false), _max(0), _interference(), _across(),
+          _roots(), _used(), _span(), _displaced(), _slot() {
+    }
+
+    // 有多个后继的块到有φ函数的块的边上插入新的块，在其中进行φ函数的复制
+    void RegisterAllocator::_split_critical_edges() {
+        IrFunction &fn = *_fn;
+        std::vector<std::uint32_t> order = fn.order;
+        for (std::uint32_t b : order) {
+            if (fn.blocks[b].succs.size() < 2) {
+                continue;
+            }
+            for (std::size_t k = 0; k < fn.blocks[b].succs.size(); ++k) {
+                std::uint32_t s = fn.blocks[b].succs[k];
+                if (!hasPhi(fn, s)) {
+                    continue;
+                }
+                std::uint32_t e = fn.addBlock();
+                std::uint32_t line = fn.insts[fn.blocks[b].insts.back()].line;
+                fn.blocks[e].insts.push_back(fn.addInst(IrKind::INST, Opcode::JMP, e, line, IR_NO_REG));
+                fn.blocks[e].preds.push_back(b);
+                fn.blocks[e].succs.push_back(s);
+                fn.blocks[b].succs[k] = e;
+                fn.blocks[s].preds[predIndex(fn.blocks[s], b)] = e;
+                fn.order.insert(std::find(fn.order.begin(), fn.order.end(), s), e);
+            }
+        }
+    }
+
+    // 活跃性分析，建立干涉图，记录每个调用之后仍然活跃的值及安全点处的字符串值
+    void RegisterAllocator::_analyze() {
+        IrFunction &fn = *_fn;
+        std::size_t count = fn.insts.size();
+        std::size_t blocks = fn.blocks.size();
+        _interference.assign(count, {});
+        _across.assign(count, {});
+        _roots.assign(count, {});
+        _used.assign(count, false);
+        _span.assign(count, 0);
+
+        std::vector<ValueSet> defs(blocks, ValueSet(count));
+        std::vector<ValueSet> uses(blocks, ValueSet(count));
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                const IrInst &inst = fn.insts[i];
+                for (std::uint32_t arg : inst.args) {
+                    if (arg == fn.undef) {
+                        continue;
+                    }
+                    _used[arg] = true;
+                    if (inst.kind != IrKind::PHI && !defs[b].test(arg)) {
+                        uses[b].set(arg);
+                    }
+                }
+                if (inst.defines()) {
+                    defs[b].set(i);
+                }
+            }
+        }
+        // live_in不包括块中的φ函数，φ函数的参数在对应的前驱的出口处活跃
+        std::vector<std::uint32_t> rpo = fn.reversePostorder();
+        std::vector<ValueSet> live_in(blocks, ValueSet(count));
+        std::vector<ValueSet> live_out(blocks, ValueSet(count));
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto it = rpo.rbegin(); it != rpo.rend(); ++it) {
+                std::uint32_t b = *it;
+                ValueSet out(count);
+                for (std::uint32_t s : fn.blocks[b].succs) {
+                    out.unite(live_in[s]);
+                    std::size_t k = predIndex(fn.blocks[s], b);
+                    for (std::uint32_t phi : fn.blocks[s].insts) {
+                        if (fn.insts[phi].kind != IrKind::PHI) {
+                            break;
+                        }
+                        if (fn.insts[phi].args[k] != fn.undef) {
+                            out.set(fn.insts[phi].args[k]);
+                        }
+                    }
+                }
+                ValueSet in = out;
+                in.subtract(defs[b]);
+                in.unite(uses[b]);
+                live_out[b] = std::move(out);
+                if (in != live_in[b]) {
+                    live_in[b] = std::move(in);
+                    changed = true;
+                }
+            }
+        }
+
+        auto interfere = [this](std::uint32_t a, std::uint32_t b) {
+            _interference[a].push_back(b);
+            _interference[b].push_back(a);
+        };
+        for (std::uint32_t b : rpo) {
+            live_in[b].each([this](std::uint32_t value) { _span[value]++; });
+            ValueSet live = live_out[b];
+            const IrBlock &block = fn.blocks[b];
+            std::vector<std::uint32_t> heads;      // φ函数及参数，在块的开始处同时定义
+            for (auto it = block.insts.rbegin(); it != block.insts.rend(); ++it) {
+                std::uint32_t i = *it;
+                const IrInst &inst = fn.insts[i];
+                if (inst.kind != IrKind::INST) {
+                    if (inst.kind != IrKind::UNDEF) {
+                        heads.push_back(i);
+                    }
+                    continue;
+                }
+                if (inst.defines()) {
+                    live.reset(i);
+                    live.each([&](std::uint32_t value) { interfere(i, value); });
+                }
+                if (inst.isCall()) {
+                    live.each([&](std::uint32_t value) { _across[i].push_back(value); });
+                }
+                if (inst.isSafepoint()) {
+                    live.each([&](std::uint32_t value) {
+                        if (fn.insts[value].ref) {
+                            _roots[i].push_back(value);
+                        }
+                    });
+                    // CONCAT和大整数运算分配结果时其参数仍在使用。调用的参数已复制到被调用者的栈帧中，
+                    // 窗口中的寄存器由被调用者改写，不能作为调用者的根
+                    for (std::uint32_t arg : inst.args) {
+                        if (!inst.isCall() && arg != fn.undef && fn.insts[arg].ref && !live.test(arg)) {
+                            _roots[i].push_back(arg);
+                        }
+                    }
+                }
+                for (std::uint32_t arg : inst.args) {
+                    if (arg != fn.undef) {
+                        live.set(arg);
+                    }
+                }
+            }
+            for (std::uint32_t head : heads) {
+                live.reset(head);
+            }
+            for (std::size_t h = 0; h < heads.size(); ++h) {
+                live.each([&](std::uint32_t value) { interfere(heads[h], value); });
+                for (std::size_t other = 0; other < h; ++other) {
+                    interfere(heads[h], heads[other]);
+                }
+            }
+        }
+    }
+
+    // 先让每个值使用原来的寄存器，再把冲突的值移到新增的寄存器中
+    void RegisterAllocator::_assign() {
+        IrFunction &fn = *_fn;
+        std::size_t count = fn.insts.size();
+        _displaced.assign(count, false);
+        _slot.assign(count, IR_NO_REG);
+        _extra = 0;
+        std::vector<std::uint32_t> values;     // 需要寄存器的值，按在代码中的顺序
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                const IrInst &inst = fn.insts[i];
+                if (inst.defines() && inst.kind != IrKind::UNDEF) {
+                    values.push_back(i);
+                    _slot[i] = inst.reg;
+                    _displaced[i] = inst.reg == IR_NO_REG;
+                }
+            }
+        }
+
+        // 跨越调用的值不能在调用的参数窗口中
+        for (std::uint32_t v : values) {
+            if (fn.insts[v].isCall()) {
+                for (std::uint32_t value : _across[v]) {
+                    if (!_displaced[value] && _slot[value] >= fn.insts[v].reg) {
+                        _displaced[value] = true;
+                    }
+                }
+            }
+        }
+
+        // 保持原来的寄存器可以省去的复制：与φ函数的参数或结果在同一寄存器中、在调用的参数窗口中的对应位置
+        std::vector<std::vector<std::uint32_t>> related(count);
+        std::vector<unsigned> affinity(count, 0);
+        for (std::uint32_t v : values) {
+            const IrInst &inst = fn.insts[v];
+            if (inst.kind == IrKind::PHI) {
+                for (std::uint32_t arg : inst.args) {
+                    if (arg != fn.undef) {
+                        related[v].push_back(arg);
+                        related[arg].push_back(v);
+                    }
+                }
+            }
+        }
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                const IrInst &inst = fn.insts[i];
+                if (!inst.isCall()) {
+                    continue;
+                }
+                for (std::size_t k = 0; k < inst.args.size(); ++k) {
+                    if (inst.args[k] != fn.undef && fn.insts[inst.args[k]].reg == inst.reg + k) {
+                        affinity[inst.args[k]]++;
+                    }
+                }
+            }
+        }
+        for (std::uint32_t v : values) {
+            for (std::uint32_t other : related[v]) {
+                if (fn.insts[other].reg == fn.insts[v].reg) {
+                    affinity[v]++;
+                }
+            }
+        }
+        // 使用同一寄存器的两个值同时活跃时移走一个：可以省去的复制较少的，其次是活跃范围较长的
+        auto victim = [&](std::uint32_t a, std::uint32_t b) {
+            if (affinity[a] != affinity[b]) {
+                return affinity[a] < affinity[b] ? a : b;
+            }
+            if (_span[a] != _span[b]) {
+                return _span[a] > _span[b] ? a : b;
+            }
+            return std::max(a, b);
+        };
+        for (std::uint32_t v : values) {
+            for (std::uint32_t other : _interference[v]) {
+                if (_displaced[v]) {
+                    break;
+                }
+                if (other != v && !_displaced[other] && _slot[other] == _slot[v]) {
+                    _displaced[victim(v, other)] = true;
+                }
+            }
+        }
+
+        // 新增的寄存器：按干涉图贪心着色，优先与相关的值使用同一寄存器
+        for (std::uint32_t v : values) {
+            if (_displaced[v]) {
+                _slot[v] = IR_NO_REG;
+            }
+        }
+        std::vector<bool> taken;
+        for (std::uint32_t v : values) {
+            if (!_displaced[v]) {
+                continue;
+            }
+            taken.assign(_extra + 1, false);
+            for (std::uint32_t other : _interference[v]) {
+                if (_displaced[other] && _slot[other] != IR_NO_REG) {
+                    taken[_slot[other]] = true;
+                }
+            }
+            unsigned slot = IR_NO_REG;
+            for (std::uint32_t other : related[v]) {
+                if (_displaced[other] && _slot[other] != IR_NO_REG && !taken[_slot[other]]) {
+                    slot = _slot[other];
+                    break;
+                }
+            }
+            if (slot == IR_NO_REG) {
+                slot = static_cast<unsigned>(std::find(taken.begin(), taken.end(), false) - taken.begin());
+            }
+            _slot[v] = slot;
+            _extra = std::max(_extra, slot + 1);
+        }
+    }
+
+    unsigned RegisterAllocator::_location(std::uint32_t value) const {
+        // 未定义值不会被真正读取，可以是任意寄存器
+        if (value == _fn->undef) {
+            return 0;
+        }
+        if (_displaced[value]) {
+            return _base + _slot[value];
+        }
+        return _slot[value] < _base ? _slot[value] : _slot[value] + _extra;
+    }
+
+    void RegisterAllocator::_emit(Code &out, Instruction ins, std::uint32_t line) {
+        out.code.push_back(ins);
+        out.lines.push_back(line);
+    }
+
+    // 按顺序执行并行复制：先写不再被读取的寄存器，只剩下环时把其中一个寄存器保存到_scratch
+    bool RegisterAllocator::_parallel(Moves moves, std::uint32_t line, Code &out) {
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [](const auto &move) { return move.first == move.second; }),
+                    moves.end());
+        while (!moves.empty()) {
+            auto ready = std::find_if(moves.begin(), moves.end(), [&moves](const auto &move) {
+                return std::none_of(moves.begin(), moves.end(), [&move](const auto &other) {
+                    return other.second == move.first;
+                });
+            });
+            if (ready != moves.end()) {
+                _emit(out, encodeABC(Opcode::MOVE, ready->first, ready->second, 0), line);
+                moves.erase(ready);
+                continue;
+            }
+            if (_scratch == IR_NO_REG) {
+                _cycle = true;
+                return false;
+            }
+            unsigned saved = moves[0].first;
+            _emit(out, encodeABC(Opcode::MOVE, _scratch, saved, 0), line);
+            for (auto &move : moves) {
+                if (move.second == saved) {
+                    move.second = _scratch;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool RegisterAllocator::_block(std::uint32_t b, Code &out) {
+        const IrFunction &fn = *_fn;
+        const IrBlock &block = fn.blocks[b];
+        out = Code{{}, {}, {}, nullptr, 0};
+        auto safepoint = [&](std::uint32_t i) {
+            std::bitset<MAX_REGISTERS> map;
+            for (std::uint32_t root : _roots[i]) {
+                map.set(_location(root));
+            }
+            if (map.any()) {
+                out.safepoints.emplace_back(out.code.size(), map);
+            }
+        };
+        Moves params;
+        for (std::uint32_t i : block.insts) {
+            const IrInst &inst = fn.insts[i];
+            if (inst.kind == IrKind::PARAM && _used[i]) {
+                params.emplace_back(_location(i), inst.reg);
+            }
+        }
+        if (!params.empty() && !_parallel(params, fn.insts[block.insts.back()].line, out)) {
+            return false;
+        }
+        for (std::uint32_t i : block.insts) {
+            const IrInst &inst = fn.insts[i];
+            if (inst.kind != IrKind::INST) {
+                continue;
+            }
+            if (inst.op == Opcode::JMP) {
+                // φ函数的参数复制到φ函数的寄存器中
+                std::uint32_t succ = block.succs[0];
+                std::size_t k = predIndex(fn.blocks[succ], b);
+                Moves moves;
+                for (std::uint32_t phi : fn.blocks[succ].insts) {
+                    if (fn.insts[phi].kind != IrKind::PHI) {
+                        break;
+                    }
+                    if (fn.insts[phi].args[k] != fn.undef) {
+                        moves.emplace_back(_location(phi), _location(fn.insts[phi].args[k]));
+                    }
+                }
+                if (!_parallel(moves, inst.line, out)) {
+                    return false;
+                }
+                out.branch = &inst;
+            } else if (inst.op == Opcode::JMPT || inst.op == Opcode::JMPF) {
+                out.branch = &inst;
+                out.cond = _location(inst.args[0]);
+            } else if (inst.isCall()) {
+                // 参数放到从A开始的连续寄存器中，常量直接在其中重新生成
+                unsigned window = inst.reg + _extra;
+                Moves moves;
+                std::vector<std::size_t> constants;
+                for (std::size_t k = 0; k < inst.args.size(); ++k) {
+                    std::uint32_t arg = inst.args[k];
+                    if (arg == fn.undef) {
+                        continue;
+                    }
+                    unsigned dst = window + static_cast<unsigned>(k);
+                    if (fn.insts[arg].isConstant() && _location(arg) != dst) {
+                        constants.push_back(k);
+                    } else {
+                        moves.emplace_back(dst, _location(arg));
+                    }
+                }
+                if (!_parallel(moves, inst.line, out)) {
+                    return false;
+                }
+                for (std::size_t k : constants) {
+                    _emit(out, encode(fn.insts[inst.args[k]], window + static_cast<unsigned>(k), 0, 0), inst.line);
+                }
+                _max = std::max<unsigned>(_max, window + std::max<unsigned>(static_cast<unsigned>(inst.args.size()), 1) - 1);
+                if (inst.isSafepoint()) {
+                    safepoint(i);
+                }
+                _emit(out, encodeABx(inst.op, window, static_cast<unsigned>(inst.imm)), inst.line);
+                if (inst.defines() && _used[i] && _location(i) != window) {
+                    _emit(out, encodeABC(Opcode::MOVE, _location(i), window, 0), inst.line);
+                }
+            } else {
+                unsigned args[3] = {0, 0, 0};
+                for (std::size_t k = 0; k < inst.args.size() && k < 3; ++k) {
+                    args[k] = _location(inst.args[k]);
+                }
+                if (inst.isSafepoint()) {
+                    safepoint(i);
+                }
+                if (inst.op == Opcode::SETARR) {
+                    _emit(out, encodeABC(inst.op, args[0], args[1], args[2]), inst.line);
+                } else {
+                    _emit(out, encode(inst, inst.defines() ? _location(i) : 0, args[0], args[1]), inst.line);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool RegisterAllocator::lower(IrFunction &fn, FunctionCode &code) {
+        _fn = &fn;
+        _split_critical_edges();
+        _analyze();
+        _base = code.register_count;
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                if (fn.insts[i].isCall()) {
+                    _base = std::min(_base, fn.insts[i].reg);
+                }
+            }
+        }
+        _assign();
+
+        // 生成各基本块的指令，并行复制中有环时增加一个寄存器后重新生成
+        std::vector<Code> blocks(fn.blocks.size());
+        _scratch = IR_NO_REG;
+        for (;;) {
+            _cycle = false;
+            _max = 0;
+            bool done = true;
+            for (std::uint32_t b : fn.order) {
+                if (!_block(b, blocks[b])) {
+                    done = false;
+                    break;
+                }
+            }
+            if (done) {
+                break;
+            }
+            if (!_cycle || _scratch != IR_NO_REG) {
+                return false;
+            }
+            _scratch = _base + _extra++;
+        }
+        std::uint32_t registers = code.param_count;
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                if (fn.insts[i].defines() && i != fn.undef) {
+                    registers = std::max(registers, _location(i) + 1);
+                }
+            }
+        }
+        registers = std::max(registers, _max + 1);
+        if (_scratch != IR_NO_REG) {
+            registers = std::max(registers, _scratch + 1);
+        }
+        if (registers > MAX_REGISTERS) {
+            return false;
+        }
+
+        // 跳过只有一条无条件跳转的块，跳转到它们的改为跳转到最终的目标
+        std::size_t size = fn.blocks.size();
+        std::vector<bool> skip(size, false);
+        for (std::uint32_t b : fn.order) {
+            skip[b] = b != 0 && blocks[b].code.empty() && blocks[b].branch != nullptr
+                      && blocks[b].branch->op == Opcode::JMP;
+        }
+        std::vector<std::uint32_t> forward(size, IR_NONE);
+        for (std::uint32_t b : fn.order) {
+            std::vector<std::uint32_t> chain;
+            std::uint32_t target = b;
+            for (;;) {
+                if (forward[target] != IR_NONE) {
+                    target = forward[target];
+                    break;
+                }
+                if (!skip[target]) {
+                    forward[target] = target;
+                    break;
+                }
+                if (std::find(chain.begin(), chain.end(), target) != chain.end()) {
+                    // 空的无限循环，保留其中的跳转
+                    skip[target] = false;
+                    forward[target] = target;
+                    break;
+                }
+                chain.push_back(target);
+                target = fn.blocks[target].succs[0];
+            }
+            for (std::uint32_t block : chain) {
+                if (forward[block] == IR_NONE) {
+                    forward[block] = target;
+                }
+            }
+        }
+        std::vector<std::uint32_t> layout;
+        for (std::uint32_t b : fn.order) {
+            if (!skip[b]) {
+                layout.push_back(b);
+            }
+        }
+
+        std::vector<Instruction> result;
+        std::vector<std::uint32_t> lines;
+        std::vector<std::pair<std::size_t, std::bitset<MAX_REGISTERS>>> safepoints;
+        std::vector<std::size_t> start(size, 0);
+        std::vector<std::pair<std::size_t, std::uint32_t>> jumps;      // 跳转指令的下标及目标块
+        auto jump = [&](Opcode op, unsigned a, std::uint32_t target, std::uint32_t line) {
+            jumps.emplace_back(result.size(), target);
+            result.push_back(encodeAsBx(op, a, 0));
+            lines.push_back(line);
+        };
+        for (std::size_t index = 0; index < layout.size(); ++index) {
+            std::uint32_t b = layout[index];
+            std::uint32_t next = index + 1 < layout.size() ? layout[index + 1] : IR_NONE;
+            const Code &block = blocks[b];
+            start[b] = result.size();
+            for (const auto &safepoint : block.safepoints) {
+                safepoints.emplace_back(result.size() + safepoint.first, safepoint.second);
+            }
+            result.insert(result.end(), block.code.begin(), block.code.end());
+            lines.insert(lines.end(), block.lines.begin(), block.lines.end());
+            const IrInst *branch = block.branch;
+            if (branch == nullptr) {
+                continue;
+            }
+            const std::vector<std::uint32_t> &succs = fn.blocks[b].succs;
+            std::uint32_t taken = forward[succs[0]];
+            if (branch->op == Opcode::JMP || forward[succs[1]] == taken) {
+                if (taken != next) {
+                    jump(Opcode::JMP, 0, taken, branch->line);
+                }
+                continue;
+            }
+            std::uint32_t otherwise = forward[succs[1]];
+            if (otherwise == next) {
+                jump(branch->op, block.cond, taken, branch->line);
+            } else if (taken == next) {
+                jump(branch->op == Opcode::JMPT ? Opcode::JMPF : Opcode::JMPT, block.cond, otherwise, branch->line);
+            } else {
+                jump(branch->op, block.cond, taken, branch->line);
+                jump(Opcode::JMP, 0, otherwise, branch->line);
+            }
+        }
+        for (const auto &[at, target] : jumps) {
+            long offset = static_cast<long>(start[target]) - static_cast<long>(at) - 1;
+            if (offset > MAX_JUMP || offset < -MAX_JUMP) {
+                return false;
+            }
+            result[at] = encodeAsBx(opOf(result[at]), argA(result[at]), static_cast<int>(offset));
+        }
+
+        code.register_count = registers;
+        code.code = std::move(result);
+        code.lines.clear();
+        for (std::size_t pc = 0; pc < lines.size(); ++pc) {
+            if (code.lines.empty() || code.lines.back().line != lines[pc]) {
+                code.lines.push_back(LineEntry{static_cast<dword>(pc), lines[pc]});
+            }
+        }
+        code.stack_maps.clear();
+        std::size_t words = stackMapWords(registers);
+        for (const auto &[pc, map] : safepoints) {
+            std::size_t at = code.stack_maps.size();
+            code.stack_maps.resize(at + words, 0);
+            code.stack_maps[at] = pc;
+            for (unsigned reg = 0; reg < registers; ++reg) {
+                if (map.test(reg)) {
+                    code.stack_maps[at + 1 + reg / 64] |= 1ULL << (reg % 64);
+                }
+            }
+        }
+        return true;
+    }
+
+}   // namespace Lett.
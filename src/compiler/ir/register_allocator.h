@@ -0,0 +1,64 @@
+#ifndef __LETT_IR_REGISTER_ALLOCATOR_H__
+#define __LETT_IR_REGISTER_ALLOCATOR_H__
+
+#include <bitset>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "bytecode_module.h"
+#include "ir.h"
+
+namespace Lett {
+
+    // 寄存器分配与退出SSA：把优化后的SSA形式重新映射到虚拟机的寄存器上，生成字节码、栈映射和行号表。
+    // 每个值优先使用提升前的寄存器，同一φ函数的参数与结果原来就在同一寄存器中，大多不需要复制。
+    // 以下的值改用新增的寄存器（按干涉图着色）：
+    //   - 优化使其活跃范围与使用同一寄存器的另一个值重叠，如被提出循环的不变量、复制传播后活得更久的值
+    //   - 跨越调用却在调用的参数窗口（A及以上的寄存器）中的值
+    //   - 优化新增的值，如强度削减的归纳变量
+    // 新增的寄存器插在所有调用的参数窗口之下，原来在其上的寄存器整体上移，参数窗口仍然连续且不覆盖跨越调用的值。
+    // φ函数在前驱的末尾、调用的参数在调用之前用并行复制放到所需的寄存器中，关键边先被拆分
+    class RegisterAllocator {
+    private:
+        typedef std::vector<std::pair<unsigned, unsigned>> Moves;     // 并行复制：(目标寄存器, 源寄存器)
+
+        // 一个基本块生成的指令，最后的跳转在排列基本块时生成
+        struct Code {
+            std::vector<Instruction> code;
+            std::vector<std::uint32_t> lines;
+            std::vector<std::pair<std::size_t, std::bitset<MAX_REGISTERS>>> safepoints;
+            const IrInst *branch;           // 结束基本块的JMP、JMPT或JMPF，返回时为空
+            unsigned cond;                  // 条件跳转的条件所在的寄存器
+        };
+
+        IrFunction *_fn;
+        unsigned _base;                     // 新增的寄存器从这里开始
+        unsigned _extra;                    // 新增的寄存器个数
+        unsigned _scratch;                  // 打破并行复制中的环的寄存器，没有为IR_NO_REG
+        bool _cycle;                        // 并行复制需要_scratch
+        unsigned _max;                      // 使用的最大寄存器
+        std::vector<std::vector<std::uint32_t>> _interference;
+        std::vector<std::vector<std::uint32_t>> _across;     // 调用之后仍然活跃的值（不包括调用的结果）
+        std::vector<std::vector<std::uint32_t>> _roots;      // 安全点处需要写入栈映射的字符串值
+        std::vector<bool> _used;
+        std::vector<unsigned> _span;        // 值在入口处活跃的基本块数
+        std::vector<bool> _displaced;
+        std::vector<unsigned> _slot;        // 原来的寄存器，或新增寄存器的编号（_displaced时）
+
+        void _split_critical_edges();
+        void _analyze();
+        void _assign();
+        unsigned _location(std::uint32_t value) const;
+        bool _parallel(Moves moves, std::uint32_t line, Code &out);
+        void _emit(Code &out, Instruction ins, std::uint32_t line);
+        bool _block(std::uint32_t b, Code &out);
+    public:
+        RegisterAllocator();
+
+        // code为提升前的函数，成功时替换为新生成的字节码。寄存器超过MAX_REGISTERS或跳转超出范围时返回false
+        bool lower(IrFunction &fn, FunctionCode &code);
+    };  // class RegisterAllocator
+
+}   // namespace Lett.
+
+#endif // __LETT_IR_REGISTER_ALLOCATOR_H__
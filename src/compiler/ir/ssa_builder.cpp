@@ -0,0 +1,492 @@
+#include <bitset>
+#include <numeric>
+#include <utility>
+#include "natives.h"
+#include "ssa_builder.h"
+
+namespace Lett {
+
+    namespace {
+        typedef std::bitset<MAX_REGISTERS> Registers;
+
+        bool isJump(Opcode op) {
+            return op == Opcode::JMP || op == Opcode::JMPT || op == Opcode::JMPF;
+        }
+
+        bool endsBlock(Opcode op) {
+            return isJump(op) || op == Opcode::RET || op == Opcode::RET0 || op == Opcode::TAILCALL;
+        }
+
+        // 原来的一个基本块：指令的范围及后继
+        struct Range {
+            std::size_t first;
+            std::size_t last;
+            std::vector<std::size_t> succs;     // 后继的下标
+            std::uint32_t block;                // SSA形式中的基本块，不可到达时为IR_NONE
+            Registers gen;                      // 写入之前读取的寄存器
+            Registers kill;                     // 写入（包括被调用改写）的寄存器
+            Registers live_in;
+        };
+    }   // namespace
+
+    SsaBuilder::SsaBuilder(const BytecodeModule &module)
+        : _module(module) {
+    }
+
+    bool SsaBuilder::_operands(Instruction ins, unsigned registers, Operands &ops) const {
+        Opcode op = opOf(ins);
+        unsigned a = argA(ins), b = argB(ins), c = argC(ins);
+        ops.uses.clear();
+        ops.def = IR_NO_REG;
+        ops.clobber = IR_NO_REG;
+        switch (op) {
+            case Opcode::NOP:
+            case Opcode::JMP:
+            case Opcode::RET0:
+                break;
+            case Opcode::LOADI:
+            case Opcode::LOADK:
+            case Opcode::LOADS:
+                ops.def = a;
+                break;
+            case Opcode::MOVE:
+            case Opcode::ADDI_I64:
+            case Opcode::NEG_I64:
+            case Opcode::BNOT:
+            case Opcode::TRUNC_I:
+            case Opcode::TRUNC_U:
+            case Opcode::NEG_F64:
+            case Opcode::F64_TO_F32:
+            case Opcode::I64_TO_F64:
+            case Opcode::U64_TO_F64:
+            case Opcode::F64_TO_I64:
+            case Opcode::F64_TO_U64:
+            case Opcode::NOT:
+            case Opcode::NEG_BIG:
+            case Opcode::I64_TO_BIG:
+            case Opcode::U64_TO_BIG:
+            case Opcode::BIG_TO_I64:
+            case Opcode::AWAIT:
+            case Opcode::NEWARR:
+            case Opcode::LEN:
+                ops.uses.push_back(b);
+                ops.def = a;
+                break;
+            case Opcode::GETARR:
+                ops.uses.push_back(b);
+                ops.uses.push_back(c);
+                ops.def = a;
+                break;
+            case Opcode::SETARR:
+                ops.uses.push_back(a);
+                ops.uses.push_back(b);
+                ops.uses.push_back(c);
+                break;
+            case Opcode::JMPT:
+            case Opcode::JMPF:
+            case Opcode::RET:
+                ops.uses.push_back(a);
+                break;
+            case Opcode::CALL:
+            case Opcode::TAILCALL:
+            case Opcode::NATIVE:
+            case Opcode::SPAWN:
+            case Opcode::SPAWN_STR: {
+                unsigned arity;
+                if (op == Opcode::NATIVE) {
+                    if (argBx(ins) >= NATIVE_COUNT) {
+                        return false;
+                    }
+                    arity = 2 * nativeInfo(static_cast<NativeId>(argBx(ins))).arity;
+                } else {
+                    if (argBx(ins) >= _module.calls.size()) {
+                        return false;
+                    }
+                    arity = _module.calls[argBx(ins)].arity;
+                }
+                if (a + std::max(arity, 1u) > registers) {
+                    return false;
+                }
+                for (unsigned i = 0; i < arity; ++i) {
+                    ops.uses.push_back(a + i);
+                }
+                if (op != Opcode::TAILCALL) {
+                    ops.def = a;
+                    ops.clobber = a + 1;
+                }
+                break;
+            }
+            default:
+                // 其余指令到LE_BIG为止都是R[A] = R[B] op R[C]，之后是链接时才融合的超级指令
+                if (op > Opcode::LE_BIG) {
+                    return false;
+                }
+                ops.uses.push_back(b);
+                ops.uses.push_back(c);
+                ops.def = a;
+                break;
+        }
+        for (unsigned reg : ops.uses) {
+            if (reg >= registers) {
+                return false;
+            }
+        }
+        return ops.def == IR_NO_REG || ops.def < registers;
+    }
+
+    bool SsaBuilder::build(const FunctionCode &code, IrFunction &fn) const {
+        std::size_t size = code.code.size();
+        unsigned registers = code.register_count;
+        if (size == 0 || registers > MAX_REGISTERS || code.param_count > registers) {
+            return false;
+        }
+
+        // 1. 划分基本块
+        std::vector<Operands> operands(size);
+        std::vector<bool> leader(size + 1, false);
+        leader[0] = true;
+        for (std::size_t pc = 0; pc < size; ++pc) {
+            Instruction ins = code.code[pc];
+            if (!_operands(ins, registers, operands[pc])) {
+                return false;
+            }
+            if (isJump(opOf(ins))) {
+                long target = static_cast<long>(pc) + 1 + argSBx(ins);
+                if (target < 0 || target >= static_cast<long>(size)) {
+                    return false;
+                }
+                leader[static_cast<std::size_t>(target)] = true;
+            }
+            if (endsBlock(opOf(ins))) {
+                leader[pc + 1] = true;
+            }
+        }
+        std::vector<Range> ranges;
+        std::vector<std::size_t> range_of(size);
+        for (std::size_t pc = 0; pc < size; ++pc) {
+            if (leader[pc]) {
+                ranges.push_back(Range{pc, pc, {}, IR_NONE, {}, {}, {}});
+            }
+            ranges.back().last = pc;
+            range_of[pc] = ranges.size() - 1;
+        }
+        for (Range &range : ranges) {
+            Instruction ins = code.code[range.last];
+            Opcode op = opOf(ins);
+            if (isJump(op)) {
+                range.succs.push_back(range_of[static_cast<std::size_t>(static_cast<long>(range.last) + 1 + argSBx(ins))]);
+            }
+            if (!endsBlock(op) || op == Opcode::JMPT || op == Opcode::JMPF) {
+                if (range.last + 1 >= size) {
+                    return false;       // 执行到函数末尾之外
+                }
+                std::size_t next = range_of[range.last + 1];
+                // 跳转目标就是下一条指令的条件跳转只有一个后继
+                if (range.succs.empty() || range.succs[0] != next) {
+                    range.succs.push_back(next);
+                }
+            }
+        }
+
+        // 2. 可到达的块按原来的顺序编号，块0为入口块
+        std::vector<std::size_t> stack{0};
+        ranges[0].block = 0;
+        while (!stack.empty()) {
+            std::size_t r = stack.back();
+            stack.pop_back();
+            for (std::size_t succ : ranges[r].succs) {
+                if (ranges[succ].block == IR_NONE) {
+                    ranges[succ].block = 0;
+                    stack.push_back(succ);
+                }
+            }
+        }
+        fn = IrFunction{code.name, code.param_count, IR_NONE, {}, {}, {}};
+        std::uint32_t entry = fn.addBlock();
+        fn.order.push_back(entry);
+        std::vector<std::size_t> range_of_block(1, size);     // 入口块没有对应的指令
+        for (std::size_t r = 0; r < ranges.size(); ++r) {
+            if (ranges[r].block != IR_NONE) {
+                ranges[r].block = fn.addBlock();
+                fn.order.push_back(ranges[r].block);
+                range_of_block.push_back(r);
+            }
+        }
+        auto link = [&fn](std::uint32_t from, std::uint32_t to) {
+            fn.blocks[from].succs.push_back(to);
+            fn.blocks[to].preds.push_back(from);
+        };
+        link(entry, ranges[0].block);
+        for (const Range &range : ranges) {
+            if (range.block != IR_NONE) {
+                for (std::size_t succ : range.succs) {
+                    link(range.block, ranges[succ].block);
+                }
+            }
+        }
+
+        // 3. 寄存器的活跃性
+        for (std::size_t pc = 0; pc < size; ++pc) {
+            Range &range = ranges[range_of[pc]];
+            const Operands &ops = operands[pc];
+            for (unsigned reg : ops.uses) {
+                if (!range.kill.test(reg)) {
+                    range.gen.set(reg);
+                }
+            }
+            if (ops.def != IR_NO_REG) {
+                range.kill.set(ops.def);
+            }
+            for (unsigned reg = ops.clobber; reg < registers; ++reg) {
+                range.kill.set(reg);
+            }
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::size_t r = ranges.size(); r-- > 0;) {
+                Range &range = ranges[r];
+                if (range.block == IR_NONE) {
+                    continue;
+                }
+                Registers live_out;
+                for (std::size_t succ : range.succs) {
+                    live_out |= ranges[succ].live_in;
+                }
+                Registers live_in = range.gen | (live_out & ~range.kill);
+                if (live_in != range.live_in) {
+                    range.live_in = live_in;
+                    changed = true;
+                }
+            }
+        }
+
+        // 4. 在迭代支配边界上放置φ函数
+        std::vector<std::uint32_t> rpo = fn.reversePostorder();
+        std::vector<std::uint32_t> idom = fn.dominators(rpo);
+        std::vector<std::vector<std::uint32_t>> frontier(fn.blocks.size());
+        for (std::uint32_t b = 0; b < fn.blocks.size(); ++b) {
+            if (fn.blocks[b].preds.size() < 2) {
+                continue;
+            }
+            for (std::uint32_t pred : fn.blocks[b].preds) {
+                for (std::uint32_t runner = pred; runner != idom[b]; runner = idom[runner]) {
+                    std::vector<std::uint32_t> &df = frontier[runner];
+                    if (df.empty() || df.back() != b) {
+                        df.push_back(b);
+                    }
+                }
+            }
+        }
+        for (unsigned reg = 0; reg < registers; ++reg) {
+            std::vector<bool> has_phi(fn.blocks.size(), false);
+            std::vector<bool> queued(fn.blocks.size(), false);
+            std::vector<std::uint32_t> work;
+            for (const Range &range : ranges) {
+                if (range.block != IR_NONE && range.kill.test(reg)) {
+                    work.push_back(range.block);
+                    queued[range.block] = true;
+                }
+            }
+            while (!work.empty()) {
+                std::uint32_t b = work.back();
+                work.pop_back();
+                for (std::uint32_t y : frontier[b]) {
+                    if (has_phi[y] || !ranges[range_of_block[y]].live_in.test(reg)) {
+                        continue;
+                    }
+                    has_phi[y] = true;
+                    std::uint32_t phi = fn.addInst(IrKind::PHI, Opcode::NOP, y, 0, reg);
+                    fn.insts[phi].args.assign(fn.blocks[y].preds.size(), IR_NONE);
+                    fn.blocks[y].insts.push_back(phi);
+                    if (!queued[y]) {
+                        queued[y] = true;
+                        work.push_back(y);
+                    }
+                }
+            }
+        }
+
+        // 5. 沿支配树重命名
+        std::vector<std::uint32_t> lines(size, 0);
+        for (std::size_t i = 0; i < code.lines.size(); ++i) {
+            std::size_t end = i + 1 < code.lines.size() ? code.lines[i + 1].pc : size;
+            for (std::size_t pc = code.lines[i].pc; pc < end && pc < size; ++pc) {
+                lines[pc] = code.lines[i].line;
+            }
+        }
+        std::vector<const qword *> maps(size, nullptr);
+        std::size_t words = stackMapWords(registers);
+        for (std::size_t at = 0; at + words <= code.stack_maps.size(); at += words) {
+            if (code.stack_maps[at] < size) {
+                maps[code.stack_maps[at]] = &code.stack_maps[at + 1];
+            }
+        }
+        std::vector<std::uint32_t> current(registers);
+        for (unsigned reg = 0; reg < code.param_count; ++reg) {
+            std::uint32_t param = fn.addInst(IrKind::PARAM, Opcode::NOP, entry, lines[0], reg);
+            fn.blocks[entry].insts.push_back(param);
+            current[reg] = param;
+        }
+        fn.undef = fn.addInst(IrKind::UNDEF, Opcode::NOP, entry, lines[0], IR_NO_REG);
+        fn.blocks[entry].insts.push_back(fn.undef);
+        for (unsigned reg = code.param_count; reg < registers; ++reg) {
+            current[reg] = fn.undef;
+        }
+        fn.blocks[entry].insts.push_back(fn.addInst(IrKind::INST, Opcode::JMP, entry, lines[0], IR_NO_REG));
+
+        std::vector<std::vector<std::uint32_t>> children(fn.blocks.size());
+        for (std::uint32_t b : rpo) {
+            if (idom[b] != IR_NONE) {
+                children[idom[b]].push_back(b);
+            }
+        }
+        std::vector<std::pair<unsigned, std::uint32_t>> undo;     // 重命名前寄存器的值，离开子树时恢复
+        auto set = [&current, &undo](unsigned reg, std::uint32_t value) {
+            undo.emplace_back(reg, current[reg]);
+            current[reg] = value;
+        };
+        // 显式的栈：基本块，及进入该块时undo的长度（为PENDING表示尚未处理）
+        const std::size_t PENDING = static_cast<std::size_t>(-1);
+        std::vector<std::pair<std::uint32_t, std::size_t>> walk;
+        walk.emplace_back(entry, PENDING);
+        while (!walk.empty()) {
+            auto [b, mark] = walk.back();
+            if (mark != PENDING) {
+                while (undo.size() > mark) {
+                    current[undo.back().first] = undo.back().second;
+                    undo.pop_back();
+                }
+                walk.pop_back();
+                continue;
+            }
+            walk.back().second = undo.size();
+            IrBlock &block = fn.blocks[b];
+            if (b != entry) {
+                for (std::uint32_t phi : block.insts) {
+                    set(fn.insts[phi].reg, phi);
+                }
+                const Range &range = ranges[range_of_block[b]];
+                for (std::size_t pc = range.first; pc <= range.last; ++pc) {
+                    Instruction ins = code.code[pc];
+                    Opcode op = opOf(ins);
+                    const Operands &ops = operands[pc];
+                    if (maps[pc] != nullptr) {
+                        for (unsigned reg = 0; reg < registers; ++reg) {
+                            if ((maps[pc][reg / 64] >> (reg % 64) & 1) != 0 && current[reg] != fn.undef) {
+                                fn.insts[current[reg]].ref = true;
+                            }
+                        }
+                    }
+                    if (op == Opcode::NOP) {
+                        continue;
+                    }
+                    if ((op == Opcode::JMPT || op == Opcode::JMPF) && block.succs.size() == 1) {
+                        op = Opcode::JMP;   // 两个后继相同，只需要跳转
+                    }
+                    unsigned reg = ops.def;
+                    if (op == Opcode::TAILCALL) {
+                        reg = argA(ins);
+                    }
+                    std::uint32_t inst = fn.addInst(IrKind::INST, op, b, lines[pc], op == Opcode::JMP ? IR_NO_REG : reg);
+                    IrInst &ir = fn.insts[inst];
+                    if (op != Opcode::JMP) {
+                        for (unsigned use : ops.uses) {
+                            ir.args.push_back(current[use]);
+                        }
+                    }
+                    switch (op) {
+                        case Opcode::LOADI:
+                            ir.imm = argSBx(ins);
+                            break;
+                        case Opcode::ADDI_I64:
+                            ir.imm = argSC(ins);
+                            break;
+                        case Opcode::TRUNC_I:
+                        case Opcode::TRUNC_U:
+                        case Opcode::NEWARR:
+                            ir.imm = static_cast<std::int32_t>(argC(ins));
+                            break;
+                        case Opcode::LOADK:
+                        case Opcode::LOADS:
+                        case Opcode::CALL:
+                        case Opcode::TAILCALL:
+                        case Opcode::NATIVE:
+                        case Opcode::SPAWN:
+                        case Opcode::SPAWN_STR:
+                            ir.imm = static_cast<std::int32_t>(argBx(ins));
+                            break;
+                        default:
+                            break;
+                    }
+                    block.insts.push_back(inst);
+                    if (ops.def != IR_NO_REG) {
+                        set(ops.def, inst);
+                    }
+                    for (unsigned clobbered = ops.clobber; clobbered < registers; ++clobbered) {
+                        set(clobbered, fn.undef);
+                    }
+                }
+                if (!endsBlock(opOf(code.code[range.last]))) {
+                    block.insts.push_back(fn.addInst(IrKind::INST, Opcode::JMP, b, lines[range.last], IR_NO_REG));
+                }
+            }
+            for (std::uint32_t succ : block.succs) {
+                const IrBlock &target = fn.blocks[succ];
+                std::size_t index = 0;
+                while (target.preds[index] != b) {
+                    ++index;
+                }
+                for (std::uint32_t phi : target.insts) {
+                    if (fn.insts[phi].kind != IrKind::PHI) {
+                        break;
+                    }
+                    fn.insts[phi].args[index] = current[fn.insts[phi].reg];
+                }
+            }
+            for (auto it = children[b].rbegin(); it != children[b].rend(); ++it) {
+                walk.emplace_back(*it, PENDING);
+            }
+        }
+        _mark_strings(fn);
+        return true;
+    }
+
+    // 通过MOVE和φ函数相连的值类型相同，其中之一是堆上的对象则都是
+    void SsaBuilder::_mark_strings(IrFunction &fn) const {
+        std::vector<std::uint32_t> parent(fn.insts.size());
+        std::iota(parent.begin(), parent.end(), 0);
+        auto find = [&parent](std::uint32_t value) {
+            while (parent[value] != value) {
+                parent[value] = parent[parent[value]];
+                value = parent[value];
+            }
+            return value;
+        };
+        for (std::uint32_t i = 0; i < fn.insts.size(); ++i) {
+            IrInst &inst = fn.insts[i];
+            if (inst.op == Opcode::LOADS || inst.allocates()
+                || (inst.op == Opcode::NATIVE && (nativeInfo(static_cast<NativeId>(inst.imm)).ret == NATIVE_STRING
+                                                  || nativeInfo(static_cast<NativeId>(inst.imm)).ret == NATIVE_ARRAY))) {
+                inst.ref = true;
+            }
+            if (inst.kind == IrKind::PHI || (inst.kind == IrKind::INST && inst.op == Opcode::MOVE)) {
+                for (std::uint32_t arg : inst.args) {
+                    if (arg != fn.undef) {
+                        parent[find(arg)] = find(i);
+                    }
+                }
+            }
+        }
+        std::vector<bool> ref(fn.insts.size(), false);
+        for (std::uint32_t i = 0; i < fn.insts.size(); ++i) {
+            if (fn.insts[i].ref) {
+                ref[find(i)] = true;
+            }
+        }
+        for (std::uint32_t i = 0; i < fn.insts.size(); ++i) {
+            fn.insts[i].ref = ref[find(i)];
+        }
+    }
+
+}   // namespace Lett.
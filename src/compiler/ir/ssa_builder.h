@@ -0,0 +1,38 @@
+#ifndef __LETT_IR_SSA_BUILDER_H__
+#define __LETT_IR_SSA_BUILDER_H__
+
+#include <cstdint>
+#include <vector>
+#include "bytecode_module.h"
+#include "ir.h"
+
+namespace Lett {
+
+    // 把代码生成得到的一个函数（链接前的字节码）提升为SSA形式：
+    //   1. 按跳转划分基本块，删除不可到达的块。
+    //   2. 求寄存器的活跃性，在迭代支配边界上只为入口处活跃的寄存器放置φ函数（剪枝的SSA）。
+    //   3. 沿支配树重命名，每次写寄存器定义一个新值。调用之后从A+1开始的寄存器被被调用者的栈帧覆盖，其值变为未定义。
+    // 值是否为字符串或大整数来自三处：LOADS、CONCAT、大整数运算和返回字符串的内置函数的结果；原来的栈映射中标记的寄存器在该处的值；
+    // 以及通过MOVE和φ函数与它们相连的值
+    class SsaBuilder {
+    private:
+        struct Operands {
+            std::vector<unsigned> uses;     // 读取的寄存器
+            unsigned def;                   // 写入的寄存器，没有为IR_NO_REG
+            unsigned clobber;               // 调用之后从该寄存器开始都被改写，没有为IR_NO_REG
+        };
+
+        const BytecodeModule &_module;
+
+        bool _operands(Instruction ins, unsigned registers, Operands &ops) const;
+        void _mark_strings(IrFunction &fn) const;
+    public:
+        explicit SsaBuilder(const BytecodeModule &module);
+
+        // 不支持的字节码（寄存器超出范围、跳转到函数之外、链接后才有的超级指令等）返回false
+        bool build(const FunctionCode &code, IrFunction &fn) const;
+    };  // class SsaBuilder
+
+}   // namespace Lett.
+
+#endif // __LETT_IR_SSA_BUILDER_H__
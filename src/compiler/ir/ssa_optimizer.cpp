@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <utility>
+#include "register_allocator.h"
+#include "ssa_builder.h"
+#include "ssa_optimizer.h"
+
+namespace Lett {
+
+    namespace {
+        bool isCommutative(Opcode op) {
+            switch (op) {
+                case Opcode::ADD_I64:
+                case Opcode::MUL_I64:
+                case Opcode::BAND:
+                case Opcode::BOR:
+                case Opcode::BXOR:
+                case Opcode::ADD_F64:
+                case Opcode::MUL_F64:
+                case Opcode::EQ:
+                case Opcode::NE:
+                case Opcode::EQ_F64:
+                case Opcode::NE_F64:
+                case Opcode::EQ_STR:
+                case Opcode::NE_STR:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // 值是否为LOADI加载的整数常量
+        bool isImmediate(const IrFunction &fn, std::uint32_t value, std::int64_t &imm) {
+            const IrInst &inst = fn.insts[value];
+            if (inst.kind != IrKind::INST || inst.op != Opcode::LOADI) {
+                return false;
+            }
+            imm = inst.imm;
+            return true;
+        }
+
+        // 在基本块的终结指令之前插入指令
+        void insertBeforeTerminator(IrFunction &fn, std::uint32_t block, std::uint32_t inst) {
+            std::vector<std::uint32_t> &insts = fn.blocks[block].insts;
+            insts.insert(insts.end() - 1, inst);
+            fn.insts[inst].block = block;
+        }
+
+        std::vector<std::uint32_t> identity(std::size_t size) {
+            std::vector<std::uint32_t> forward(size);
+            std::iota(forward.begin(), forward.end(), 0);
+            return forward;
+        }
+    }   // namespace
+
+    SsaOptimizer::SsaOptimizer()
+        : _optimized_functions(0), _propagated_copies(0), _numbered_values(0), _hoisted_insts(0), _reduced_muls(0),
+          _removed_insts(0) {
+    }
+
+    void SsaOptimizer::_propagate_copies(IrFunction &fn) {
+        std::vector<std::uint32_t> forward = identity(fn.insts.size());
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                IrInst &inst = fn.insts[i];
+                if (inst.kind == IrKind::INST && inst.op == Opcode::MOVE) {
+                    forward[i] = inst.args[0];
+                    inst.removed = true;
+                    _propagated_copies++;
+                }
+            }
+        }
+        fn.forwardArgs(forward);
+        // 除自身和未定义值外参数都相同的φ函数就是该参数
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::uint32_t b : fn.order) {
+                for (std::uint32_t i : fn.blocks[b].insts) {
+                    IrInst &inst = fn.insts[i];
+                    if (inst.kind != IrKind::PHI) {
+                        break;
+                    }
+                    if (inst.removed) {
+                        continue;
+                    }
+                    std::uint32_t same = IR_NONE;
+                    bool unique = true;
+                    for (std::uint32_t arg : inst.args) {
+                        if (arg == i || arg == fn.undef || arg == same) {
+                            continue;
+                        }
+                        if (same != IR_NONE) {
+                            unique = false;
+                            break;
+                        }
+                        same = arg;
+                    }
+                    if (unique) {
+                        forward[i] = same == IR_NONE ? fn.undef : same;
+                        inst.removed = true;
+                        _propagated_copies++;
+                        changed = true;
+                    }
+                }
+            }
+            fn.forwardArgs(forward);
+        }
+        fn.compact();
+    }
+
+    // 按支配树的先序遍历，在支配当前块的块中已经计算过的相同表达式直接复用
+    void SsaOptimizer::_number_values(IrFunction &fn) {
+        std::vector<std::uint32_t> rpo = fn.reversePostorder();
+        std::vector<std::uint32_t> idom = fn.dominators(rpo);
+        std::vector<std::vector<std::uint32_t>> children(fn.blocks.size());
+        for (std::uint32_t b : rpo) {
+            if (idom[b] != IR_NONE) {
+                children[idom[b]].push_back(b);
+            }
+        }
+        std::vector<std::uint32_t> forward = identity(fn.insts.size());
+        std::map<std::vector<std::int64_t>, std::uint32_t> table;
+        // 显式的栈：基本块、下一个要访问的子节点、在该块中加入表的表达式
+        struct Frame {
+            std::uint32_t block;
+            std::size_t next;
+            std::vector<std::vector<std::int64_t>> added;
+        };
+        std::vector<Frame> stack;
+        auto enter = [&](std::uint32_t b) {
+            Frame frame{b, 0, {}};
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                IrInst &inst = fn.insts[i];
+                for (std::uint32_t &arg : inst.args) {
+                    arg = forward[arg];
+                }
+                if (!inst.isPure() || inst.isConstant() || inst.op == Opcode::MOVE || inst.allocates()) {
+                    continue;
+                }
+                // 常量参数按其操作码和立即数比较，不同位置加载的相同常量视为同一个值
+                std::vector<std::pair<std::int64_t, std::int64_t>> operands;
+                for (std::uint32_t arg : inst.args) {
+                    const IrInst &def = fn.insts[arg];
+                    if (def.isConstant()) {
+                        operands.emplace_back(-1 - static_cast<std::int64_t>(def.op), def.imm);
+                    } else {
+                        operands.emplace_back(arg, 0);
+                    }
+                }
+                if (isCommutative(inst.op)) {
+                    std::sort(operands.begin(), operands.end());
+                }
+                std::vector<std::int64_t> key{static_cast<std::int64_t>(inst.op), inst.imm};
+                for (const auto &[value, imm] : operands) {
+                    key.push_back(value);
+                    key.push_back(imm);
+                }
+                auto found = table.find(key);
+                if (found != table.end()) {
+                    forward[i] = found->second;
+                    inst.removed = true;
+                    _numbered_values++;
+                } else {
+                    table.emplace(key, i);
+                    frame.added.push_back(std::move(key));
+                }
+            }
+            stack.push_back(std::move(frame));
+        };
+        enter(0);
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            if (frame.next < children[frame.block].size()) {
+                enter(children[frame.block][frame.next++]);
+                continue;
+            }
+            for (const auto &key : frame.added) {
+                table.erase(key);
+            }
+            stack.pop_back();
+        }
+        // φ函数的参数可能来自之后才访问的块
+        fn.forwardArgs(forward);
+        fn.compact();
+    }
+
+    // 为每个循环头插入唯一的前置块：循环外的前驱都跳转到前置块，来自它们的φ函数参数在前置块中合并
+    void SsaOptimizer::_insert_preheaders(IrFunction &fn) {
+        std::vector<std::uint32_t> rpo = fn.reversePostorder();
+        std::vector<std::uint32_t> idom = fn.dominators(rpo);
+        for (std::uint32_t h : rpo) {
+            std::vector<std::size_t> outside, backs;
+            for (std::size_t k = 0; k < fn.blocks[h].preds.size(); ++k) {
+                (dominates(idom, h, fn.blocks[h].preds[k]) ? backs : outside).push_back(k);
+            }
+            if (backs.empty() || outside.empty()) {
+                continue;
+            }
+            if (outside.size() == 1 && fn.blocks[fn.blocks[h].preds[outside[0]]].succs.size() == 1) {
+                continue;
+            }
+            std::uint32_t pre = fn.addBlock();
+            std::uint32_t line = fn.insts[fn.blocks[h].insts.back()].line;
+            std::vector<std::uint32_t> preds;
+            for (std::size_t k : outside) {
+                std::uint32_t pred = fn.blocks[h].preds[k];
+                fn.blocks[pre].preds.push_back(pred);
+                std::replace(fn.blocks[pred].succs.begin(), fn.blocks[pred].succs.end(), h, pre);
+            }
+            preds.push_back(pre);
+            for (std::size_t k : backs) {
+                preds.push_back(fn.blocks[h].preds[k]);
+            }
+            for (std::uint32_t phi : fn.blocks[h].insts) {
+                if (fn.insts[phi].kind != IrKind::PHI) {
+                    break;
+                }
+                std::vector<std::uint32_t> args;
+                if (outside.size() == 1) {
+                    args.push_back(fn.insts[phi].args[outside[0]]);
+                } else {
+                    std::uint32_t merged = fn.addInst(IrKind::PHI, Opcode::NOP, pre, line, fn.insts[phi].reg);
+                    fn.insts[merged].ref = fn.insts[phi].ref;
+                    for (std::size_t k : outside) {
+                        fn.insts[merged].args.push_back(fn.insts[phi].args[k]);
+                    }
+                    fn.blocks[pre].insts.push_back(merged);
+                    args.push_back(merged);
+                }
+                for (std::size_t k : backs) {
+                    args.push_back(fn.insts[phi].args[k]);
+                }
+                fn.insts[phi].args = std::move(args);
+            }
+            fn.blocks[pre].insts.push_back(fn.addInst(IrKind::INST, Opcode::JMP, pre, line, IR_NO_REG));
+            fn.blocks[pre].succs.push_back(h);
+            fn.blocks[h].preds = std::move(preds);
+            fn.order.insert(std::find(fn.order.begin(), fn.order.end(), h), pre);
+        }
+    }
+
+    std::vector<SsaOptimizer::Loop> SsaOptimizer::_loops(const IrFunction &fn) const {
+        std::vector<std::uint32_t> rpo = fn.reversePostorder();
+        std::vector<std::uint32_t> idom = fn.dominators(rpo);
+        std::vector<Loop> loops;
+        for (std::uint32_t h : rpo) {
+            Loop loop{h, IR_NONE, {}, std::vector<bool>(fn.blocks.size(), false)};
+            std::vector<std::uint32_t> stack;
+            for (std::uint32_t pred : fn.blocks[h].preds) {
+                if (dominates(idom, h, pred)) {
+                    stack.push_back(pred);
+                }
+            }
+            if (stack.empty()) {
+                continue;
+            }
+            // 从回边的起点逆向到循环头
+            loop.body[h] = true;
+            while (!stack.empty()) {
+                std::uint32_t b = stack.back();
+                stack.pop_back();
+                if (!loop.body[b]) {
+                    loop.body[b] = true;
+                    stack.insert(stack.end(), fn.blocks[b].preds.begin(), fn.blocks[b].preds.end());
+                }
+            }
+            for (std::uint32_t pred : fn.blocks[h].preds) {
+                if (!loop.body[pred]) {
+                    loop.preheader = pred;
+                }
+            }
+            for (std::uint32_t b : rpo) {
+                if (loop.body[b]) {
+                    loop.blocks.push_back(b);
+                }
+            }
+            loops.push_back(std::move(loop));
+        }
+        std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+            return a.blocks.size() < b.blocks.size();
+        });
+        return loops;
+    }
+
+    // 操作数都在循环外的纯计算移到前置块的末尾。可能除零的除法和在堆上分配结果的指令不外提，
+    // 常量只在有调用参数和φ函数以外的使用时外提，否则在原处重新生成更便宜
+    void SsaOptimizer::_hoist_invariants(IrFunction &fn, const std::vector<Loop> &loops) {
+        std::vector<bool> computed(fn.insts.size(), false);
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                const IrInst &inst = fn.insts[i];
+                if (inst.kind != IrKind::PHI && !inst.isCall()) {
+                    for (std::uint32_t arg : inst.args) {
+                        computed[arg] = true;
+                    }
+                }
+            }
+        }
+        for (const Loop &loop : loops) {
+            for (std::uint32_t b : loop.blocks) {
+                std::vector<std::uint32_t> kept;
+                for (std::uint32_t i : fn.blocks[b].insts) {
+                    const IrInst &inst = fn.insts[i];
+                    bool invariant = inst.isPure() && !inst.mayThrow() && inst.op != Opcode::MOVE
+                                     && !inst.allocates() && (!inst.isConstant() || computed[i]);
+                    for (std::uint32_t arg : inst.args) {
+                        invariant = invariant && !loop.body[fn.insts[arg].block];
+                    }
+                    if (invariant) {
+                        insertBeforeTerminator(fn, loop.preheader, i);
+                        _hoisted_insts++;
+                    } else {
+                        kept.push_back(i);
+                    }
+                }
+                fn.blocks[b].insts = std::move(kept);
+            }
+        }
+    }
+
+    // 循环头的φ函数i每次迭代增加常量c，循环中的i * M改为新的归纳变量j：在前置块中j = i0 * M，每次迭代j += c * M
+    void SsaOptimizer::_reduce_strength(IrFunction &fn, const std::vector<Loop> &loops) {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> replaced;     // 被替换的乘法及新的归纳变量
+        for (const Loop &loop : loops) {
+            std::uint32_t h = loop.header;
+            std::uint32_t pre = loop.preheader;
+            std::size_t entry = static_cast<std::size_t>(
+                std::find(fn.blocks[h].preds.begin(), fn.blocks[h].preds.end(), pre) - fn.blocks[h].preds.begin());
+            std::vector<std::uint32_t> phis;
+            for (std::uint32_t i : fn.blocks[h].insts) {
+                if (fn.insts[i].kind == IrKind::PHI) {
+                    phis.push_back(i);
+                }
+            }
+            for (std::uint32_t phi : phis) {
+                std::uint32_t init = fn.insts[phi].args[entry];
+                std::uint32_t next = IR_NONE;
+                bool single = true;
+                for (std::size_t k = 0; k < fn.insts[phi].args.size(); ++k) {
+                    if (k == entry) {
+                        continue;
+                    }
+                    std::uint32_t arg = fn.insts[phi].args[k];
+                    single = single && (next == IR_NONE || next == arg);
+                    next = arg;
+                }
+                if (!single || next == IR_NONE || next == fn.undef || fn.insts[next].kind != IrKind::INST) {
+                    continue;
+                }
+                const IrInst &step = fn.insts[next];
+                std::int64_t c;
+                if (step.op == Opcode::ADDI_I64 && step.args[0] == phi) {
+                    c = step.imm;
+                } else if (!(step.op == Opcode::ADD_I64
+                             && ((step.args[0] == phi && isImmediate(fn, step.args[1], c))
+                                 || (step.args[1] == phi && isImmediate(fn, step.args[0], c))))) {
+                    continue;
+                }
+                if (init == fn.undef || !loop.body[step.block]) {
+                    continue;
+                }
+                for (std::uint32_t b : loop.blocks) {
+                    std::vector<std::uint32_t> insts = fn.blocks[b].insts;
+                    for (std::uint32_t mul : insts) {
+                        const IrInst &inst = fn.insts[mul];
+                        std::int64_t m;
+                        if (inst.kind != IrKind::INST || inst.op != Opcode::MUL_I64 || inst.removed
+                            || !((inst.args[0] == phi && isImmediate(fn, inst.args[1], m))
+                                 || (inst.args[1] == phi && isImmediate(fn, inst.args[0], m)))) {
+                            continue;
+                        }
+                        std::int64_t s = c * m;
+                        if (s < INT16_MIN || s > INT16_MAX) {
+                            continue;
+                        }
+                        std::uint32_t line = inst.line;
+                        // 前置块中的初值
+                        std::uint32_t factor = fn.addInst(IrKind::INST, Opcode::LOADI, pre, line, IR_NO_REG);
+                        fn.insts[factor].imm = static_cast<std::int32_t>(m);
+                        insertBeforeTerminator(fn, pre, factor);
+                        std::uint32_t start = fn.addInst(IrKind::INST, Opcode::MUL_I64, pre, line, IR_NO_REG);
+                        fn.insts[start].args = {init, factor};
+                        insertBeforeTerminator(fn, pre, start);
+                        // 循环头的φ函数及紧跟在i的递增之后的递增
+                        std::uint32_t j = fn.addInst(IrKind::PHI, Opcode::NOP, h, line, IR_NO_REG);
+                        std::uint32_t step_block = fn.insts[next].block;
+                        std::uint32_t increment;
+                        if (s >= INT8_MIN && s <= INT8_MAX) {
+                            increment = fn.addInst(IrKind::INST, Opcode::ADDI_I64, step_block, line, IR_NO_REG);
+                            fn.insts[increment].imm = static_cast<std::int32_t>(s);
+                            fn.insts[increment].args = {j};
+                        } else {
+                            std::uint32_t stride = fn.addInst(IrKind::INST, Opcode::LOADI, pre, line, IR_NO_REG);
+                            fn.insts[stride].imm = static_cast<std::int32_t>(s);
+                            insertBeforeTerminator(fn, pre, stride);
+                            increment = fn.addInst(IrKind::INST, Opcode::ADD_I64, step_block, line, IR_NO_REG);
+                            fn.insts[increment].args = {j, stride};
+                        }
+                        std::vector<std::uint32_t> &step_insts = fn.blocks[step_block].insts;
+                        step_insts.insert(std::find(step_insts.begin(), step_insts.end(), next) + 1, increment);
+                        fn.insts[j].args.assign(fn.blocks[h].preds.size(), increment);
+                        fn.insts[j].args[entry] = start;
+                        fn.blocks[h].insts.insert(fn.blocks[h].insts.begin(), j);
+
+                        replaced.emplace_back(mul, j);
+                        fn.insts[mul].removed = true;
+                        _reduced_muls++;
+                    }
+                }
+            }
+        }
+        std::vector<std::uint32_t> forward = identity(fn.insts.size());
+        for (const auto &[mul, j] : replaced) {
+            forward[mul] = j;
+        }
+        fn.forwardArgs(forward);
+        fn.compact();
+    }
+
+    void SsaOptimizer::_eliminate_dead_code(IrFunction &fn) {
+        std::vector<bool> live(fn.insts.size(), false);
+        std::vector<std::uint32_t> worklist;
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                const IrInst &inst = fn.insts[i];
+                if (inst.kind == IrKind::PARAM || inst.kind == IrKind::UNDEF
+                    || (inst.kind == IrKind::INST && (!inst.isPure() || inst.mayThrow()))) {
+                    live[i] = true;
+                    worklist.push_back(i);
+                }
+            }
+        }
+        while (!worklist.empty()) {
+            std::uint32_t i = worklist.back();
+            worklist.pop_back();
+            for (std::uint32_t arg : fn.insts[i].args) {
+                if (!live[arg]) {
+                    live[arg] = true;
+                    worklist.push_back(arg);
+                }
+            }
+        }
+        for (std::uint32_t b : fn.order) {
+            for (std::uint32_t i : fn.blocks[b].insts) {
+                if (!live[i]) {
+                    fn.insts[i].removed = true;
+                    _removed_insts++;
+                }
+            }
+        }
+        fn.compact();
+    }
+
+    void SsaOptimizer::optimize(IrFunction &fn) {
+        _propagate_copies(fn);
+        _number_values(fn);
+        _insert_preheaders(fn);
+        std::vector<Loop> loops = _loops(fn);
+        _hoist_invariants(fn, loops);
+        _reduce_strength(fn, loops);
+        _eliminate_dead_code(fn);
+    }
+
+    std::size_t SsaOptimizer::run(BytecodeModule &module) {
+        SsaBuilder builder(module);
+        std::size_t optimized = 0;
+        for (FunctionCode &code : module.functions) {
+            IrFunction fn;
+            if (!builder.build(code, fn)) {
+                continue;
+            }
+            optimize(fn);
+            RegisterAllocator allocator;
+            FunctionCode lowered = code;
+            if (allocator.lower(fn, lowered)) {
+                code = std::move(lowered);
+                optimized++;
+            }
+        }
+        _optimized_functions += optimized;
+        return optimized;
+    }
+
+}   // namespace Lett.
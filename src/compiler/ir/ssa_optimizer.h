@@ -0,0 +1,61 @@
+#ifndef __LETT_IR_SSA_OPTIMIZER_H__
+#define __LETT_IR_SSA_OPTIMIZER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bytecode_module.h"
+#include "ir.h"
+
+namespace Lett {
+
+    // SSA形式上的优化，在代码生成之后、链接之前对模块的每个函数进行：
+    //   - 复制传播：删除MOVE，化简参数相同的φ函数
+    //   - 全局值编号：沿支配树删除重复的纯计算
+    //   - 循环不变量外提：为每个循环插入前置块，把操作数都在循环外的纯计算移到其中
+    //   - 强度削减：循环中归纳变量与常量的乘法改为随归纳变量递增的新归纳变量
+    //   - 死代码消除
+    // 之后由RegisterAllocator重新生成字节码。不能提升或重新生成的函数保持不变
+    class SsaOptimizer {
+    private:
+        // 自然循环，内层循环在前
+        struct Loop {
+            std::uint32_t header;
+            std::uint32_t preheader;
+            std::vector<std::uint32_t> blocks;  // 按逆后序
+            std::vector<bool> body;             // 按基本块编号，是否在循环中
+        };
+
+        std::size_t _optimized_functions;
+        std::size_t _propagated_copies;
+        std::size_t _numbered_values;
+        std::size_t _hoisted_insts;
+        std::size_t _reduced_muls;
+        std::size_t _removed_insts;
+
+        void _propagate_copies(IrFunction &fn);
+        void _number_values(IrFunction &fn);
+        void _insert_preheaders(IrFunction &fn);
+        std::vector<Loop> _loops(const IrFunction &fn) const;
+        void _hoist_invariants(IrFunction &fn, const std::vector<Loop> &loops);
+        void _reduce_strength(IrFunction &fn, const std::vector<Loop> &loops);
+        void _eliminate_dead_code(IrFunction &fn);
+    public:
+        SsaOptimizer();
+
+        // 优化模块中的每个函数，返回重新生成了字节码的函数个数
+        std::size_t run(BytecodeModule &module);
+        // 在SSA形式上进行全部优化，不生成字节码
+        void optimize(IrFunction &fn);
+
+        std::size_t optimizedFunctions() const { return _optimized_functions; }
+        std::size_t propagatedCopies() const { return _propagated_copies; }
+        std::size_t numberedValues() const { return _numbered_values; }
+        std::size_t hoistedInsts() const { return _hoisted_insts; }
+        std::size_t reducedMuls() const { return _reduced_muls; }
+        std::size_t removedInsts() const { return _removed_insts; }
+    };  // class SsaOptimizer
+
+}   // namespace Lett.
+
+#endif // __LETT_IR_SSA_OPTIMIZER_H__
@@ -40,7 +40,7 @@ namespace Lett {
     }
 
     LexicalAnalyzer::LexicalAnalyzer() 
-        : _reader(nullptr), _state(LexerState::READY), _lexer_used_chars(LEXER_USED_CHARS) 
+        : _reader(nullptr), _sink(nullptr), _state(LexerState::READY), _lexer_used_chars(LEXER_USED_CHARS) 
     {
         // 初始化词法分析器
         _init_state_table(); // 初始化状态转移表
@@ -237,7 +237,7 @@ namespace Lett {
                 value += ch;
             }
         }
-        _tokens.push_back(Token(TokenType::UNKNOWN,value, line, column));
+        _emit(Token(TokenType::UNKNOWN,value, line, column));
         _state = LexerState::READY;
     }
 
@@ -276,7 +276,7 @@ namespace Lett {
                         // 如果是单行或多行注释状态，则丢弃不处理
                         if (!(_state == LexerState::SINGLINE_COMMENT || _state == LexerState::MUILTLINE_COMMENT)) {
                             TokenType type = _get_token_type();
-                            _tokens.push_back(Token(type, value, line, column));
+                            _emit(Token(type, value, line, column));
                         }
                         _state = LexerState::READY;
                     } else if (next_state == LexerState::ERROR) {
@@ -292,7 +292,7 @@ namespace Lett {
                     // 下个字符是文件结束符
                     if (!(_state == LexerState::SINGLINE_COMMENT || _state == LexerState::MUILTLINE_COMMENT)) { 
                         TokenType type = _get_token_type();
-                        _tokens.push_back(Token(type, value, line, column));
+                        _emit(Token(type, value, line, column));
                     }
                     _state = LexerState::READY;
                 }
@@ -300,6 +300,25 @@ namespace Lett {
         }
     }
 
+    void LexicalAnalyzer::analyze(TokenSink &sink) {
+        _sink = &sink;
+        try {
+            analyze();
+        } catch (...) {
+            _sink = nullptr;
+            throw;
+        }
+        _sink = nullptr;
+    }
+
+    void LexicalAnalyzer::_emit(Token &&token) {
+        if (_sink != nullptr) {
+            _sink->put(std::move(token));
+        } else {
+            _tokens.push_back(std::move(token));
+        }
+    }
+
     /*
      * 打印词法分析出的Token列表，用于测试
      */
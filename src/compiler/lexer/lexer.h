@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include "reader.h"
 #include "token.h"
+#include "token_stream.h"
 
 // 列出ASCII表中的可见字符
 #define LEXER_USED_CHARS "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$@#?`.:,;()[]{}+-*/%&|!^~<>=\\'\"\t\n "
@@ -65,6 +66,7 @@ namespace Lett {
         
         Reader *_reader;
         std::vector<Token> _tokens;
+        TokenSink *_sink;                  // 不为空时词法单元交给它，而不保存在_tokens中
         LexerState _state;
 
         std::string _lexer_used_chars;
@@ -76,12 +78,14 @@ namespace Lett {
         LexerState _get_next_state(char ch);
         TokenType _get_token_type();       // 获取最终状态的TokeType
         void _handle_error(std::string &value, std::size_t line, std::size_t column);
+        void _emit(Token &&token);
 
         static const std::unordered_map<LexerState, TokenType> &_final_state_tktp_map;
         static LexerState _get_final_state(TokenType type);
     public:
         static LexicalAnalyzer& getInstance(Reader *rd=nullptr);
         void analyze();     // 词法分析
+        void analyze(TokenSink &sink);     // 流式的词法分析，每得到一个词法单元就交给sink
         void print();       // 打印词法分析的结果
         const std::vector<Token>& getTokens() const { return _tokens; } // 获取token列表
     };
@@ -79,6 +79,8 @@
         KEYWORD_MEMBER(default) \
         KEYWORD_MEMBER(break) \
         KEYWORD_MEMBER(continue) \
+        KEYWORD_MEMBER(spawn) \
+        KEYWORD_MEMBER(await) \
         KEYWORD_MEMBER(void) \
         KEYWORD_MEMBER(int) \
         KEYWORD_MEMBER(int8) \
@@ -95,6 +97,7 @@
         KEYWORD_MEMBER(float64) \
         KEYWORD_MEMBER(char) \
         KEYWORD_MEMBER(string) \
+        KEYWORD_MEMBER(bigint) \
         KEYWORD_MEMBER(bool) \
         KEYWORD_MEMBER(class) \
         KEYWORD_MEMBER(public) \
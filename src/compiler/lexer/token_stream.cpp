@@ -0,0 +1,84 @@
+#include <chrono>
+#include <thread>
+#include "token_stream.h"
+
+namespace Lett {
+
+    namespace {
+        // 等待另一端时的退避：先自旋，再让出CPU，之后每次睡眠一小段时间
+        void backoff(unsigned &spins) {
+            if (spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            } else if (spins < 256) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            spins++;
+        }
+    }   // namespace
+
+    TokenStream::TokenStream()
+        : _ring(), _batch(), _received(), _closed(false), _cancelled(false), _failure() {
+        _batch.reserve(BATCH_SIZE);
+    }
+
+    void TokenStream::_publish() {
+        unsigned spins = 0;
+        while (!_ring.tryPush(_batch)) {
+            if (_cancelled.load(std::memory_order_relaxed)) {
+                break;
+            }
+            backoff(spins);
+        }
+        // 换回的是消费者用过的批次
+        _batch.clear();
+    }
+
+    void TokenStream::put(Token &&token) {
+        _batch.push_back(std::move(token));
+        if (_batch.size() == BATCH_SIZE) {
+            _publish();
+        }
+    }
+
+    void TokenStream::close() {
+        if (!_batch.empty()) {
+            _publish();
+        }
+        _closed.store(true, std::memory_order_release);
+    }
+
+    void TokenStream::fail(std::exception_ptr failure) {
+        _failure = failure;
+        _closed.store(true, std::memory_order_release);
+    }
+
+    bool TokenStream::next(std::vector<Token> &tokens) {
+        unsigned spins = 0;
+        while (true) {
+            // 先读_closed再尝试出队，关闭之前发布的批次不会遗漏
+            bool closed = _closed.load(std::memory_order_acquire);
+            if (_ring.tryPop(_received)) {
+                tokens.insert(tokens.end(), std::make_move_iterator(_received.begin()),
+                              std::make_move_iterator(_received.end()));
+                _received.clear();
+                return true;
+            }
+            if (closed) {
+                if (_failure) {
+                    std::rethrow_exception(_failure);
+                }
+                return false;
+            }
+            backoff(spins);
+        }
+    }
+
+    void TokenStream::cancel() {
+        _cancelled.store(true, std::memory_order_relaxed);
+    }
+
+}   // namespace Lett.
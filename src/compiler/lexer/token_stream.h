@@ -0,0 +1,90 @@
+#ifndef __LETT_LEXER_TOKEN_STREAM_H__
+#define __LETT_LEXER_TOKEN_STREAM_H__
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <vector>
+#include "token.h"
+
+namespace Lett {
+
+    // 有界的无锁单生产者单消费者环形队列，容量为2的幂。
+    // 元素通过交换进出队列：出队时把调用者的对象换入槽位，下次入队时生产者再把它换回，
+    // 元素为vector时其已分配的内存可以在生产者和消费者之间循环使用
+    template <typename T, std::size_t Capacity>
+    class SpscRing {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    private:
+        // head只由消费者写，tail只由生产者写，分别位于不同的缓存行
+        alignas(64) std::atomic<std::size_t> _head;
+        alignas(64) std::atomic<std::size_t> _tail;
+        alignas(64) T _slots[Capacity];
+    public:
+        SpscRing() : _head(0), _tail(0), _slots() {}
+
+        // 生产者调用，队列已满时返回false
+        bool tryPush(T &value) {
+            std::size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+            std::swap(_slots[tail & (Capacity - 1)], value);
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 消费者调用，队列为空时返回false
+        bool tryPop(T &value) {
+            std::size_t head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            std::swap(_slots[head & (Capacity - 1)], value);
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+    };  // class SpscRing
+
+    // 流式词法分析时接收词法单元
+    class TokenSink {
+    public:
+        virtual ~TokenSink() = default;
+        virtual void put(Token &&token) = 0;
+    };  // class TokenSink
+
+    // 词法分析线程与语法分析线程之间的词法单元流。
+    // 生产者（词法分析器）按BATCH_SIZE个一批发布词法单元，结束时调用close()，出错时调用fail()；
+    // 消费者（语法分析器）用next()按批取出，提前退出时调用cancel()，之后生产者不再等待、丢弃其余的词法单元。
+    // 队列满或空时先自旋，再让出CPU，最后短暂睡眠，不使用锁
+    class TokenStream : public TokenSink {
+    public:
+        static constexpr std::size_t BATCH_SIZE = 256;
+        static constexpr std::size_t RING_SIZE = 64;
+    private:
+        typedef std::vector<Token> Batch;
+
+        SpscRing<Batch, RING_SIZE> _ring;
+        Batch _batch;                       // 生产者正在填充的批次
+        Batch _received;                    // 消费者最近取出的批次
+        std::atomic<bool> _closed;
+        std::atomic<bool> _cancelled;
+        std::exception_ptr _failure;        // 在_closed之前写入
+
+        void _publish();
+    public:
+        TokenStream();
+
+        // 生产者
+        void put(Token &&token) override;
+        void close();
+        void fail(std::exception_ptr failure);
+
+        // 消费者：取出下一批词法单元追加到tokens，流结束时返回false；生产者失败时重新抛出其异常
+        bool next(std::vector<Token> &tokens);
+        void cancel();
+    };  // class TokenStream
+
+}   // namespace Lett.
+
+#endif // __LETT_LEXER_TOKEN_STREAM_H__
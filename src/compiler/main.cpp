@@ -2,32 +2,238 @@
  * 编译器主程序
  * 生成编译器lett
  */
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
 #include "common.h"
+#include "image.h"
 #include "lexer/reader.h"
 #include "lexer/lexer.h"
+#include "driver/driver.h"
+#include "daemon/compile_server.h"
 
-int main(int argc, char* argv[]) {
-    Lett::ArgumentParser arg_parser("lettc");
+// 打印词法分析的结果
+static int tokenize(Lett::Reader &reader) {
+    Lett::LexicalAnalyzer& analyzer = Lett::LexicalAnalyzer::getInstance(&reader);
+    analyzer.analyze();
+    analyzer.print();
+    return 0;
+}
+
+// 注册命令行选项，编译服务器用同样的选项解析转发来的请求
+static void addOptions(Lett::ArgumentParser &arg_parser) {
     arg_parser.addOption("file", "f", "compile with file.", true, "filename");
     arg_parser.addOption("string", "s", "compile with string", true, "str");
+    arg_parser.addOption("output", "o", "write the bytecode to file, defaults to <source>.ltc.", true, "filename");
+    arg_parser.addOption("tokens", "t", "print the tokens.");
+    arg_parser.addOption("ast", "a", "print the syntax tree.");
+    arg_parser.addOption("dump", "d", "print the generated bytecode.");
+    arg_parser.addOption("jobs", "j", "compile with n threads, 0 for all cores.", true, "n");
+    arg_parser.addOption("path", "p", "search imported modules in dirs, separated by ':'.", true, "dirs");
+    arg_parser.addOption("cache", "c", "cache compiled module interfaces in dir.", true, "dir");
+    arg_parser.addOption("no-fuse", "n", "do not fuse instruction sequences into superinstructions.");
+    arg_parser.addOption("no-ssa", "O", "do not optimize the bytecode in SSA form.");
+    arg_parser.addOption("pipeline", "P", "lex on another thread while parsing the tokens already scanned.");
+    arg_parser.addOption("daemon", "D", "run as a compile server on the unix socket, see LETTC_SERVER.", true, "socket");
+}
+
+// 相对路径按工作目录cwd解释，cwd为空时（在本进程中编译）不变
+static std::string resolve(const std::string &cwd, const std::string &path) {
+    if (cwd.empty() || path.empty() || std::filesystem::path(path).is_absolute()) {
+        return path;
+    }
+    return (std::filesystem::path(cwd) / path).string();
+}
+
+// 字节码文件的路径：-o指定，或与源文件同名、扩展名为.ltc
+static std::string outputPath(const Lett::ArgumentParser &arg_parser, const std::string &cwd) {
+    if (arg_parser.givend("output")) {
+        return resolve(cwd, arg_parser.getValue("output"));
+    }
+    if (arg_parser.givend("file")) {
+        return std::filesystem::path(resolve(cwd, arg_parser.getValue("file"))).replace_extension(".ltc").string();
+    }
+    return resolve(cwd, "main.ltc");
+}
+
+// 编译入口模块及其导入的所有模块，链接为字节码文件。
+// 编译服务器中cwd为客户端的工作目录，modules为在请求之间共享的模块缓存
+static int compile(const Lett::ArgumentParser &arg_parser, const std::string &cwd, Lett::ModuleCache *modules,
+                   std::ostream &out, std::ostream &err) {
+    Lett::DriverOptions options;
+    if (arg_parser.givend("jobs")) {
+        options.jobs = static_cast<std::size_t>(std::strtoul(arg_parser.getValue("jobs").c_str(), nullptr, 10));
+    }
+    if (arg_parser.givend("path")) {
+        // 多个目录以':'分隔
+        std::string paths = arg_parser.getValue("path");
+        std::size_t begin = 0;
+        while (begin <= paths.size()) {
+            std::size_t end = paths.find(':', begin);
+            if (end == std::string::npos) {
+                end = paths.size();
+            }
+            if (end > begin) {
+                options.search_paths.push_back(resolve(cwd, paths.substr(begin, end - begin)));
+            }
+            begin = end + 1;
+        }
+    }
+    if (arg_parser.givend("cache")) {
+        options.cache_dir = resolve(cwd, arg_parser.getValue("cache"));
+    }
+    options.superinstructions = !arg_parser.givend("no-fuse");
+    options.ssa = !arg_parser.givend("no-ssa");
+    options.modules = modules;
+    // 只有一个核时词法分析和语法分析无法重叠，流水线只会增加线程间同步的开销
+    options.pipeline = arg_parser.givend("pipeline") && std::thread::hardware_concurrency() > 1;
+
+    Lett::Driver driver(options);
+    if (arg_parser.givend("file")) {
+        driver.compileFile(resolve(cwd, arg_parser.getValue("file")));
+    } else {
+        driver.compileString(arg_parser.getValue("string"), cwd.empty() ? "." : cwd);
+    }
+    for (const std::string &e : driver.getErrors()) {
+        err << e << std::endl;
+    }
+    if (driver.hasErrors()) {
+        return -1;
+    }
+    if (arg_parser.givend("ast")) {
+        Lett::dumpModule(*driver.entry().module, out);
+        return 0;
+    }
+    std::string image;
+    if (!driver.link(image)) {
+        for (const std::string &e : driver.getErrors()) {
+            err << e << std::endl;
+        }
+        return -1;
+    }
+    std::string path = outputPath(arg_parser, cwd);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!file) {
+        err << "cannot write " << path << std::endl;
+        return -1;
+    }
+    if (arg_parser.givend("dump")) {
+        Lett::Image loaded;
+        loaded.loadFromMemory(image, path);
+        Lett::disassemble(loaded, out);
+    }
+    return 0;
+}
+
+// 编译服务器处理一个请求：与命令行相同地解析参数并编译。
+// 帮助、版本和打印记号由客户端自己处理，不会转发
+static int handle(const Lett::CompileRequest &request, Lett::ModuleCache &modules, std::ostream &out, std::ostream &err) {
+    std::vector<std::string> args;
+    args.push_back("lettc");
+    for (const std::string &arg : request.args) {
+        if (arg == "-h" || arg == "--help" || arg == "-v" || arg == "--version") {
+            err << "option " << arg << " is not supported by the compile server" << std::endl;
+            return -1;
+        }
+        args.push_back(arg);
+    }
+    std::vector<char *> argv;
+    for (std::string &arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    Lett::ArgumentParser arg_parser("lettc");
+    addOptions(arg_parser);
+    arg_parser.parse(static_cast<int>(argv.size()), argv.data());
+    if (arg_parser.givend("daemon") || arg_parser.givend("tokens")
+        || (!arg_parser.givend("file") && !arg_parser.givend("string"))) {
+        err << "not a compile request" << std::endl;
+        return -1;
+    }
+    return compile(arg_parser, request.cwd, &modules, out, err);
+}
+
+static Lett::CompileServer *runningServer = nullptr;
+
+static void stopServer(int) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+// 作为编译服务器运行，直到收到SIGINT或SIGTERM
+static int serve(const std::string &socket_path) {
+    Lett::ModuleCache modules;
+    Lett::CompileServer server(socket_path, [&modules](const Lett::CompileRequest &request, std::ostream &out,
+                                                       std::ostream &err) {
+        return handle(request, modules, out, err);
+    });
+    server.listen();
+    // 预先初始化词法分析器的状态转移表和记号表，第一个请求不再承担
+    Lett::Driver warmup{Lett::DriverOptions()};
+    warmup.compileString("fn main() { }");
+
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.serve();
+    runningServer = nullptr;
+    std::cerr << "served " << server.served() << " requests, module cache: " << modules.hits() << " hits, "
+              << modules.misses() << " misses" << std::endl;
+    return 0;
+}
+
+// 把编译请求转发给编译服务器，服务器不可用时返回false，由本进程编译
+static bool forward(const std::string &socket_path, int argc, char *argv[], int &status) {
+    Lett::CompileRequest request;
+    std::error_code ec;
+    request.cwd = std::filesystem::current_path(ec).string();
+    if (ec) {
+        return false;
+    }
+    request.args.assign(argv + 1, argv + argc);
+    Lett::CompileResponse response;
+    if (!Lett::requestCompile(socket_path, request, response)) {
+        return false;
+    }
+    std::cout << response.out;
+    std::cerr << response.err;
+    status = response.status;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Lett::ArgumentParser arg_parser("lettc");
+    addOptions(arg_parser);
 
     try {
         arg_parser.parse(argc, argv);
+        if (arg_parser.givend("daemon")) {
+            return serve(arg_parser.getValue("daemon"));
+        }
+        if (arg_parser.givend("file") || arg_parser.givend("string")) {
+            if (!arg_parser.givend("tokens")) {
+                // 设置了LETTC_SERVER时由该套接字上的编译服务器编译
+                const char *server = std::getenv("LETTC_SERVER");
+                int status = 0;
+                if (server != nullptr && server[0] != '\0' && forward(server, argc, argv, status)) {
+                    return status;
+                }
+                return compile(arg_parser, "", nullptr, std::cout, std::cerr);
+            }
+        }
         if (arg_parser.givend("file")) {
             std::string filename = arg_parser.getValue("file");
             std::string file(filename);
             Lett::FileReader reader(file);
-            Lett::LexicalAnalyzer& analyzer = Lett::LexicalAnalyzer::getInstance(&reader);
-            analyzer.analyze();
-            analyzer.print();
-
+            return tokenize(reader);
         } else if (arg_parser.givend("string")) {
             std::string str = arg_parser.getValue("string");
             Lett::StringReader reader(str);
-            Lett::LexicalAnalyzer& analyzer = Lett::LexicalAnalyzer::getInstance(&reader);
-            analyzer.analyze();
-            analyzer.print();
+            return tokenize(reader);
         } else {
             arg_parser.printHelp();
         }
@@ -43,4 +249,4 @@ int main(int argc, char* argv[]) {
         return -1;
     }
     return 0;
-}
\ No newline at end of file
+}
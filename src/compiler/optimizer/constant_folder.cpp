@@ -0,0 +1,450 @@
+#include <cstdint>
+#include <limits>
+#include <string>
+#include "constant_folder.h"
+
+namespace Lett {
+
+    namespace {
+        // 字面量的值
+        struct Constant {
+            enum Kind { NONE, INT, FLOAT, BOOL, STRING };
+            Kind kind;
+            std::int64_t integer;
+            double real;
+            bool boolean;
+            std::string_view text;
+            TypeId type;        // 未经类型检查时为TYPE_ERROR，整数按int64处理，bigint的字面量不作为常量
+        };
+
+        Constant constantOf(const Expr *expr) {
+            Constant c{Constant::NONE, 0, 0.0, false, std::string_view(), expr->type};
+            // bigint的运算不回绕，不按64位整数折叠
+            if (expr->kind != ExprKind::LITERAL || expr->type == TYPE_BIGINT) {
+                return c;
+            }
+            const LiteralExpr *lit = expr->as<LiteralExpr>();
+            if (lit->isInteger() || lit->token == TokenType::CHAR) {
+                c.kind = Constant::INT;
+                c.integer = static_cast<std::int64_t>(lit->integer);
+            } else if (lit->token == TokenType::FLOAT) {
+                c.kind = Constant::FLOAT;
+                c.real = lit->real;
+            } else if (lit->token == TokenType::BOOL) {
+                c.kind = Constant::BOOL;
+                c.boolean = lit->boolean;
+            } else if (lit->token == TokenType::STRING) {
+                c.kind = Constant::STRING;
+                c.text = lit->text;
+            }
+            return c;
+        }
+
+        bool isBoolLiteral(const Expr *expr, bool value) {
+            return expr != nullptr && expr->kind == ExprKind::LITERAL
+                && expr->as<LiteralExpr>()->token == TokenType::BOOL
+                && expr->as<LiteralExpr>()->boolean == value;
+        }
+
+        // 64位有符号整数的回绕运算
+        std::int64_t wrap(qword value) {
+            return static_cast<std::int64_t>(value);
+        }
+
+        bool isUnsigned(TypeId type) {
+            return type == TYPE_CHAR || (TypeTable::isInteger(type) && !TypeTable::isSigned(type));
+        }
+
+        // 按类型的位宽截断整数运算的结果，与运行时的回绕结果保持一致
+        qword normalize(qword value, TypeId type) {
+            unsigned width = TypeTable::isInteger(type) || type == TYPE_CHAR ? TypeTable::width(type) : 64;
+            if (width >= 64) {
+                return value;
+            }
+            qword mask = (1ULL << width) - 1;
+            value &= mask;
+            if (TypeTable::isSigned(type) && ((value >> (width - 1)) & 1) != 0) {
+                value |= ~mask;
+            }
+            return value;
+        }
+
+        double roundFloat(double value, TypeId type) {
+            return type == TYPE_FLOAT32 ? static_cast<double>(static_cast<float>(value)) : value;
+        }
+    }   // namespace
+
+    ConstantFolder::ConstantFolder()
+        : _arena(nullptr), _folded_exprs(0), _pruned_branches(0), _removed_stmts(0) {
+    }
+
+    void ConstantFolder::run(Module &module) {
+        _arena = &module.arena();
+        for (FunctionDecl *fn : module.functions) {
+            fn->body = _block(fn->body);
+        }
+        _arena = nullptr;
+    }
+
+    /*
+     * 表达式折叠
+     */
+    Expr *ConstantFolder::_expr(Expr *expr) {
+        if (expr == nullptr) {
+            return nullptr;
+        }
+        switch (expr->kind) {
+            case ExprKind::LITERAL:
+            case ExprKind::NAME:
+                return expr;
+            case ExprKind::INC_DEC:
+                _expr(expr->as<IncDecExpr>()->target);     // 目标是数组元素时折叠其下标
+                return expr;
+            case ExprKind::UNARY:
+                return _fold_unary(expr->as<UnaryExpr>());
+            case ExprKind::BINARY:
+                return _fold_binary(expr->as<BinaryExpr>());
+            case ExprKind::ASSIGN:
+                _expr(expr->as<AssignExpr>()->target);
+                expr->as<AssignExpr>()->value = _expr(expr->as<AssignExpr>()->value);
+                return expr;
+            case ExprKind::CALL: {
+                CallExpr *call = expr->as<CallExpr>();
+                call->callee = _expr(call->callee);
+                for (Expr *&arg : call->args) {
+                    arg = _expr(arg);
+                }
+                return expr;
+            }
+            case ExprKind::MEMBER:
+                expr->as<MemberExpr>()->object = _expr(expr->as<MemberExpr>()->object);
+                return expr;
+            case ExprKind::CAST:
+                return _fold_cast(expr->as<CastExpr>());
+            case ExprKind::SPAWN:
+                _expr(expr->as<SpawnExpr>()->call);
+                return expr;
+            case ExprKind::AWAIT:
+                expr->as<AwaitExpr>()->task = _expr(expr->as<AwaitExpr>()->task);
+                return expr;
+            case ExprKind::INDEX:
+                expr->as<IndexExpr>()->array = _expr(expr->as<IndexExpr>()->array);
+                expr->as<IndexExpr>()->index = _expr(expr->as<IndexExpr>()->index);
+                return expr;
+            case ExprKind::NEW_ARRAY:
+                expr->as<NewArrayExpr>()->length = _expr(expr->as<NewArrayExpr>()->length);
+                return expr;
+        }
+        return expr;
+    }
+
+    Expr *ConstantFolder::_fold_cast(CastExpr *expr) {
+        expr->operand = _expr(expr->operand);
+        Constant c = constantOf(expr->operand);
+        TypeId to = expr->type;
+        LiteralExpr *result = nullptr;
+        if (c.kind == Constant::INT && (TypeTable::isInteger(to) || to == TYPE_CHAR)) {
+            result = _arena->create<LiteralExpr>(to == TYPE_CHAR ? TokenType::CHAR : TokenType::DEC_INTEGER,
+                                                 expr->line, expr->column);
+            result->integer = normalize(static_cast<qword>(c.integer), to);
+        } else if (c.kind == Constant::INT && TypeTable::isFloat(to)) {
+            result = _arena->create<LiteralExpr>(TokenType::FLOAT, expr->line, expr->column);
+            result->real = roundFloat(isUnsigned(c.type) ? static_cast<double>(static_cast<qword>(c.integer))
+                                                         : static_cast<double>(c.integer), to);
+        } else if (c.kind == Constant::FLOAT && TypeTable::isFloat(to)) {
+            result = _arena->create<LiteralExpr>(TokenType::FLOAT, expr->line, expr->column);
+            result->real = roundFloat(c.real, to);
+        } else if (c.kind == Constant::FLOAT && TypeTable::isInteger(to)
+                   && c.real > -9223372036854775808.0 && c.real < 9223372036854775808.0) {
+            // 超出范围的浮点数转换留到运行时处理
+            result = _arena->create<LiteralExpr>(TokenType::DEC_INTEGER, expr->line, expr->column);
+            result->integer = normalize(static_cast<qword>(static_cast<std::int64_t>(c.real)), to);
+        }
+        if (result == nullptr) {
+            return expr;
+        }
+        result->type = to;
+        _folded_exprs++;
+        return result;
+    }
+
+    Expr *ConstantFolder::_fold_unary(UnaryExpr *expr) {
+        expr->operand = _expr(expr->operand);
+        Constant c = constantOf(expr->operand);
+        LiteralExpr *result = nullptr;
+        if (expr->op == TokenType::OP_SUB && c.kind == Constant::INT) {
+            result = _arena->create<LiteralExpr>(TokenType::DEC_INTEGER, expr->line, expr->column);
+            result->integer = normalize(0ULL - static_cast<qword>(c.integer), expr->type);
+        } else if (expr->op == TokenType::OP_SUB && c.kind == Constant::FLOAT) {
+            result = _arena->create<LiteralExpr>(TokenType::FLOAT, expr->line, expr->column);
+            result->real = -c.real;
+        } else if (expr->op == TokenType::OP_BIT_NOT && c.kind == Constant::INT) {
+            result = _arena->create<LiteralExpr>(TokenType::DEC_INTEGER, expr->line, expr->column);
+            result->integer = normalize(~static_cast<qword>(c.integer), expr->type);
+        } else if (expr->op == TokenType::OP_NOT && c.kind == Constant::BOOL) {
+            result = _arena->create<LiteralExpr>(TokenType::BOOL, expr->line, expr->column);
+            result->boolean = !c.boolean;
+        }
+        if (result == nullptr) {
+            return expr;
+        }
+        result->type = expr->type;
+        _folded_exprs++;
+        return result;
+    }
+
+    Expr *ConstantFolder::_fold_binary(BinaryExpr *expr) {
+        expr->left = _expr(expr->left);
+        expr->right = _expr(expr->right);
+        // 短路运算：左操作数为常量时右操作数不会被求值
+        if ((expr->op == TokenType::OP_AND && isBoolLiteral(expr->left, false))
+            || (expr->op == TokenType::OP_OR && isBoolLiteral(expr->left, true))) {
+            _folded_exprs++;
+            return expr->left;
+        }
+
+        Constant l = constantOf(expr->left);
+        Constant r = constantOf(expr->right);
+        if (l.kind == Constant::NONE || r.kind == Constant::NONE) {
+            return expr;
+        }
+        std::uint32_t line = expr->line, column = expr->column;
+        auto makeInt = [&](qword value) {
+            LiteralExpr *lit = _arena->create<LiteralExpr>(TokenType::DEC_INTEGER, line, column);
+            lit->integer = normalize(value, expr->type);
+            return lit;
+        };
+        auto makeFloat = [&](double value) {
+            LiteralExpr *lit = _arena->create<LiteralExpr>(TokenType::FLOAT, line, column);
+            lit->real = roundFloat(value, expr->type);
+            return lit;
+        };
+        auto makeBool = [&](bool value) {
+            LiteralExpr *lit = _arena->create<LiteralExpr>(TokenType::BOOL, line, column);
+            lit->boolean = value;
+            return lit;
+        };
+
+        LiteralExpr *result = nullptr;
+        if (l.kind == Constant::INT && r.kind == Constant::INT) {
+            // 无符号整数的除法、右移及比较与有符号整数不同
+            bool u = isUnsigned(l.type);
+            qword a = static_cast<qword>(l.integer), b = static_cast<qword>(r.integer);
+            std::int64_t sa = l.integer, sb = r.integer;
+            switch (expr->op) {
+                case TokenType::OP_ADD:         result = makeInt(a + b); break;
+                case TokenType::OP_SUB:         result = makeInt(a - b); break;
+                case TokenType::OP_MUL:         result = makeInt(a * b); break;
+                case TokenType::OP_DIV:
+                case TokenType::OP_MOD:
+                    // 除零及溢出留到运行时处理
+                    if (b == 0 || (!u && sa == std::numeric_limits<std::int64_t>::min() && sb == -1)) {
+                        break;
+                    }
+                    if (u) {
+                        result = makeInt(expr->op == TokenType::OP_DIV ? a / b : a % b);
+                    } else {
+                        result = makeInt(static_cast<qword>(expr->op == TokenType::OP_DIV ? sa / sb : sa % sb));
+                    }
+                    break;
+                case TokenType::OP_BIT_AND:     result = makeInt(a & b); break;
+                case TokenType::OP_BIT_OR:      result = makeInt(a | b); break;
+                case TokenType::OP_BIT_XOR:     result = makeInt(a ^ b); break;
+                case TokenType::OP_BIT_SHIFT_LEFT:
+                    if (b < 64) {
+                        result = makeInt(a << b);
+                    }
+                    break;
+                case TokenType::OP_BIT_SHIFT_RIGHT:
+                    if (b < 64) {
+                        result = makeInt(u ? a >> b : static_cast<qword>(wrap(a) >> b));
+                    }
+                    break;
+                case TokenType::OP_EQUAL:       result = makeBool(a == b); break;
+                case TokenType::OP_NOT_EQUAL:   result = makeBool(a != b); break;
+                case TokenType::OP_LESS:        result = makeBool(u ? a < b : sa < sb); break;
+                case TokenType::OP_LESS_EQUAL:  result = makeBool(u ? a <= b : sa <= sb); break;
+                case TokenType::OP_GREAT:       result = makeBool(u ? a > b : sa > sb); break;
+                case TokenType::OP_GREAT_EQUAL: result = makeBool(u ? a >= b : sa >= sb); break;
+                default: break;
+            }
+        } else if ((l.kind == Constant::INT || l.kind == Constant::FLOAT)
+                   && (r.kind == Constant::INT || r.kind == Constant::FLOAT)) {
+            double a = l.kind == Constant::INT ? static_cast<double>(l.integer) : l.real;
+            double b = r.kind == Constant::INT ? static_cast<double>(r.integer) : r.real;
+            switch (expr->op) {
+                case TokenType::OP_ADD:         result = makeFloat(a + b); break;
+                case TokenType::OP_SUB:         result = makeFloat(a - b); break;
+                case TokenType::OP_MUL:         result = makeFloat(a * b); break;
+                case TokenType::OP_DIV:         result = makeFloat(a / b); break;
+                case TokenType::OP_EQUAL:       result = makeBool(a == b); break;
+                case TokenType::OP_NOT_EQUAL:   result = makeBool(a != b); break;
+                case TokenType::OP_LESS:        result = makeBool(a < b); break;
+                case TokenType::OP_LESS_EQUAL:  result = makeBool(a <= b); break;
+                case TokenType::OP_GREAT:       result = makeBool(a > b); break;
+                case TokenType::OP_GREAT_EQUAL: result = makeBool(a >= b); break;
+                default: break;
+            }
+        } else if (l.kind == Constant::BOOL && r.kind == Constant::BOOL) {
+            switch (expr->op) {
+                case TokenType::OP_AND:         result = makeBool(l.boolean && r.boolean); break;
+                case TokenType::OP_OR:          result = makeBool(l.boolean || r.boolean); break;
+                case TokenType::OP_BIT_AND:     result = makeBool(l.boolean & r.boolean); break;
+                case TokenType::OP_BIT_OR:      result = makeBool(l.boolean | r.boolean); break;
+                case TokenType::OP_BIT_XOR:
+                case TokenType::OP_NOT_EQUAL:   result = makeBool(l.boolean != r.boolean); break;
+                case TokenType::OP_EQUAL:       result = makeBool(l.boolean == r.boolean); break;
+                default: break;
+            }
+        } else if (l.kind == Constant::STRING && r.kind == Constant::STRING) {
+            switch (expr->op) {
+                case TokenType::OP_ADD: {
+                    result = _arena->create<LiteralExpr>(TokenType::STRING, line, column);
+                    result->text = _arena->copyString(std::string(l.text) + std::string(r.text));
+                    break;
+                }
+                case TokenType::OP_EQUAL:       result = makeBool(l.text == r.text); break;
+                case TokenType::OP_NOT_EQUAL:   result = makeBool(l.text != r.text); break;
+                default: break;
+            }
+        }
+        if (result == nullptr) {
+            return expr;
+        }
+        result->type = expr->type;
+        _folded_exprs++;
+        return result;
+    }
+
+    /*
+     * 死代码消除
+     */
+    // 语句执行后是否一定不会继续执行其后的语句
+    bool ConstantFolder::_terminates(const Stmt *stmt) {
+        if (stmt == nullptr) {
+            return false;
+        }
+        switch (stmt->kind) {
+            case StmtKind::RETURN:
+            case StmtKind::BREAK:
+            case StmtKind::CONTINUE:
+                return true;
+            case StmtKind::BLOCK: {
+                const BlockStmt *block = stmt->as<BlockStmt>();
+                return !block->stmts.empty() && _terminates(block->stmts[block->stmts.size() - 1]);
+            }
+            case StmtKind::IF: {
+                const IfStmt *s = stmt->as<IfStmt>();
+                return _terminates(s->then) && _terminates(s->otherwise);
+            }
+            default:
+                return false;
+        }
+    }
+
+    BlockStmt *ConstantFolder::_block(BlockStmt *block) {
+        std::vector<Stmt *> stmts;
+        bool changed = false;
+        for (std::size_t i = 0; i < block->stmts.size(); ++i) {
+            Stmt *stmt = _stmt(block->stmts[i]);
+            if (stmt != block->stmts[i]) {
+                changed = true;
+            }
+            if (stmt != nullptr) {
+                stmts.push_back(stmt);
+            }
+            if (_terminates(stmt) && i + 1 < block->stmts.size()) {
+                // 之后的语句不可达
+                _removed_stmts += block->stmts.size() - i - 1;
+                changed = true;
+                break;
+            }
+        }
+        if (changed) {
+            block->stmts = _arena->copyList(stmts);
+        }
+        return block;
+    }
+
+    // 返回替换后的语句，nullptr表示删除该语句
+    Stmt *ConstantFolder::_stmt(Stmt *stmt) {
+        if (stmt == nullptr) {
+            return nullptr;
+        }
+        switch (stmt->kind) {
+            case StmtKind::BLOCK:
+                return _block(stmt->as<BlockStmt>());
+            case StmtKind::VAR:
+                for (VarDecl *decl : stmt->as<VarStmt>()->decls) {
+                    decl->init = _expr(decl->init);
+                }
+                return stmt;
+            case StmtKind::EXPR: {
+                ExprStmt *s = stmt->as<ExprStmt>();
+                s->expr = _expr(s->expr);
+                if (s->expr->kind == ExprKind::LITERAL) {
+                    // 没有副作用的常量表达式语句
+                    _removed_stmts++;
+                    return nullptr;
+                }
+                return stmt;
+            }
+            case StmtKind::IF: {
+                IfStmt *s = stmt->as<IfStmt>();
+                s->cond = _expr(s->cond);
+                s->then = _block(s->then);
+                s->otherwise = _stmt(s->otherwise);
+                if (isBoolLiteral(s->cond, true)) {
+                    _pruned_branches++;
+                    return s->then;
+                }
+                if (isBoolLiteral(s->cond, false)) {
+                    _pruned_branches++;
+                    return s->otherwise;
+                }
+                return stmt;
+            }
+            case StmtKind::WHILE: {
+                WhileStmt *s = stmt->as<WhileStmt>();
+                s->cond = _expr(s->cond);
+                if (isBoolLiteral(s->cond, false)) {
+                    _pruned_branches++;
+                    return nullptr;
+                }
+                s->body = _block(s->body);
+                return stmt;
+            }
+            case StmtKind::DO_WHILE: {
+                DoWhileStmt *s = stmt->as<DoWhileStmt>();
+                s->body = _block(s->body);
+                s->cond = _expr(s->cond);
+                return stmt;
+            }
+            case StmtKind::FOR: {
+                ForStmt *s = stmt->as<ForStmt>();
+                s->init = _stmt(s->init);
+                s->cond = _expr(s->cond);
+                if (isBoolLiteral(s->cond, false)) {
+                    // 循环体不会执行，仅保留初始化语句，并保持其独立的作用域
+                    _pruned_branches++;
+                    if (s->init == nullptr) {
+                        return nullptr;
+                    }
+                    std::vector<Stmt *> init{s->init};
+                    return _arena->create<BlockStmt>(_arena->copyList(init), s->line, s->column);
+                }
+                s->step = _expr(s->step);
+                s->body = _block(s->body);
+                return stmt;
+            }
+            case StmtKind::RETURN:
+                stmt->as<ReturnStmt>()->value = _expr(stmt->as<ReturnStmt>()->value);
+                return stmt;
+            case StmtKind::BREAK:
+            case StmtKind::CONTINUE:
+                return stmt;
+        }
+        return stmt;
+    }
+
+}   // namespace Lett.
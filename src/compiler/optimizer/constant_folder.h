@@ -0,0 +1,40 @@
+#ifndef __LETT_OPTIMIZER_CONSTANT_FOLDER_H__
+#define __LETT_OPTIMIZER_CONSTANT_FOLDER_H__
+
+#include <cstddef>
+#include "ast.h"
+
+namespace Lett {
+
+    // 常量折叠与死代码消除，位于语义分析与代码生成之间
+    //   - 折叠操作数均为字面量的表达式（整数、浮点数、布尔值、字符、字符串拼接）
+    //   - 删除条件为常量的if/elif/else分支及条件恒为false的循环
+    //   - 删除return/break/continue之后不可达的语句
+    // 经过类型检查的表达式按其类型的位宽与符号折叠，未经类型检查的整数按int64处理
+    class ConstantFolder {
+    private:
+        Arena *_arena;
+        std::size_t _folded_exprs;
+        std::size_t _pruned_branches;
+        std::size_t _removed_stmts;
+
+        Expr *_expr(Expr *expr);
+        Expr *_fold_unary(UnaryExpr *expr);
+        Expr *_fold_binary(BinaryExpr *expr);
+        Expr *_fold_cast(CastExpr *expr);
+        Stmt *_stmt(Stmt *stmt);
+        BlockStmt *_block(BlockStmt *block);
+        static bool _terminates(const Stmt *stmt);
+    public:
+        ConstantFolder();
+
+        void run(Module &module);
+
+        std::size_t foldedExprs() const { return _folded_exprs; }
+        std::size_t prunedBranches() const { return _pruned_branches; }
+        std::size_t removedStmts() const { return _removed_stmts; }
+    };  // class ConstantFolder
+
+}   // namespace Lett.
+
+#endif // __LETT_OPTIMIZER_CONSTANT_FOLDER_H__
@@ -0,0 +1,114 @@
+#ifndef __LETT_PARSER_ARENA_H__
+#define __LETT_PARSER_ARENA_H__
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Lett {
+
+    // 连续存放在arena中的只读数组，用于AST子节点列表
+    template <typename T>
+    class ArenaList {
+    private:
+        T *_data;
+        std::size_t _size;
+    public:
+        ArenaList() : _data(nullptr), _size(0) {}
+        ArenaList(T *data, std::size_t size) : _data(data), _size(size) {}
+
+        std::size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        T *begin() const { return _data; }
+        T *end() const { return _data + _size; }
+        T &operator[](std::size_t i) const { return _data[i]; }
+    };
+
+    // 线性（bump-pointer）内存分配器
+    // AST节点全部分配在arena中，随arena整体释放，因此节点必须是平凡析构的
+    class Arena {
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            std::size_t size;
+        };
+        std::vector<Block> _blocks;
+        char *_cursor;
+        char *_limit;
+        std::size_t _next_block_size;
+        std::size_t _allocated;
+
+        void _grow(std::size_t min_size) {
+            std::size_t size = _next_block_size;
+            while (size < min_size) {
+                size *= 2;
+            }
+            _blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+            _cursor = _blocks.back().data.get();
+            _limit = _cursor + size;
+            if (_next_block_size < MAX_BLOCK_SIZE) {
+                _next_block_size *= 2;
+            }
+        }
+    public:
+        static constexpr std::size_t MIN_BLOCK_SIZE = 4 * 1024;
+        static constexpr std::size_t MAX_BLOCK_SIZE = 1024 * 1024;
+
+        Arena() : _cursor(nullptr), _limit(nullptr), _next_block_size(MIN_BLOCK_SIZE), _allocated(0) {}
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void *allocate(std::size_t size, std::size_t align) {
+            std::size_t space = static_cast<std::size_t>(_limit - _cursor);
+            void *p = _cursor;
+            if (_cursor == nullptr || std::align(align, size, p, space) == nullptr) {
+                _grow(size + align);
+                space = static_cast<std::size_t>(_limit - _cursor);
+                p = _cursor;
+                std::align(align, size, p, space);
+            }
+            _cursor = static_cast<char *>(p) + size;
+            _allocated += size;
+            return p;
+        }
+
+        template <typename T, typename... Args>
+        T *create(Args&&... args) {
+            static_assert(std::is_trivially_destructible<T>::value,
+                          "arena objects are never destroyed");
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // 将vector中的元素拷贝到arena中
+        template <typename T>
+        ArenaList<T> copyList(const std::vector<T> &items) {
+            static_assert(std::is_trivially_copyable<T>::value, "arena lists hold plain data");
+            if (items.empty()) {
+                return ArenaList<T>();
+            }
+            T *data = static_cast<T *>(allocate(sizeof(T) * items.size(), alignof(T)));
+            std::memcpy(static_cast<void *>(data), items.data(), sizeof(T) * items.size());
+            return ArenaList<T>(data, items.size());
+        }
+
+        std::string_view copyString(std::string_view str) {
+            if (str.empty()) {
+                return std::string_view();
+            }
+            char *data = static_cast<char *>(allocate(str.size(), 1));
+            std::memcpy(data, str.data(), str.size());
+            return std::string_view(data, str.size());
+        }
+
+        // arena中已分配的字节数
+        std::size_t allocated() const { return _allocated; }
+    };  // class Arena
+
+}   // namespace Lett.
+
+#endif // __LETT_PARSER_ARENA_H__
@@ -0,0 +1,296 @@
+#include <string>
+#include "ast.h"
+
+namespace Lett {
+
+    #define AST_MEMBER(k, c) case ExprKind::k: return #k;
+    const char *getExprKindName(ExprKind kind) {
+        switch (kind) {
+            LETT_AST_EXPR
+            default:
+                return "UNKOWN";
+        }
+    }
+    #undef AST_MEMBER
+
+    #define AST_MEMBER(k, c) case StmtKind::k: return #k;
+    const char *getStmtKindName(StmtKind kind) {
+        switch (kind) {
+            LETT_AST_STMT
+            default:
+                return "UNKOWN";
+        }
+    }
+    #undef AST_MEMBER
+
+    /*
+     * 语法树打印
+     */
+    namespace {
+        class Dumper {
+        private:
+            std::ostream &_os;
+            const TypeTable &_types;
+            int _depth;
+
+            std::ostream &_line() {
+                return _os << std::string(static_cast<std::size_t>(_depth) * 2, ' ');
+            }
+
+            void _type(const TypeNode *type) {
+                if (type != nullptr) {
+                    _os << ":" << type->name.name << (type->array ? "[]" : "");
+                }
+            }
+        public:
+            Dumper(std::ostream &os, const TypeTable &types) : _os(os), _types(types), _depth(0) {}
+
+            void expr(const Expr *e) {
+                if (e == nullptr) {
+                    _line() << "<null>\n";
+                    return;
+                }
+                _line() << getExprKindName(e->kind);
+                if (e->type != TYPE_ERROR) {
+                    // 类型检查之后打印表达式的类型
+                    _os << "<" << _types.name(e->type) << ">";
+                }
+                switch (e->kind) {
+                    case ExprKind::LITERAL: {
+                        const LiteralExpr *lit = e->as<LiteralExpr>();
+                        _os << " " << Token::getTypeName(lit->token) << " ";
+                        if (lit->token == TokenType::FLOAT) {
+                            _os << lit->real;
+                        } else if (lit->token == TokenType::BOOL) {
+                            _os << (lit->boolean ? "true" : "false");
+                        } else if (lit->token == TokenType::STRING) {
+                            _os << "\"" << lit->text << "\"";
+                        } else {
+                            _os << lit->integer;
+                        }
+                        _os << "\n";
+                        return;
+                    }
+                    case ExprKind::NAME:
+                        _os << " " << e->as<NameExpr>()->ident.name << "\n";
+                        return;
+                    case ExprKind::UNARY: {
+                        const UnaryExpr *u = e->as<UnaryExpr>();
+                        _os << " " << Token::getTypeName(u->op) << "\n";
+                        _depth++;
+                        expr(u->operand);
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::BINARY: {
+                        const BinaryExpr *b = e->as<BinaryExpr>();
+                        _os << " " << Token::getTypeName(b->op) << "\n";
+                        _depth++;
+                        expr(b->left);
+                        expr(b->right);
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::ASSIGN: {
+                        const AssignExpr *a = e->as<AssignExpr>();
+                        _os << " " << Token::getTypeName(a->op) << "\n";
+                        _depth++;
+                        expr(a->target);
+                        expr(a->value);
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::INC_DEC: {
+                        const IncDecExpr *i = e->as<IncDecExpr>();
+                        _os << " " << Token::getTypeName(i->op) << (i->prefix ? " prefix" : " postfix") << "\n";
+                        _depth++;
+                        expr(i->target);
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::CALL: {
+                        const CallExpr *c = e->as<CallExpr>();
+                        _os << "\n";
+                        _depth++;
+                        expr(c->callee);
+                        for (const Expr *arg : c->args) {
+                            expr(arg);
+                        }
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::MEMBER: {
+                        const MemberExpr *m = e->as<MemberExpr>();
+                        _os << " " << m->member.name << "\n";
+                        _depth++;
+                        expr(m->object);
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::CAST: {
+                        const CastExpr *c = e->as<CastExpr>();
+                        _os << (c->target != nullptr ? " explicit" : " implicit") << "\n";
+                        _depth++;
+                        expr(c->operand);
+                        _depth--;
+                        return;
+                    }
+                    case ExprKind::SPAWN:
+                        _os << "\n";
+                        _depth++;
+                        expr(e->as<SpawnExpr>()->call);
+                        _depth--;
+                        return;
+                    case ExprKind::AWAIT:
+                        _os << "\n";
+                        _depth++;
+                        expr(e->as<AwaitExpr>()->task);
+                        _depth--;
+                        return;
+                    case ExprKind::INDEX:
+                        _os << "\n";
+                        _depth++;
+                        expr(e->as<IndexExpr>()->array);
+                        expr(e->as<IndexExpr>()->index);
+                        _depth--;
+                        return;
+                    case ExprKind::NEW_ARRAY:
+                        _os << " " << e->as<NewArrayExpr>()->element->name.name << "\n";
+                        _depth++;
+                        expr(e->as<NewArrayExpr>()->length);
+                        _depth--;
+                        return;
+                }
+            }
+
+            void stmt(const Stmt *s) {
+                if (s == nullptr) {
+                    return;
+                }
+                _line() << getStmtKindName(s->kind);
+                switch (s->kind) {
+                    case StmtKind::BLOCK:
+                        _os << "\n";
+                        _depth++;
+                        for (const Stmt *child : s->as<BlockStmt>()->stmts) {
+                            stmt(child);
+                        }
+                        _depth--;
+                        return;
+                    case StmtKind::VAR:
+                        _os << "\n";
+                        _depth++;
+                        for (const VarDecl *decl : s->as<VarStmt>()->decls) {
+                            _line() << decl->name.name;
+                            _type(decl->type);
+                            _os << "\n";
+                            if (decl->init != nullptr) {
+                                _depth++;
+                                expr(decl->init);
+                                _depth--;
+                            }
+                        }
+                        _depth--;
+                        return;
+                    case StmtKind::EXPR:
+                        _os << "\n";
+                        _depth++;
+                        expr(s->as<ExprStmt>()->expr);
+                        _depth--;
+                        return;
+                    case StmtKind::IF: {
+                        const IfStmt *i = s->as<IfStmt>();
+                        _os << "\n";
+                        _depth++;
+                        expr(i->cond);
+                        stmt(i->then);
+                        stmt(i->otherwise);
+                        _depth--;
+                        return;
+                    }
+                    case StmtKind::WHILE: {
+                        const WhileStmt *w = s->as<WhileStmt>();
+                        _os << "\n";
+                        _depth++;
+                        expr(w->cond);
+                        stmt(w->body);
+                        _depth--;
+                        return;
+                    }
+                    case StmtKind::DO_WHILE: {
+                        const DoWhileStmt *w = s->as<DoWhileStmt>();
+                        _os << "\n";
+                        _depth++;
+                        stmt(w->body);
+                        expr(w->cond);
+                        _depth--;
+                        return;
+                    }
+                    case StmtKind::FOR: {
+                        const ForStmt *f = s->as<ForStmt>();
+                        _os << "\n";
+                        _depth++;
+                        stmt(f->init);
+                        if (f->cond != nullptr) {
+                            expr(f->cond);
+                        }
+                        if (f->step != nullptr) {
+                            expr(f->step);
+                        }
+                        stmt(f->body);
+                        _depth--;
+                        return;
+                    }
+                    case StmtKind::RETURN:
+                        _os << "\n";
+                        if (s->as<ReturnStmt>()->value != nullptr) {
+                            _depth++;
+                            expr(s->as<ReturnStmt>()->value);
+                            _depth--;
+                        }
+                        return;
+                    case StmtKind::BREAK:
+                    case StmtKind::CONTINUE:
+                        _os << "\n";
+                        return;
+                }
+            }
+
+            void function(const FunctionDecl *fn) {
+                _line() << "FUNCTION " << fn->name.name << "(";
+                for (std::size_t i = 0; i < fn->params.size(); ++i) {
+                    if (i > 0) {
+                        _os << ", ";
+                    }
+                    _os << fn->params[i]->name.name;
+                    _type(fn->params[i]->type);
+                }
+                _os << ")";
+                _type(fn->ret);
+                _os << "\n";
+                _depth++;
+                stmt(fn->body);
+                _depth--;
+            }
+
+            void import(const ImportDecl *imp) {
+                _line() << "IMPORT ";
+                for (std::size_t i = 0; i < imp->path.size(); ++i) {
+                    _os << (i > 0 ? "." : "") << imp->path[i].name;
+                }
+                _os << "\n";
+            }
+        };  // class Dumper
+    }   // namespace
+
+    void dumpModule(const Module &module, std::ostream &os) {
+        Dumper dumper(os, module.types);
+        for (const ImportDecl *imp : module.imports) {
+            dumper.import(imp);
+        }
+        for (const FunctionDecl *fn : module.functions) {
+            dumper.function(fn);
+        }
+    }
+
+}   // namespace Lett.
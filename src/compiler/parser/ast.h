@@ -0,0 +1,375 @@
+#ifndef __LETT_PARSER_AST_H__
+#define __LETT_PARSER_AST_H__
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "types.h"
+#include "token.h"
+#include "arena.h"
+#include "type_table.h"
+
+// 表达式节点类型
+#define LETT_AST_EXPR \
+        AST_MEMBER(LITERAL, LiteralExpr)    \
+        AST_MEMBER(NAME, NameExpr)          \
+        AST_MEMBER(UNARY, UnaryExpr)        \
+        AST_MEMBER(BINARY, BinaryExpr)      \
+        AST_MEMBER(ASSIGN, AssignExpr)      \
+        AST_MEMBER(INC_DEC, IncDecExpr)     \
+        AST_MEMBER(CALL, CallExpr)          \
+        AST_MEMBER(MEMBER, MemberExpr)      \
+        AST_MEMBER(CAST, CastExpr)          \
+        AST_MEMBER(SPAWN, SpawnExpr)        \
+        AST_MEMBER(AWAIT, AwaitExpr)        \
+        AST_MEMBER(INDEX, IndexExpr)        \
+        AST_MEMBER(NEW_ARRAY, NewArrayExpr)
+
+// 语句节点类型
+#define LETT_AST_STMT \
+        AST_MEMBER(BLOCK, BlockStmt)        \
+        AST_MEMBER(VAR, VarStmt)            \
+        AST_MEMBER(EXPR, ExprStmt)          \
+        AST_MEMBER(IF, IfStmt)              \
+        AST_MEMBER(WHILE, WhileStmt)        \
+        AST_MEMBER(DO_WHILE, DoWhileStmt)   \
+        AST_MEMBER(FOR, ForStmt)            \
+        AST_MEMBER(RETURN, ReturnStmt)      \
+        AST_MEMBER(BREAK, BreakStmt)        \
+        AST_MEMBER(CONTINUE, ContinueStmt)
+
+namespace Lett {
+
+    #define AST_MEMBER(k, c) k,
+    enum class ExprKind {
+        LETT_AST_EXPR
+    };
+
+    enum class StmtKind {
+        LETT_AST_STMT
+    };
+    #undef AST_MEMBER
+
+    // 名字绑定的对象种类，由语义分析阶段填写
+    enum class SymbolKind {
+        UNRESOLVED,
+        MODULE,         // import导入的模块
+        FUNCTION,       // 模块中的函数
+        PARAM,          // 函数参数
+        VARIABLE,       // 局部变量
+        NATIVE          // 虚拟机提供的内置函数，如sys.println
+    };
+
+    // 标识符，哈希值在解析时预先计算，供后续的符号表直接使用
+    struct Identifier {
+        std::string_view name;
+        std::size_t hash;
+
+        static std::size_t hashOf(std::string_view name) {
+            // FNV-1a
+            std::uint64_t h = 14695981039346656037ULL;
+            for (char ch : name) {
+                h ^= static_cast<unsigned char>(ch);
+                h *= 1099511628211ULL;
+            }
+            return static_cast<std::size_t>(h);
+        }
+        bool operator==(const Identifier &other) const {
+            return hash == other.hash && name == other.name;
+        }
+    };
+
+    // 所有AST节点的公共部分：源代码位置
+    struct Node {
+        std::uint32_t line;
+        std::uint32_t column;
+        Node(std::uint32_t l, std::uint32_t c) : line(l), column(c) {}
+    };
+
+    struct Expr : Node {
+        ExprKind kind;
+        TypeId type;        // 表达式的类型，由类型检查阶段填写
+        Expr(ExprKind k, std::uint32_t l, std::uint32_t c) : Node(l, c), kind(k), type(TYPE_ERROR) {}
+
+        template <typename T> T *as() { return static_cast<T *>(this); }
+        template <typename T> const T *as() const { return static_cast<const T *>(this); }
+    };
+
+    struct Stmt : Node {
+        StmtKind kind;
+        Stmt(StmtKind k, std::uint32_t l, std::uint32_t c) : Node(l, c), kind(k) {}
+
+        template <typename T> T *as() { return static_cast<T *>(this); }
+        template <typename T> const T *as() const { return static_cast<const T *>(this); }
+    };
+
+    // 类型标注，如`var a:int`中的int，array表示`var a:int32[]`中元素类型之后的[]
+    struct TypeNode : Node {
+        Identifier name;
+        bool array;
+        TypeId resolved;    // 类型名对应的类型，由类型检查阶段填写
+        TypeNode(Identifier n, bool a, std::uint32_t l, std::uint32_t c)
+            : Node(l, c), name(n), array(a), resolved(TYPE_ERROR) {}
+    };
+
+    /*
+     * 表达式
+     */
+    // 字面量: token为字面量的原始类型(DEC_INTEGER, HEX_INTEGER, FLOAT, BOOL, CHAR, STRING...)
+    struct LiteralExpr : Expr {
+        TokenType token;
+        union {
+            qword integer;      // 整数及字符
+            double real;        // 浮点数
+            bool boolean;       // 布尔值
+        };
+        std::string_view text;  // 字符串字面量转义后的内容
+        LiteralExpr(TokenType t, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::LITERAL, l, c), token(t), integer(0) {}
+
+        bool isInteger() const {
+            return token == TokenType::DEC_INTEGER || token == TokenType::HEX_INTEGER
+                || token == TokenType::OCT_INTEGER || token == TokenType::BIN_INTEGER;
+        }
+    };
+
+    struct NameExpr : Expr {
+        Identifier ident;
+        SymbolKind binding;     // 名字解析的结果
+        std::uint32_t slot;     // 参数或局部变量在函数中的编号，函数或模块的下标
+        const Node *decl;       // 声明该名字的节点
+        NameExpr(Identifier id, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::NAME, l, c), ident(id), binding(SymbolKind::UNRESOLVED), slot(0), decl(nullptr) {}
+    };
+
+    struct UnaryExpr : Expr {
+        TokenType op;
+        Expr *operand;
+        UnaryExpr(TokenType o, Expr *e, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::UNARY, l, c), op(o), operand(e) {}
+    };
+
+    struct BinaryExpr : Expr {
+        TokenType op;
+        Expr *left;
+        Expr *right;
+        BinaryExpr(TokenType o, Expr *lhs, Expr *rhs, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::BINARY, l, c), op(o), left(lhs), right(rhs) {}
+    };
+
+    // 赋值及复合赋值，op为OP_ASSIGN, OP_ADD_ASSIGN...
+    struct AssignExpr : Expr {
+        TokenType op;
+        Expr *target;
+        Expr *value;
+        AssignExpr(TokenType o, Expr *t, Expr *v, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::ASSIGN, l, c), op(o), target(t), value(v) {}
+    };
+
+    // 自增自减，prefix区分++i与i++
+    struct IncDecExpr : Expr {
+        TokenType op;
+        bool prefix;
+        Expr *target;
+        IncDecExpr(TokenType o, bool p, Expr *t, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::INC_DEC, l, c), op(o), prefix(p), target(t) {}
+    };
+
+    struct CallExpr : Expr {
+        Expr *callee;
+        ArenaList<Expr *> args;
+        CallExpr(Expr *f, ArenaList<Expr *> a, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::CALL, l, c), callee(f), args(a) {}
+    };
+
+    // 成员访问，如sys.println
+    struct MemberExpr : Expr {
+        Expr *object;
+        Identifier member;
+        SymbolKind binding;     // 成员解析的结果：FUNCTION或NATIVE
+        std::uint32_t slot;     // 内置函数的编号，或导入模块中函数的下标
+        MemberExpr(Expr *o, Identifier m, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::MEMBER, l, c), object(o), member(m), binding(SymbolKind::UNRESOLVED), slot(0) {}
+    };
+
+    // 类型转换，如float64(x)。target为空表示类型检查时插入的隐式转换，目标类型即type
+    struct CastExpr : Expr {
+        TypeNode *target;
+        Expr *operand;
+        CastExpr(TypeNode *t, Expr *e, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::CAST, l, c), target(t), operand(e) {}
+    };
+
+    // spawn f(x)：在新纤程中执行调用，结果为纤程的句柄
+    struct SpawnExpr : Expr {
+        CallExpr *call;
+        SpawnExpr(CallExpr *e, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::SPAWN, l, c), call(e) {}
+    };
+
+    // await t：等待纤程完成，结果为其返回值
+    struct AwaitExpr : Expr {
+        Expr *task;
+        AwaitExpr(Expr *e, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::AWAIT, l, c), task(e) {}
+    };
+
+    // a[i]：数组的元素，可以作为赋值和自增自减的目标
+    struct IndexExpr : Expr {
+        Expr *array;
+        Expr *index;
+        IndexExpr(Expr *a, Expr *i, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::INDEX, l, c), array(a), index(i) {}
+    };
+
+    // float64[n]：创建长度为n、元素全为0的数组，element为元素类型
+    struct NewArrayExpr : Expr {
+        TypeNode *element;
+        Expr *length;
+        NewArrayExpr(TypeNode *e, Expr *n, std::uint32_t l, std::uint32_t c)
+            : Expr(ExprKind::NEW_ARRAY, l, c), element(e), length(n) {}
+    };
+
+    /*
+     * 语句
+     */
+    struct BlockStmt : Stmt {
+        ArenaList<Stmt *> stmts;
+        BlockStmt(ArenaList<Stmt *> s, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::BLOCK, l, c), stmts(s) {}
+    };
+
+    struct VarDecl : Node {
+        Identifier name;
+        TypeNode *type;     // 可为空，由初始值推导类型
+        Expr *init;         // 可为空
+        std::uint32_t slot; // 局部变量在函数中的编号
+        TypeId value_type;  // 变量的类型，由类型检查阶段填写
+        VarDecl(Identifier n, TypeNode *t, Expr *i, std::uint32_t l, std::uint32_t c)
+            : Node(l, c), name(n), type(t), init(i), slot(0), value_type(TYPE_ERROR) {}
+    };
+
+    // var a:int = 1, b:int = 2;
+    struct VarStmt : Stmt {
+        ArenaList<VarDecl *> decls;
+        VarStmt(ArenaList<VarDecl *> d, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::VAR, l, c), decls(d) {}
+    };
+
+    struct ExprStmt : Stmt {
+        Expr *expr;
+        ExprStmt(Expr *e, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::EXPR, l, c), expr(e) {}
+    };
+
+    // if-elif-else，elif表示为otherwise中嵌套的IfStmt
+    struct IfStmt : Stmt {
+        Expr *cond;
+        BlockStmt *then;
+        Stmt *otherwise;    // IfStmt | BlockStmt | nullptr
+        IfStmt(Expr *e, BlockStmt *t, Stmt *o, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::IF, l, c), cond(e), then(t), otherwise(o) {}
+    };
+
+    struct WhileStmt : Stmt {
+        Expr *cond;
+        BlockStmt *body;
+        WhileStmt(Expr *e, BlockStmt *b, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::WHILE, l, c), cond(e), body(b) {}
+    };
+
+    struct DoWhileStmt : Stmt {
+        BlockStmt *body;
+        Expr *cond;
+        DoWhileStmt(BlockStmt *b, Expr *e, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::DO_WHILE, l, c), body(b), cond(e) {}
+    };
+
+    struct ForStmt : Stmt {
+        Stmt *init;         // VarStmt | ExprStmt | nullptr
+        Expr *cond;         // 可为空
+        Expr *step;         // 可为空
+        BlockStmt *body;
+        ForStmt(Stmt *i, Expr *e, Expr *s, BlockStmt *b, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::FOR, l, c), init(i), cond(e), step(s), body(b) {}
+    };
+
+    struct ReturnStmt : Stmt {
+        Expr *value;        // 可为空
+        ReturnStmt(Expr *v, std::uint32_t l, std::uint32_t c)
+            : Stmt(StmtKind::RETURN, l, c), value(v) {}
+    };
+
+    struct BreakStmt : Stmt {
+        BreakStmt(std::uint32_t l, std::uint32_t c) : Stmt(StmtKind::BREAK, l, c) {}
+    };
+
+    struct ContinueStmt : Stmt {
+        ContinueStmt(std::uint32_t l, std::uint32_t c) : Stmt(StmtKind::CONTINUE, l, c) {}
+    };
+
+    /*
+     * 顶层声明
+     */
+    struct Param : Node {
+        Identifier name;
+        TypeNode *type;
+        std::uint32_t slot; // 参数的编号，与参数的位置相同
+        Param(Identifier n, TypeNode *t, std::uint32_t l, std::uint32_t c)
+            : Node(l, c), name(n), type(t), slot(0) {}
+    };
+
+    struct FunctionDecl : Node {
+        Identifier name;
+        ArenaList<Param *> params;
+        TypeNode *ret;      // 可为空，表示void
+        BlockStmt *body;
+        std::uint32_t index;        // 函数在模块中的下标
+        std::uint32_t local_count;  // 参数及局部变量占用的编号数，互不相交的作用域共享编号
+        TypeId signature;           // 函数类型，由类型检查阶段填写
+        FunctionDecl(Identifier n, ArenaList<Param *> p, TypeNode *r, BlockStmt *b,
+                     std::uint32_t l, std::uint32_t c)
+            : Node(l, c), name(n), params(p), ret(r), body(b), index(0), local_count(0), signature(TYPE_ERROR) {}
+    };
+
+    // import a.b.c;
+    class ModuleInterface;
+
+    struct ImportDecl : Node {
+        ArenaList<Identifier> path;
+        const ModuleInterface *interface;   // 被导入模块的接口，为空表示虚拟机内置的模块(如sys)
+        ImportDecl(ArenaList<Identifier> p, std::uint32_t l, std::uint32_t c)
+            : Node(l, c), path(p), interface(nullptr) {}
+    };
+
+    // 一个源文件对应的语法树，节点的内存由_arenas持有
+    class Module {
+    private:
+        std::vector<std::unique_ptr<Arena>> _arenas;
+    public:
+        std::vector<ImportDecl *> imports;
+        std::vector<FunctionDecl *> functions;
+        TypeTable types;
+
+        Module() { _arenas.emplace_back(new Arena()); }
+        Module(const Module&) = delete;
+        Module& operator=(const Module&) = delete;
+
+        // 模块的主arena，供后续的编译过程分配新节点
+        Arena &arena() { return *_arenas.front(); }
+        void adoptArena(std::unique_ptr<Arena> arena) { _arenas.push_back(std::move(arena)); }
+        std::size_t arenaCount() const { return _arenas.size(); }
+    };
+
+    const char *getExprKindName(ExprKind kind);
+    const char *getStmtKindName(StmtKind kind);
+
+    // 以缩进的树形文本打印语法树，用于调试和测试
+    void dumpModule(const Module &module, std::ostream &os);
+
+}   // namespace Lett.
+
+#endif // __LETT_PARSER_AST_H__
@@ -1,5 +1,815 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <thread>
 #include "parser.h"
 
 namespace Lett {
 
-} // namespace Lett.
\ No newline at end of file
+    namespace {
+        bool isKeyword(const Token &token, const char *keyword) {
+            return token.type() == TokenType::KEYWORD && std::strcmp(token.value(), keyword) == 0;
+        }
+
+        // 是否为顶层声明的起始token
+        bool isTopLevelStart(const Token &token) {
+            return isKeyword(token, "import") || isKeyword(token, "fn");
+        }
+
+        bool isTypeKeyword(const Token &token) {
+            static const char *types[] = {
+                "void", "int", "int8", "int16", "int32", "int64",
+                "uint", "uint8", "uint16", "uint32", "uint64",
+                "float", "float32", "float64", "char", "string", "bigint", "bool", "object"
+            };
+            if (token.type() != TokenType::KEYWORD) {
+                return false;
+            }
+            for (const char *type : types) {
+                if (std::strcmp(token.value(), type) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool isAssignOperator(TokenType type) {
+            switch (type) {
+                case TokenType::OP_ASSIGN:
+                case TokenType::OP_ADD_ASSIGN:
+                case TokenType::OP_SUB_ASSIGN:
+                case TokenType::OP_MUL_ASSIGN:
+                case TokenType::OP_DIV_ASSIGN:
+                case TokenType::OP_MOD_ASSIGN:
+                case TokenType::OP_BIT_AND_ASSIGN:
+                case TokenType::OP_BIT_OR_ASSIGN:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // 二元运算符的优先级，数值越大优先级越高，0表示不是二元运算符
+        int binaryPrecedence(TokenType type) {
+            switch (type) {
+                case TokenType::OP_OR:                  return 1;
+                case TokenType::OP_AND:                 return 2;
+                case TokenType::OP_BIT_OR:              return 3;
+                case TokenType::OP_BIT_XOR:             return 4;
+                case TokenType::OP_BIT_AND:             return 5;
+                case TokenType::OP_EQUAL:
+                case TokenType::OP_NOT_EQUAL:           return 6;
+                case TokenType::OP_GREAT:
+                case TokenType::OP_LESS:
+                case TokenType::OP_GREAT_EQUAL:
+                case TokenType::OP_LESS_EQUAL:          return 7;
+                case TokenType::OP_BIT_SHIFT_LEFT:
+                case TokenType::OP_BIT_SHIFT_RIGHT:     return 8;
+                case TokenType::OP_ADD:
+                case TokenType::OP_SUB:                 return 9;
+                case TokenType::OP_MUL:
+                case TokenType::OP_DIV:
+                case TokenType::OP_MOD:                 return 10;
+                default:                                return 0;
+            }
+        }
+
+        bool isAssignable(const Expr *e) {
+            return e->kind == ExprKind::NAME || e->kind == ExprKind::MEMBER || e->kind == ExprKind::INDEX;
+        }
+
+        // 解析转义字符，失败返回false
+        bool unescape(char ch, char &out) {
+            switch (ch) {
+                case 'a':  out = '\a'; return true;
+                case 'b':  out = '\b'; return true;
+                case 'f':  out = '\f'; return true;
+                case 'n':  out = '\n'; return true;
+                case 'r':  out = '\r'; return true;
+                case 't':  out = '\t'; return true;
+                case 'v':  out = '\v'; return true;
+                case '"':  out = '"';  return true;
+                case '\'': out = '\''; return true;
+                case '\\': out = '\\'; return true;
+                default:   return false;
+            }
+        }
+
+        /*
+         * 递归下降的语法分析器，解析token区间[begin, end)，节点分配在给定的arena中
+         */
+        class SyntaxParser {
+        private:
+            const Token *_pos;
+            const Token *_end;
+            const Token *_last;     // 区间中的最后一个token，用于定位结尾处的错误
+            Arena &_arena;
+
+            const Token *_peek(std::size_t n = 0) const {
+                return static_cast<std::size_t>(_end - _pos) > n ? _pos + n : nullptr;
+            }
+
+            bool _check(TokenType type, std::size_t n = 0) const {
+                const Token *token = _peek(n);
+                return token != nullptr && token->type() == type;
+            }
+
+            bool _check_keyword(const char *keyword) const {
+                const Token *token = _peek();
+                return token != nullptr && isKeyword(*token, keyword);
+            }
+
+            bool _match(TokenType type) {
+                if (_check(type)) {
+                    _pos++;
+                    return true;
+                }
+                return false;
+            }
+
+            [[noreturn]] void _error(const std::string &msg) const {
+                const Token *token = _peek();
+                if (token == nullptr) {
+                    throw SyntaxError(_last->line(), _last->column(), msg + " but reached the end of input");
+                }
+                throw SyntaxError(token->line(), token->column(),
+                                  msg + " but found '" + token->value() + "'");
+            }
+
+            const Token &_expect(TokenType type, const char *what) {
+                if (!_check(type)) {
+                    _error(std::string("expected ") + what);
+                }
+                return *_pos++;
+            }
+
+            // 声明必须恰好占满整个区间
+            void _expect_end() const {
+                if (_pos != _end) {
+                    _error("expected the end of declaration");
+                }
+            }
+
+            const Token &_expect_keyword(const char *keyword) {
+                if (!_check_keyword(keyword)) {
+                    _error(std::string("expected '") + keyword + "'");
+                }
+                return *_pos++;
+            }
+
+            Identifier _ident(const Token &token) {
+                std::string_view name = _arena.copyString(token.value());
+                return Identifier{name, Identifier::hashOf(name)};
+            }
+
+            static std::uint32_t _line(const Token &token) { return static_cast<std::uint32_t>(token.line()); }
+            static std::uint32_t _column(const Token &token) { return static_cast<std::uint32_t>(token.column()); }
+
+            TypeNode *_type() {
+                const Token *token = _peek();
+                if (token == nullptr || !(token->type() == TokenType::IDENTIFIER || isTypeKeyword(*token))) {
+                    _error("expected a type name");
+                }
+                _pos++;
+                // 元素类型之后的[]表示数组类型，如int32[]
+                bool array = _check(TokenType::LEFT_BRACKET) && _check(TokenType::RIGHT_BRACKET, 1);
+                if (array) {
+                    _pos += 2;
+                }
+                return _arena.create<TypeNode>(_ident(*token), array, _line(*token), _column(*token));
+            }
+
+            /*
+             * 语句
+             */
+            BlockStmt *_block() {
+                const Token &open = _expect(TokenType::LEFT_BRACE, "'{'");
+                std::vector<Stmt *> stmts;
+                while (!_check(TokenType::RIGHT_BRACE)) {
+                    if (_peek() == nullptr) {
+                        _error("expected '}'");
+                    }
+                    stmts.push_back(_statement());
+                }
+                _pos++;
+                return _arena.create<BlockStmt>(_arena.copyList(stmts), _line(open), _column(open));
+            }
+
+            // var声明，不包含结尾的分号
+            VarStmt *_var_stmt() {
+                const Token &var = _expect_keyword("var");
+                std::vector<VarDecl *> decls;
+                do {
+                    const Token &name = _expect(TokenType::IDENTIFIER, "variable name");
+                    TypeNode *type = nullptr;
+                    Expr *init = nullptr;
+                    if (_match(TokenType::COLON)) {
+                        type = _type();
+                    }
+                    if (_match(TokenType::OP_ASSIGN)) {
+                        init = expression();
+                    }
+                    decls.push_back(_arena.create<VarDecl>(_ident(name), type, init, _line(name), _column(name)));
+                } while (_match(TokenType::COMMA));
+                return _arena.create<VarStmt>(_arena.copyList(decls), _line(var), _column(var));
+            }
+
+            Stmt *_if_stmt() {
+                const Token &token = *_pos++;   // if | elif
+                _expect(TokenType::LEFT_PARENT, "'('");
+                Expr *cond = expression();
+                _expect(TokenType::RIGHT_PARENT, "')'");
+                BlockStmt *then = _block();
+                Stmt *otherwise = nullptr;
+                if (_check_keyword("elif")) {
+                    otherwise = _if_stmt();
+                } else if (_check_keyword("else")) {
+                    _pos++;
+                    otherwise = _block();
+                }
+                return _arena.create<IfStmt>(cond, then, otherwise, _line(token), _column(token));
+            }
+
+            Stmt *_statement() {
+                const Token &token = *_pos;
+                std::uint32_t line = _line(token), column = _column(token);
+                if (token.type() == TokenType::LEFT_BRACE) {
+                    return _block();
+                }
+                if (token.type() == TokenType::KEYWORD) {
+                    if (isKeyword(token, "var")) {
+                        VarStmt *stmt = _var_stmt();
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        return stmt;
+                    } else if (isKeyword(token, "if")) {
+                        return _if_stmt();
+                    } else if (isKeyword(token, "while")) {
+                        _pos++;
+                        _expect(TokenType::LEFT_PARENT, "'('");
+                        Expr *cond = expression();
+                        _expect(TokenType::RIGHT_PARENT, "')'");
+                        BlockStmt *body = _block();
+                        return _arena.create<WhileStmt>(cond, body, line, column);
+                    } else if (isKeyword(token, "do")) {
+                        _pos++;
+                        BlockStmt *body = _block();
+                        _expect_keyword("while");
+                        _expect(TokenType::LEFT_PARENT, "'('");
+                        Expr *cond = expression();
+                        _expect(TokenType::RIGHT_PARENT, "')'");
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        return _arena.create<DoWhileStmt>(body, cond, line, column);
+                    } else if (isKeyword(token, "for")) {
+                        _pos++;
+                        _expect(TokenType::LEFT_PARENT, "'('");
+                        Stmt *init = nullptr;
+                        if (_check_keyword("var")) {
+                            init = _var_stmt();
+                        } else if (!_check(TokenType::SEMI_COLON)) {
+                            const Token &start = *_pos;
+                            init = _arena.create<ExprStmt>(expression(), _line(start), _column(start));
+                        }
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        Expr *cond = _check(TokenType::SEMI_COLON) ? nullptr : expression();
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        Expr *step = _check(TokenType::RIGHT_PARENT) ? nullptr : expression();
+                        _expect(TokenType::RIGHT_PARENT, "')'");
+                        BlockStmt *body = _block();
+                        return _arena.create<ForStmt>(init, cond, step, body, line, column);
+                    } else if (isKeyword(token, "return")) {
+                        _pos++;
+                        Expr *value = _check(TokenType::SEMI_COLON) ? nullptr : expression();
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        return _arena.create<ReturnStmt>(value, line, column);
+                    } else if (isKeyword(token, "break")) {
+                        _pos++;
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        return _arena.create<BreakStmt>(line, column);
+                    } else if (isKeyword(token, "continue")) {
+                        _pos++;
+                        _expect(TokenType::SEMI_COLON, "';'");
+                        return _arena.create<ContinueStmt>(line, column);
+                    }
+                }
+                Expr *expr = expression();
+                _expect(TokenType::SEMI_COLON, "';'");
+                return _arena.create<ExprStmt>(expr, line, column);
+            }
+
+            /*
+             * 表达式
+             */
+            Expr *_assignment() {
+                Expr *target = _binary(1);
+                const Token *token = _peek();
+                if (token != nullptr && isAssignOperator(token->type())) {
+                    if (!isAssignable(target)) {
+                        _error("expected an assignable expression before '" + std::string(token->value()) + "'");
+                    }
+                    _pos++;
+                    Expr *value = _assignment();
+                    return _arena.create<AssignExpr>(token->type(), target, value, _line(*token), _column(*token));
+                }
+                return target;
+            }
+
+            // 按优先级爬升解析左结合的二元运算
+            Expr *_binary(int min_precedence) {
+                Expr *left = _unary();
+                while (true) {
+                    const Token *token = _peek();
+                    if (token == nullptr) {
+                        break;
+                    }
+                    int precedence = binaryPrecedence(token->type());
+                    if (precedence == 0 || precedence < min_precedence) {
+                        break;
+                    }
+                    _pos++;
+                    Expr *right = _binary(precedence + 1);
+                    left = _arena.create<BinaryExpr>(token->type(), left, right, _line(*token), _column(*token));
+                }
+                return left;
+            }
+
+            Expr *_unary() {
+                const Token *token = _peek();
+                if (token != nullptr) {
+                    TokenType type = token->type();
+                    if (type == TokenType::OP_SUB || type == TokenType::OP_NOT || type == TokenType::OP_BIT_NOT) {
+                        _pos++;
+                        Expr *operand = _unary();
+                        return _arena.create<UnaryExpr>(type, operand, _line(*token), _column(*token));
+                    }
+                    if (type == TokenType::OP_INC || type == TokenType::OP_DEC) {
+                        _pos++;
+                        Expr *target = _unary();
+                        if (!isAssignable(target)) {
+                            throw SyntaxError(token->line(), token->column(),
+                                              std::string("operand of '") + token->value() + "' is not assignable");
+                        }
+                        return _arena.create<IncDecExpr>(type, true, target, _line(*token), _column(*token));
+                    }
+                    if (isKeyword(*token, "spawn")) {
+                        _pos++;
+                        Expr *call = _postfix();
+                        if (call->kind != ExprKind::CALL) {
+                            throw SyntaxError(token->line(), token->column(), "expected a function call after 'spawn'");
+                        }
+                        return _arena.create<SpawnExpr>(call->as<CallExpr>(), _line(*token), _column(*token));
+                    }
+                    if (isKeyword(*token, "await")) {
+                        _pos++;
+                        Expr *task = _unary();
+                        return _arena.create<AwaitExpr>(task, _line(*token), _column(*token));
+                    }
+                }
+                return _postfix();
+            }
+
+            Expr *_postfix() {
+                Expr *expr = _primary();
+                while (true) {
+                    const Token *token = _peek();
+                    if (token == nullptr) {
+                        break;
+                    }
+                    if (token->type() == TokenType::LEFT_PARENT) {
+                        _pos++;
+                        std::vector<Expr *> args;
+                        if (!_check(TokenType::RIGHT_PARENT)) {
+                            do {
+                                args.push_back(expression());
+                            } while (_match(TokenType::COMMA));
+                        }
+                        _expect(TokenType::RIGHT_PARENT, "')'");
+                        expr = _arena.create<CallExpr>(expr, _arena.copyList(args), _line(*token), _column(*token));
+                    } else if (token->type() == TokenType::DOT) {
+                        _pos++;
+                        const Token &member = _expect(TokenType::IDENTIFIER, "member name");
+                        expr = _arena.create<MemberExpr>(expr, _ident(member), _line(member), _column(member));
+                    } else if (token->type() == TokenType::LEFT_BRACKET) {
+                        _pos++;
+                        Expr *index = expression();
+                        _expect(TokenType::RIGHT_BRACKET, "']'");
+                        expr = _arena.create<IndexExpr>(expr, index, _line(*token), _column(*token));
+                    } else if (token->type() == TokenType::OP_INC || token->type() == TokenType::OP_DEC) {
+                        if (!isAssignable(expr)) {
+                            _error("expected an assignable operand");
+                        }
+                        _pos++;
+                        expr = _arena.create<IncDecExpr>(token->type(), false, expr, _line(*token), _column(*token));
+                    } else {
+                        break;
+                    }
+                }
+                return expr;
+            }
+
+            qword _integer(const Token &token) {
+                const char *text = token.value();
+                unsigned base = 10;
+                switch (token.type()) {
+                    case TokenType::HEX_INTEGER: base = 16; text += 2; break;
+                    case TokenType::OCT_INTEGER: base = 8;  text += 2; break;
+                    case TokenType::BIN_INTEGER: base = 2;  text += 2; break;
+                    default: break;
+                }
+                qword value = 0;
+                for (; *text != '\0'; ++text) {
+                    unsigned digit;
+                    char ch = *text;
+                    if (ch >= '0' && ch <= '9') {
+                        digit = static_cast<unsigned>(ch - '0');
+                    } else if (ch >= 'a' && ch <= 'f') {
+                        digit = static_cast<unsigned>(ch - 'a' + 10);
+                    } else {
+                        digit = static_cast<unsigned>(ch - 'A' + 10);
+                    }
+                    if (value > (~0ULL - digit) / base) {
+                        throw SyntaxError(token.line(), token.column(),
+                                          std::string("integer literal '") + token.value() + "' is too large");
+                    }
+                    value = value * base + digit;
+                }
+                return value;
+            }
+
+            // 去掉引号并处理转义字符
+            std::string _unquote(const Token &token) {
+                const char *text = token.value();
+                std::size_t len = std::strlen(text);
+                std::string result;
+                for (std::size_t i = 1; i + 1 < len; ++i) {
+                    char ch = text[i];
+                    if (ch == '\\' && i + 2 < len) {
+                        if (!unescape(text[++i], ch)) {
+                            throw SyntaxError(token.line(), token.column(),
+                                              std::string("invalid escape sequence in ") + text);
+                        }
+                    }
+                    result += ch;
+                }
+                return result;
+            }
+
+            Expr *_primary() {
+                const Token *token = _peek();
+                if (token == nullptr) {
+                    _error("expected an expression");
+                }
+                std::uint32_t line = _line(*token), column = _column(*token);
+                switch (token->type()) {
+                    case TokenType::DEC_INTEGER:
+                    case TokenType::HEX_INTEGER:
+                    case TokenType::OCT_INTEGER:
+                    case TokenType::BIN_INTEGER: {
+                        LiteralExpr *lit = _arena.create<LiteralExpr>(token->type(), line, column);
+                        lit->integer = _integer(*token);
+                        _pos++;
+                        return lit;
+                    }
+                    case TokenType::FLOAT: {
+                        LiteralExpr *lit = _arena.create<LiteralExpr>(token->type(), line, column);
+                        errno = 0;
+                        lit->real = std::strtod(token->value(), nullptr);
+                        if (errno == ERANGE) {
+                            _error("float literal out of range");
+                        }
+                        _pos++;
+                        return lit;
+                    }
+                    case TokenType::BOOL: {
+                        LiteralExpr *lit = _arena.create<LiteralExpr>(token->type(), line, column);
+                        lit->boolean = std::strcmp(token->value(), "true") == 0;
+                        _pos++;
+                        return lit;
+                    }
+                    case TokenType::CHAR: {
+                        LiteralExpr *lit = _arena.create<LiteralExpr>(token->type(), line, column);
+                        std::string ch = _unquote(*token);
+                        lit->integer = static_cast<unsigned char>(ch.empty() ? '\0' : ch[0]);
+                        _pos++;
+                        return lit;
+                    }
+                    case TokenType::STRING: {
+                        LiteralExpr *lit = _arena.create<LiteralExpr>(token->type(), line, column);
+                        lit->text = _arena.copyString(_unquote(*token));
+                        _pos++;
+                        return lit;
+                    }
+                    case TokenType::IDENTIFIER:
+                        _pos++;
+                        return _arena.create<NameExpr>(_ident(*token), line, column);
+                    case TokenType::LEFT_PARENT: {
+                        _pos++;
+                        Expr *expr = expression();
+                        _expect(TokenType::RIGHT_PARENT, "')'");
+                        return expr;
+                    }
+                    case TokenType::UNKNOWN:
+                        throw SyntaxError(token->line(), token->column(),
+                                          std::string("invalid token '") + token->value() + "'");
+                    default:
+                        if (isTypeKeyword(*token) && _check(TokenType::LEFT_BRACKET, 1)
+                            && !_check(TokenType::RIGHT_BRACKET, 2)) {
+                            // 创建数组，如float64[n]
+                            _pos++;
+                            TypeNode *element = _arena.create<TypeNode>(_ident(*token), false, line, column);
+                            _pos++;
+                            Expr *length = expression();
+                            _expect(TokenType::RIGHT_BRACKET, "']'");
+                            return _arena.create<NewArrayExpr>(element, length, line, column);
+                        }
+                        if (isTypeKeyword(*token)) {
+                            // 显式类型转换，如float64(x)
+                            TypeNode *target = _type();
+                            _expect(TokenType::LEFT_PARENT, "'('");
+                            Expr *operand = expression();
+                            _expect(TokenType::RIGHT_PARENT, "')'");
+                            return _arena.create<CastExpr>(target, operand, line, column);
+                        }
+                        _error("expected an expression");
+                }
+            }
+        public:
+            SyntaxParser(const Token *begin, const Token *end, Arena &arena)
+                : _pos(begin), _end(end), _last(end - 1), _arena(arena) {}
+
+            Expr *expression() {
+                return _assignment();
+            }
+
+            ImportDecl *import() {
+                const Token &token = _expect_keyword("import");
+                std::vector<Identifier> path;
+                do {
+                    path.push_back(_ident(_expect(TokenType::IDENTIFIER, "module name")));
+                } while (_match(TokenType::DOT));
+                _expect(TokenType::SEMI_COLON, "';'");
+                _expect_end();
+                return _arena.create<ImportDecl>(_arena.copyList(path), _line(token), _column(token));
+            }
+
+            FunctionDecl *function() {
+                const Token &token = _expect_keyword("fn");
+                const Token *name = _peek();
+                if (name == nullptr || !(name->type() == TokenType::IDENTIFIER || isKeyword(*name, "main"))) {
+                    _error("expected function name");
+                }
+                _pos++;
+                _expect(TokenType::LEFT_PARENT, "'('");
+                std::vector<Param *> params;
+                if (!_check(TokenType::RIGHT_PARENT)) {
+                    do {
+                        const Token &param = _expect(TokenType::IDENTIFIER, "parameter name");
+                        _expect(TokenType::COLON, "':'");
+                        TypeNode *type = _type();
+                        params.push_back(_arena.create<Param>(_ident(param), type, _line(param), _column(param)));
+                    } while (_match(TokenType::COMMA));
+                }
+                _expect(TokenType::RIGHT_PARENT, "')'");
+                TypeNode *ret = nullptr;
+                if (_match(TokenType::COLON)) {
+                    ret = _type();
+                }
+                BlockStmt *body = _block();
+                _expect_end();
+                return _arena.create<FunctionDecl>(_ident(*name), _arena.copyList(params), ret, body,
+                                                   _line(token), _column(token));
+            }
+
+        };  // class SyntaxParser
+
+        // 一个顶层声明的解析结果
+        struct ChunkResult {
+            ImportDecl *import = nullptr;
+            FunctionDecl *function = nullptr;
+            std::vector<SyntaxError> errors;
+        };
+
+        ChunkResult parseChunk(const std::vector<Token> &tokens, const TopLevelChunk &chunk, Arena &arena) {
+            ChunkResult result;
+            const Token *begin = tokens.data() + chunk.begin;
+            const Token *end = tokens.data() + chunk.end;
+            try {
+                SyntaxParser parser(begin, end, arena);
+                if (chunk.kind == TopLevelChunk::IMPORT) {
+                    result.import = parser.import();
+                } else if (chunk.kind == TopLevelChunk::FUNCTION) {
+                    result.function = parser.function();
+                } else {
+                    throw SyntaxError(begin->line(), begin->column(),
+                                      std::string("expected 'import' or 'fn' but found '") + begin->value() + "'");
+                }
+            } catch (const SyntaxError &e) {
+                result.errors.push_back(e);
+            }
+            return result;
+        }
+
+        void mergeChunk(Module &module, ChunkResult &result, std::vector<SyntaxError> &errors) {
+            if (result.import != nullptr) {
+                module.imports.push_back(result.import);
+            }
+            if (result.function != nullptr) {
+                module.functions.push_back(result.function);
+            }
+            for (SyntaxError &e : result.errors) {
+                errors.push_back(std::move(e));
+            }
+        }
+    }   // namespace
+
+    Skimmer::Skimmer()
+        : _kind(TopLevelChunk::INVALID), _begin(0), _pos(0), _depth(0), _started(false), _body(false) {
+    }
+
+    bool Skimmer::_finish(TopLevelChunk &chunk) {
+        chunk = TopLevelChunk{_kind, _begin, _pos};
+        _started = false;
+        return true;
+    }
+
+    bool Skimmer::next(const std::vector<Token> &tokens, bool final, TopLevelChunk &chunk) {
+        std::size_t count = tokens.size();
+        if (!_started) {
+            if (_pos >= count) {
+                return false;
+            }
+            _started = true;
+            _begin = _pos;
+            _depth = 0;
+            _body = false;
+            const Token &token = tokens[_pos];
+            if (isKeyword(token, "import")) {
+                _kind = TopLevelChunk::IMPORT;
+                _pos++;
+            } else if (isKeyword(token, "fn")) {
+                _kind = TopLevelChunk::FUNCTION;
+                _pos++;
+            } else {
+                _kind = TopLevelChunk::INVALID;
+            }
+        }
+        if (_kind == TopLevelChunk::IMPORT) {
+            // import以分号结束
+            for (; _pos < count; _pos++) {
+                if (tokens[_pos].type() == TokenType::SEMI_COLON) {
+                    _pos++;
+                    return _finish(chunk);
+                }
+                if (isTopLevelStart(tokens[_pos])) {
+                    return _finish(chunk);
+                }
+            }
+        } else if (_kind == TopLevelChunk::FUNCTION) {
+            // 函数以函数体的右大括号结束
+            if (!_body) {
+                for (; _pos < count; _pos++) {
+                    if (tokens[_pos].type() == TokenType::LEFT_BRACE) {
+                        _body = true;
+                        break;
+                    }
+                    if (isTopLevelStart(tokens[_pos])) {
+                        return _finish(chunk);
+                    }
+                }
+            }
+            if (_body) {
+                for (; _pos < count; _pos++) {
+                    TokenType type = tokens[_pos].type();
+                    if (type == TokenType::LEFT_BRACE) {
+                        _depth++;
+                    } else if (type == TokenType::RIGHT_BRACE && --_depth == 0) {
+                        _pos++;
+                        return _finish(chunk);
+                    }
+                }
+            }
+        } else {
+            // 非法的顶层token，跳过至下一个顶层声明
+            for (; _pos < count; _pos++) {
+                TokenType type = tokens[_pos].type();
+                if (_depth == 0 && _pos > _begin && isTopLevelStart(tokens[_pos])) {
+                    return _finish(chunk);
+                }
+                if (type == TokenType::LEFT_BRACE) {
+                    _depth++;
+                } else if (type == TokenType::RIGHT_BRACE && _depth > 0) {
+                    _depth--;
+                }
+            }
+        }
+        // 到达token序列的末尾
+        return final ? _finish(chunk) : false;
+    }
+
+    Parser::Parser(const std::vector<Token> &tokens)
+        : _buffer(), _tokens(tokens), _stream(nullptr), _errors() {
+    }
+
+    Parser::Parser(TokenStream &stream)
+        : _buffer(), _tokens(_buffer), _stream(&stream), _errors() {
+    }
+
+    std::vector<TopLevelChunk> Parser::skim() const {
+        std::vector<TopLevelChunk> chunks;
+        Skimmer skimmer;
+        TopLevelChunk chunk;
+        while (skimmer.next(_tokens, true, chunk)) {
+            chunks.push_back(chunk);
+        }
+        return chunks;
+    }
+
+    void Parser::_parse_serial(Module &module, const std::vector<TopLevelChunk> &chunks) {
+        for (const TopLevelChunk &chunk : chunks) {
+            ChunkResult result = parseChunk(_tokens, chunk, module.arena());
+            mergeChunk(module, result, _errors);
+        }
+    }
+
+    void Parser::_parse_parallel(Module &module, const std::vector<TopLevelChunk> &chunks, std::size_t jobs) {
+        std::vector<ChunkResult> results(chunks.size());
+        std::vector<std::unique_ptr<Arena>> arenas(jobs);
+        std::vector<std::exception_ptr> failures(jobs);
+        std::atomic<std::size_t> next(0);
+        std::vector<std::thread> workers;
+        workers.reserve(jobs);
+        for (std::size_t w = 0; w < jobs; ++w) {
+            arenas[w].reset(new Arena());
+            workers.emplace_back([&, w]() {
+                try {
+                    // 每个线程从队列中领取下一个声明，解析到自己的arena中
+                    while (true) {
+                        std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                        if (i >= chunks.size()) {
+                            break;
+                        }
+                        results[i] = parseChunk(_tokens, chunks[i], *arenas[w]);
+                    }
+                } catch (...) {
+                    failures[w] = std::current_exception();
+                    next.store(chunks.size());
+                }
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        for (std::exception_ptr &failure : failures) {
+            if (failure) {
+                std::rethrow_exception(failure);
+            }
+        }
+        // 按源代码顺序合并
+        for (ChunkResult &result : results) {
+            mergeChunk(module, result, _errors);
+        }
+        for (std::unique_ptr<Arena> &arena : arenas) {
+            module.adoptArena(std::move(arena));
+        }
+    }
+
+    // 每收到一批token就找出其中已经完整的声明并解析。
+    // 声明的token在解析时是连续的；_buffer之后的增长可能移动token，但语法树不引用token
+    void Parser::_parse_stream(Module &module) {
+        Skimmer skimmer;
+        TopLevelChunk chunk;
+        bool more = true;
+        while (more) {
+            more = _stream->next(_buffer);
+            while (skimmer.next(_buffer, !more, chunk)) {
+                ChunkResult result = parseChunk(_buffer, chunk, module.arena());
+                mergeChunk(module, result, _errors);
+            }
+        }
+    }
+
+    std::unique_ptr<Module> Parser::parse(std::size_t jobs) {
+        _errors.clear();
+        std::unique_ptr<Module> module(new Module());
+        if (_stream != nullptr) {
+            _parse_stream(*module);
+            return module;
+        }
+        std::vector<TopLevelChunk> chunks = skim();
+        if (jobs == 0) {
+            jobs = std::thread::hardware_concurrency();
+        }
+        if (jobs > chunks.size()) {
+            jobs = chunks.size();
+        }
+        if (jobs <= 1) {
+            _parse_serial(*module, chunks);
+        } else {
+            _parse_parallel(*module, chunks, jobs);
+        }
+        return module;
+    }
+
+}   // namespace Lett.
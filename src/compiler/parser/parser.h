@@ -1,8 +1,76 @@
 #ifndef __LETT_PARSER_ANALYZER_H__
 #define __LETT_PARSER_ANALYZER_H__
 
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "exception.h"
+#include "token.h"
+#include "token_stream.h"
+#include "ast.h"
+
 namespace Lett {
 
+    // 顶层声明(import或fn)在token序列中的区间[begin, end)
+    struct TopLevelChunk {
+        enum Kind { IMPORT, FUNCTION, INVALID };
+        Kind kind;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // 划分顶层声明的边界，可以在token序列增长的过程中分多次进行：
+    // token还不足以确定当前声明的结尾时next返回false，追加token后从上次停下的位置继续扫描
+    class Skimmer {
+    private:
+        TopLevelChunk::Kind _kind;
+        std::size_t _begin;
+        std::size_t _pos;
+        std::size_t _depth;
+        bool _started;              // 正在扫描一个声明
+        bool _body;                 // 正在扫描函数体
+
+        bool _finish(TopLevelChunk &chunk);
+    public:
+        Skimmer();
+
+        // 在tokens中找到下一个顶层声明。final为真表示tokens之后不再有token，
+        // 此时到达末尾的声明也是完整的；所有声明都已找到时返回false
+        bool next(const std::vector<Token> &tokens, bool final, TopLevelChunk &chunk);
+    };  // class Skimmer
+
+    // 语法分析器，递归下降地将token序列解析为语法树
+    // 解析以顶层声明为单位进行：先按大括号匹配找到每个声明的边界，
+    // 再逐个解析。某个声明出错时记录错误并继续解析下一个声明。
+    class Parser {
+    private:
+        std::vector<Token> _buffer;             // 从流中收到的token
+        const std::vector<Token> &_tokens;
+        TokenStream *_stream;
+        std::vector<SyntaxError> _errors;
+
+        void _parse_serial(Module &module, const std::vector<TopLevelChunk> &chunks);
+        void _parse_parallel(Module &module, const std::vector<TopLevelChunk> &chunks, std::size_t jobs);
+        void _parse_stream(Module &module);
+    public:
+        Parser(const std::vector<Token> &tokens);
+        // 从另一个线程中的词法分析器接收token，与词法分析同时进行：每个顶层声明的token到齐后立即解析。
+        // 解析结果与先得到全部token再解析相同
+        Parser(TokenStream &stream);
+
+        // 解析整个模块
+        // jobs <= 1 时在当前线程串行解析；否则由jobs个工作线程并行解析各个顶层声明，
+        // 每个线程使用独立的arena，结果按源代码顺序合并。jobs为0时使用全部CPU核心。
+        // 从流中接收token时忽略jobs，在当前线程中边接收边解析。
+        std::unique_ptr<Module> parse(std::size_t jobs = 1);
+
+        // 扫描token序列，仅通过匹配LEFT_BRACE/RIGHT_BRACE划分出顶层声明的边界（不适用于从流中接收的token）
+        std::vector<TopLevelChunk> skim() const;
+
+        const std::vector<SyntaxError>& getErrors() const { return _errors; }
+        bool hasErrors() const { return !_errors.empty(); }
+    };  // class Parser
+
 }   // namespace Lett.
 
-#endif // __LETT_PARSER_ANALYZER_H__
\ No newline at end of file
+#endif // __LETT_PARSER_ANALYZER_H__
@@ -0,0 +1,107 @@
+#include "type_table.h"
+
+namespace Lett {
+
+    namespace {
+        #define TYPE_MEMBER(m, s, w) s,
+        const char *primitiveNames[] = {
+            LETT_PRIMITIVE_TYPES
+        };
+        #undef TYPE_MEMBER
+
+        #define TYPE_MEMBER(m, s, w) w,
+        const unsigned primitiveWidths[] = {
+            LETT_PRIMITIVE_TYPES
+        };
+        #undef TYPE_MEMBER
+    }   // namespace
+
+    TypeTable::TypeTable()
+        : _types(), _params(), _functions(), _tasks() {
+        for (TypeId i = 0; i < TYPE_PRIMITIVE_COUNT; ++i) {
+            _types.push_back(TypeInfo{TypeKind::PRIMITIVE, TYPE_ERROR, 0, 0});
+        }
+        for (TypeId element = TYPE_INT8; element <= TYPE_FLOAT64; ++element) {
+            _types.push_back(TypeInfo{TypeKind::ARRAY, element, 0, 0});
+        }
+    }
+
+    TypeId TypeTable::lookup(std::string_view name) {
+        if (name == "uint") {
+            return TYPE_UINT64;
+        }
+        if (name == "float") {
+            return TYPE_FLOAT64;
+        }
+        for (TypeId i = TYPE_VOID; i < TYPE_MODULE; ++i) {
+            if (name == primitiveNames[i]) {
+                return i;
+            }
+        }
+        return TYPE_ERROR;
+    }
+
+    bool TypeTable::isInteger(TypeId type) {
+        return type >= TYPE_INT8 && type <= TYPE_UINT64;
+    }
+
+    bool TypeTable::isSigned(TypeId type) {
+        return type >= TYPE_INT8 && type <= TYPE_INT;
+    }
+
+    bool TypeTable::isFloat(TypeId type) {
+        return type == TYPE_FLOAT32 || type == TYPE_FLOAT64;
+    }
+
+    unsigned TypeTable::width(TypeId type) {
+        return type < TYPE_PRIMITIVE_COUNT ? primitiveWidths[type] : 64;
+    }
+
+    TypeId TypeTable::function(TypeId ret, const std::vector<TypeId> &params) {
+        std::vector<TypeId> key;
+        key.reserve(params.size() + 1);
+        key.push_back(ret);
+        key.insert(key.end(), params.begin(), params.end());
+        auto it = _functions.find(key);
+        if (it != _functions.end()) {
+            return it->second;
+        }
+        TypeId id = static_cast<TypeId>(_types.size());
+        _types.push_back(TypeInfo{TypeKind::FUNCTION, ret,
+                                  static_cast<std::uint32_t>(_params.size()),
+                                  static_cast<std::uint32_t>(params.size())});
+        _params.insert(_params.end(), params.begin(), params.end());
+        _functions.emplace(std::move(key), id);
+        return id;
+    }
+
+    TypeId TypeTable::task(TypeId ret) {
+        auto it = _tasks.find(ret);
+        if (it != _tasks.end()) {
+            return it->second;
+        }
+        TypeId id = static_cast<TypeId>(_types.size());
+        _types.push_back(TypeInfo{TypeKind::TASK, ret, 0, 0});
+        _tasks.emplace(ret, id);
+        return id;
+    }
+
+    std::string TypeTable::name(TypeId type) const {
+        if (type < TYPE_PRIMITIVE_COUNT) {
+            return primitiveNames[type];
+        }
+        const TypeInfo &fn = _types[type];
+        if (fn.kind == TypeKind::TASK) {
+            return "task<" + name(fn.ret) + ">";
+        }
+        if (fn.kind == TypeKind::ARRAY) {
+            return name(fn.ret) + "[]";
+        }
+        std::string result = "fn(";
+        for (std::uint32_t i = 0; i < fn.param_count; ++i) {
+            result += (i > 0 ? ", " : "") + name(_params[fn.first_param + i]);
+        }
+        return result + "):" + name(fn.ret);
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,103 @@
+#ifndef __LETT_PARSER_TYPE_TABLE_H__
+#define __LETT_PARSER_TYPE_TABLE_H__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 基本类型：名称、位宽
+// int为64位有符号整数，uint和float分别是uint64和float64的别名，bigint为任意精度的有符号整数
+#define LETT_PRIMITIVE_TYPES \
+        TYPE_MEMBER(ERROR, "<error>", 0)    \
+        TYPE_MEMBER(VOID, "void", 0)        \
+        TYPE_MEMBER(BOOL, "bool", 8)        \
+        TYPE_MEMBER(CHAR, "char", 8)        \
+        TYPE_MEMBER(INT8, "int8", 8)        \
+        TYPE_MEMBER(INT16, "int16", 16)     \
+        TYPE_MEMBER(INT32, "int32", 32)     \
+        TYPE_MEMBER(INT64, "int64", 64)     \
+        TYPE_MEMBER(INT, "int", 64)         \
+        TYPE_MEMBER(UINT8, "uint8", 8)      \
+        TYPE_MEMBER(UINT16, "uint16", 16)   \
+        TYPE_MEMBER(UINT32, "uint32", 32)   \
+        TYPE_MEMBER(UINT64, "uint64", 64)   \
+        TYPE_MEMBER(FLOAT32, "float32", 32) \
+        TYPE_MEMBER(FLOAT64, "float64", 64) \
+        TYPE_MEMBER(STRING, "string", 64)   \
+        TYPE_MEMBER(BIGINT, "bigint", 64)   \
+        TYPE_MEMBER(MODULE, "module", 0)    \
+        TYPE_MEMBER(ANY, "any", 0)
+
+namespace Lett {
+
+    // 类型编号。同一个类型在TypeTable中只有一个编号，类型相等即编号相等
+    typedef std::uint32_t TypeId;
+
+    #define TYPE_MEMBER(m, s, w) TYPE_##m,
+    enum : TypeId {
+        LETT_PRIMITIVE_TYPES
+        TYPE_PRIMITIVE_COUNT
+    };
+    #undef TYPE_MEMBER
+
+    // 数组类型T[]的元素类型为int8到float64之间的数值类型，编号紧跟在基本类型之后，也是固定的
+    constexpr TypeId TYPE_ARRAY_FIRST = TYPE_PRIMITIVE_COUNT;
+    constexpr TypeId TYPE_FIXED_COUNT = TYPE_ARRAY_FIRST + (TYPE_FLOAT64 - TYPE_INT8 + 1);
+
+    enum class TypeKind {
+        PRIMITIVE,
+        FUNCTION,
+        TASK,                       // spawn得到的纤程句柄
+        ARRAY                       // 连续存放、不装箱的数值数组
+    };
+
+    struct TypeInfo {
+        TypeKind kind;
+        TypeId ret;                 // 函数的返回值类型，纤程的返回值类型，或数组的元素类型
+        std::uint32_t first_param;  // 函数参数类型在参数表中的起始位置
+        std::uint32_t param_count;
+    };
+
+    // 类型表：基本类型和数组类型的编号固定，其他复合类型(函数类型、纤程类型)按结构驻留(intern)
+    class TypeTable {
+    private:
+        std::vector<TypeInfo> _types;
+        std::vector<TypeId> _params;                        // 所有函数类型的参数类型
+        std::map<std::vector<TypeId>, TypeId> _functions;   // {返回值, 参数...} -> 函数类型
+        std::map<TypeId, TypeId> _tasks;                    // 返回值 -> 纤程类型
+    public:
+        TypeTable();
+
+        // 根据类型名查找基本类型，未找到返回TYPE_ERROR
+        static TypeId lookup(std::string_view name);
+        static bool isInteger(TypeId type);
+        static bool isSigned(TypeId type);
+        static bool isFloat(TypeId type);
+        static bool isNumeric(TypeId type) { return isInteger(type) || isFloat(type); }
+        // 基本类型的位宽
+        static unsigned width(TypeId type);
+        // 能作为数组元素的类型
+        static bool isElement(TypeId type) { return type >= TYPE_INT8 && type <= TYPE_FLOAT64; }
+        static bool isArray(TypeId type) { return type >= TYPE_ARRAY_FIRST && type < TYPE_FIXED_COUNT; }
+        // 元素类型为element的数组类型，isElement(element)
+        static TypeId array(TypeId element) { return TYPE_ARRAY_FIRST + (element - TYPE_INT8); }
+        static TypeId element(TypeId array) { return TYPE_INT8 + (array - TYPE_ARRAY_FIRST); }
+
+        TypeId function(TypeId ret, const std::vector<TypeId> &params);
+        // 驻留新的类型会使返回的引用失效
+        const TypeInfo &info(TypeId type) const { return _types[type]; }
+        // 返回值为ret的纤程的类型task<ret>
+        TypeId task(TypeId ret);
+        bool isFunction(TypeId type) const { return _types[type].kind == TypeKind::FUNCTION; }
+        bool isTask(TypeId type) const { return _types[type].kind == TypeKind::TASK; }
+        TypeId param(TypeId function, std::size_t i) const { return _params[_types[function].first_param + i]; }
+        std::size_t size() const { return _types.size(); }
+
+        std::string name(TypeId type) const;
+    };  // class TypeTable
+
+}   // namespace Lett.
+
+#endif // __LETT_PARSER_TYPE_TABLE_H__
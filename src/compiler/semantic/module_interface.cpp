@@ -0,0 +1,137 @@
+#include <cstring>
+#include "binary.h"
+#include "module_interface.h"
+
+namespace Lett {
+
+    namespace {
+        const char INTERFACE_MAGIC[4] = {'L', 'T', 'I', '1'};
+    }   // namespace
+
+    ModuleInterface::ModuleInterface()
+        : name(), source_hash(0), imports(), dependencies(), functions() {
+    }
+
+    std::uint64_t ModuleInterface::hashOf(std::string_view data) {
+        return static_cast<std::uint64_t>(Identifier::hashOf(data));
+    }
+
+    ModuleInterface ModuleInterface::fromModule(const Module &module, const std::string &name,
+                                                std::uint64_t source_hash) {
+        ModuleInterface result;
+        result.name = name;
+        result.source_hash = source_hash;
+        for (const ImportDecl *imp : module.imports) {
+            result.imports.push_back(moduleNameOf(*imp));
+            result.dependencies.push_back(imp->interface != nullptr ? imp->interface->hash() : 0);
+        }
+        for (const FunctionDecl *fn : module.functions) {
+            if (fn->name.name == "main") {
+                continue;
+            }
+            const TypeInfo &info = module.types.info(fn->signature);
+            ExportedFunction exported{std::string(fn->name.name), fn->index, info.ret, {}};
+            for (std::uint32_t i = 0; i < info.param_count; ++i) {
+                exported.params.push_back(module.types.param(fn->signature, i));
+            }
+            result.functions.push_back(std::move(exported));
+        }
+        return result;
+    }
+
+    const ExportedFunction *ModuleInterface::find(std::string_view name) const {
+        for (const ExportedFunction &fn : functions) {
+            if (fn.name == name) {
+                return &fn;
+            }
+        }
+        return nullptr;
+    }
+
+    std::uint64_t ModuleInterface::hash() const {
+        std::string data;
+        for (const ExportedFunction &fn : functions) {
+            putString(data, fn.name);
+            put32(data, fn.index);
+            put32(data, fn.ret);
+            put32(data, static_cast<std::uint32_t>(fn.params.size()));
+            for (TypeId param : fn.params) {
+                put32(data, param);
+            }
+        }
+        return hashOf(data);
+    }
+
+    std::string ModuleInterface::serialize() const {
+        std::string out(INTERFACE_MAGIC, sizeof(INTERFACE_MAGIC));
+        putString(out, name);
+        put64(out, source_hash);
+        put32(out, static_cast<std::uint32_t>(imports.size()));
+        for (std::size_t i = 0; i < imports.size(); ++i) {
+            putString(out, imports[i]);
+            put64(out, dependencies[i]);
+        }
+        put32(out, static_cast<std::uint32_t>(functions.size()));
+        for (const ExportedFunction &fn : functions) {
+            putString(out, fn.name);
+            put32(out, fn.index);
+            put32(out, fn.ret);
+            put32(out, static_cast<std::uint32_t>(fn.params.size()));
+            for (TypeId param : fn.params) {
+                put32(out, param);
+            }
+        }
+        return out;
+    }
+
+    bool ModuleInterface::deserialize(std::string_view data, ModuleInterface &out) {
+        if (data.size() < sizeof(INTERFACE_MAGIC)
+            || std::memcmp(data.data(), INTERFACE_MAGIC, sizeof(INTERFACE_MAGIC)) != 0) {
+            return false;
+        }
+        InputBuffer in(data.substr(sizeof(INTERFACE_MAGIC)));
+        ModuleInterface result;
+        result.name = in.getString();
+        result.source_hash = in.get64();
+        std::uint32_t import_count = in.getCount();
+        for (std::uint32_t i = 0; i < import_count && !in.failed(); ++i) {
+            result.imports.push_back(in.getString());
+            result.dependencies.push_back(in.get64());
+        }
+        std::uint32_t function_count = in.getCount();
+        for (std::uint32_t i = 0; i < function_count && !in.failed(); ++i) {
+            ExportedFunction fn{in.getString(), in.get32(), in.get32(), {}};
+            std::uint32_t param_count = in.getCount();
+            for (std::uint32_t j = 0; j < param_count && !in.failed(); ++j) {
+                fn.params.push_back(in.get32());
+            }
+            // 导出函数的类型只能是基本类型或数组类型，它们的编号是固定的
+            if (fn.ret >= TYPE_FIXED_COUNT) {
+                return false;
+            }
+            for (TypeId param : fn.params) {
+                if (param >= TYPE_FIXED_COUNT) {
+                    return false;
+                }
+            }
+            result.functions.push_back(std::move(fn));
+        }
+        if (in.failed() || !in.atEnd()) {
+            return false;
+        }
+        out = std::move(result);
+        return true;
+    }
+
+    std::string moduleNameOf(const ImportDecl &decl) {
+        std::string name;
+        for (std::size_t i = 0; i < decl.path.size(); ++i) {
+            if (i > 0) {
+                name += ".";
+            }
+            name += decl.path[i].name;
+        }
+        return name;
+    }
+
+}   // namespace Lett.
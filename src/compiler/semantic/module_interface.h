@@ -0,0 +1,51 @@
+#ifndef __LETT_SEMANTIC_MODULE_INTERFACE_H__
+#define __LETT_SEMANTIC_MODULE_INTERFACE_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+
+namespace Lett {
+
+    struct ExportedFunction {
+        std::string name;
+        std::uint32_t index;            // 函数在所在模块中的下标
+        TypeId ret;
+        std::vector<TypeId> params;     // 导出函数的类型只由基本类型和数组类型组成
+    };
+
+    // 模块接口：编译导入该模块的其它模块时所需的全部信息
+    // 接口不依赖语法树，可以序列化后缓存在磁盘上，导入未修改的模块时不需要重新编译
+    class ModuleInterface {
+    public:
+        std::string name;                           // 模块名，如math.vector
+        std::uint64_t source_hash;                  // 源代码的哈希值
+        std::vector<std::string> imports;           // 导入的模块名
+        std::vector<std::uint64_t> dependencies;    // 编译时各导入模块接口的哈希值，内置模块为0
+        std::vector<ExportedFunction> functions;    // main之外的所有函数
+
+        ModuleInterface();
+
+        // 从通过类型检查的语法树生成接口
+        static ModuleInterface fromModule(const Module &module, const std::string &name, std::uint64_t source_hash);
+        // 源代码及接口的哈希值(FNV-1a)
+        static std::uint64_t hashOf(std::string_view data);
+
+        // 查找导出的函数，未找到返回nullptr
+        const ExportedFunction *find(std::string_view name) const;
+        // 导出部分(函数的名字与类型)的哈希值，导出部分不变时导入它的模块不需要重新编译
+        std::uint64_t hash() const;
+
+        std::string serialize() const;
+        // 反序列化，数据不完整或格式错误时返回false
+        static bool deserialize(std::string_view data, ModuleInterface &out);
+    };  // class ModuleInterface
+
+    // 导入路径对应的模块名，如import math.vector;中的"math.vector"
+    std::string moduleNameOf(const ImportDecl &decl);
+
+}   // namespace Lett.
+
+#endif // __LETT_SEMANTIC_MODULE_INTERFACE_H__
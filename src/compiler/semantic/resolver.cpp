@@ -0,0 +1,215 @@
+#include <string>
+#include "resolver.h"
+
+namespace Lett {
+
+    Resolver::Resolver()
+        : _table(), _errors(), _next_slot(0), _max_slot(0), _loop_depth(0) {
+    }
+
+    void Resolver::_error(const Node &node, const std::string &msg) {
+        _errors.emplace_back(node.line, node.column, msg);
+    }
+
+    void Resolver::_declare_local(const Identifier &name, SymbolKind kind, std::uint32_t &slot, const Node &decl) {
+        Symbol symbol = _table.declare(name, kind, _next_slot, &decl);
+        if (symbol.decl != &decl) {
+            _error(decl, "'" + std::string(name.name) + "' is already declared in this scope");
+            return;
+        }
+        slot = _next_slot++;
+        if (_next_slot > _max_slot) {
+            _max_slot = _next_slot;
+        }
+    }
+
+    bool Resolver::resolve(Module &module) {
+        _errors.clear();
+        _table.enterScope();
+        for (std::size_t i = 0; i < module.imports.size(); ++i) {
+            ImportDecl *imp = module.imports[i];
+            const Identifier &name = imp->path[imp->path.size() - 1];
+            Symbol symbol = _table.declare(name, SymbolKind::MODULE, static_cast<std::uint32_t>(i), imp);
+            if (symbol.decl != imp) {
+                _error(*imp, "module '" + std::string(name.name) + "' is already imported");
+            }
+        }
+        // 先声明所有函数，函数体中可以引用在其后定义的函数
+        for (std::size_t i = 0; i < module.functions.size(); ++i) {
+            FunctionDecl *fn = module.functions[i];
+            fn->index = static_cast<std::uint32_t>(i);
+            Symbol symbol = _table.declare(fn->name, SymbolKind::FUNCTION, fn->index, fn);
+            if (symbol.decl != fn) {
+                _error(*fn, "'" + std::string(fn->name.name) + "' is already defined");
+            }
+        }
+        for (FunctionDecl *fn : module.functions) {
+            _function(*fn);
+        }
+        _table.leaveScope();
+        return _errors.empty();
+    }
+
+    void Resolver::_function(FunctionDecl &fn) {
+        _next_slot = 0;
+        _max_slot = 0;
+        _loop_depth = 0;
+        // 参数与函数体最外层的语句处于同一个作用域
+        _table.enterScope();
+        for (Param *param : fn.params) {
+            _declare_local(param->name, SymbolKind::PARAM, param->slot, *param);
+        }
+        for (Stmt *stmt : fn.body->stmts) {
+            _stmt(stmt);
+        }
+        _table.leaveScope();
+        fn.local_count = _max_slot;
+    }
+
+    void Resolver::_block(BlockStmt &block) {
+        std::uint32_t saved = _next_slot;
+        _table.enterScope();
+        for (Stmt *stmt : block.stmts) {
+            _stmt(stmt);
+        }
+        _table.leaveScope();
+        _next_slot = saved;     // 离开作用域后其中的编号可被复用
+    }
+
+    void Resolver::_stmt(Stmt *stmt) {
+        if (stmt == nullptr) {
+            return;
+        }
+        switch (stmt->kind) {
+            case StmtKind::BLOCK:
+                _block(*stmt->as<BlockStmt>());
+                break;
+            case StmtKind::VAR:
+                for (VarDecl *decl : stmt->as<VarStmt>()->decls) {
+                    // 先解析初始值，`var x = x;`中的x指向外层的x
+                    _expr(decl->init);
+                    _declare_local(decl->name, SymbolKind::VARIABLE, decl->slot, *decl);
+                }
+                break;
+            case StmtKind::EXPR:
+                _expr(stmt->as<ExprStmt>()->expr);
+                break;
+            case StmtKind::IF: {
+                IfStmt *s = stmt->as<IfStmt>();
+                _expr(s->cond);
+                _block(*s->then);
+                _stmt(s->otherwise);
+                break;
+            }
+            case StmtKind::WHILE: {
+                WhileStmt *s = stmt->as<WhileStmt>();
+                _expr(s->cond);
+                _loop_depth++;
+                _block(*s->body);
+                _loop_depth--;
+                break;
+            }
+            case StmtKind::DO_WHILE: {
+                DoWhileStmt *s = stmt->as<DoWhileStmt>();
+                _loop_depth++;
+                _block(*s->body);
+                _loop_depth--;
+                _expr(s->cond);
+                break;
+            }
+            case StmtKind::FOR: {
+                // for的初始化语句拥有独立的作用域
+                ForStmt *s = stmt->as<ForStmt>();
+                std::uint32_t saved = _next_slot;
+                _table.enterScope();
+                _stmt(s->init);
+                _expr(s->cond);
+                _expr(s->step);
+                _loop_depth++;
+                _block(*s->body);
+                _loop_depth--;
+                _table.leaveScope();
+                _next_slot = saved;
+                break;
+            }
+            case StmtKind::RETURN:
+                _expr(stmt->as<ReturnStmt>()->value);
+                break;
+            case StmtKind::BREAK:
+                if (_loop_depth == 0) {
+                    _error(*stmt, "'break' outside of a loop");
+                }
+                break;
+            case StmtKind::CONTINUE:
+                if (_loop_depth == 0) {
+                    _error(*stmt, "'continue' outside of a loop");
+                }
+                break;
+        }
+    }
+
+    void Resolver::_expr(Expr *expr) {
+        if (expr == nullptr) {
+            return;
+        }
+        switch (expr->kind) {
+            case ExprKind::LITERAL:
+                break;
+            case ExprKind::NAME: {
+                NameExpr *name = expr->as<NameExpr>();
+                const Symbol *symbol = _table.lookup(name->ident);
+                if (symbol == nullptr) {
+                    _error(*name, "undefined name '" + std::string(name->ident.name) + "'");
+                    break;
+                }
+                name->binding = symbol->kind;
+                name->slot = symbol->slot;
+                name->decl = symbol->decl;
+                break;
+            }
+            case ExprKind::UNARY:
+                _expr(expr->as<UnaryExpr>()->operand);
+                break;
+            case ExprKind::BINARY:
+                _expr(expr->as<BinaryExpr>()->left);
+                _expr(expr->as<BinaryExpr>()->right);
+                break;
+            case ExprKind::ASSIGN:
+                _expr(expr->as<AssignExpr>()->value);
+                _expr(expr->as<AssignExpr>()->target);
+                break;
+            case ExprKind::INC_DEC:
+                _expr(expr->as<IncDecExpr>()->target);
+                break;
+            case ExprKind::CALL: {
+                CallExpr *call = expr->as<CallExpr>();
+                _expr(call->callee);
+                for (Expr *arg : call->args) {
+                    _expr(arg);
+                }
+                break;
+            }
+            case ExprKind::MEMBER:
+                // 成员名由类型检查阶段根据对象的类型解析
+                _expr(expr->as<MemberExpr>()->object);
+                break;
+            case ExprKind::CAST:
+                _expr(expr->as<CastExpr>()->operand);
+                break;
+            case ExprKind::SPAWN:
+                _expr(expr->as<SpawnExpr>()->call);
+                break;
+            case ExprKind::AWAIT:
+                _expr(expr->as<AwaitExpr>()->task);
+                break;
+            case ExprKind::INDEX:
+                _expr(expr->as<IndexExpr>()->array);
+                _expr(expr->as<IndexExpr>()->index);
+                break;
+            case ExprKind::NEW_ARRAY:
+                _expr(expr->as<NewArrayExpr>()->length);
+                break;
+        }
+    }
+
+}   // namespace Lett.
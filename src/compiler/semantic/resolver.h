@@ -0,0 +1,41 @@
+#ifndef __LETT_SEMANTIC_RESOLVER_H__
+#define __LETT_SEMANTIC_RESOLVER_H__
+
+#include <cstdint>
+#include <vector>
+#include "exception.h"
+#include "ast.h"
+#include "symbol_table.h"
+
+namespace Lett {
+
+    // 名字解析
+    // 将表达式中的每个名字绑定到其声明(模块、函数、参数或局部变量)，
+    // 并为参数和局部变量分配函数内的编号。互不相交的块作用域共享编号。
+    class Resolver {
+    private:
+        SymbolTable _table;
+        std::vector<SemanticError> _errors;
+        std::uint32_t _next_slot;       // 下一个可用的局部变量编号
+        std::uint32_t _max_slot;        // 当前函数使用的最大编号
+        std::uint32_t _loop_depth;
+
+        void _error(const Node &node, const std::string &msg);
+        void _declare_local(const Identifier &name, SymbolKind kind, std::uint32_t &slot, const Node &decl);
+        void _function(FunctionDecl &fn);
+        void _block(BlockStmt &block);
+        void _stmt(Stmt *stmt);
+        void _expr(Expr *expr);
+    public:
+        Resolver();
+
+        // 解析整个模块，返回是否没有错误
+        bool resolve(Module &module);
+
+        const std::vector<SemanticError>& getErrors() const { return _errors; }
+        bool hasErrors() const { return !_errors.empty(); }
+    };  // class Resolver
+
+}   // namespace Lett.
+
+#endif // __LETT_SEMANTIC_RESOLVER_H__
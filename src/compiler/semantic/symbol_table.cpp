@@ -0,0 +1,107 @@
+#include "symbol_table.h"
+
+namespace Lett {
+
+    namespace {
+        std::size_t roundUpPowerOfTwo(std::size_t n) {
+            std::size_t capacity = 16;
+            while (capacity < n) {
+                capacity *= 2;
+            }
+            return capacity;
+        }
+    }   // namespace
+
+    SymbolTable::SymbolTable(std::size_t capacity)
+        : _slots(roundUpPowerOfTwo(capacity), Slot{0, EMPTY}), _symbols(), _scopes(), _used(0) {
+        _symbols.reserve(capacity);
+    }
+
+    // 返回名字所在的槽位，若名字不存在返回探测序列中第一个空槽位
+    std::size_t SymbolTable::_find_slot(const Identifier &name) const {
+        std::size_t mask = _slots.size() - 1;
+        std::uint32_t hash = static_cast<std::uint32_t>(name.hash);
+        std::size_t i = name.hash & mask;
+        while (true) {
+            const Slot &slot = _slots[i];
+            if (slot.index == EMPTY) {
+                return i;
+            }
+            if (slot.hash == hash && _symbols[slot.index].name.name == name.name) {
+                return i;
+            }
+            i = (i + 1) & mask;
+        }
+    }
+
+    // 将符号栈中index处的符号放入哈希表
+    void SymbolTable::_insert(std::uint32_t index) {
+        const Symbol &symbol = _symbols[index];
+        Slot &slot = _slots[_find_slot(symbol.name)];
+        if (slot.index == EMPTY) {
+            _used++;
+        }
+        slot.hash = static_cast<std::uint32_t>(symbol.name.hash);
+        slot.index = index;
+    }
+
+    // 扩容后按声明顺序重新插入，保持与逐个声明时相同的探测顺序
+    void SymbolTable::_grow() {
+        _slots.assign(_slots.size() * 2, Slot{0, EMPTY});
+        _used = 0;
+        for (std::size_t i = 0; i < _symbols.size(); ++i) {
+            _insert(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    void SymbolTable::enterScope() {
+        _scopes.push_back(_symbols.size());
+    }
+
+    void SymbolTable::leaveScope() {
+        if (_scopes.empty()) {
+            return;
+        }
+        std::size_t mark = _scopes.back();
+        _scopes.pop_back();
+        while (_symbols.size() > mark) {
+            const Symbol &symbol = _symbols.back();
+            Slot &slot = _slots[_find_slot(symbol.name)];
+            if (symbol.shadowed != NONE) {
+                slot.index = symbol.shadowed;
+            } else {
+                slot.index = EMPTY;
+                _used--;
+            }
+            _symbols.pop_back();
+        }
+    }
+
+    Symbol SymbolTable::declare(const Identifier &name, SymbolKind kind, std::uint32_t slot, const Node *decl) {
+        std::uint32_t shadowed = NONE;
+        const Slot &found = _slots[_find_slot(name)];
+        if (found.index != EMPTY) {
+            const Symbol &existing = _symbols[found.index];
+            if (existing.depth == depth()) {
+                return existing;
+            }
+            shadowed = found.index;
+        }
+        if ((_used + 1) * 2 > _slots.size()) {
+            _grow();
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(_symbols.size());
+        _symbols.push_back(Symbol{name, kind, depth(), slot, shadowed, decl});
+        _insert(index);
+        return _symbols.back();
+    }
+
+    const Symbol *SymbolTable::lookup(const Identifier &name) const {
+        const Slot &slot = _slots[_find_slot(name)];
+        if (slot.index == EMPTY) {
+            return nullptr;
+        }
+        return &_symbols[slot.index];
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,71 @@
+#ifndef __LETT_SEMANTIC_SYMBOL_TABLE_H__
+#define __LETT_SEMANTIC_SYMBOL_TABLE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ast.h"
+
+namespace Lett {
+
+    struct Symbol {
+        Identifier name;
+        SymbolKind kind;
+        std::uint32_t depth;        // 声明所在的作用域深度
+        std::uint32_t slot;         // 参数或局部变量的编号，函数或模块的下标
+        std::uint32_t shadowed;     // 被遮蔽的同名外层符号的下标，NONE表示没有
+        const Node *decl;           // 声明该符号的节点
+    };
+
+    // 符号表：扁平的开放寻址哈希表 + 符号栈
+    //
+    // 所有作用域共用一张哈希表，每个名字只占一个槽位，槽位指向该名字当前可见的(最内层的)符号。
+    // 符号按声明顺序压入符号栈，内层的同名符号记录被其遮蔽的外层符号。
+    // 离开作用域时按后进先出的顺序弹出符号，并恢复槽位：
+    //   - 若符号遮蔽了外层符号，槽位改为指向外层符号；
+    //   - 否则直接清空槽位。由于删除严格按插入的逆序进行，探测序列经过该槽位的名字都在其之后插入，
+    //     此时已全部删除，因此线性探测不需要墓碑标记。
+    // 查找只访问连续的槽位数组，不分配内存。
+    class SymbolTable {
+    private:
+        static constexpr std::uint32_t EMPTY = 0xFFFFFFFFu;
+
+        // 槽位保存哈希值的低32位，探测时先比较哈希值，避免访问符号栈
+        struct Slot {
+            std::uint32_t hash;
+            std::uint32_t index;
+        };
+
+        std::vector<Slot> _slots;
+        std::vector<Symbol> _symbols;       // 符号栈
+        std::vector<std::size_t> _scopes;   // 每个作用域开始时符号栈的大小
+        std::size_t _used;                  // 已占用的槽位数
+
+        std::size_t _find_slot(const Identifier &name) const;
+        void _insert(std::uint32_t index);
+        void _grow();
+    public:
+        static constexpr std::uint32_t NONE = EMPTY;
+
+        SymbolTable(std::size_t capacity = 64);
+
+        // 进入一个新的块作用域
+        void enterScope();
+        // 离开当前作用域，回滚其中声明的所有符号
+        void leaveScope();
+        std::uint32_t depth() const { return static_cast<std::uint32_t>(_scopes.size()); }
+
+        // 在当前作用域中声明符号
+        // 当前作用域中已存在同名符号时不做修改，返回已存在的符号，否则返回新符号。
+        // 返回副本：之后的声明可能使符号栈重新分配
+        Symbol declare(const Identifier &name, SymbolKind kind, std::uint32_t slot, const Node *decl);
+        // 查找当前可见的符号，未找到返回nullptr
+        const Symbol *lookup(const Identifier &name) const;
+
+        std::size_t size() const { return _symbols.size(); }
+        std::size_t capacity() const { return _slots.size(); }
+    };  // class SymbolTable
+
+}   // namespace Lett.
+
+#endif // __LETT_SEMANTIC_SYMBOL_TABLE_H__
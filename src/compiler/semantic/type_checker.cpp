@@ -0,0 +1,725 @@
+#include <string>
+#include "natives.h"
+#include "module_interface.h"
+#include "type_checker.h"
+
+namespace Lett {
+
+    namespace {
+        #define TKTP_MEMBER(t, s) case TokenType::t: return s;
+        const char *operatorText(TokenType op) {
+            switch (op) {
+                LETT_TKTP_OPERATOR
+                default:
+                    return "?";
+            }
+        }
+        #undef TKTP_MEMBER
+
+        // 复合赋值对应的二元运算
+        TokenType binaryOf(TokenType op) {
+            switch (op) {
+                case TokenType::OP_ADD_ASSIGN:      return TokenType::OP_ADD;
+                case TokenType::OP_SUB_ASSIGN:      return TokenType::OP_SUB;
+                case TokenType::OP_MUL_ASSIGN:      return TokenType::OP_MUL;
+                case TokenType::OP_DIV_ASSIGN:      return TokenType::OP_DIV;
+                case TokenType::OP_MOD_ASSIGN:      return TokenType::OP_MOD;
+                case TokenType::OP_BIT_AND_ASSIGN:  return TokenType::OP_BIT_AND;
+                case TokenType::OP_BIT_OR_ASSIGN:   return TokenType::OP_BIT_OR;
+                default:                            return op;
+            }
+        }
+
+        // 整数常量：整数字面量或对其取负，如-1、-(-2)
+        bool intConstant(const Expr *expr, bool &negative, qword &magnitude) {
+            if (expr->kind == ExprKind::LITERAL && expr->as<LiteralExpr>()->isInteger()) {
+                negative = false;
+                magnitude = expr->as<LiteralExpr>()->integer;
+                return true;
+            }
+            if (expr->kind == ExprKind::UNARY && expr->as<UnaryExpr>()->op == TokenType::OP_SUB
+                && intConstant(expr->as<UnaryExpr>()->operand, negative, magnitude)) {
+                negative = !negative && magnitude != 0;
+                return true;
+            }
+            return false;
+        }
+
+        bool isIntConstant(const Expr *expr) {
+            bool negative;
+            qword magnitude;
+            return intConstant(expr, negative, magnitude);
+        }
+
+        bool fits(TypeId type, bool negative, qword magnitude) {
+            if (TypeTable::isFloat(type) || type == TYPE_BIGINT) {
+                return true;
+            }
+            unsigned width = TypeTable::width(type);
+            if (!TypeTable::isSigned(type)) {
+                return !negative && (width >= 64 || magnitude < (1ULL << width));
+            }
+            qword limit = 1ULL << (width - 1);
+            return negative ? magnitude <= limit : magnitude < limit;
+        }
+
+        // 将整数常量标注为指定的类型，浮点类型时字面量直接转换为浮点数
+        void retype(Expr *expr, TypeId type) {
+            expr->type = type;
+            if (expr->kind == ExprKind::UNARY) {
+                retype(expr->as<UnaryExpr>()->operand, type);
+            } else if (TypeTable::isFloat(type)) {
+                LiteralExpr *lit = expr->as<LiteralExpr>();
+                lit->real = static_cast<double>(lit->integer);
+                lit->token = TokenType::FLOAT;
+            }
+        }
+
+        // 能作为sys.print之类内置函数参数的类型
+        bool isPrintable(TypeId type) {
+            return type == TYPE_BOOL || type == TYPE_CHAR || type == TYPE_STRING || type == TYPE_BIGINT
+                   || TypeTable::isNumeric(type);
+        }
+
+        // 内置函数的返回值和参数的类型，ANY接受任意可打印的值。
+        // array模块的函数对所有数组类型通用，其类型在调用时由第一个参数决定，这里只作为占位
+        TypeId nativeType(NativeType type) {
+            switch (type) {
+                case NATIVE_INT:        return TYPE_INT;
+                case NATIVE_STRING:     return TYPE_STRING;
+                case NATIVE_ANY:
+                case NATIVE_ARRAY:
+                case NATIVE_ELEMENT:
+                case NATIVE_WIDE:       return TYPE_ANY;
+                default:                return TYPE_VOID;
+            }
+        }
+
+        // 数组的sum、dot的结果类型
+        TypeId wideOf(TypeId element) {
+            if (TypeTable::isFloat(element)) {
+                return TYPE_FLOAT64;
+            }
+            return TypeTable::isSigned(element) ? TYPE_INT : TYPE_UINT64;
+        }
+    }   // namespace
+
+    TypeChecker::TypeChecker()
+        : _types(nullptr), _arena(nullptr), _errors(), _return_type(TYPE_VOID) {
+    }
+
+    void TypeChecker::_error(const Node &node, const std::string &msg) {
+        _errors.emplace_back(node.line, node.column, msg);
+    }
+
+    bool TypeChecker::widens(TypeId from, TypeId to) {
+        if (from == to) {
+            return true;
+        }
+        if (TypeTable::isInteger(from) && to == TYPE_BIGINT) {
+            return true;        // bigint可以容纳任意整数类型的值
+        }
+        if (TypeTable::isInteger(from) && TypeTable::isInteger(to)) {
+            if (to == TYPE_INT) {
+                return true;    // int可以容纳任意整数类型的值
+            }
+            if (from == TYPE_INT || (TypeTable::isSigned(from) && !TypeTable::isSigned(to))) {
+                return false;
+            }
+            // 同符号的拓宽，或无符号到更宽的有符号类型
+            return TypeTable::width(from) < TypeTable::width(to);
+        }
+        return from == TYPE_FLOAT32 && to == TYPE_FLOAT64;
+    }
+
+    bool TypeChecker::check(Module &module) {
+        _errors.clear();
+        _types = &module.types;
+        _arena = &module.arena();
+        // 先确定所有函数的类型，函数体中可以调用在其后定义的函数
+        for (FunctionDecl *fn : module.functions) {
+            _signature(*fn);
+        }
+        for (FunctionDecl *fn : module.functions) {
+            _function(*fn);
+        }
+        _types = nullptr;
+        _arena = nullptr;
+        return _errors.empty();
+    }
+
+    TypeId TypeChecker::_resolve(TypeNode *type, bool allow_void) {
+        TypeId id = TypeTable::lookup(type->name.name);
+        if (id == TYPE_ERROR) {
+            _error(*type, "unknown type '" + std::string(type->name.name) + "'");
+        } else if (type->array) {
+            id = _element(*type, id) ? TypeTable::array(id) : TYPE_ERROR;
+        } else if (id == TYPE_VOID && !allow_void) {
+            _error(*type, "'void' is not a valid type here");
+            id = TYPE_ERROR;
+        }
+        type->resolved = id;
+        return id;
+    }
+
+    // 数组只能存放定长的数值类型
+    bool TypeChecker::_element(const Node &node, TypeId type) {
+        if (!TypeTable::isElement(type)) {
+            _error(node, "array elements must be of a fixed-width numeric type, not '" + _types->name(type) + "'");
+            return false;
+        }
+        return true;
+    }
+
+    void TypeChecker::_signature(FunctionDecl &fn) {
+        std::vector<TypeId> params;
+        for (Param *param : fn.params) {
+            params.push_back(_resolve(param->type, false));
+        }
+        TypeId ret = fn.ret != nullptr ? _resolve(fn.ret, true) : TYPE_VOID;
+        fn.signature = _types->function(ret, params);
+    }
+
+    void TypeChecker::_function(FunctionDecl &fn) {
+        _return_type = _types->info(fn.signature).ret;
+        _block(*fn.body);
+    }
+
+    void TypeChecker::_block(BlockStmt &block) {
+        for (Stmt *stmt : block.stmts) {
+            _stmt(stmt);
+        }
+    }
+
+    void TypeChecker::_condition(Expr *&cond) {
+        TypeId type = _expr(cond, TYPE_BOOL);
+        if (type != TYPE_BOOL && type != TYPE_ERROR) {
+            _error(*cond, "condition must be of type 'bool', not '" + _types->name(type) + "'");
+        }
+    }
+
+    // 将表达式隐式转换为目标类型，只允许拓宽转换
+    void TypeChecker::_coerce(Expr *&expr, TypeId target) {
+        TypeId from = expr->type;
+        if (from == TYPE_ERROR || target == TYPE_ERROR || from == target) {
+            return;
+        }
+        if (!widens(from, target)) {
+            _error(*expr, "cannot convert '" + _types->name(from) + "' to '" + _types->name(target) + "'");
+            return;
+        }
+        CastExpr *cast = _arena->create<CastExpr>(nullptr, expr, expr->line, expr->column);
+        cast->type = target;
+        expr = cast;
+    }
+
+    // 将二元运算的两个操作数转换为相同的类型
+    bool TypeChecker::_unify(const Node &node, Expr *&left, Expr *&right) {
+        TypeId l = left->type, r = right->type;
+        if (l == TYPE_ERROR || r == TYPE_ERROR) {
+            return false;
+        }
+        if (widens(l, r)) {
+            _coerce(left, r);
+        } else if (widens(r, l)) {
+            _coerce(right, l);
+        } else {
+            _error(node, "mismatched operand types '" + _types->name(l) + "' and '" + _types->name(r) + "'");
+            return false;
+        }
+        return true;
+    }
+
+    void TypeChecker::_stmt(Stmt *stmt) {
+        if (stmt == nullptr) {
+            return;
+        }
+        switch (stmt->kind) {
+            case StmtKind::BLOCK:
+                _block(*stmt->as<BlockStmt>());
+                break;
+            case StmtKind::VAR:
+                for (VarDecl *decl : stmt->as<VarStmt>()->decls) {
+                    TypeId type = decl->type != nullptr ? _resolve(decl->type, false) : TYPE_ERROR;
+                    if (decl->init != nullptr) {
+                        TypeId init = _expr(decl->init, type);
+                        if (decl->type != nullptr) {
+                            _coerce(decl->init, type);
+                        } else if (init == TYPE_VOID) {
+                            _error(*decl, "cannot declare variable '" + std::string(decl->name.name) + "' of type 'void'");
+                        } else {
+                            type = init;    // 由初始值推导变量的类型
+                        }
+                    } else if (decl->type == nullptr) {
+                        _error(*decl, "variable '" + std::string(decl->name.name) + "' needs a type or an initializer");
+                    }
+                    decl->value_type = type;
+                }
+                break;
+            case StmtKind::EXPR:
+                _expr(stmt->as<ExprStmt>()->expr, TYPE_ERROR);
+                break;
+            case StmtKind::IF: {
+                IfStmt *s = stmt->as<IfStmt>();
+                _condition(s->cond);
+                _block(*s->then);
+                _stmt(s->otherwise);
+                break;
+            }
+            case StmtKind::WHILE: {
+                WhileStmt *s = stmt->as<WhileStmt>();
+                _condition(s->cond);
+                _block(*s->body);
+                break;
+            }
+            case StmtKind::DO_WHILE: {
+                DoWhileStmt *s = stmt->as<DoWhileStmt>();
+                _block(*s->body);
+                _condition(s->cond);
+                break;
+            }
+            case StmtKind::FOR: {
+                ForStmt *s = stmt->as<ForStmt>();
+                _stmt(s->init);
+                if (s->cond != nullptr) {
+                    _condition(s->cond);
+                }
+                if (s->step != nullptr) {
+                    _expr(s->step, TYPE_ERROR);
+                }
+                _block(*s->body);
+                break;
+            }
+            case StmtKind::RETURN: {
+                ReturnStmt *s = stmt->as<ReturnStmt>();
+                if (s->value == nullptr) {
+                    if (_return_type != TYPE_VOID && _return_type != TYPE_ERROR) {
+                        _error(*s, "missing return value of type '" + _types->name(_return_type) + "'");
+                    }
+                } else if (_return_type == TYPE_VOID) {
+                    _error(*s, "void function cannot return a value");
+                } else {
+                    _expr(s->value, _return_type);
+                    _coerce(s->value, _return_type);
+                }
+                break;
+            }
+            case StmtKind::BREAK:
+            case StmtKind::CONTINUE:
+                break;
+        }
+    }
+
+    /*
+     * 表达式
+     * expected为上下文期望的类型，仅用于确定整数和浮点数常量的类型，不代表检查结果
+     */
+    TypeId TypeChecker::_expr(Expr *expr, TypeId expected) {
+        if (isIntConstant(expr)) {
+            return _constant(expr, expected);
+        }
+        TypeId type = TYPE_ERROR;
+        switch (expr->kind) {
+            case ExprKind::LITERAL: {
+                switch (expr->as<LiteralExpr>()->token) {
+                    case TokenType::FLOAT:  type = TypeTable::isFloat(expected) ? expected : TYPE_FLOAT64; break;
+                    case TokenType::BOOL:   type = TYPE_BOOL; break;
+                    case TokenType::CHAR:   type = TYPE_CHAR; break;
+                    case TokenType::STRING: type = TYPE_STRING; break;
+                    default: break;
+                }
+                break;
+            }
+            case ExprKind::NAME:
+            case ExprKind::MEMBER:
+                type = expr->kind == ExprKind::NAME ? _name(expr->as<NameExpr>()) : _member(expr->as<MemberExpr>());
+                if (type == TYPE_MODULE || _types->isFunction(type)) {
+                    _error(*expr, "a module or function cannot be used as a value");
+                    type = TYPE_ERROR;
+                }
+                break;
+            case ExprKind::UNARY:
+                type = _unary(expr->as<UnaryExpr>(), expected);
+                break;
+            case ExprKind::BINARY:
+                type = _binary(expr->as<BinaryExpr>(), expected);
+                break;
+            case ExprKind::ASSIGN:
+                type = _assign(expr->as<AssignExpr>());
+                break;
+            case ExprKind::INC_DEC:
+                type = _inc_dec(expr->as<IncDecExpr>());
+                break;
+            case ExprKind::CALL:
+                type = _call(expr->as<CallExpr>());
+                break;
+            case ExprKind::CAST:
+                type = _cast(expr->as<CastExpr>());
+                break;
+            case ExprKind::SPAWN:
+                type = _spawn(expr->as<SpawnExpr>());
+                break;
+            case ExprKind::AWAIT:
+                type = _await(expr->as<AwaitExpr>());
+                break;
+            case ExprKind::INDEX:
+                type = _index(expr->as<IndexExpr>());
+                break;
+            case ExprKind::NEW_ARRAY:
+                type = _new_array(expr->as<NewArrayExpr>());
+                break;
+        }
+        expr->type = type;
+        return type;
+    }
+
+    // 整数常量的类型由上下文决定，默认为int
+    TypeId TypeChecker::_constant(Expr *expr, TypeId expected) {
+        bool negative;
+        qword magnitude;
+        intConstant(expr, negative, magnitude);
+        TypeId type = TypeTable::isNumeric(expected) || expected == TYPE_BIGINT ? expected : TYPE_INT;
+        if (!fits(type, negative, magnitude)) {
+            _error(*expr, "integer constant does not fit in type '" + _types->name(type) + "'");
+            type = TYPE_ERROR;
+        }
+        retype(expr, type);
+        return type;
+    }
+
+    TypeId TypeChecker::_name(NameExpr *expr) {
+        TypeId type = TYPE_ERROR;
+        switch (expr->binding) {
+            case SymbolKind::VARIABLE:
+                type = static_cast<const VarDecl *>(expr->decl)->value_type;
+                break;
+            case SymbolKind::PARAM:
+                type = static_cast<const Param *>(expr->decl)->type->resolved;
+                break;
+            case SymbolKind::FUNCTION:
+                type = static_cast<const FunctionDecl *>(expr->decl)->signature;
+                break;
+            case SymbolKind::MODULE:
+                type = TYPE_MODULE;
+                break;
+            default:
+                break;  // 名字解析已报告错误
+        }
+        expr->type = type;
+        return type;
+    }
+
+    // 模块的成员：导入模块导出的函数，或虚拟机提供的内置函数
+    TypeId TypeChecker::_member(MemberExpr *expr) {
+        if (expr->object->kind != ExprKind::NAME || _name(expr->object->as<NameExpr>()) != TYPE_MODULE) {
+            if (expr->object->type != TYPE_ERROR || expr->object->kind != ExprKind::NAME) {
+                _error(*expr, "member access is only supported on modules");
+            }
+            expr->type = TYPE_ERROR;
+            return TYPE_ERROR;
+        }
+        const ImportDecl *imp = static_cast<const ImportDecl *>(expr->object->as<NameExpr>()->decl);
+        std::string module = moduleNameOf(*imp);
+        if (imp->interface != nullptr) {
+            const ExportedFunction *fn = imp->interface->find(expr->member.name);
+            if (fn != nullptr) {
+                expr->binding = SymbolKind::FUNCTION;
+                expr->slot = fn->index;
+                expr->type = _types->function(fn->ret, fn->params);
+                return expr->type;
+            }
+        } else {
+            NativeId id = findNative(module, expr->member.name);
+            if (id != NATIVE_COUNT) {
+                expr->binding = SymbolKind::NATIVE;
+                expr->slot = id;
+                const NativeInfo &info = nativeInfo(id);
+                std::vector<TypeId> params;
+                for (std::uint32_t i = 0; i < info.arity; ++i) {
+                    params.push_back(nativeType(info.paramType(i)));
+                }
+                expr->type = _types->function(nativeType(info.ret), params);
+                return expr->type;
+            }
+        }
+        _error(*expr, "module '" + module + "' has no member '" + std::string(expr->member.name) + "'");
+        expr->type = TYPE_ERROR;
+        return TYPE_ERROR;
+    }
+
+    TypeId TypeChecker::_unary(UnaryExpr *expr, TypeId expected) {
+        TypeId type = _expr(expr->operand, expr->op == TokenType::OP_NOT ? TYPE_BOOL : expected);
+        return _operator(*expr, expr->op, type);
+    }
+
+    TypeId TypeChecker::_binary(BinaryExpr *expr, TypeId expected) {
+        TokenType op = expr->op;
+        if (op == TokenType::OP_AND || op == TokenType::OP_OR) {
+            _condition(expr->left);
+            _condition(expr->right);
+            return TYPE_BOOL;
+        }
+        if (op == TokenType::OP_BIT_SHIFT_LEFT || op == TokenType::OP_BIT_SHIFT_RIGHT) {
+            // 移位的两个操作数不需要相同的类型，结果的类型为左操作数的类型
+            TypeId left = _expr(expr->left, expected);
+            TypeId right = _expr(expr->right, TYPE_ERROR);
+            if (right != TYPE_ERROR && !TypeTable::isInteger(right)) {
+                _error(*expr->right, "shift count must be an integer, not '" + _types->name(right) + "'");
+            }
+            return _operator(*expr, op, left);
+        }
+        // 整数常量采用另一个操作数的类型，两个操作数都是常量时采用上下文期望的类型
+        if (isIntConstant(expr->left) && !isIntConstant(expr->right)) {
+            _expr(expr->left, _expr(expr->right, TYPE_ERROR));
+        } else {
+            _expr(expr->right, _expr(expr->left, isIntConstant(expr->left) ? expected : TYPE_ERROR));
+        }
+        if (!_unify(*expr, expr->left, expr->right)) {
+            return TYPE_ERROR;
+        }
+        return _operator(*expr, op, expr->left->type);
+    }
+
+    // 检查运算符能否作用于类型为type的操作数，返回运算结果的类型
+    TypeId TypeChecker::_operator(const Node &node, TokenType op, TypeId type) {
+        if (type == TYPE_ERROR) {
+            return TYPE_ERROR;
+        }
+        bool integer = TypeTable::isInteger(type);
+        bool numeric = TypeTable::isNumeric(type);
+        bool big = type == TYPE_BIGINT;     // bigint只支持算术运算和比较
+        bool valid = false;
+        TypeId result = type;
+        switch (op) {
+            case TokenType::OP_ADD:
+                valid = numeric || big || type == TYPE_STRING;
+                break;
+            case TokenType::OP_SUB:
+            case TokenType::OP_MUL:
+            case TokenType::OP_DIV:
+                valid = numeric || big;
+                break;
+            case TokenType::OP_MOD:
+                valid = integer || big;
+                break;
+            case TokenType::OP_BIT_NOT:
+            case TokenType::OP_BIT_SHIFT_LEFT:
+            case TokenType::OP_BIT_SHIFT_RIGHT:
+                valid = integer;
+                break;
+            case TokenType::OP_BIT_AND:
+            case TokenType::OP_BIT_OR:
+            case TokenType::OP_BIT_XOR:
+                valid = integer || type == TYPE_BOOL;
+                break;
+            case TokenType::OP_NOT:
+                valid = type == TYPE_BOOL;
+                break;
+            case TokenType::OP_EQUAL:
+            case TokenType::OP_NOT_EQUAL:
+                valid = isPrintable(type);
+                result = TYPE_BOOL;
+                break;
+            case TokenType::OP_LESS:
+            case TokenType::OP_LESS_EQUAL:
+            case TokenType::OP_GREAT:
+            case TokenType::OP_GREAT_EQUAL:
+                valid = numeric || big || type == TYPE_CHAR || type == TYPE_STRING;
+                result = TYPE_BOOL;
+                break;
+            default:
+                break;
+        }
+        if (!valid) {
+            _error(node, std::string("operator '") + operatorText(op) + "' cannot be applied to '" + _types->name(type) + "'");
+            return TYPE_ERROR;
+        }
+        return result;
+    }
+
+    TypeId TypeChecker::_assign(AssignExpr *expr) {
+        TypeId target = _expr(expr->target, TYPE_ERROR);
+        if (expr->target->kind != ExprKind::NAME && expr->target->kind != ExprKind::INDEX) {
+            if (target != TYPE_ERROR) {
+                _error(*expr->target, "cannot assign to this expression");
+            }
+            _expr(expr->value, TYPE_ERROR);
+            return TYPE_ERROR;
+        }
+        TypeId value = _expr(expr->value, target);
+        if (target == TYPE_ERROR || value == TYPE_ERROR) {
+            return target;
+        }
+        if (expr->op != TokenType::OP_ASSIGN && _operator(*expr, binaryOf(expr->op), target) == TYPE_ERROR) {
+            return target;
+        }
+        _coerce(expr->value, target);
+        return target;
+    }
+
+    TypeId TypeChecker::_inc_dec(IncDecExpr *expr) {
+        TypeId target = _expr(expr->target, TYPE_ERROR);
+        if (target != TYPE_ERROR && !TypeTable::isNumeric(target) && target != TYPE_BIGINT) {
+            _error(*expr, std::string("operator '") + operatorText(expr->op) + "' cannot be applied to '" + _types->name(target) + "'");
+            return TYPE_ERROR;
+        }
+        return target;
+    }
+
+    TypeId TypeChecker::_call(CallExpr *expr) {
+        // 被调用者可以是函数或内置函数，不需要作为值使用
+        TypeId callee;
+        if (expr->callee->kind == ExprKind::NAME) {
+            callee = _name(expr->callee->as<NameExpr>());
+        } else if (expr->callee->kind == ExprKind::MEMBER) {
+            callee = _member(expr->callee->as<MemberExpr>());
+        } else {
+            callee = _expr(expr->callee, TYPE_ERROR);
+        }
+        if (callee != TYPE_ERROR && expr->callee->kind == ExprKind::MEMBER
+            && expr->callee->as<MemberExpr>()->binding == SymbolKind::NATIVE) {
+            const NativeInfo &native = nativeInfo(static_cast<NativeId>(expr->callee->as<MemberExpr>()->slot));
+            if (native.param == NATIVE_ARRAY) {
+                return _array_call(expr, native);
+            }
+        }
+        if (callee == TYPE_ERROR || !_types->isFunction(callee)) {
+            if (callee != TYPE_ERROR) {
+                _error(*expr, "expression of type '" + _types->name(callee) + "' is not callable");
+            }
+            for (Expr *arg : expr->args) {
+                _expr(arg, TYPE_ERROR);
+            }
+            return TYPE_ERROR;
+        }
+        // 复制一份：检查参数时可能驻留新的函数类型或纤程类型，使类型表重新分配
+        const TypeInfo info = _types->info(callee);
+        if (expr->args.size() != info.param_count) {
+            _error(*expr, "expected " + std::to_string(info.param_count) + " arguments, got "
+                          + std::to_string(expr->args.size()));
+        }
+        for (std::size_t i = 0; i < expr->args.size(); ++i) {
+            TypeId param = i < info.param_count ? _types->param(callee, i) : TYPE_ERROR;
+            TypeId arg = _expr(expr->args[i], param);
+            if (param != TYPE_ANY) {
+                _coerce(expr->args[i], param);
+            } else if (arg != TYPE_ERROR && !isPrintable(arg)) {
+                _error(*expr->args[i], "cannot print a value of type '" + _types->name(arg) + "'");
+            }
+        }
+        return info.ret;
+    }
+
+    // 只能在纤程中执行模块中的函数，内置函数由虚拟机直接执行，不能作为纤程的入口
+    TypeId TypeChecker::_spawn(SpawnExpr *expr) {
+        TypeId ret = _call(expr->call);
+        expr->call->type = ret;
+        if (expr->call->callee->kind == ExprKind::MEMBER
+            && expr->call->callee->as<MemberExpr>()->binding == SymbolKind::NATIVE) {
+            _error(*expr, "cannot spawn a native function");
+            return TYPE_ERROR;
+        }
+        return ret == TYPE_ERROR ? TYPE_ERROR : _types->task(ret);
+    }
+
+    TypeId TypeChecker::_await(AwaitExpr *expr) {
+        TypeId task = _expr(expr->task, TYPE_ERROR);
+        if (task == TYPE_ERROR) {
+            return TYPE_ERROR;
+        }
+        if (!_types->isTask(task)) {
+            _error(*expr, "cannot await a value of type '" + _types->name(task) + "'");
+            return TYPE_ERROR;
+        }
+        return _types->info(task).ret;
+    }
+
+    // array模块的函数：第一个参数为数组，其余参数和返回值的类型由该数组的类型决定
+    TypeId TypeChecker::_array_call(CallExpr *expr, const NativeInfo &info) {
+        if (expr->args.size() != info.arity) {
+            _error(*expr, "expected " + std::to_string(info.arity) + " arguments, got "
+                          + std::to_string(expr->args.size()));
+        }
+        TypeId array = TYPE_ERROR;
+        for (std::size_t i = 0; i < expr->args.size(); ++i) {
+            if (i == 0) {
+                array = _expr(expr->args[i], TYPE_ERROR);
+                if (array != TYPE_ERROR && !TypeTable::isArray(array)) {
+                    _error(*expr->args[i], "expected an array, not '" + _types->name(array) + "'");
+                    array = TYPE_ERROR;
+                }
+                continue;
+            }
+            TypeId param = TYPE_ERROR;
+            if (array != TYPE_ERROR && i < info.arity) {
+                param = info.rest == NATIVE_ARRAY ? array : TypeTable::element(array);
+            }
+            _expr(expr->args[i], param);
+            _coerce(expr->args[i], param);
+        }
+        if (array == TYPE_ERROR) {
+            return TYPE_ERROR;
+        }
+        switch (info.ret) {
+            case NATIVE_INT:        return TYPE_INT;
+            case NATIVE_ARRAY:      return array;
+            case NATIVE_ELEMENT:    return TypeTable::element(array);
+            case NATIVE_WIDE:       return wideOf(TypeTable::element(array));
+            default:                return TYPE_VOID;
+        }
+    }
+
+    // 数组的下标转换为int，越界在执行时检查
+    TypeId TypeChecker::_index(IndexExpr *expr) {
+        TypeId array = _expr(expr->array, TYPE_ERROR);
+        TypeId index = _expr(expr->index, TYPE_INT);
+        if (index != TYPE_ERROR && !TypeTable::isInteger(index)) {
+            _error(*expr->index, "array index must be an integer, not '" + _types->name(index) + "'");
+        } else {
+            _coerce(expr->index, TYPE_INT);
+        }
+        if (array == TYPE_ERROR) {
+            return TYPE_ERROR;
+        }
+        if (!TypeTable::isArray(array)) {
+            _error(*expr, "cannot index a value of type '" + _types->name(array) + "'");
+            return TYPE_ERROR;
+        }
+        return TypeTable::element(array);
+    }
+
+    // 数组的长度转换为int，为负数时在执行时报错
+    TypeId TypeChecker::_new_array(NewArrayExpr *expr) {
+        TypeId element = TypeTable::lookup(expr->element->name.name);
+        expr->element->resolved = element;
+        if (element != TYPE_ERROR && !_element(*expr, element)) {
+            element = TYPE_ERROR;
+        }
+        TypeId length = _expr(expr->length, TYPE_INT);
+        if (length != TYPE_ERROR && !TypeTable::isInteger(length)) {
+            _error(*expr->length, "array length must be an integer, not '" + _types->name(length) + "'");
+        } else {
+            _coerce(expr->length, TYPE_INT);
+        }
+        return element == TYPE_ERROR ? TYPE_ERROR : TypeTable::array(element);
+    }
+
+    // 显式类型转换：数值类型之间，char与整数之间，以及整数与bigint之间（bigint转为整数时取补码的低位）
+    TypeId TypeChecker::_cast(CastExpr *expr) {
+        TypeId target = _resolve(expr->target, false);
+        TypeId from = _expr(expr->operand, TYPE_ERROR);     // 常量按其默认类型转换，如uint32(-1)
+        if (target == TYPE_ERROR || from == TYPE_ERROR || from == target) {
+            return target;
+        }
+        bool valid = (TypeTable::isNumeric(from) && TypeTable::isNumeric(target))
+                  || (from == TYPE_CHAR && TypeTable::isInteger(target))
+                  || (TypeTable::isInteger(from) && target == TYPE_CHAR)
+                  || (TypeTable::isInteger(from) && target == TYPE_BIGINT)
+                  || (from == TYPE_BIGINT && TypeTable::isInteger(target));
+        if (!valid) {
+            _error(*expr, "cannot convert '" + _types->name(from) + "' to '" + _types->name(target) + "'");
+        }
+        return target;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,63 @@
+#ifndef __LETT_SEMANTIC_TYPE_CHECKER_H__
+#define __LETT_SEMANTIC_TYPE_CHECKER_H__
+
+#include <vector>
+#include "exception.h"
+#include "natives.h"
+#include "ast.h"
+
+namespace Lett {
+
+    // 静态类型检查，在名字解析之后进行
+    // 为每个表达式标注类型(Expr::type)，为变量和函数标注类型，并在需要隐式类型转换的地方插入CastExpr。
+    // 检查通过后，代码生成可以根据操作数的类型直接选择带类型的指令(如ADD_I64、ADD_F64)，运行时不再检查类型。
+    class TypeChecker {
+    private:
+        TypeTable *_types;
+        Arena *_arena;
+        std::vector<SemanticError> _errors;
+        TypeId _return_type;        // 当前函数的返回值类型
+
+        void _error(const Node &node, const std::string &msg);
+        TypeId _resolve(TypeNode *type, bool allow_void);
+        bool _element(const Node &node, TypeId type);
+        void _signature(FunctionDecl &fn);
+        void _function(FunctionDecl &fn);
+        void _block(BlockStmt &block);
+        void _stmt(Stmt *stmt);
+        void _condition(Expr *&cond);
+        void _coerce(Expr *&expr, TypeId target);
+        bool _unify(const Node &node, Expr *&left, Expr *&right);
+
+        TypeId _expr(Expr *expr, TypeId expected);
+        TypeId _constant(Expr *expr, TypeId expected);
+        TypeId _name(NameExpr *expr);
+        TypeId _member(MemberExpr *expr);
+        TypeId _unary(UnaryExpr *expr, TypeId expected);
+        TypeId _binary(BinaryExpr *expr, TypeId expected);
+        TypeId _assign(AssignExpr *expr);
+        TypeId _inc_dec(IncDecExpr *expr);
+        TypeId _call(CallExpr *expr);
+        TypeId _cast(CastExpr *expr);
+        TypeId _spawn(SpawnExpr *expr);
+        TypeId _await(AwaitExpr *expr);
+        TypeId _array_call(CallExpr *expr, const NativeInfo &info);
+        TypeId _index(IndexExpr *expr);
+        TypeId _new_array(NewArrayExpr *expr);
+        TypeId _operator(const Node &node, TokenType op, TypeId operand);
+    public:
+        TypeChecker();
+
+        // 检查整个模块，返回是否没有错误
+        bool check(Module &module);
+
+        // 类型from的值能否隐式转换为类型to(不丢失信息的拓宽转换)
+        static bool widens(TypeId from, TypeId to);
+
+        const std::vector<SemanticError>& getErrors() const { return _errors; }
+        bool hasErrors() const { return !_errors.empty(); }
+    };  // class TypeChecker
+
+}   // namespace Lett.
+
+#endif // __LETT_SEMANTIC_TYPE_CHECKER_H__
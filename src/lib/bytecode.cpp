@@ -0,0 +1,76 @@
+#include "bytecode.h"
+
+namespace Lett {
+
+    #define OPCODE(name, format) #name,
+    const char *getOpcodeName(Opcode op) {
+        static const char *names[] = {
+            LETT_OPCODES
+        };
+        return op < Opcode::COUNT ? names[static_cast<byte>(op)] : "?";
+    }
+    #undef OPCODE
+
+    #define OPCODE(name, format) OpFormat::format,
+    OpFormat getOpFormat(Opcode op) {
+        static const OpFormat formats[] = {
+            LETT_OPCODES
+        };
+        return op < Opcode::COUNT ? formats[static_cast<byte>(op)] : OpFormat::ABC;
+    }
+    #undef OPCODE
+
+    unsigned getOpLength(Opcode op) {
+        switch (op) {
+            case Opcode::EQ_JMPF:
+            case Opcode::NE_JMPF:
+            case Opcode::LT_I64_JMPF:
+            case Opcode::LE_I64_JMPF:
+            case Opcode::ADDI_I64_JMP:
+            case Opcode::ADD_I64_RET:
+                return 2;
+            case Opcode::LOADI_LT_I64_JMPF:
+            case Opcode::LOADI_LE_I64_JMPF:
+                return 3;
+            default:
+                return 1;
+        }
+    }
+
+    namespace {
+        inline qword rotl(qword x, int b) {
+            return (x << b) | (x >> (64 - b));
+        }
+
+        inline void sipRound(qword &v0, qword &v1, qword &v2, qword &v3) {
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+        }
+    }   // namespace
+
+    // 按小端字节序的字节流计算，数据的长度总是8的倍数，最后一块只有长度
+    qword snapshotMac(const SnapshotKey &key, const qword *data, std::size_t count) {
+        qword v0 = key.k0 ^ 0x736f6d6570736575ULL;
+        qword v1 = key.k1 ^ 0x646f72616e646f6dULL;
+        qword v2 = key.k0 ^ 0x6c7967656e657261ULL;
+        qword v3 = key.k1 ^ 0x7465646279746573ULL;
+        auto compress = [&](qword m) {
+            v3 ^= m;
+            sipRound(v0, v1, v2, v3);
+            sipRound(v0, v1, v2, v3);
+            v0 ^= m;
+        };
+        for (std::size_t i = 0; i < count; ++i) {
+            compress(data[i]);
+        }
+        compress(static_cast<qword>(count * 8) << 56);
+        v2 ^= 0xff;
+        for (int i = 0; i < 4; ++i) {
+            sipRound(v0, v1, v2, v3);
+        }
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+}   // namespace Lett
@@ -15,4 +15,26 @@ namespace Lett {
         :LettException("Error option: " + option_name + "," + msg) {
 
     }
+
+    SyntaxError::SyntaxError(std::size_t line, std::size_t column, const std::string &msg)
+        :LettException("Syntax error at " + std::to_string(line) + ":" + std::to_string(column) + ", " + msg),
+        _line(line), _column(column) {
+
+    }
+
+    SemanticError::SemanticError(std::size_t line, std::size_t column, const std::string &msg)
+        :LettException("Semantic error at " + std::to_string(line) + ":" + std::to_string(column) + ", " + msg),
+        _line(line), _column(column) {
+
+    }
+
+    InvalidImage::InvalidImage(const std::string &fileName, const std::string &msg)
+        :LettException("Invalid image " + fileName + ", " + msg) {
+
+    }
+
+    RuntimeError::RuntimeError(const std::string &msg)
+        :LettException("Runtime error: " + msg) {
+
+    }
 }
\ No newline at end of file
@@ -0,0 +1,533 @@
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <cerrno>
+#include <filesystem>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "exception.h"
+#include "natives.h"
+#include "image.h"
+#include "verifier.h"
+
+namespace Lett {
+
+    namespace {
+        std::size_t alignUp(std::size_t value) {
+            return (value + 7) & ~static_cast<std::size_t>(7);
+        }
+
+        template <typename T>
+        void append(std::string &out, const T *data, std::size_t count) {
+            out.append(reinterpret_cast<const char *>(data), sizeof(T) * count);
+        }
+
+        // 打印字符串常量，不可打印的字符转义
+        void printQuoted(std::ostream &os, std::string_view text) {
+            static const char hex[] = "0123456789abcdef";
+            os << '"';
+            for (char ch : text) {
+                unsigned char c = static_cast<unsigned char>(ch);
+                switch (ch) {
+                    case '"':  os << "\\\""; break;
+                    case '\\': os << "\\\\"; break;
+                    case '\n': os << "\\n"; break;
+                    case '\t': os << "\\t"; break;
+                    case '\r': os << "\\r"; break;
+                    default:
+                        if (c < 0x20 || c >= 0x7F) {
+                            os << "\\x" << hex[c >> 4] << hex[c & 0xF];
+                        } else {
+                            os << ch;
+                        }
+                        break;
+                }
+            }
+            os << '"';
+        }
+    }   // namespace
+
+    /*
+     * ImageBuilder
+     */
+    ImageBuilder::ImageBuilder()
+        : _functions(), _code(), _constants(), _strings(), _string_offsets(), _constant_index(), _entry(0) {
+    }
+
+    dword ImageBuilder::addString(std::string_view value) {
+        auto it = _string_offsets.find(std::string(value));
+        if (it != _string_offsets.end()) {
+            return it->second;
+        }
+        dword offset = static_cast<dword>(_strings.size());
+        StringData header{static_cast<dword>(value.size()), StringData::hashOf(value.data(), value.size())};
+        append(_strings, &header, 1);
+        _strings.append(value.data(), value.size());
+        _strings.resize(offset + StringData::sizeFor(value.size()), '\0');
+        _string_offsets.emplace(std::string(value), offset);
+        return offset;
+    }
+
+    dword ImageBuilder::addConstant(qword value) {
+        auto it = _constant_index.find(value);
+        if (it != _constant_index.end()) {
+            return it->second;
+        }
+        dword index = static_cast<dword>(_constants.size());
+        _constants.push_back(value);
+        _constant_index.emplace(value, index);
+        return index;
+    }
+
+    dword ImageBuilder::addFunction(std::string_view name, word param_count, word register_count,
+                                    const std::vector<Instruction> &code, const std::vector<qword> &stack_maps,
+                                    const std::vector<LineEntry> &lines) {
+        FunctionEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.name = addString(name);
+        entry.code = static_cast<dword>(_code.size());
+        entry.code_size = static_cast<dword>(code.size());
+        entry.param_count = param_count;
+        entry.register_count = register_count;
+        entry.stack_maps = static_cast<dword>(_stack_maps.size());
+        entry.stack_map_count = static_cast<dword>(stack_maps.size() / stackMapWords(register_count));
+        _stack_maps.insert(_stack_maps.end(), stack_maps.begin(), stack_maps.end());
+        entry.lines = static_cast<dword>(_lines.size());
+        entry.line_count = static_cast<dword>(lines.size());
+        _lines.insert(_lines.end(), lines.begin(), lines.end());
+        _code.insert(_code.end(), code.begin(), code.end());
+        _functions.push_back(entry);
+        return static_cast<dword>(_functions.size() - 1);
+    }
+
+    std::string ImageBuilder::build() const {
+        ImageHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, LTC_MAGIC, sizeof(LTC_MAGIC));
+        header.version_major = LTC_VERSION_MAJOR;
+        header.version_minor = LTC_VERSION_MINOR;
+        header.byte_order = LTC_BYTE_ORDER;
+        header.header_size = sizeof(ImageHeader);
+        header.entry = _entry;
+
+        std::size_t offset = sizeof(ImageHeader);
+        header.function_count = static_cast<dword>(_functions.size());
+        header.functions_offset = static_cast<dword>(offset);
+        offset += sizeof(FunctionEntry) * _functions.size();
+        header.code_count = static_cast<dword>(_code.size());
+        header.code_offset = static_cast<dword>(offset);
+        offset = alignUp(offset + sizeof(Instruction) * _code.size());
+        header.constant_count = static_cast<dword>(_constants.size());
+        header.constants_offset = static_cast<dword>(offset);
+        offset += sizeof(qword) * _constants.size();
+        header.stack_maps_size = static_cast<dword>(_stack_maps.size());
+        header.stack_maps_offset = static_cast<dword>(offset);
+        offset += sizeof(qword) * _stack_maps.size();
+        header.line_count = static_cast<dword>(_lines.size());
+        header.lines_offset = static_cast<dword>(offset);
+        offset += sizeof(LineEntry) * _lines.size();
+        header.strings_size = static_cast<dword>(_strings.size());
+        header.strings_offset = static_cast<dword>(offset);
+        offset += _strings.size();
+        header.file_size = static_cast<dword>(offset);
+
+        std::string out;
+        out.reserve(offset);
+        append(out, &header, 1);
+        append(out, _functions.data(), _functions.size());
+        append(out, _code.data(), _code.size());
+        out.resize(header.constants_offset, '\0');
+        append(out, _constants.data(), _constants.size());
+        append(out, _stack_maps.data(), _stack_maps.size());
+        append(out, _lines.data(), _lines.size());
+        out += _strings;
+        return out;
+    }
+
+    /*
+     * Image
+     */
+    Image::Image()
+        : _name(), _data(nullptr), _size(0), _mapping(nullptr), _mapping_size(0), _buffer(), _string_index() {
+    }
+
+    Image::~Image() {
+        _unload();
+    }
+
+    void Image::_unload() {
+        if (_mapping != nullptr) {
+            ::munmap(_mapping, _mapping_size);
+            _mapping = nullptr;
+            _mapping_size = 0;
+        }
+        _buffer.clear();
+        _string_index.clear();
+        _data = nullptr;
+        _size = 0;
+    }
+
+    void Image::_fail(const std::string &msg) const {
+        throw InvalidImage(_name, msg);
+    }
+
+    void Image::load(const std::string &path) {
+        _unload();
+        _name = path;
+        _map(path);
+        try {
+            _validate();
+        } catch (...) {
+            _unload();
+            throw;
+        }
+    }
+
+    void Image::_map(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw FileNotExsit(path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ImageHeader)) {
+            ::close(fd);
+            _fail("file is too small");
+        }
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            _fail("cannot map file");
+        }
+        // 程序启动时即会访问大部分指令和常量，提前读入以减少缺页
+        ::madvise(mapping, size, MADV_WILLNEED);
+        _mapping = mapping;
+        _mapping_size = size;
+        _data = static_cast<const byte *>(mapping);
+        _size = size;
+    }
+
+    void Image::loadFromMemory(std::string_view data, const std::string &name) {
+        _unload();
+        _name = name;
+        _buffer.assign((data.size() + 7) / 8, 0);
+        if (!data.empty()) {
+            std::memcpy(_buffer.data(), data.data(), data.size());
+        }
+        _data = reinterpret_cast<const byte *>(_buffer.data());
+        _size = data.size();
+        try {
+            _validate();
+        } catch (...) {
+            _unload();
+            throw;
+        }
+    }
+
+    // 快照头和认证码正确时直接使用其中的字节码文件，只重新检查文件结构。
+    // 认证码防止篡改，结构检查使损坏的快照即使认证码碰巧正确也不会导致越界访问
+    void Image::loadSnapshot(const std::string &path, const SnapshotKey &key) {
+        _unload();
+        _name = path;
+        _map(path);
+        try {
+            const SnapshotHeader &s = *reinterpret_cast<const SnapshotHeader *>(_data);
+            if (_size < sizeof(SnapshotHeader) || std::memcmp(s.magic, LTS_MAGIC, sizeof(LTS_MAGIC)) != 0) {
+                _fail("not a snapshot");
+            }
+            if (s.byte_order != LTC_BYTE_ORDER || s.version_major != LTC_VERSION_MAJOR
+                || s.version_minor != LTC_VERSION_MINOR) {
+                _fail("snapshot of another version");
+            }
+            if (s.header_size != sizeof(SnapshotHeader) || s.file_size != _size || _size % 8 != 0
+                || s.image_offset % 8 != 0 || s.image_offset < s.header_size || s.image_offset > _size
+                || s.image_size < sizeof(ImageHeader) || s.image_size > _size - s.image_offset
+                || s.index_offset % 8 != 0 || s.index_offset < s.header_size || s.index_offset > _size
+                || s.index_size > (_size - s.index_offset) / sizeof(qword)) {
+                _fail("bad snapshot header");
+            }
+            const qword *body = reinterpret_cast<const qword *>(_data + s.header_size);
+            if (snapshotMac(key, body, (_size - s.header_size) / sizeof(qword)) != s.mac) {
+                _fail("bad snapshot authentication code, the snapshot was written with another key or modified");
+            }
+            const qword *index = reinterpret_cast<const qword *>(_data + s.index_offset);
+            std::size_t index_size = s.index_size;
+            _data += s.image_offset;
+            _size = s.image_size;
+            _validate(true);
+            if (_string_index.size() != index_size || !std::equal(_string_index.begin(), _string_index.end(), index)) {
+                _fail("bad snapshot string index");
+            }
+        } catch (...) {
+            _unload();
+            throw;
+        }
+    }
+
+    std::string Image::snapshot(const SnapshotKey &key) const {
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, LTS_MAGIC, sizeof(LTS_MAGIC));
+        header.version_major = LTC_VERSION_MAJOR;
+        header.version_minor = LTC_VERSION_MINOR;
+        header.byte_order = LTC_BYTE_ORDER;
+        header.header_size = sizeof(SnapshotHeader);
+        header.image_offset = sizeof(SnapshotHeader);
+        header.image_size = static_cast<dword>(_size);
+        header.index_offset = static_cast<dword>(alignUp(header.image_offset + _size));
+        header.index_size = static_cast<dword>(_string_index.size());
+        header.file_size = header.index_offset + sizeof(qword) * _string_index.size();
+
+        std::vector<qword> body((header.file_size - sizeof(SnapshotHeader)) / sizeof(qword), 0);
+        std::memcpy(body.data(), _data, _size);
+        std::copy(_string_index.begin(), _string_index.end(),
+                  body.begin() + (header.index_offset - sizeof(SnapshotHeader)) / sizeof(qword));
+        header.mac = snapshotMac(key, body.data(), body.size());
+        std::string out;
+        out.reserve(header.file_size);
+        append(out, &header, 1);
+        append(out, body.data(), body.size());
+        return out;
+    }
+
+    // 检查文件结构：各区都在文件范围内且对齐，函数的指令范围、函数名都有效。
+    // 之后由verify校验每个函数的指令。verified为真时（快照中的字节码文件）只检查结构，
+    // 不再检查字符串的哈希值和唯一性，也不再校验指令
+    void Image::_validate(bool verified) {
+        if (_size < sizeof(ImageHeader)) {
+            _fail("file is too small");
+        }
+        const ImageHeader &h = header();
+        if (std::memcmp(h.magic, LTC_MAGIC, sizeof(LTC_MAGIC)) != 0) {
+            _fail("bad magic number");
+        }
+        if (h.byte_order != LTC_BYTE_ORDER) {
+            _fail("byte order mismatch");
+        }
+        if (h.version_major != LTC_VERSION_MAJOR) {
+            _fail("unsupported version " + std::to_string(h.version_major) + "." + std::to_string(h.version_minor));
+        }
+        if (h.header_size < sizeof(ImageHeader) || h.file_size != _size) {
+            _fail("bad header");
+        }
+        auto section = [&](dword offset, dword count, std::size_t size, const char *name) {
+            if (offset % 8 != 0 || offset < h.header_size || offset > _size || count > (_size - offset) / size) {
+                _fail(std::string("bad ") + name + " section");
+            }
+        };
+        section(h.functions_offset, h.function_count, sizeof(FunctionEntry), "function");
+        section(h.code_offset, h.code_count, sizeof(Instruction), "code");
+        section(h.constants_offset, h.constant_count, sizeof(qword), "constant");
+        section(h.stack_maps_offset, h.stack_maps_size, sizeof(qword), "stack map");
+        section(h.lines_offset, h.line_count, sizeof(LineEntry), "line");
+        section(h.strings_offset, h.strings_size, 1, "string");
+        if (h.strings_size % 8 != 0) {
+            _fail("bad string section");
+        }
+
+        // 字符串表中每一项的起始位置。字符串互不相同且哈希值正确，解释器据此只比较两个字符串常量的地址
+        _string_index.assign((h.strings_size / 8 + 63) / 64, 0);
+        std::unordered_set<std::string_view> strings;
+        for (std::size_t pos = 0; pos < h.strings_size; ) {
+            if (h.strings_size - pos < sizeof(StringData)) {
+                _fail("bad string at " + std::to_string(pos));
+            }
+            const StringData *s = string(static_cast<dword>(pos));
+            if (s->length > h.strings_size - pos - sizeof(StringData) - 1 || s->chars()[s->length] != '\0'
+                || (!verified && (s->hash != StringData::hashOf(s->chars(), s->length)
+                                  || !strings.emplace(s->chars(), s->length).second))) {
+                _fail("bad string at " + std::to_string(pos));
+            }
+            _string_index[pos / 512] |= 1ULL << (pos / 8 % 64);
+            pos += StringData::sizeFor(s->length);
+        }
+        if (h.entry >= h.function_count) {
+            _fail("bad entry function");
+        }
+        for (dword i = 0; i < h.function_count; ++i) {
+            const FunctionEntry &fn = function(i);
+            if (!isString(fn.name) || fn.code_size == 0 || fn.code > h.code_count
+                || fn.code_size > h.code_count - fn.code
+                || fn.register_count > MAX_REGISTERS || fn.param_count > fn.register_count) {
+                _fail("bad function " + std::to_string(i));
+            }
+            // 栈映射在栈映射区内，按指令的下标严格递增
+            std::size_t words = stackMapWords(fn.register_count);
+            const qword *maps = reinterpret_cast<const qword *>(_data + h.stack_maps_offset);
+            if (fn.stack_maps > h.stack_maps_size || fn.stack_map_count > (h.stack_maps_size - fn.stack_maps) / words) {
+                _fail("bad stack maps of function " + std::to_string(i));
+            }
+            for (dword j = 0; j < fn.stack_map_count; ++j) {
+                qword pc = maps[fn.stack_maps + j * words];
+                if (pc >= fn.code_size || (j > 0 && pc <= maps[fn.stack_maps + (j - 1) * words])) {
+                    _fail("bad stack maps of function " + std::to_string(i));
+                }
+            }
+            // 行号在行号表内，同样按指令的下标严格递增
+            const LineEntry *lines = reinterpret_cast<const LineEntry *>(_data + h.lines_offset);
+            if (fn.lines > h.line_count || fn.line_count > h.line_count - fn.lines) {
+                _fail("bad lines of function " + std::to_string(i));
+            }
+            for (dword j = 0; j < fn.line_count; ++j) {
+                const LineEntry &line = lines[fn.lines + j];
+                if (line.pc >= fn.code_size || (j > 0 && line.pc <= lines[fn.lines + j - 1].pc)) {
+                    _fail("bad lines of function " + std::to_string(i));
+                }
+            }
+        }
+
+        if (!verified) {
+            verify(*this);
+        }
+    }
+
+    dword Image::line(const FunctionEntry &fn, dword pc) const {
+        const LineEntry *lines = reinterpret_cast<const LineEntry *>(_data + header().lines_offset) + fn.lines;
+        const LineEntry *end = lines + fn.line_count;
+        const LineEntry *after = std::upper_bound(lines, end, pc, [](dword at, const LineEntry &entry) {
+            return at < entry.pc;
+        });
+        return after == lines ? 0 : after[-1].line;
+    }
+
+    const qword *Image::stackMap(const FunctionEntry &fn, dword pc) const {
+        std::size_t words = stackMapWords(fn.register_count);
+        const qword *maps = reinterpret_cast<const qword *>(_data + header().stack_maps_offset) + fn.stack_maps;
+        dword low = 0, high = fn.stack_map_count;
+        while (low < high) {
+            dword mid = low + (high - low) / 2;
+            qword at = maps[mid * words];
+            if (at == pc) {
+                return maps + mid * words + 1;
+            }
+            if (at < pc) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return nullptr;
+    }
+
+    /*
+     * 反汇编
+     */
+    void disassemble(const Image &image, std::ostream &os) {
+        const ImageHeader &h = image.header();
+        os << "; lett bytecode " << h.version_major << "." << h.version_minor << ", "
+           << h.function_count << " functions, " << h.code_count << " instructions, "
+           << h.constant_count << " constants" << std::endl;
+        for (dword i = 0; i < h.function_count; ++i) {
+            const FunctionEntry &fn = image.function(i);
+            os << std::endl << "function " << image.stringView(fn.name)
+               << " (params " << fn.param_count << ", registers " << fn.register_count << ")"
+               << (i == h.entry ? " entry" : "") << std::endl;
+            const Instruction *code = image.code() + fn.code;
+            for (dword pc = 0; pc < fn.code_size; ++pc) {
+                Instruction ins = code[pc];
+                Opcode op = opOf(ins);
+                os << "  " << std::setw(4) << std::setfill('0') << pc << std::setfill(' ') << "  "
+                   << std::left << std::setw(18) << getOpcodeName(op) << std::right;
+                switch (getOpFormat(op)) {
+                    case OpFormat::ABC:
+                        os << argA(ins) << " " << argB(ins) << " " << (op == Opcode::ADDI_I64 || op == Opcode::ADDI_I64_JMP ? argSC(ins) : static_cast<int>(argC(ins)));
+                        break;
+                    case OpFormat::ABx:
+                        os << argA(ins) << " " << argBx(ins);
+                        break;
+                    case OpFormat::AsBx:
+                        os << argA(ins) << " " << argSBx(ins);
+                        break;
+                }
+                // 注释：常量的值、跳转目标、被调用的函数
+                dword bx = argBx(ins);
+                switch (op) {
+                    case Opcode::LOADK:
+                        if (bx < h.constant_count) {
+                            os << "\t; " << static_cast<std::int64_t>(image.constants()[bx]);
+                        }
+                        break;
+                    case Opcode::LOADS:
+                        if (bx < h.constant_count && image.constants()[bx] < h.strings_size) {
+                            os << "\t; ";
+                            printQuoted(os, image.stringView(static_cast<dword>(image.constants()[bx])));
+                        }
+                        break;
+                    case Opcode::JMP:
+                    case Opcode::JMPT:
+                    case Opcode::JMPF:
+                        os << "\t; to " << static_cast<std::int64_t>(pc) + 1 + argSBx(ins);
+                        break;
+                    case Opcode::CALL:
+                    case Opcode::TAILCALL:
+                    case Opcode::SPAWN:
+                    case Opcode::SPAWN_STR:
+                        if (bx < h.function_count) {
+                            os << "\t; " << image.stringView(image.function(bx).name);
+                        }
+                        break;
+                    case Opcode::NATIVE:
+                        if (bx < NATIVE_COUNT) {
+                            const NativeInfo &info = nativeInfo(static_cast<NativeId>(bx));
+                            os << "\t; " << info.module << "." << info.name;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                os << std::endl;
+            }
+        }
+    }
+
+    SnapshotKey readSnapshotKey(const std::string &path, bool create) {
+        SnapshotKey key;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0 && errno == ENOENT && create) {
+            // 先写入临时文件，再用link原子地创建，同时生成密钥的进程都使用先创建的文件
+            std::error_code ec;
+            std::filesystem::path parent = std::filesystem::path(path).parent_path();
+            if (!parent.empty()) {
+                std::filesystem::create_directories(parent, ec);
+            }
+            if (::getrandom(&key, sizeof(key), 0) != static_cast<ssize_t>(sizeof(key))) {
+                throw RuntimeError("cannot generate a snapshot key: " + std::string(std::strerror(errno)));
+            }
+            std::string temp = path + "." + std::to_string(::getpid());
+            ::unlink(temp.c_str());
+            int out = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            bool written = out >= 0 && ::write(out, &key, sizeof(key)) == static_cast<ssize_t>(sizeof(key));
+            int error = errno;
+            if (out >= 0) {
+                ::close(out);
+            }
+            if (written && ::link(temp.c_str(), path.c_str()) != 0 && errno != EEXIST) {
+                written = false;
+                error = errno;
+            }
+            ::unlink(temp.c_str());
+            if (!written) {
+                throw RuntimeError("cannot create snapshot key " + path + ": " + std::strerror(error));
+            }
+            fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        if (fd < 0) {
+            throw RuntimeError("cannot read snapshot key " + path + ": " + std::strerror(errno));
+        }
+        // 其他用户可以读取或改写的密钥不能防止伪造快照
+        struct stat st;
+        bool valid = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_uid == ::geteuid()
+            && (st.st_mode & 077) == 0 && st.st_size == static_cast<off_t>(sizeof(key))
+            && ::read(fd, &key, sizeof(key)) == static_cast<ssize_t>(sizeof(key));
+        ::close(fd);
+        if (!valid) {
+            throw RuntimeError("bad snapshot key " + path + ", it must be a 16-byte file accessible only by its owner");
+        }
+        return key;
+    }
+
+}   // namespace Lett
@@ -0,0 +1,726 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "exception.h"
+#include "natives.h"
+#include "verifier.h"
+
+namespace Lett {
+
+    namespace {
+
+        // 寄存器中的值的种类。NONE表示还没有推导到（不可达），UNDEF为未写入的寄存器，
+        // VALUE为整数、浮点数等不是引用的值，BIG为大整数（小整数或堆上的对象），ARRAY为数组，ANY为种类不确定的值
+        enum class Kind : byte {
+            NONE,
+            UNDEF,
+            VALUE,
+            TASK,
+            STRING,
+            BIG,
+            ARRAY,
+            ANY
+        };
+
+        // 可能引用堆上的对象，在安全点处必须在栈映射中
+        bool isReference(Kind kind) {
+            return kind == Kind::STRING || kind == Kind::BIG || kind == Kind::ARRAY;
+        }
+
+        struct Type {
+            Kind kind;
+            byte tasks;         // TASK：纤程的结果仍是纤程时的嵌套层数
+            Kind result;        // TASK：最内层纤程的结果为VALUE、STRING、BIG或ARRAY
+            bool known;         // VALUE：是否为已知的常量，用于检查内置函数参数的类型标记
+            std::int64_t value;
+
+            static Type of(Kind kind) { return Type{kind, 0, Kind::VALUE, false, 0}; }
+            static Type constant(std::int64_t value) { return Type{Kind::VALUE, 0, Kind::VALUE, true, value}; }
+            static Type task(Kind result) { return Type{Kind::TASK, 1, result, false, 0}; }
+
+            bool operator==(const Type &other) const {
+                return kind == other.kind && tasks == other.tasks && result == other.result && known == other.known
+                       && (!known || value == other.value);
+            }
+            bool operator!=(const Type &other) const { return !(*this == other); }
+        };
+
+        // 控制流汇合处的类型：不是引用的值合并为VALUE，字符串、大整数与其他种类合并为ANY
+        Type join(const Type &a, const Type &b) {
+            if (a.kind == Kind::NONE || a == b) {
+                return b;
+            }
+            if (b.kind == Kind::NONE) {
+                return a;
+            }
+            if (isReference(a.kind) || isReference(b.kind) || a.kind == Kind::ANY || b.kind == Kind::ANY) {
+                return Type::of(Kind::ANY);
+            }
+            return Type::of(Kind::VALUE);
+        }
+
+        // 以函数t的返回值为结果的纤程，SPAWN_STR创建的纤程的结果为t的种类（字符串、大整数或数组）
+        Type taskOf(const Type &t, bool reference) {
+            if (t.kind == Kind::TASK && t.tasks < 255 && !reference) {
+                Type task = t;
+                ++task.tasks;
+                task.known = false;
+                return task;
+            }
+            if (!reference) {
+                return Type::task(Kind::VALUE);
+            }
+            return Type::task(t.kind == Kind::BIG || t.kind == Kind::ARRAY ? t.kind : Kind::STRING);
+        }
+
+        // 等待纤程得到的结果
+        Type awaited(const Type &t) {
+            if (t.kind != Kind::TASK) {
+                return Type::of(Kind::VALUE);
+            }
+            if (t.tasks > 1) {
+                Type task = t;
+                --task.tasks;
+                return task;
+            }
+            return Type::of(t.result);
+        }
+
+        // 把超级指令看作它的第一条指令，其后融合的指令仍然按原来的指令校验
+        Opcode baseOf(Opcode op) {
+            switch (op) {
+                case Opcode::EQ_JMPF:           return Opcode::EQ;
+                case Opcode::NE_JMPF:           return Opcode::NE;
+                case Opcode::LT_I64_JMPF:       return Opcode::LT_I64;
+                case Opcode::LE_I64_JMPF:       return Opcode::LE_I64;
+                case Opcode::LOADI_LT_I64_JMPF:
+                case Opcode::LOADI_LE_I64_JMPF: return Opcode::LOADI;
+                case Opcode::ADDI_I64_JMP:      return Opcode::ADDI_I64;
+                case Opcode::ADD_I64_RET:       return Opcode::ADD_I64;
+                default:                        return op;
+            }
+        }
+
+        // 在堆上分配结果的指令，其操作数在分配时仍在使用
+        bool allocates(Opcode op) {
+            return op == Opcode::CONCAT || op == Opcode::NEWARR || (op >= Opcode::ADD_BIG && op <= Opcode::U64_TO_BIG);
+        }
+
+        // 可能进行垃圾回收的指令，只有它们可以有栈映射
+        bool isSafepoint(Opcode op) {
+            return allocates(op) || op == Opcode::CALL || op == Opcode::NATIVE || op == Opcode::SPAWN
+                   || op == Opcode::SPAWN_STR || op == Opcode::AWAIT;
+        }
+
+        bool isCall(Opcode op) {
+            return op == Opcode::CALL || op == Opcode::TAILCALL || op == Opcode::SPAWN || op == Opcode::SPAWN_STR;
+        }
+
+        class Verifier {
+        private:
+            const Image &_image;
+            const ImageHeader &_header;
+            std::vector<std::vector<Type>> _params;     // 按函数，参数的类型
+            std::vector<Type> _returns;                 // 按函数，返回值的类型
+            std::vector<bool> _reachable;               // 从入口函数可以调用到的函数
+            bool _changed;                              // 参数或返回值的类型在本轮推导中改变
+            bool _report;                               // 最后一轮推导报告类型错误
+
+            [[noreturn]] void _fail(dword index, dword pc, const std::string &msg) const;
+            void _structure(dword index);
+            void _calls();
+            void _types(dword index);
+            void _join_param(dword callee, word i, const Type &t);
+            void _join_return(dword index, const Type &t);
+        public:
+            explicit Verifier(const Image &image);
+
+            void run();
+        };  // class Verifier
+
+        Verifier::Verifier(const Image &image)
+            : _image(image), _header(image.header()), _params(), _returns(), _reachable(), _changed(false),
+              _report(false) {
+
+        }
+
+        void Verifier::_fail(dword index, dword pc, const std::string &msg) const {
+            throw InvalidImage(_image.name(), "function " + std::string(_image.stringView(_image.function(index).name))
+                                              + " at " + std::to_string(pc) + ": " + msg);
+        }
+
+        // 检查指令的编码，与寄存器中的值无关
+        void Verifier::_structure(dword index) {
+            const FunctionEntry &fn = _image.function(index);
+            const Instruction *code = _image.code() + fn.code;
+            unsigned rc = fn.register_count;
+            auto reg = [&](dword pc, unsigned r) {
+                if (r >= rc) {
+                    _fail(index, pc, "register " + std::to_string(r) + " out of range");
+                }
+            };
+            auto jump = [&](dword pc, Instruction ins) {
+                std::int64_t target = static_cast<std::int64_t>(pc) + 1 + argSBx(ins);
+                if (target < 0 || target >= fn.code_size) {
+                    _fail(index, pc, "jump target out of range");
+                }
+            };
+            // 融合的指令本身也可能是另一个超级指令的开始
+            auto fused = [&](dword pc, Opcode op) {
+                if (baseOf(opOf(code[pc])) != op) {
+                    _fail(index, pc, std::string("expected ") + getOpcodeName(op) + " in a superinstruction");
+                }
+                return code[pc];
+            };
+
+            for (dword pc = 0; pc < fn.code_size; ++pc) {
+                Instruction ins = code[pc];
+                Opcode op = opOf(ins);
+                if (op >= Opcode::COUNT) {
+                    _fail(index, pc, "invalid opcode " + std::to_string(static_cast<unsigned>(op)));
+                }
+                if (fn.code_size - pc < getOpLength(op)) {
+                    _fail(index, pc, "incomplete superinstruction");
+                }
+                // 超级指令的执行跳过其后的指令，它们必须是融合的指令
+                switch (op) {
+                    case Opcode::EQ_JMPF:
+                    case Opcode::NE_JMPF:
+                    case Opcode::LT_I64_JMPF:
+                    case Opcode::LE_I64_JMPF:
+                        if (argA(fused(pc + 1, Opcode::JMPF)) != argA(ins)) {
+                            _fail(index, pc, "bad superinstruction");
+                        }
+                        break;
+                    case Opcode::LOADI_LT_I64_JMPF:
+                    case Opcode::LOADI_LE_I64_JMPF: {
+                        Instruction cmp = fused(pc + 1, op == Opcode::LOADI_LT_I64_JMPF ? Opcode::LT_I64 : Opcode::LE_I64);
+                        if (argC(cmp) != argA(ins) || argA(fused(pc + 2, Opcode::JMPF)) != argA(cmp)) {
+                            _fail(index, pc, "bad superinstruction");
+                        }
+                        break;
+                    }
+                    case Opcode::ADDI_I64_JMP:
+                        fused(pc + 1, Opcode::JMP);
+                        break;
+                    case Opcode::ADD_I64_RET:
+                        if (argA(fused(pc + 1, Opcode::RET)) != argA(ins)) {
+                            _fail(index, pc, "bad superinstruction");
+                        }
+                        break;
+                    default:
+                        break;
+                }
+
+                Opcode base = baseOf(op);
+                switch (base) {
+                    case Opcode::NOP:
+                    case Opcode::RET0:
+                        break;
+                    case Opcode::LOADI:
+                    case Opcode::RET:
+                        reg(pc, argA(ins));
+                        break;
+                    case Opcode::LOADK:
+                    case Opcode::LOADS:
+                        reg(pc, argA(ins));
+                        if (argBx(ins) >= _header.constant_count) {
+                            _fail(index, pc, "constant " + std::to_string(argBx(ins)) + " out of range");
+                        }
+                        if (base == Opcode::LOADS && !_image.isString(_image.constants()[argBx(ins)])) {
+                            _fail(index, pc, "constant " + std::to_string(argBx(ins)) + " is not a string");
+                        }
+                        break;
+                    case Opcode::JMP:
+                        jump(pc, ins);
+                        break;
+                    case Opcode::JMPT:
+                    case Opcode::JMPF:
+                        reg(pc, argA(ins));
+                        jump(pc, ins);
+                        break;
+                    case Opcode::CALL:
+                    case Opcode::TAILCALL:
+                    case Opcode::SPAWN:
+                    case Opcode::SPAWN_STR: {
+                        if (argBx(ins) >= _header.function_count) {
+                            _fail(index, pc, "function " + std::to_string(argBx(ins)) + " out of range");
+                        }
+                        // 参数窗口在栈帧内。CALL和SPAWN的返回值写入R[A]
+                        unsigned window = _image.function(argBx(ins)).param_count;
+                        if (base != Opcode::TAILCALL && window == 0) {
+                            window = 1;
+                        }
+                        if (argA(ins) + window > rc) {
+                            _fail(index, pc, "arguments out of range");
+                        }
+                        break;
+                    }
+                    case Opcode::NATIVE: {
+                        if (argBx(ins) >= NATIVE_COUNT) {
+                            _fail(index, pc, "unknown native function " + std::to_string(argBx(ins)));
+                        }
+                        // 每个参数占用值和类型标记两个寄存器，返回值写入R[A]
+                        unsigned window = nativeInfo(static_cast<NativeId>(argBx(ins))).arity * 2;
+                        if (argA(ins) + (window == 0 ? 1 : window) > rc) {
+                            _fail(index, pc, "arguments out of range");
+                        }
+                        break;
+                    }
+                    case Opcode::TRUNC_I:
+                    case Opcode::TRUNC_U:
+                        reg(pc, argA(ins));
+                        reg(pc, argB(ins));
+                        if (argC(ins) == 0 || argC(ins) >= 64) {
+                            _fail(index, pc, "bad truncation width " + std::to_string(argC(ins)));
+                        }
+                        break;
+                    case Opcode::NEWARR:
+                        reg(pc, argA(ins));
+                        reg(pc, argB(ins));
+                        if (argC(ins) >= ELEMENT_COUNT) {
+                            _fail(index, pc, "bad element type " + std::to_string(argC(ins)));
+                        }
+                        break;
+                    case Opcode::MOVE:
+                    case Opcode::ADDI_I64:
+                    case Opcode::NEG_I64:
+                    case Opcode::BNOT:
+                    case Opcode::NEG_F64:
+                    case Opcode::F64_TO_F32:
+                    case Opcode::I64_TO_F64:
+                    case Opcode::U64_TO_F64:
+                    case Opcode::F64_TO_I64:
+                    case Opcode::F64_TO_U64:
+                    case Opcode::NOT:
+                    case Opcode::NEG_BIG:
+                    case Opcode::I64_TO_BIG:
+                    case Opcode::U64_TO_BIG:
+                    case Opcode::BIG_TO_I64:
+                    case Opcode::LEN:
+                    case Opcode::AWAIT:
+                        reg(pc, argA(ins));
+                        reg(pc, argB(ins));
+                        break;
+                    default:
+                        reg(pc, argA(ins));
+                        reg(pc, argB(ins));
+                        reg(pc, argC(ins));
+                        break;
+                }
+                // 除无条件跳转和返回外，执行完后继续执行下一条指令
+                if (base != Opcode::JMP && base != Opcode::RET && base != Opcode::RET0 && base != Opcode::TAILCALL
+                    && pc + 1 == fn.code_size) {
+                    _fail(index, pc, "control flows off the end of the function");
+                }
+            }
+
+            std::size_t words = stackMapWords(rc);
+            const qword *maps = reinterpret_cast<const qword *>(
+                reinterpret_cast<const byte *>(&_header) + _header.stack_maps_offset) + fn.stack_maps;
+            for (dword j = 0; j < fn.stack_map_count; ++j) {
+                dword pc = static_cast<dword>(maps[j * words]);
+                if (!isSafepoint(opOf(code[pc]))) {
+                    _fail(index, pc, "stack map at a non-safepoint instruction");
+                }
+            }
+        }
+
+        // 从入口函数开始标记可以调用到的函数，其他函数不会执行，不推导类型
+        void Verifier::_calls() {
+            _reachable.assign(_header.function_count, false);
+            std::vector<dword> work{_header.entry};
+            _reachable[_header.entry] = true;
+            while (!work.empty()) {
+                const FunctionEntry &fn = _image.function(work.back());
+                work.pop_back();
+                const Instruction *code = _image.code() + fn.code;
+                for (dword pc = 0; pc < fn.code_size; ++pc) {
+                    if (isCall(opOf(code[pc])) && !_reachable[argBx(code[pc])]) {
+                        _reachable[argBx(code[pc])] = true;
+                        work.push_back(argBx(code[pc]));
+                    }
+                }
+            }
+        }
+
+        void Verifier::_join_param(dword callee, word i, const Type &t) {
+            Type joined = join(_params[callee][i], t);
+            if (joined != _params[callee][i]) {
+                _params[callee][i] = joined;
+                _changed = true;
+            }
+        }
+
+        void Verifier::_join_return(dword index, const Type &t) {
+            Type joined = join(_returns[index], t);
+            if (joined != _returns[index]) {
+                _returns[index] = joined;
+                _changed = true;
+            }
+        }
+
+        // 在函数的控制流上推导每条指令之前各寄存器的类型。只在基本块的开始保存状态，块内顺序推导
+        void Verifier::_types(dword index) {
+            const FunctionEntry &fn = _image.function(index);
+            const Instruction *code = _image.code() + fn.code;
+            word rc = fn.register_count;
+            dword n = fn.code_size;
+
+            // 基本块的开始：函数入口和跳转目标
+            std::vector<bool> leader(n, false);
+            leader[0] = true;
+            for (dword pc = 0; pc < n; ++pc) {
+                Opcode op = opOf(code[pc]);
+                if (op == Opcode::JMP || op == Opcode::JMPT || op == Opcode::JMPF) {
+                    leader[pc + 1 + argSBx(code[pc])] = true;
+                }
+            }
+            std::vector<std::vector<Type>> in(n);
+            std::vector<dword> work;
+            std::vector<bool> queued(n, false);
+            auto merge = [&](dword pc, const std::vector<Type> &state) {
+                if (in[pc].empty()) {
+                    in[pc] = state;
+                } else {
+                    bool changed = false;
+                    for (word r = 0; r < rc; ++r) {
+                        Type joined = join(in[pc][r], state[r]);
+                        if (joined != in[pc][r]) {
+                            in[pc][r] = joined;
+                            changed = true;
+                        }
+                    }
+                    if (!changed) {
+                        return;
+                    }
+                }
+                if (!queued[pc]) {
+                    queued[pc] = true;
+                    work.push_back(pc);
+                }
+            };
+
+            std::vector<Type> entry(rc, Type::of(Kind::UNDEF));
+            for (word i = 0; i < fn.param_count; ++i) {
+                entry[i] = _params[index][i];
+            }
+            merge(0, entry);
+
+            std::vector<Type> R;
+            while (!work.empty()) {
+                dword pc = work.back();
+                work.pop_back();
+                queued[pc] = false;
+                R = in[pc];
+                for (;;) {
+                    Instruction ins = code[pc];
+                    Opcode op = baseOf(opOf(ins));
+                    unsigned a = argA(ins), b = argB(ins), c = argC(ins);
+                    auto fail = [&](const std::string &msg) {
+                        if (_report) {
+                            _fail(index, pc, msg);
+                        }
+                    };
+                    // 算术、比较和条件跳转的操作数。未写入的寄存器作为数值读取不影响安全
+                    auto needNumber = [&](unsigned r) {
+                        Kind k = R[r].kind;
+                        if (isReference(k) || k == Kind::ANY) {
+                            fail("register " + std::to_string(r) + " is not a number");
+                        }
+                    };
+                    auto needString = [&](unsigned r) {
+                        Kind k = R[r].kind;
+                        if (k != Kind::NONE && k != Kind::STRING) {
+                            fail("register " + std::to_string(r) + " is not a string");
+                        }
+                    };
+                    auto needBig = [&](unsigned r) {
+                        Kind k = R[r].kind;
+                        if (k != Kind::NONE && k != Kind::BIG) {
+                            fail("register " + std::to_string(r) + " is not a bigint");
+                        }
+                    };
+                    auto needArray = [&](unsigned r) {
+                        Kind k = R[r].kind;
+                        if (k != Kind::NONE && k != Kind::ARRAY) {
+                            fail("register " + std::to_string(r) + " is not an array");
+                        }
+                    };
+                    // 可能进行垃圾回收的指令之前，栈映射标记的寄存器都是引用；
+                    // 之后没有标记的字符串、大整数和数组可能已被回收，不能再作为引用使用
+                    auto safepoint = [&](unsigned limit) {
+                        const qword *map = _image.stackMap(fn, pc);
+                        for (word r = 0; r < rc; ++r) {
+                            bool marked = map != nullptr && (map[r / 64] >> (r % 64) & 1) != 0;
+                            if (marked) {
+                                if (r >= limit) {
+                                    fail("register " + std::to_string(r) + " in the stack map is overwritten by the call");
+                                }
+                                if (R[r].kind != Kind::NONE && !isReference(R[r].kind)) {
+                                    fail("register " + std::to_string(r) + " in the stack map is not a reference");
+                                }
+                            } else if (isReference(R[r].kind)) {
+                                if (allocates(op) && (r == b || r == c)) {
+                                    fail("operand " + std::to_string(r) + " of " + getOpcodeName(op)
+                                         + " is not in the stack map");
+                                }
+                                R[r] = Type::of(Kind::ANY);
+                            }
+                        }
+                    };
+                    // 调用之后参数窗口中的寄存器为被调用者的栈帧
+                    auto clobber = [&](unsigned from) {
+                        for (unsigned r = from; r < rc; ++r) {
+                            R[r] = Type::of(Kind::UNDEF);
+                        }
+                    };
+
+                    bool next = true;
+                    switch (op) {
+                        case Opcode::NOP:
+                            break;
+                        case Opcode::MOVE:
+                            R[a] = R[b];
+                            break;
+                        case Opcode::LOADI:
+                            R[a] = Type::constant(argSBx(ins));
+                            break;
+                        case Opcode::LOADK:
+                            R[a] = Type::constant(static_cast<std::int64_t>(_image.constants()[argBx(ins)]));
+                            break;
+                        case Opcode::LOADS:
+                            R[a] = Type::of(Kind::STRING);
+                            break;
+                        case Opcode::EQ:
+                        case Opcode::NE:
+                            // 按位比较，任何值都可以
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::EQ_STR:
+                        case Opcode::NE_STR:
+                        case Opcode::LT_STR:
+                        case Opcode::LE_STR:
+                            needString(b);
+                            needString(c);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::CONCAT:
+                            needString(b);
+                            needString(c);
+                            safepoint(rc);
+                            R[a] = Type::of(Kind::STRING);
+                            break;
+                        case Opcode::ADD_BIG:
+                        case Opcode::SUB_BIG:
+                        case Opcode::MUL_BIG:
+                        case Opcode::DIV_BIG:
+                        case Opcode::MOD_BIG:
+                            needBig(b);
+                            needBig(c);
+                            safepoint(rc);
+                            R[a] = Type::of(Kind::BIG);
+                            break;
+                        case Opcode::NEG_BIG:
+                            needBig(b);
+                            safepoint(rc);
+                            R[a] = Type::of(Kind::BIG);
+                            break;
+                        case Opcode::I64_TO_BIG:
+                        case Opcode::U64_TO_BIG:
+                            needNumber(b);
+                            safepoint(rc);
+                            R[a] = Type::of(Kind::BIG);
+                            break;
+                        case Opcode::BIG_TO_I64:
+                            needBig(b);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::NEWARR:
+                            needNumber(b);
+                            safepoint(rc);
+                            R[a] = Type::of(Kind::ARRAY);
+                            break;
+                        case Opcode::LEN:
+                            needArray(b);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::GETARR:
+                            needArray(b);
+                            needNumber(c);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::SETARR:
+                            needArray(a);
+                            needNumber(b);
+                            needNumber(c);
+                            break;
+                        case Opcode::EQ_BIG:
+                        case Opcode::NE_BIG:
+                        case Opcode::LT_BIG:
+                        case Opcode::LE_BIG:
+                            needBig(b);
+                            needBig(c);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::ADDI_I64:
+                        case Opcode::NEG_I64:
+                        case Opcode::BNOT:
+                        case Opcode::TRUNC_I:
+                        case Opcode::TRUNC_U:
+                        case Opcode::NEG_F64:
+                        case Opcode::F64_TO_F32:
+                        case Opcode::I64_TO_F64:
+                        case Opcode::U64_TO_F64:
+                        case Opcode::F64_TO_I64:
+                        case Opcode::F64_TO_U64:
+                        case Opcode::NOT:
+                            needNumber(b);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                        case Opcode::JMP:
+                            merge(pc + 1 + argSBx(ins), R);
+                            next = false;
+                            break;
+                        case Opcode::JMPT:
+                        case Opcode::JMPF:
+                            needNumber(a);
+                            merge(pc + 1 + argSBx(ins), R);
+                            break;
+                        case Opcode::CALL:
+                        case Opcode::TAILCALL:
+                        case Opcode::SPAWN:
+                        case Opcode::SPAWN_STR: {
+                            dword callee = argBx(ins);
+                            const FunctionEntry &target = _image.function(callee);
+                            for (word i = 0; i < target.param_count; ++i) {
+                                _join_param(callee, i, R[a + i]);
+                            }
+                            const Type &ret = _returns[callee];
+                            if (op == Opcode::TAILCALL) {
+                                _join_return(index, ret);
+                                next = false;
+                                break;
+                            }
+                            if (op == Opcode::SPAWN_STR && ret.kind != Kind::NONE && !isReference(ret.kind)) {
+                                fail("function " + std::to_string(callee) + " does not return a reference");
+                            }
+                            safepoint(a);
+                            clobber(a + 1);
+                            if (op == Opcode::CALL) {
+                                R[a] = ret;
+                            } else {
+                                R[a] = taskOf(ret, op == Opcode::SPAWN_STR);
+                            }
+                            break;
+                        }
+                        case Opcode::NATIVE: {
+                            const NativeInfo &info = nativeInfo(static_cast<NativeId>(argBx(ins)));
+                            for (unsigned i = 0; i < info.arity; ++i) {
+                                unsigned value = a + 2 * i;
+                                NativeType param = info.paramType(i);
+                                if (param == NATIVE_STRING) {
+                                    needString(value);
+                                } else if (param == NATIVE_INT || param == NATIVE_ELEMENT) {
+                                    needNumber(value);
+                                } else if (param == NATIVE_ARRAY) {
+                                    needArray(value);
+                                } else if (R[value].kind != Kind::NONE) {
+                                    // 按类型标记打印：字符串、大整数的标记必须是TAG_STRING、TAG_BIGINT，
+                                    // 其他值必须是数值，标记为已知的常量且不是引用的标记
+                                    Kind k = R[value].kind;
+                                    const Type &tag = R[value + 1];
+                                    bool valid = tag.kind == Kind::VALUE && tag.known;
+                                    if (k == Kind::STRING || k == Kind::BIG) {
+                                        valid = valid && tag.value == (k == Kind::STRING ? TAG_STRING : TAG_BIGINT);
+                                    } else {
+                                        needNumber(value);
+                                        valid = valid && tag.value != TAG_STRING && tag.value != TAG_BIGINT
+                                                && tag.value != TAG_ARRAY;
+                                    }
+                                    if (tag.kind != Kind::NONE && !valid) {
+                                        fail("register " + std::to_string(value + 1) + " is not a valid type tag");
+                                    }
+                                }
+                            }
+                            safepoint(rc);
+                            R[a] = Type::of(info.ret == NATIVE_STRING ? Kind::STRING
+                                            : info.ret == NATIVE_ARRAY ? Kind::ARRAY
+                                            : info.ret == NATIVE_VOID ? Kind::ANY : Kind::VALUE);
+                            break;
+                        }
+                        case Opcode::AWAIT: {
+                            // 纤程编号在执行时检查，不是纤程的值等待到的结果不作为引用使用
+                            Kind k = R[b].kind;
+                            if (isReference(k) || k == Kind::ANY) {
+                                fail("register " + std::to_string(b) + " is not a task");
+                            }
+                            Type result = awaited(R[b]);
+                            safepoint(rc);
+                            R[a] = result;
+                            break;
+                        }
+                        case Opcode::RET:
+                            _join_return(index, R[a]);
+                            next = false;
+                            break;
+                        case Opcode::RET0:
+                            _join_return(index, rc > 0 ? R[0] : Type::of(Kind::UNDEF));
+                            next = false;
+                            break;
+                        default:
+                            // 其余为两个操作数的算术与比较
+                            needNumber(b);
+                            needNumber(c);
+                            R[a] = Type::of(Kind::VALUE);
+                            break;
+                    }
+                    if (!next) {
+                        break;
+                    }
+                    ++pc;
+                    if (leader[pc]) {
+                        merge(pc, R);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // 先检查所有函数的编码，再反复推导类型直到参数和返回值的类型不再变化，最后一轮报告错误
+        void Verifier::run() {
+            for (dword i = 0; i < _header.function_count; ++i) {
+                _structure(i);
+            }
+            _calls();
+            _params.resize(_header.function_count);
+            _returns.assign(_header.function_count, Type::of(Kind::NONE));
+            for (dword i = 0; i < _header.function_count; ++i) {
+                _params[i].assign(_image.function(i).param_count, Type::of(Kind::NONE));
+            }
+            for (Type &param : _params[_header.entry]) {
+                param = Type::of(Kind::UNDEF);
+            }
+            do {
+                _changed = false;
+                for (dword i = 0; i < _header.function_count; ++i) {
+                    if (_reachable[i]) {
+                        _types(i);
+                    }
+                }
+            } while (_changed);
+            _report = true;
+            for (dword i = 0; i < _header.function_count; ++i) {
+                if (_reachable[i]) {
+                    _types(i);
+                }
+            }
+        }
+
+    }   // namespace
+
+    void verify(const Image &image) {
+        Verifier(image).run();
+    }
+
+}   // namespace Lett.
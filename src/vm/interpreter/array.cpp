@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "array.h"
+
+// 内核用GCC/Clang的向量扩展编写，向量的字节数Bytes是模板参数：通用版本为16字节（SSE2的xmm寄存器），
+// AVX2版本为32字节。比寄存器宽的向量由编译器逐个lane计算，所以不能统一使用32字节。
+// 各版本的内核是同一个always_inline模板在不同target属性的函数中的实例。sum、dot总是用4个64位的lane累加，
+// 通用版本把它们分在两个向量中，各lane累加的元素和顺序与AVX2版本相同，结果也相同
+#define LETT_KERNEL inline __attribute__((always_inline))
+
+namespace Lett {
+
+    namespace {
+        // N个T组成的向量
+        template <typename T, std::size_t N>
+        struct VectorOf { typedef T type __attribute__((vector_size(N * sizeof(T)))); };
+        template <typename T, std::size_t N>
+        using Lanes = typename VectorOf<T, N>::type;
+
+        // 逐元素运算的类型：整数使用同宽度的无符号数，按位宽回绕
+        template <typename T, bool Float = std::is_floating_point<T>::value>
+        struct ArithOf { typedef T type; };
+        template <typename T>
+        struct ArithOf<T, false> { typedef std::make_unsigned_t<T> type; };
+        template <typename T>
+        using Arith = typename ArithOf<T>::type;
+
+        // sum、dot累加的类型：整数为按64位回绕的uint64，浮点数为double
+        template <typename T>
+        using Wide = typename std::conditional<std::is_floating_point<T>::value, double, qword>::type;
+
+        template <typename T>
+        LETT_KERNEL Value wideValue(Wide<T> value) {
+            if constexpr (std::is_floating_point<T>::value) {
+                return Value::fromFloat(value);
+            } else {
+                return Value::fromUint(value);
+            }
+        }
+
+        // 元素按寄存器的形式返回
+        template <typename T>
+        LETT_KERNEL Value elementValue(T value) {
+            if constexpr (std::is_floating_point<T>::value) {
+                return Value::fromFloat(static_cast<double>(value));
+            } else if constexpr (std::is_signed<T>::value) {
+                return Value::fromInt(value);
+            } else {
+                return Value::fromUint(value);
+            }
+        }
+
+        // 寄存器中的标量转换为元素类型，类型检查保证它在元素类型的范围内
+        template <typename T>
+        LETT_KERNEL Arith<T> scalarOf(Value value) {
+            if constexpr (std::is_floating_point<T>::value) {
+                return static_cast<T>(value.asFloat());
+            } else {
+                return static_cast<Arith<T>>(value.bits());
+            }
+        }
+
+        // 合并4个累加的lane：(l0 + l1) + (l2 + l3)
+        template <typename W, std::size_t K>
+        LETT_KERNEL W reduce(const Lanes<W, K> *acc) {
+            W lane[4];
+            for (std::size_t j = 0; j < 4; ++j) {
+                lane[j] = acc[j / K][j % K];
+            }
+            return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+        }
+
+        // 每次把4个元素拓宽为4个64位的值累加，每个累加的向量有Bytes / 8个lane
+        template <typename T, std::size_t Bytes>
+        LETT_KERNEL Value sumOf(const void *data, std::size_t n) {
+            constexpr std::size_t K = Bytes / 8;
+            typedef Lanes<Wide<T>, K> Acc;
+            const T *a = static_cast<const T *>(data);
+            Acc acc[4 / K] = {};
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                for (std::size_t g = 0; g < 4 / K; ++g) {
+                    Lanes<T, K> x;
+                    __builtin_memcpy(&x, a + i + g * K, sizeof(x));
+                    acc[g] += __builtin_convertvector(x, Acc);
+                }
+            }
+            Wide<T> total = reduce<Wide<T>, K>(acc);
+            for (; i < n; ++i) {
+                total += static_cast<Wide<T>>(a[i]);
+            }
+            return wideValue<T>(total);
+        }
+
+        template <typename T, std::size_t Bytes>
+        LETT_KERNEL Value dotOf(const void *left, const void *right, std::size_t n) {
+            constexpr std::size_t K = Bytes / 8;
+            typedef Lanes<Wide<T>, K> Acc;
+            const T *a = static_cast<const T *>(left);
+            const T *b = static_cast<const T *>(right);
+            Acc acc[4 / K] = {};
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                for (std::size_t g = 0; g < 4 / K; ++g) {
+                    Lanes<T, K> x, y;
+                    __builtin_memcpy(&x, a + i + g * K, sizeof(x));
+                    __builtin_memcpy(&y, b + i + g * K, sizeof(y));
+                    acc[g] += __builtin_convertvector(x, Acc) * __builtin_convertvector(y, Acc);
+                }
+            }
+            Wide<T> total = reduce<Wide<T>, K>(acc);
+            for (; i < n; ++i) {
+                total += static_cast<Wide<T>>(a[i]) * static_cast<Wide<T>>(b[i]);
+            }
+            return wideValue<T>(total);
+        }
+
+        template <typename T, bool Max>
+        LETT_KERNEL T pick(T x, T m) {
+            if constexpr (Max) {
+                return x > m ? x : m;
+            } else {
+                return x < m ? x : m;
+            }
+        }
+
+        // 每个lane各自求最小（大）值，最后合并各lane。浮点数另外累加x - x：没有NaN和无穷大时为0，
+        // 否则为NaN，此时再逐个检查是否有NaN。不用x != x的掩码，SSE2没有64位整数的比较，通用版本会逐个lane计算
+        template <typename T, bool Max, std::size_t Bytes>
+        LETT_KERNEL Value extremeOf(const void *data, std::size_t n) {
+            constexpr std::size_t LANES = Bytes / sizeof(T);
+            typedef Lanes<T, LANES> Full;
+            constexpr bool FLOAT = std::is_floating_point<T>::value;
+            const T *a = static_cast<const T *>(data);
+            T m = a[0];
+            T special = 0;
+            std::size_t i = 0;
+            if (n >= LANES) {
+                Full acc, residue = {};
+                __builtin_memcpy(&acc, a, sizeof(acc));
+                for (i = LANES; i + LANES <= n; i += LANES) {
+                    Full x;
+                    __builtin_memcpy(&x, a + i, sizeof(x));
+                    if constexpr (Max) {
+                        acc = x > acc ? x : acc;
+                    } else {
+                        acc = x < acc ? x : acc;
+                    }
+                    if constexpr (FLOAT) {
+                        residue += x - x;
+                    }
+                }
+                m = acc[0];
+                for (std::size_t k = 0; k < LANES; ++k) {
+                    m = pick<T, Max>(acc[k], m);
+                    if constexpr (FLOAT) {
+                        special += residue[k] + (acc[k] - acc[k]);
+                    }
+                }
+            }
+            for (std::size_t k = i; k < n; ++k) {
+                m = pick<T, Max>(a[k], m);
+            }
+            if constexpr (FLOAT) {
+                for (std::size_t k = i; k < n; ++k) {
+                    special += a[k] - a[k];
+                }
+                if (special != 0 || special != special) {
+                    for (std::size_t k = 0; k < n; ++k) {
+                        if (a[k] != a[k]) {
+                            return Value::fromFloat(std::numeric_limits<double>::quiet_NaN());
+                        }
+                    }
+                }
+            }
+            return elementValue<T>(m);
+        }
+
+        // 标量的运算：窄的无符号整数先转换为qword，避免提升为int后溢出
+        template <typename T, bool Mul>
+        LETT_KERNEL Arith<T> apply(Arith<T> x, Arith<T> y) {
+            if constexpr (std::is_floating_point<T>::value) {
+                return Mul ? x * y : x + y;
+            } else {
+                qword a = x, b = y;
+                return static_cast<Arith<T>>(Mul ? a * b : a + b);
+            }
+        }
+
+        template <typename T, bool Mul, std::size_t Bytes>
+        LETT_KERNEL void zipOf(void *out, const void *left, const void *right, std::size_t n) {
+            typedef Arith<T> U;
+            constexpr std::size_t LANES = Bytes / sizeof(U);
+            typedef Lanes<U, LANES> Full;
+            const U *a = static_cast<const U *>(left);
+            const U *b = static_cast<const U *>(right);
+            U *r = static_cast<U *>(out);
+            std::size_t i = 0;
+            for (; i + LANES <= n; i += LANES) {
+                Full x, y, z;
+                __builtin_memcpy(&x, a + i, sizeof(x));
+                __builtin_memcpy(&y, b + i, sizeof(y));
+                if constexpr (Mul) {
+                    z = x * y;
+                } else {
+                    z = x + y;
+                }
+                __builtin_memcpy(r + i, &z, sizeof(z));
+            }
+            for (; i < n; ++i) {
+                r[i] = apply<T, Mul>(a[i], b[i]);
+            }
+        }
+
+        template <typename T, bool Mul, std::size_t Bytes>
+        LETT_KERNEL void mapOf(void *out, const void *data, Value scalar, std::size_t n) {
+            typedef Arith<T> U;
+            constexpr std::size_t LANES = Bytes / sizeof(U);
+            typedef Lanes<U, LANES> Full;
+            const U *a = static_cast<const U *>(data);
+            U *r = static_cast<U *>(out);
+            U s = scalarOf<T>(scalar);
+            Full splat = Full{} + s;
+            std::size_t i = 0;
+            for (; i + LANES <= n; i += LANES) {
+                Full x, z;
+                __builtin_memcpy(&x, a + i, sizeof(x));
+                if constexpr (Mul) {
+                    z = x * splat;
+                } else {
+                    z = x + splat;
+                }
+                __builtin_memcpy(r + i, &z, sizeof(z));
+            }
+            for (; i < n; ++i) {
+                r[i] = apply<T, Mul>(a[i], s);
+            }
+        }
+
+// 以attr（如target属性）和向量的字节数生成一组内核的实例，函数名以prefix开头
+#define LETT_KERNEL_VARIANT(prefix, attr, bytes)                                                            \
+        template <typename T> attr Value prefix##Sum(const void *a, std::size_t n) {                      \
+            return sumOf<T, bytes>(a, n);                                                                   \
+        }                                                                                                   \
+        template <typename T> attr Value prefix##Min(const void *a, std::size_t n) {                      \
+            return extremeOf<T, false, bytes>(a, n);                                                        \
+        }                                                                                                   \
+        template <typename T> attr Value prefix##Max(const void *a, std::size_t n) {                      \
+            return extremeOf<T, true, bytes>(a, n);                                                         \
+        }                                                                                                   \
+        template <typename T> attr Value prefix##Dot(const void *a, const void *b, std::size_t n) {       \
+            return dotOf<T, bytes>(a, b, n);                                                                \
+        }                                                                                                   \
+        template <typename T> attr void prefix##Add(void *out, const void *a, const void *b, std::size_t n) { \
+            zipOf<T, false, bytes>(out, a, b, n);                                                           \
+        }                                                                                                   \
+        template <typename T> attr void prefix##Mul(void *out, const void *a, const void *b, std::size_t n) { \
+            zipOf<T, true, bytes>(out, a, b, n);                                                            \
+        }                                                                                                   \
+        template <typename T> attr void prefix##Scale(void *out, const void *a, Value s, std::size_t n) { \
+            mapOf<T, true, bytes>(out, a, s, n);                                                            \
+        }                                                                                                   \
+        template <typename T> attr void prefix##Offset(void *out, const void *a, Value s, std::size_t n) { \
+            mapOf<T, false, bytes>(out, a, s, n);                                                           \
+        }
+
+// 按ElementType的顺序实例化
+#define LETT_PER_ELEMENT(f)                                                                                 \
+        {f<std::int8_t>, f<std::int16_t>, f<std::int32_t>, f<std::int64_t>,                                 \
+         f<std::uint8_t>, f<std::uint16_t>, f<std::uint32_t>, f<std::uint64_t>, f<float>, f<double>}
+
+#define LETT_KERNEL_TABLE(prefix, name)                                                                     \
+        ArrayKernels{name, LETT_PER_ELEMENT(prefix##Sum), LETT_PER_ELEMENT(prefix##Min),                    \
+                     LETT_PER_ELEMENT(prefix##Max), LETT_PER_ELEMENT(prefix##Dot),                          \
+                     LETT_PER_ELEMENT(prefix##Add), LETT_PER_ELEMENT(prefix##Mul),                          \
+                     LETT_PER_ELEMENT(prefix##Scale), LETT_PER_ELEMENT(prefix##Offset)}
+
+        LETT_KERNEL_VARIANT(generic, , 16)
+#if defined(__x86_64__)
+        LETT_KERNEL_VARIANT(avx2, __attribute__((target("avx2"))), 32)
+#endif
+
+        // 排序的键：按无符号数比较的顺序与元素的顺序相同
+        template <typename T, typename K>
+        K keyOf(K bits) {
+            constexpr K SIGN = static_cast<K>(K(1) << (8 * sizeof(K) - 1));
+            if constexpr (std::is_floating_point<T>::value) {
+                return (bits & SIGN) != 0 ? static_cast<K>(~bits) : static_cast<K>(bits ^ SIGN);
+            } else if constexpr (std::is_signed<T>::value) {
+                return static_cast<K>(bits ^ SIGN);
+            } else {
+                return bits;
+            }
+        }
+
+        template <typename T, typename K>
+        K bitsOf(K key) {
+            constexpr K SIGN = static_cast<K>(K(1) << (8 * sizeof(K) - 1));
+            if constexpr (std::is_floating_point<T>::value) {
+                return (key & SIGN) != 0 ? static_cast<K>(key ^ SIGN) : static_cast<K>(~key);
+            } else if constexpr (std::is_signed<T>::value) {
+                return static_cast<K>(key ^ SIGN);
+            } else {
+                return key;
+            }
+        }
+
+        // 每次按一个字节分配，所有键在该字节上相同时跳过这一趟
+        template <typename K>
+        void radixSort(K *keys, std::size_t n) {
+            std::vector<K> buffer(n);
+            K *from = keys, *to = buffer.data();
+            for (unsigned shift = 0; shift < 8 * sizeof(K); shift += 8) {
+                std::size_t count[256] = {};
+                for (std::size_t i = 0; i < n; ++i) {
+                    count[(from[i] >> shift) & 0xFF]++;
+                }
+                if (count[(from[0] >> shift) & 0xFF] == n) {
+                    continue;
+                }
+                std::size_t offset = 0;
+                for (std::size_t &c : count) {
+                    std::size_t size = c;
+                    c = offset;
+                    offset += size;
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    to[count[(from[i] >> shift) & 0xFF]++] = from[i];
+                }
+                std::swap(from, to);
+            }
+            if (from != keys) {
+                std::copy(from, from + n, keys);
+            }
+        }
+
+        template <typename T>
+        void sortAs(void *elements, std::size_t n) {
+            typedef std::conditional_t<sizeof(T) == 1, std::uint8_t,
+                    std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                    std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>> K;
+            byte *p = static_cast<byte *>(elements);
+            std::vector<K> keys(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                K bits;
+                std::memcpy(&bits, p + i * sizeof(K), sizeof(K));
+                keys[i] = keyOf<T, K>(bits);
+            }
+            radixSort(keys.data(), n);
+            for (std::size_t i = 0; i < n; ++i) {
+                K bits = bitsOf<T, K>(keys[i]);
+                std::memcpy(p + i * sizeof(K), &bits, sizeof(K));
+            }
+        }
+    }   // namespace
+
+    const ArrayKernels &genericKernels() {
+        static const ArrayKernels kernels = LETT_KERNEL_TABLE(generic, "generic");
+        return kernels;
+    }
+
+    const ArrayKernels *avx2Kernels() {
+#if defined(__x86_64__)
+        static const ArrayKernels kernels = LETT_KERNEL_TABLE(avx2, "avx2");
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? &kernels : nullptr;
+#else
+        return nullptr;
+#endif
+    }
+
+    const ArrayKernels &arrayKernels() {
+        static const ArrayKernels *selected = avx2Kernels() != nullptr ? avx2Kernels() : &genericKernels();
+        return *selected;
+    }
+
+    void sortElements(ElementType type, void *elements, std::size_t n) {
+        if (n < 2) {
+            return;
+        }
+        switch (type) {
+            case ELEMENT_INT8:      sortAs<std::int8_t>(elements, n); break;
+            case ELEMENT_INT16:     sortAs<std::int16_t>(elements, n); break;
+            case ELEMENT_INT32:     sortAs<std::int32_t>(elements, n); break;
+            case ELEMENT_INT64:     sortAs<std::int64_t>(elements, n); break;
+            case ELEMENT_UINT8:     sortAs<std::uint8_t>(elements, n); break;
+            case ELEMENT_UINT16:    sortAs<std::uint16_t>(elements, n); break;
+            case ELEMENT_UINT32:    sortAs<std::uint32_t>(elements, n); break;
+            case ELEMENT_UINT64:    sortAs<std::uint64_t>(elements, n); break;
+            case ELEMENT_FLOAT32:   sortAs<float>(elements, n); break;
+            default:                sortAs<double>(elements, n); break;
+        }
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,114 @@
+#ifndef __LETT_INTERPRETER_ARRAY_H__
+#define __LETT_INTERPRETER_ARRAY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "bytecode.h"
+#include "types.h"
+#include "value.h"
+
+namespace Lett {
+
+    // 堆上的数组：长度和元素类型之后紧跟连续存放、不装箱的元素，不引用其他对象。
+    // 创建后长度不再改变，元素按8字节对齐
+    struct ArrayData {
+        qword length;
+        dword type;             // ElementType
+        dword reserved;
+
+        void *elements() { return this + 1; }
+        const void *elements() const { return this + 1; }
+        ElementType elementType() const { return static_cast<ElementType>(type); }
+
+        static std::size_t elementSize(ElementType type) {
+            static const byte sizes[ELEMENT_COUNT] = {1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
+            return sizes[type];
+        }
+        // 包括对齐填充在内占用的字节数
+        static std::size_t sizeFor(ElementType type, qword length) {
+            return (sizeof(ArrayData) + length * elementSize(type) + 7) & ~static_cast<std::size_t>(7);
+        }
+        static ArrayData *of(Value value) {
+            return reinterpret_cast<ArrayData *>(static_cast<std::uintptr_t>(value.bits()));
+        }
+        Value value() const { return Value::fromBits(static_cast<qword>(reinterpret_cast<std::uintptr_t>(this))); }
+
+        // 元素与寄存器中的值之间的转换：整数符号扩展或零扩展到64位，float32按双精度保存；
+        // 写入时按元素类型截断。i小于length
+        Value load(qword i) const {
+            const byte *p = static_cast<const byte *>(elements());
+            switch (elementType()) {
+                case ELEMENT_INT8:      return Value::fromInt(read<std::int8_t>(p, i));
+                case ELEMENT_INT16:     return Value::fromInt(read<std::int16_t>(p, i));
+                case ELEMENT_INT32:     return Value::fromInt(read<std::int32_t>(p, i));
+                case ELEMENT_UINT8:     return Value::fromUint(read<std::uint8_t>(p, i));
+                case ELEMENT_UINT16:    return Value::fromUint(read<std::uint16_t>(p, i));
+                case ELEMENT_UINT32:    return Value::fromUint(read<std::uint32_t>(p, i));
+                case ELEMENT_FLOAT32:   return Value::fromFloat(read<float>(p, i));
+                default:                return Value::fromBits(read<qword>(p, i));
+            }
+        }
+        void store(qword i, Value value) {
+            byte *p = static_cast<byte *>(elements());
+            switch (elementType()) {
+                case ELEMENT_INT8:
+                case ELEMENT_UINT8:     write(p, i, static_cast<std::uint8_t>(value.bits())); break;
+                case ELEMENT_INT16:
+                case ELEMENT_UINT16:    write(p, i, static_cast<std::uint16_t>(value.bits())); break;
+                case ELEMENT_INT32:
+                case ELEMENT_UINT32:    write(p, i, static_cast<std::uint32_t>(value.bits())); break;
+                case ELEMENT_FLOAT32:   write(p, i, static_cast<float>(value.asFloat())); break;
+                default:                write(p, i, value.bits()); break;
+            }
+        }
+    private:
+        template <typename T>
+        static T read(const byte *p, qword i) {
+            T value;
+            std::memcpy(&value, p + i * sizeof(T), sizeof(T));
+            return value;
+        }
+        template <typename T>
+        static void write(byte *p, qword i, T value) {
+            std::memcpy(p + i * sizeof(T), &value, sizeof(T));
+        }
+    };
+    static_assert(sizeof(ArrayData) == 16, "unexpected ArrayData size");
+
+    // array模块的内核，以元素类型为下标，n为元素的个数：
+    //   - sum、dot的结果为拓宽的类型：整数在64位中按回绕累加，浮点数为double
+    //   - min、max的结果为元素的值（按寄存器的形式），n不为0。浮点数中有NaN时结果为NaN
+    //   - add、mul、scale、offset的结果写入out，整数按元素类型的位宽回绕，out可以与参数相同
+    // 每个内核都有通用版本和AVX2版本，由同一份使用GCC向量扩展的代码按不同的目标生成，
+    // 两者的结果（包括浮点数累加的顺序）完全相同
+    struct ArrayKernels {
+        typedef Value (*Reduce)(const void *a, std::size_t n);
+        typedef Value (*Dot)(const void *a, const void *b, std::size_t n);
+        typedef void (*Zip)(void *out, const void *a, const void *b, std::size_t n);
+        typedef void (*Map)(void *out, const void *a, Value scalar, std::size_t n);
+
+        const char *name;
+        Reduce sum[ELEMENT_COUNT];
+        Reduce min[ELEMENT_COUNT];
+        Reduce max[ELEMENT_COUNT];
+        Dot dot[ELEMENT_COUNT];
+        Zip add[ELEMENT_COUNT];
+        Zip mul[ELEMENT_COUNT];
+        Map scale[ELEMENT_COUNT];
+        Map offset[ELEMENT_COUNT];
+    };
+
+    // 执行时使用的内核：第一次调用时检测CPU，支持AVX2时为AVX2版本，否则为通用版本
+    const ArrayKernels &arrayKernels();
+    const ArrayKernels &genericKernels();
+    // 不是x86-64或CPU不支持AVX2时为nullptr
+    const ArrayKernels *avx2Kernels();
+
+    // 原地排序。整数按值排序，浮点数按IEEE 754的全序(totalOrder)排序：-NaN < -inf < ... < -0 < +0 < ... < +NaN。
+    // 按位的LSD基数排序，不需要比较，排序的结果与元素的原有顺序无关
+    void sortElements(ElementType type, void *elements, std::size_t n);
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_ARRAY_H__
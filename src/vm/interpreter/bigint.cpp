@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cstring>
+#include "bigint.h"
+
+namespace Lett {
+
+    namespace {
+        __extension__ typedef unsigned __int128 uint128;
+
+        // 以下为绝对值的运算，limb从低到高排列，长度可以包括最高处的0
+        int compareMagnitudes(const qword *a, std::size_t na, const qword *b, std::size_t nb) {
+            while (na > 0 && a[na - 1] == 0) {
+                --na;
+            }
+            while (nb > 0 && b[nb - 1] == 0) {
+                --nb;
+            }
+            if (na != nb) {
+                return na < nb ? -1 : 1;
+            }
+            for (std::size_t i = na; i-- > 0;) {
+                if (a[i] != b[i]) {
+                    return a[i] < b[i] ? -1 : 1;
+                }
+            }
+            return 0;
+        }
+
+        // dst[0, n) += src[0, m)，m <= n，进位只传递到dst[n - 1]
+        void addTo(qword *dst, std::size_t n, const qword *src, std::size_t m) {
+            qword carry = 0;
+            std::size_t i = 0;
+            for (; i < m; ++i) {
+                uint128 t = static_cast<uint128>(dst[i]) + src[i] + carry;
+                dst[i] = static_cast<qword>(t);
+                carry = static_cast<qword>(t >> 64);
+            }
+            for (; carry != 0 && i < n; ++i) {
+                carry = ++dst[i] == 0 ? 1 : 0;
+            }
+        }
+
+        // dst[0, n) -= src[0, m)，m <= n，dst不小于src
+        void subFrom(qword *dst, std::size_t n, const qword *src, std::size_t m) {
+            qword borrow = 0;
+            std::size_t i = 0;
+            for (; i < m; ++i) {
+                qword t = dst[i] - src[i];
+                qword b = dst[i] < src[i] ? 1 : 0;
+                dst[i] = t - borrow;
+                borrow = b + (t < borrow ? 1 : 0);
+            }
+            for (; borrow != 0 && i < n; ++i) {
+                borrow = dst[i]-- == 0 ? 1 : 0;
+            }
+        }
+
+        // out[0, na + nb) = a * b，out的初值为0
+        void schoolbook(const qword *a, std::size_t na, const qword *b, std::size_t nb, qword *out) {
+            for (std::size_t i = 0; i < nb; ++i) {
+                qword carry = 0;
+                for (std::size_t j = 0; j < na; ++j) {
+                    uint128 t = static_cast<uint128>(a[j]) * b[i] + out[i + j] + carry;
+                    out[i + j] = static_cast<qword>(t);
+                    carry = static_cast<qword>(t >> 64);
+                }
+                out[i + na] = carry;
+            }
+        }
+
+        void multiply(const qword *a, std::size_t na, const qword *b, std::size_t nb, qword *out);
+
+        // 长度都为n的两个数：a = a1·B^m + a0，b = b1·B^m + b0，
+        // a·b = z2·B^2m + z1·B^m + z0，z1 = (a0 + a1)(b0 + b1) - z0 - z2，三次乘法代替四次
+        void karatsuba(const qword *a, const qword *b, std::size_t n, qword *out) {
+            std::size_t m = n / 2, h = n - m;
+            multiply(a, m, b, m, out);
+            multiply(a + m, h, b + m, h, out + 2 * m);
+            std::vector<qword> sa(h + 1, 0), sb(h + 1, 0), z1(2 * h + 2, 0);
+            std::copy(a + m, a + n, sa.begin());
+            addTo(sa.data(), h + 1, a, m);
+            std::copy(b + m, b + n, sb.begin());
+            addTo(sb.data(), h + 1, b, m);
+            multiply(sa.data(), h + 1, sb.data(), h + 1, z1.data());
+            subFrom(z1.data(), z1.size(), out, 2 * m);
+            subFrom(z1.data(), z1.size(), out + 2 * m, 2 * h);
+            std::size_t length = z1.size();
+            while (length > 0 && z1[length - 1] == 0) {
+                --length;
+            }
+            addTo(out + m, 2 * n - m, z1.data(), length);
+        }
+
+        // out[0, na + nb) = a * b，out的初值为0。长度不同时把较长的操作数按较短的长度分段相乘
+        void multiply(const qword *a, std::size_t na, const qword *b, std::size_t nb, qword *out) {
+            if (na < nb) {
+                std::swap(a, b);
+                std::swap(na, nb);
+            }
+            if (nb < BigInt::KARATSUBA_THRESHOLD) {
+                schoolbook(a, na, b, nb, out);
+                return;
+            }
+            if (na == nb) {
+                karatsuba(a, b, na, out);
+                return;
+            }
+            std::vector<qword> part(2 * nb);
+            for (std::size_t i = 0; i < na; i += nb) {
+                std::size_t n = std::min(nb, na - i);
+                std::fill(part.begin(), part.end(), 0);
+                multiply(a + i, n, b, nb, part.data());
+                addTo(out + i, na + nb - i, part.data(), n + nb);
+            }
+        }
+
+        // 绝对值的除法（Knuth, TAOCP 4.3.1算法D）：q = a / b，r = a % b，b的最高limb不为0
+        void divide(const qword *a, std::size_t na, const qword *b, std::size_t nb,
+                    std::vector<qword> &q, std::vector<qword> &r) {
+            if (compareMagnitudes(a, na, b, nb) < 0) {
+                q.clear();
+                r.assign(a, a + na);
+                return;
+            }
+            q.assign(na - nb + 1, 0);
+            if (nb == 1) {
+                qword rem = 0;
+                for (std::size_t i = na; i-- > 0;) {
+                    uint128 t = static_cast<uint128>(rem) << 64 | a[i];
+                    q[i] = static_cast<qword>(t / b[0]);
+                    rem = static_cast<qword>(t % b[0]);
+                }
+                r.assign(1, rem);
+                return;
+            }
+            // 左移使除数的最高位为1，试商最多比真正的商大2
+            unsigned s = static_cast<unsigned>(__builtin_clzll(b[nb - 1]));
+            std::vector<qword> vn(nb), un(na + 1);
+            for (std::size_t i = nb; i-- > 0;) {
+                vn[i] = b[i] << s | (s != 0 && i > 0 ? b[i - 1] >> (64 - s) : 0);
+            }
+            un[na] = s != 0 ? a[na - 1] >> (64 - s) : 0;
+            for (std::size_t i = na; i-- > 0;) {
+                un[i] = a[i] << s | (s != 0 && i > 0 ? a[i - 1] >> (64 - s) : 0);
+            }
+            for (std::size_t j = na - nb + 1; j-- > 0;) {
+                uint128 num = static_cast<uint128>(un[j + nb]) << 64 | un[j + nb - 1];
+                uint128 qhat = num / vn[nb - 1];
+                uint128 rhat = num % vn[nb - 1];
+                while ((qhat >> 64) != 0 || qhat * vn[nb - 2] > (rhat << 64 | un[j + nb - 2])) {
+                    --qhat;
+                    rhat += vn[nb - 1];
+                    if ((rhat >> 64) != 0) {
+                        break;
+                    }
+                }
+                // un[j, j + nb] -= qhat * vn
+                qword carry = 0, borrow = 0;
+                for (std::size_t i = 0; i <= nb; ++i) {
+                    uint128 p = i < nb ? static_cast<uint128>(static_cast<qword>(qhat)) * vn[i] + carry : carry;
+                    carry = static_cast<qword>(p >> 64);
+                    qword lo = static_cast<qword>(p);
+                    qword t = un[i + j] - lo;
+                    qword b1 = un[i + j] < lo ? 1 : 0;
+                    un[i + j] = t - borrow;
+                    borrow = b1 + (t < borrow ? 1 : 0);
+                }
+                q[j] = static_cast<qword>(qhat);
+                if (borrow != 0) {
+                    // 试商大了1，加回一个除数
+                    --q[j];
+                    addTo(un.data() + j, nb + 1, vn.data(), nb);
+                }
+            }
+            r.assign(nb, 0);
+            for (std::size_t i = 0; i < nb; ++i) {
+                r[i] = un[i] >> s | (s != 0 ? un[i + 1] << (64 - s) : 0);
+            }
+        }
+    }   // namespace
+
+    BigInt::BigInt()
+        : _limbs(), _negative(false), _rest() {
+    }
+
+    BigInt::View BigInt::view(Value value, qword &storage) {
+        if (value.isSmall()) {
+            std::int64_t v = value.asSmall();
+            storage = v < 0 ? 0 - static_cast<qword>(v) : static_cast<qword>(v);
+            return View{&storage, storage != 0 ? 1u : 0u, v < 0};
+        }
+        const BigData *data = reinterpret_cast<const BigData *>(static_cast<std::uintptr_t>(value.bits()));
+        return View{data->limbs(), data->length, data->negative != 0};
+    }
+
+    void BigInt::_normalize() {
+        while (!_limbs.empty() && _limbs.back() == 0) {
+            _limbs.pop_back();
+        }
+        if (_limbs.empty()) {
+            _negative = false;
+        }
+    }
+
+    void BigInt::assign(qword magnitude, bool negative) {
+        _limbs.assign(1, magnitude);
+        _negative = negative;
+        _normalize();
+    }
+
+    // 同号时绝对值相加，异号时较大的绝对值减去较小的，符号与较大者相同
+    void BigInt::add(const View &a, const View &b) {
+        if (a.negative == b.negative) {
+            const View &x = a.length >= b.length ? a : b;
+            const View &y = a.length >= b.length ? b : a;
+            _limbs.assign(x.limbs, x.limbs + x.length);
+            _limbs.push_back(0);
+            addTo(_limbs.data(), _limbs.size(), y.limbs, y.length);
+            _negative = a.negative;
+        } else {
+            bool swap = compareMagnitudes(a.limbs, a.length, b.limbs, b.length) < 0;
+            const View &x = swap ? b : a;
+            const View &y = swap ? a : b;
+            _limbs.assign(x.limbs, x.limbs + x.length);
+            subFrom(_limbs.data(), _limbs.size(), y.limbs, y.length);
+            _negative = x.negative;
+        }
+        _normalize();
+    }
+
+    void BigInt::sub(const View &a, const View &b) {
+        add(a, View{b.limbs, b.length, !b.negative});
+    }
+
+    void BigInt::mul(const View &a, const View &b) {
+        _limbs.assign(a.length + b.length, 0);
+        multiply(a.limbs, a.length, b.limbs, b.length, _limbs.data());
+        _negative = a.negative != b.negative;
+        _normalize();
+    }
+
+    void BigInt::div(const View &a, const View &b) {
+        divide(a.limbs, a.length, b.limbs, b.length, _limbs, _rest);
+        _negative = a.negative != b.negative;
+        _normalize();
+    }
+
+    void BigInt::mod(const View &a, const View &b) {
+        divide(a.limbs, a.length, b.limbs, b.length, _rest, _limbs);
+        _negative = a.negative;
+        _normalize();
+    }
+
+    void BigInt::neg(const View &a) {
+        _limbs.assign(a.limbs, a.limbs + a.length);
+        _negative = !a.negative;
+        _normalize();
+    }
+
+    bool BigInt::small(std::int64_t &value) const {
+        if (_limbs.empty()) {
+            value = 0;
+            return true;
+        }
+        qword limit = _negative ? 0 - static_cast<qword>(Value::SMALL_MIN) : static_cast<qword>(Value::SMALL_MAX);
+        if (_limbs.size() > 1 || _limbs[0] > limit) {
+            return false;
+        }
+        value = _negative ? static_cast<std::int64_t>(0 - _limbs[0]) : static_cast<std::int64_t>(_limbs[0]);
+        return true;
+    }
+
+    int BigInt::compare(const View &a, const View &b) {
+        if (a.negative != b.negative) {
+            return a.negative ? -1 : 1;
+        }
+        int result = compareMagnitudes(a.limbs, a.length, b.limbs, b.length);
+        return a.negative ? -result : result;
+    }
+
+    qword BigInt::low(const View &a) {
+        if (a.length == 0) {
+            return 0;
+        }
+        return a.negative ? 0 - a.limbs[0] : a.limbs[0];
+    }
+
+    // 反复除以10^19，每次得到19位十进制数字
+    std::string BigInt::toString(const View &a) {
+        constexpr qword CHUNK = 10000000000000000000ULL;
+        std::vector<qword> n(a.limbs, a.limbs + a.length);
+        std::vector<qword> chunks;
+        while (!n.empty()) {
+            qword rem = 0;
+            for (std::size_t i = n.size(); i-- > 0;) {
+                uint128 t = static_cast<uint128>(rem) << 64 | n[i];
+                n[i] = static_cast<qword>(t / CHUNK);
+                rem = static_cast<qword>(t % CHUNK);
+            }
+            while (!n.empty() && n.back() == 0) {
+                n.pop_back();
+            }
+            chunks.push_back(rem);
+        }
+        if (chunks.empty()) {
+            return "0";
+        }
+        std::string result = a.negative ? "-" : "";
+        result += std::to_string(chunks.back());
+        for (std::size_t i = chunks.size() - 1; i-- > 0;) {
+            std::string digits = std::to_string(chunks[i]);
+            result.append(19 - digits.size(), '0');
+            result += digits;
+        }
+        return result;
+    }
+
+}   // namespace Lett.
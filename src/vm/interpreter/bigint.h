@@ -0,0 +1,74 @@
+#ifndef __LETT_INTERPRETER_BIGINT_H__
+#define __LETT_INTERPRETER_BIGINT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "value.h"
+
+namespace Lett {
+
+    // 堆上的大整数：绝对值按64位的limb从低到高排列，最高的limb不为0，不引用其他对象。
+    // 只有超出小整数范围（见Value::fromSmall）的值才在堆上分配，每个值只有一种表示
+    struct BigData {
+        dword length;           // limb的个数
+        dword negative;
+
+        const qword *limbs() const { return reinterpret_cast<const qword *>(this + 1); }
+        qword *limbs() { return reinterpret_cast<qword *>(this + 1); }
+        static std::size_t sizeFor(std::size_t length) { return sizeof(BigData) + length * sizeof(qword); }
+    };
+
+    // 有符号大整数的运算：操作数为View，结果保存在BigInt中，由调用者复制到堆上。
+    // 运算本身不分配堆上的对象，不会触发垃圾回收；结果的存储在多次运算之间复用。
+    // 乘法在两个操作数都不短于KARATSUBA_THRESHOLD个limb时使用Karatsuba算法，除法为Knuth的算法D
+    class BigInt {
+    public:
+        // 操作数：绝对值的limb与符号，零没有limb
+        struct View {
+            const qword *limbs;
+            std::size_t length;
+            bool negative;
+        };
+
+        static constexpr std::size_t KARATSUBA_THRESHOLD = 32;
+
+        BigInt();
+
+        // 寄存器中的大整数，小整数的绝对值保存在storage中
+        static View view(Value value, qword &storage);
+        View view() const { return View{_limbs.data(), _limbs.size(), _negative}; }
+
+        // 操作数不能引用结果自身的存储
+        void assign(qword magnitude, bool negative);
+        void add(const View &a, const View &b);
+        void sub(const View &a, const View &b);
+        void mul(const View &a, const View &b);
+        // b不为0。商向零取整，余数与被除数同号
+        void div(const View &a, const View &b);
+        void mod(const View &a, const View &b);
+        void neg(const View &a);
+
+        // 结果在小整数的范围内时写入value
+        bool small(std::int64_t &value) const;
+        std::size_t length() const { return _limbs.size(); }
+        bool negative() const { return _negative; }
+        const qword *limbs() const { return _limbs.data(); }
+
+        static int compare(const View &a, const View &b);
+        // 补码表示的低64位
+        static qword low(const View &a);
+        static std::string toString(const View &a);
+    private:
+        std::vector<qword> _limbs;
+        bool _negative;
+        std::vector<qword> _rest;       // 除法中不需要的商或余数
+
+        void _normalize();
+    };  // class BigInt
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_BIGINT_H__
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "heap.h"
+
+namespace Lett {
+
+    namespace {
+        std::size_t alignUp(std::size_t size) {
+            return (size + 7) & ~static_cast<std::size_t>(7);
+        }
+
+        // 奇数的值是大整数的小整数形式，不是对象，返回空
+        void *objectOf(Value value) {
+            return value.isSmall() ? nullptr : reinterpret_cast<void *>(static_cast<std::uintptr_t>(value.bits()));
+        }
+    }   // namespace
+
+    Heap::Heap(std::size_t nursery_size, const void *static_area, std::size_t static_size)
+        : _nursery(new byte[alignUp(nursery_size)]), _nursery_size(alignUp(nursery_size)),
+          _static_area(static_cast<const byte *>(static_area)), _static_size(static_size), _top(0), _old(), _old_size(0), _major_threshold(MIN_MAJOR_THRESHOLD), _remembered(), _stats() {
+    }
+
+    Heap::~Heap() {
+        for (ObjectHeader *object : _old) {
+            std::free(object);
+        }
+    }
+
+    void *Heap::allocate(std::size_t size, word refs) {
+        // 被移动的对象在前8字节中保存新的地址
+        size = alignUp(std::max<std::size_t>(size, sizeof(void *)));
+        std::size_t total = sizeof(ObjectHeader) + size;
+        // 直接在老年代分配的对象不经过minor GC，老年代超过阈值后先回收，否则只分配大对象的程序从不回收。
+        // major GC之后老年代小于阈值，回收之后的分配总能成功
+        if (_old_size >= _major_threshold) {
+            return nullptr;
+        }
+        if (total > _nursery_size / 4) {
+            return allocateOld(size, refs);
+        }
+        if (total > _nursery_size - _top) {
+            return nullptr;
+        }
+        ObjectHeader *header = reinterpret_cast<ObjectHeader *>(_nursery.get() + _top);
+        header->size = static_cast<dword>(size);
+        header->flags = 0;
+        header->refs = refs;
+        _top += total;
+        _stats.allocated += size;
+        return header + 1;
+    }
+
+    void *Heap::allocateOld(std::size_t size, word refs) {
+        size = alignUp(std::max<std::size_t>(size, sizeof(void *)));
+        _stats.allocated += size;
+        return _allocate_old(size, refs);
+    }
+
+    void *Heap::_allocate_old(std::size_t size, word refs) {
+        ObjectHeader *header = static_cast<ObjectHeader *>(std::malloc(sizeof(ObjectHeader) + size));
+        if (header == nullptr) {
+            throw std::bad_alloc();
+        }
+        header->size = static_cast<dword>(size);
+        header->flags = 0;
+        header->refs = refs;
+        _old.push_back(header);
+        _old_size += size;
+        return header + 1;
+    }
+
+    void Heap::writeBarrier(const void *object, Value *field) {
+        if (!isYoung(object) && isYoung(objectOf(*field))) {
+            _remembered.push_back(field);
+        }
+    }
+
+    // 把slot引用的新生代对象复制到老年代，改写slot
+    void Heap::_evacuate(Value *slot) {
+        void *object = objectOf(*slot);
+        if (!isYoung(object)) {
+            return;
+        }
+        ObjectHeader *header = _header(object);
+        void *moved;
+        if (header->flags & FORWARDED) {
+            std::memcpy(&moved, object, sizeof(moved));
+        } else {
+            moved = _allocate_old(header->size, header->refs);
+            std::memcpy(moved, object, header->size);
+            std::memcpy(object, &moved, sizeof(moved));
+            header->flags |= FORWARDED;
+            _stats.promoted += header->size;
+        }
+        *slot = Value::fromBits(static_cast<qword>(reinterpret_cast<std::uintptr_t>(moved)));
+    }
+
+    void Heap::collect(const std::vector<Value *> &roots) {
+        auto start = std::chrono::steady_clock::now();
+        _minor(roots);
+        if (_old_size >= _major_threshold) {
+            _major(roots);
+        }
+        qword pause = static_cast<qword>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        _stats.total_pause += pause;
+        _stats.max_pause = std::max(_stats.max_pause, pause);
+    }
+
+    // 复制根和记忆集引用的对象，再依次扫描复制到老年代的对象的字段（Cheney算法），之后新生代整块重新使用
+    void Heap::_minor(const std::vector<Value *> &roots) {
+        std::size_t scan = _old.size();
+        for (Value *root : roots) {
+            _evacuate(root);
+        }
+        for (Value *field : _remembered) {
+            _evacuate(field);
+        }
+        _remembered.clear();
+        for (; scan < _old.size(); ++scan) {
+            Value *fields = _fields(_old[scan]);
+            for (word i = 0; i < _old[scan]->refs; ++i) {
+                _evacuate(&fields[i]);
+            }
+        }
+        _top = 0;
+        _stats.minor_collections++;
+    }
+
+    // 此时所有的对象都在老年代。从根开始标记可以到达的对象，释放未标记的对象
+    void Heap::_major(const std::vector<Value *> &roots) {
+        std::vector<ObjectHeader *> pending;
+        auto mark = [&](Value value) {
+            void *object = objectOf(value);
+            if (_managed(object) && (_header(object)->flags & MARKED) == 0) {
+                _header(object)->flags |= MARKED;
+                pending.push_back(_header(object));
+            }
+        };
+        for (Value *root : roots) {
+            mark(*root);
+        }
+        while (!pending.empty()) {
+            ObjectHeader *object = pending.back();
+            pending.pop_back();
+            Value *fields = _fields(object);
+            for (word i = 0; i < object->refs; ++i) {
+                mark(fields[i]);
+            }
+        }
+        for (ObjectHeader *&object : _old) {
+            if (object->flags & MARKED) {
+                object->flags &= ~MARKED;
+                continue;
+            }
+            _old_size -= object->size;
+            _stats.freed += object->size;
+            std::free(object);
+            object = nullptr;
+        }
+        _old.erase(std::remove(_old.begin(), _old.end(), nullptr), _old.end());
+        _major_threshold = std::max(MIN_MAJOR_THRESHOLD, 2 * _old_size);
+        _stats.major_collections++;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,101 @@
+#ifndef __LETT_INTERPRETER_HEAP_H__
+#define __LETT_INTERPRETER_HEAP_H__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "types.h"
+#include "value.h"
+
+namespace Lett {
+
+    // 分代垃圾回收的堆
+    //   - 新生代：一块连续的内存，按指针碰撞(bump pointer)分配。空满时进行minor GC，
+    //     把根引用的对象复制到老年代后整块重新使用，只存活很短时间的对象不需要任何回收的代价
+    //   - 老年代：每个对象单独分配，老年代的大小超过阈值时在minor GC之后进行major GC，
+    //     标记根引用的对象后清除其余的对象。直接在老年代分配的大对象也计入阈值
+    // 每个对象之前是8字节的对象头，值中保存对象头之后的地址（如StringData）。对象的最后若干个字是引用其他对象的字段，
+    // 个数在分配时给出，回收时沿这些字段找到所有存活的对象。
+    // 根由调用者根据编译器生成的栈映射给出，回收时会改写根中被移动的对象的地址。
+    // 根和字段也可以引用静态区（字节码文件中的字符串常量）、为0或为奇数（大整数的小整数形式），回收时忽略它们
+    class Heap {
+    public:
+        // 回收的统计
+        struct Stats {
+            qword allocated;            // 分配的字节数
+            qword promoted;             // minor GC复制到老年代的字节数
+            qword freed;                // major GC释放的字节数
+            qword minor_collections;
+            qword major_collections;
+            qword total_pause;          // 所有回收的暂停时间之和(ns)
+            qword max_pause;            // 最长的一次暂停(ns)
+        };
+
+        static constexpr std::size_t NURSERY_SIZE = 1 << 20;
+        static constexpr std::size_t MIN_MAJOR_THRESHOLD = 8 << 20;     // 老年代至少达到该大小才进行major GC
+
+        explicit Heap(std::size_t nursery_size = NURSERY_SIZE, const void *static_area = nullptr,
+                      std::size_t static_size = 0);
+        ~Heap();
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+
+        // 分配size字节的对象，返回对象头之后的地址，对象的最后refs个字是引用。
+        // 新生代已满或老年代超过major GC的阈值时返回nullptr，调用者应先collect再分配；
+        // 超过新生代四分之一的大对象直接在老年代分配
+        void *allocate(std::size_t size, word refs = 0);
+        // 在老年代分配，不会失败。用于不能进行回收的位置，分配的字节同样计入阈值，下一次allocate时回收
+        void *allocateOld(std::size_t size, word refs = 0);
+        // roots中的每个值都是堆中的对象
+        void collect(const std::vector<Value *> &roots);
+        // 写屏障：向已分配的对象的字段中写入值之后调用。老年代的对象引用新生代的对象时记录该字段，
+        // minor GC把记录的字段当作根
+        void writeBarrier(const void *object, Value *field);
+
+        bool isYoung(const void *object) const {
+            const byte *p = static_cast<const byte *>(object);
+            return p >= _nursery.get() && p < _nursery.get() + _nursery_size;
+        }
+        std::size_t oldSize() const { return _old_size; }
+        // 对象中引用的个数
+        static word references(const void *object) { return _header(object)->refs; }
+        const Stats &stats() const { return _stats; }
+    private:
+        struct ObjectHeader {
+            dword size;                 // 对象的字节数，不包括对象头
+            word flags;
+            word refs;                  // 对象末尾的引用的个数
+        };
+        static constexpr word MARKED = 1;
+        static constexpr word FORWARDED = 2;   // 已复制到老年代，对象的前8字节为新的地址
+
+        std::unique_ptr<byte[]> _nursery;
+        std::size_t _nursery_size;
+        const byte *_static_area;
+        std::size_t _static_size;
+        std::size_t _top;               // 新生代中下一个对象的位置
+        std::vector<ObjectHeader *> _old;
+        std::size_t _old_size;          // 老年代中对象的字节数
+        std::size_t _major_threshold;
+        std::vector<Value *> _remembered;   // 老年代对象中引用新生代对象的字段
+        Stats _stats;
+
+        static ObjectHeader *_header(const void *object) {
+            return reinterpret_cast<ObjectHeader *>(const_cast<void *>(object)) - 1;
+        }
+        static Value *_fields(ObjectHeader *header) {
+            return reinterpret_cast<Value *>(reinterpret_cast<byte *>(header + 1) + header->size) - header->refs;
+        }
+        bool _managed(const void *object) const {
+            const byte *p = static_cast<const byte *>(object);
+            return p != nullptr && (p < _static_area || p >= _static_area + _static_size);
+        }
+        void *_allocate_old(std::size_t size, word refs);
+        void _evacuate(Value *slot);
+        void _minor(const std::vector<Value *> &roots);
+        void _major(const std::vector<Value *> &roots);
+    };  // class Heap
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_HEAP_H__
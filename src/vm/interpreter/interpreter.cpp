@@ -0,0 +1,1297 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "exception.h"
+#include "natives.h"
+#include "value.h"
+#include "interpreter.h"
+
+// 指令分派：定义LETT_COMPUTED_GOTO时使用GCC/Clang的标签地址（labels as values），
+// 每条指令的处理代码末尾直接跳转到下一条指令的处理代码；否则使用可移植的switch
+#if defined(LETT_COMPUTED_GOTO)
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define VM_CASE(name)   L_##name:
+#define VM_INVALID      L_INVALID:
+#define VM_NEXT()       do { ins = *pc++; VM_COUNT(); goto *dispatch[static_cast<byte>(opOf(ins))]; } while (0)
+#define VM_FALLTHROUGH  static_cast<void>(0)
+#else
+#define VM_CASE(name)   case Opcode::name:
+#define VM_INVALID      default:
+#define VM_NEXT()       continue
+#define VM_FALLTHROUGH  [[fallthrough]]
+#endif
+
+// 校验过的字节码（见verifier.h）中操作码、内置函数编号和截断的位数都有效。定义LETT_TRUST_VERIFIED时
+// 不再检查它们，编译器可以省去switch的范围检查；除以零、栈溢出和纤程编号仍然检查
+#if defined(LETT_TRUST_VERIFIED)
+#define VM_VERIFIED(cond)   do { if (!(cond)) __builtin_unreachable(); } while (0)
+#else
+#define VM_VERIFIED(cond)   static_cast<void>(0)
+#endif
+
+// 操作数寄存器
+#define RA  R[argA(ins)]
+#define RB  R[argB(ins)]
+#define RC  R[argC(ins)]
+
+// 分层执行：函数的调用与回边次数达到JIT_THRESHOLD时编译为机器码，之后在调用、回边和返回时从当前指令进入机器码，
+// 机器码遇到不支持的指令时返回该指令，由解释器继续执行。统计指令对时只解释执行
+#define VM_TIER_UP(index)                                                                       \
+    if constexpr (!Profile) {                                                                   \
+        Tier &tier = _tiers[index];                                                             \
+        if (tier.code != nullptr || (++tier.counter == JIT_THRESHOLD && _compile(index))) {     \
+            pc = _jit.execute(*tier.code, R, pc);                                               \
+        }                                                                                       \
+    }
+#define VM_BACKEDGE()   VM_TIER_UP(static_cast<dword>(fp->function - functions))
+#define VM_RESUME()                                                                             \
+    if constexpr (!Profile) {                                                                   \
+        const JitFunction *jit = _tiers[static_cast<std::size_t>(fp->function - functions)].code; \
+        if (jit != nullptr) {                                                                   \
+            pc = _jit.execute(*jit, R, pc);                                                     \
+        }                                                                                       \
+    }
+
+// 切换纤程：保存当前纤程的执行位置，载入_current纤程的栈和执行位置
+#define VM_SAVE()   do { fiber->fp = fp; fiber->pc = pc; } while (0)
+#define VM_LOAD()                                                   \
+    do {                                                            \
+        fiber = _fibers[_current].get();                            \
+        frames = fiber->frames.get();                               \
+        frames_end = frames + fiber->frame_count;                   \
+        stack_end = fiber->stack.get() + fiber->stack_size;         \
+        fp = fiber->fp;                                             \
+        pc = fiber->pc;                                             \
+        R = fp->base;                                               \
+    } while (0)
+// 当前纤程已挂起或结束，切换到下一个可以执行的纤程，并交给它等待的结果
+#define VM_SWITCH()                                                 \
+    do {                                                            \
+        _current = _next();                                         \
+        VM_LOAD();                                                  \
+        _deliver(*fiber);                                           \
+    } while (0)
+
+// 统计相邻两条指令的执行次数，定时器信号到达后记录调用栈，只在Profile为true的实例中生成代码
+#define VM_COUNT()                                                  \
+    if constexpr (Profile) {                                        \
+        byte op = static_cast<byte>(opOf(ins));                     \
+        pairs[static_cast<std::size_t>(last) * 256 + op]++;         \
+        last = op;                                                  \
+        if (profiler != nullptr && Profiler::pending()) {           \
+            _sample(*profiler, fp, pc);                             \
+        }                                                           \
+    }
+
+namespace Lett {
+
+    namespace {
+        // rope：拼接得到的长字符串只记录左右两部分，需要字符时才展开。
+        // 展开后right为0，left为展开得到的字符串，之后直接使用
+        struct RopeData {
+            StringData header;          // 长度有效，哈希值在展开后才计算
+            Value left;
+            Value right;
+        };
+
+        // 按字节比较
+        int compareStrings(const StringData *a, const StringData *b) {
+            int result = std::memcmp(a->chars(), b->chars(), std::min(a->length, b->length));
+            if (result != 0) {
+                return result;
+            }
+            return a->length < b->length ? -1 : a->length > b->length ? 1 : 0;
+        }
+
+        // 浮点数转换为整数时向零取整，超出范围时取最接近的值，NaN为0
+        std::int64_t floatToInt(double value) {
+            if (value != value) {
+                return 0;
+            }
+            if (value >= 9223372036854775808.0) {
+                return std::numeric_limits<std::int64_t>::max();
+            }
+            if (value < -9223372036854775808.0) {
+                return std::numeric_limits<std::int64_t>::min();
+            }
+            return static_cast<std::int64_t>(value);
+        }
+
+        qword floatToUint(double value) {
+            if (value != value || value <= -1.0) {
+                return 0;
+            }
+            if (value >= 18446744073709551616.0) {
+                return std::numeric_limits<qword>::max();
+            }
+            return static_cast<qword>(value);
+        }
+
+        // 移位的位数不小于64时，结果为全部移出后的值
+        inline qword shiftLeft(qword value, qword count) {
+            return count < 64 ? value << count : 0;
+        }
+
+        inline qword shiftRight(qword value, qword count) {
+            return count < 64 ? value >> count : 0;
+        }
+
+        inline qword shiftRightArith(qword value, qword count) {
+            std::int64_t v = static_cast<std::int64_t>(value);
+            return static_cast<qword>(count < 64 ? v >> count : (v < 0 ? -1 : 0));
+        }
+
+        inline qword truncSigned(qword value, unsigned bits) {
+            VM_VERIFIED(bits > 0 && bits < 64);
+            if (bits == 0 || bits >= 64) {
+                return value;
+            }
+            unsigned shift = 64 - bits;
+            return static_cast<qword>(static_cast<std::int64_t>(value << shift) >> shift);
+        }
+
+        inline qword truncUnsigned(qword value, unsigned bits) {
+            VM_VERIFIED(bits > 0 && bits < 64);
+            return bits == 0 || bits >= 64 ? value : value & ((1ULL << bits) - 1);
+        }
+
+        // 小整数与堆上的大整数不会相等，两个小整数按位比较
+        bool equalBig(Value a, Value b) {
+            if (a == b) {
+                return true;
+            }
+            if (a.isSmall() || b.isSmall()) {
+                return false;
+            }
+            qword sa, sb;
+            return BigInt::compare(BigInt::view(a, sa), BigInt::view(b, sb)) == 0;
+        }
+
+        // 小整数的表示保持大小顺序，两个小整数直接比较
+        int compareBig(Value a, Value b) {
+            if (a.isSmall() && b.isSmall()) {
+                return a.asInt() < b.asInt() ? -1 : a.asInt() > b.asInt() ? 1 : 0;
+            }
+            qword sa, sb;
+            return BigInt::compare(BigInt::view(a, sa), BigInt::view(b, sb));
+        }
+
+        void printValue(Output &out, Value value, Value tag) {
+            switch (tag.asUint()) {
+                case TAG_BOOL:
+                    if (value.asBool()) {
+                        out.write("true", 4);
+                    } else {
+                        out.write("false", 5);
+                    }
+                    break;
+                case TAG_CHAR:
+                    out.put(static_cast<char>(value.asUint()));
+                    break;
+                case TAG_INT:
+                    out.writeInt(value.asInt());
+                    break;
+                case TAG_FLOAT32:
+                    out.writeFloat(static_cast<float>(value.asFloat()));
+                    break;
+                case TAG_FLOAT64:
+                    out.writeFloat(value.asFloat());
+                    break;
+                case TAG_STRING: {
+                    const StringData *s = value.asString();
+                    out.write(s->chars(), s->length);
+                    break;
+                }
+                case TAG_BIGINT: {
+                    if (value.isSmall()) {
+                        out.writeInt(value.asSmall());
+                        break;
+                    }
+                    qword storage;
+                    std::string digits = BigInt::toString(BigInt::view(value, storage));
+                    out.write(digits.data(), digits.size());
+                    break;
+                }
+                default:
+                    out.writeUint(value.asUint());
+                    break;
+            }
+        }
+    }   // namespace
+
+    Interpreter::Fiber::Fiber(std::size_t stack_size, std::size_t frame_count)
+        : stack(new Value[stack_size]), frames(new Frame[frame_count]), stack_size(stack_size),
+          frame_count(frame_count), fp(nullptr), pc(nullptr), state(FiberState::RUNNING), generation(0), task(0),
+          ref_result(false), result(), waiters(), data(), error() {
+    }
+
+    Interpreter::Interpreter(const Image &image, std::ostream &out, const InterpreterOptions &options)
+        : Interpreter(image, Output(out), options) {
+    }
+
+    Interpreter::Interpreter(const Image &image, int fd, const InterpreterOptions &options)
+        : Interpreter(image, Output(fd), options) {
+    }
+
+    Interpreter::Interpreter(const Image &image, Output &&out, const InterpreterOptions &options)
+        : _image(image), _out(std::move(out)), _fibers(), _free(), _sweep_at(SWEEP_MIN), _ready(), _current(0), _scheduler(), _completions(),
+          _heap(options.nursery_size, &image.header(), image.size()), _pending(), _bigint(), _sampled(), _jit(image), _jit_enabled(options.jit && JitCompiler::supported()),
+          _tiers(image.functionCount(), Tier{0, nullptr}) {
+        _fibers.emplace_back(new Fiber(STACK_SIZE, MAX_FRAMES));
+    }
+
+    bool Interpreter::_compile(dword function) {
+        if (_jit_enabled) {
+            _tiers[function].code = _jit.compile(_image.function(function));
+        }
+        return _tiers[function].code != nullptr;
+    }
+
+    // 新生代已满或老年代超过阈值时先回收再分配。fp和pc为当前纤程的执行位置
+    void *Interpreter::_allocate(std::size_t size, word refs, const Frame *fp, const Instruction *pc) {
+        void *storage = _heap.allocate(size, refs);
+        if (storage == nullptr) {
+            std::vector<Value *> roots;
+            _roots(fp, pc, roots);
+            _heap.collect(roots);
+            storage = _heap.allocate(size, refs);
+        }
+        return storage;
+    }
+
+    // 运行时产生的短字符串与字符串表中的字符串布局相同，不短于ROPE_MIN的结果为rope，
+    // 在循环中反复追加时每次只分配一个固定大小的节点，不复制已有的字符。
+    // 新生代已满时先回收，回收可能移动a和b引用的字符串，因此在分配之后才读取它们
+    const StringData *Interpreter::_concat(const Value *a, const Value *b, const Frame *fp, const Instruction *pc) {
+        if (a->asString()->length == 0) {
+            return b->asString();
+        }
+        if (b->asString()->length == 0) {
+            return a->asString();
+        }
+        std::size_t length = static_cast<std::size_t>(a->asString()->length) + b->asString()->length;
+        if (length > std::numeric_limits<dword>::max()) {
+            throw RuntimeError("string is too long");
+        }
+        bool rope = length >= ROPE_MIN;
+        std::size_t size = rope ? sizeof(RopeData) : StringData::sizeFor(length);
+        void *storage = _allocate(size, rope ? 2 : 0, fp, pc);
+        if (rope) {
+            RopeData *node = static_cast<RopeData *>(storage);
+            node->header.length = static_cast<dword>(length);
+            node->header.hash = 0;
+            node->left = *a;
+            node->right = *b;
+            return &node->header;
+        }
+        const StringData *left = a->asString();
+        const StringData *right = b->asString();
+        StringData *s = static_cast<StringData *>(storage);
+        char *chars = reinterpret_cast<char *>(s + 1);
+        std::memcpy(chars, left->chars(), left->length);
+        std::memcpy(chars + left->length, right->chars(), right->length);
+        chars[length] = '\0';
+        s->length = static_cast<dword>(length);
+        s->hash = StringData::hashOf(chars, length);
+        return s;
+    }
+
+    // 内置函数读到的数据复制为运行时的字符串
+    const StringData *Interpreter::_string(std::string_view chars, const Frame *fp, const Instruction *pc) {
+        if (chars.size() > std::numeric_limits<dword>::max()) {
+            throw RuntimeError("string is too long");
+        }
+        StringData *s = static_cast<StringData *>(_allocate(StringData::sizeFor(chars.size()), 0, fp, pc));
+        char *data = reinterpret_cast<char *>(s + 1);
+        std::memcpy(data, chars.data(), chars.size());
+        data[chars.size()] = '\0';
+        s->length = static_cast<dword>(chars.size());
+        s->hash = StringData::hashOf(data, chars.size());
+        return s;
+    }
+
+    bool Interpreter::_rope(const StringData *s) const {
+        return !_image.contains(s) && Heap::references(s) != 0;
+    }
+
+    // 返回rope展开后的字符串。展开时不能回收（调用者的寄存器没有栈映射），不能在新生代分配时在老年代分配，
+    // 计入major GC的阈值，由之后的_allocate回收。
+    // 循环中追加得到的rope向左倾斜，从右向左写入字符，待展开的节点不会积累
+    const StringData *Interpreter::_flatten(const StringData *s) {
+        if (!_rope(s)) {
+            return s;
+        }
+        RopeData *rope = reinterpret_cast<RopeData *>(const_cast<StringData *>(s));
+        if (rope->right.bits() == 0) {
+            return rope->left.asString();
+        }
+        std::size_t length = s->length;
+        void *storage = _heap.allocate(StringData::sizeFor(length));
+        if (storage == nullptr) {
+            storage = _heap.allocateOld(StringData::sizeFor(length));
+        }
+        StringData *flat = static_cast<StringData *>(storage);
+        char *chars = reinterpret_cast<char *>(flat + 1);
+        chars[length] = '\0';
+        std::size_t end = length;
+        _pending.push_back(s);
+        while (!_pending.empty()) {
+            const StringData *part = _pending.back();
+            _pending.pop_back();
+            if (_rope(part)) {
+                const RopeData *node = reinterpret_cast<const RopeData *>(part);
+                if (node->right.bits() != 0) {
+                    _pending.push_back(node->left.asString());
+                    _pending.push_back(node->right.asString());
+                    continue;
+                }
+                part = node->left.asString();
+            }
+            end -= part->length;
+            std::memcpy(chars + end, part->chars(), part->length);
+        }
+        flat->length = static_cast<dword>(length);
+        flat->hash = StringData::hashOf(chars, length);
+        rope->left = Value::fromString(flat);
+        rope->right = Value::fromBits(0);
+        _heap.writeBarrier(rope, &rope->left);
+        return flat;
+    }
+
+    // 字符串表中的字符串互不相同，两个字符串常量只需比较地址
+    bool Interpreter::_equal(const StringData *a, const StringData *b) {
+        if (a == b) {
+            return true;
+        }
+        if (a->length != b->length || (_image.contains(a) && _image.contains(b))) {
+            return false;
+        }
+        a = _flatten(a);
+        b = _flatten(b);
+        return a->hash == b->hash && std::memcmp(a->chars(), b->chars(), a->length) == 0;
+    }
+
+    // 所有纤程中保存字符串、大整数和数组的寄存器，已完成的纤程返回的引用，以及_protected中的值，其中的字符串常量和小整数由Heap忽略。
+    // fp和pc为当前纤程的执行位置，其他纤程停在SPAWN、AWAIT或内置函数调用处，都有栈映射
+    void Interpreter::_roots(const Frame *fp, const Instruction *pc, std::vector<Value *> &roots) {
+        roots.insert(roots.end(), _protected.begin(), _protected.end());
+        for (std::size_t i = 0; i < _fibers.size(); ++i) {
+            Fiber &fiber = *_fibers[i];
+            if (fiber.state == FiberState::DONE) {
+                if (fiber.ref_result) {
+                    roots.push_back(&fiber.result);
+                }
+            } else if (i == _current) {
+                _frame_roots(fiber.frames.get(), fp, pc, roots);
+            } else {
+                _frame_roots(fiber.frames.get(), fiber.fp, fiber.pc, roots);
+            }
+        }
+    }
+
+    // 一个纤程的所有栈帧中保存字符串的寄存器。pc为最上层栈帧下一条要执行的指令，
+    // 其他栈帧停在调用指令处，即上一层栈帧的返回地址的前一条指令
+    void Interpreter::_frame_roots(const Frame *frames, const Frame *fp, const Instruction *pc,
+                                   std::vector<Value *> &roots) {
+        const Instruction *code = _image.code();
+        for (const Frame *frame = fp; frame >= frames; --frame) {
+            const Instruction *at = (frame == fp ? pc : frame[1].ret) - 1;
+            const FunctionEntry &fn = *frame->function;
+            const qword *map = _image.stackMap(fn, static_cast<dword>(at - code) - fn.code);
+            if (map == nullptr) {
+                continue;
+            }
+            for (word reg = 0; reg < fn.register_count; ++reg) {
+                if ((map[reg / 64] >> (reg % 64) & 1) != 0) {
+                    roots.push_back(&frame->base[reg]);
+                }
+            }
+        }
+    }
+
+    // 内置函数的参数为(值, 类型标记)对，返回值写入args[0]。
+    // 返回true表示发起了需要等待的I/O操作，当前纤程挂起，完成后由_deliver写入返回值
+    bool Interpreter::_native(dword id, Value *args, const Frame *fp, const Instruction *pc) {
+        if (id >= NATIVE_ARRAY_LENGTH) {
+            _array(id, args, fp, pc);
+            return false;
+        }
+        if (id == NATIVE_SYS_FLUSH) {
+            _out.flush();
+            return false;
+        }
+        Value value = args[1].asUint() == TAG_STRING ? Value::fromString(_flatten(args[0].asString())) : args[0];
+        auto text = [this](Value v) {
+            const StringData *s = _flatten(v.asString());
+            return std::string(s->chars(), s->length);
+        };
+        switch (id) {
+            case NATIVE_SYS_PRINT:
+                printValue(_out, value, args[1]);
+                return false;
+            case NATIVE_SYS_PRINTLN:
+                printValue(_out, value, args[1]);
+                _out.put('\n');
+                return false;
+            case NATIVE_SYS_SLEEP:
+                _scheduler.sleep(_current, value.asInt());
+                return true;
+            case NATIVE_SYS_READ: {
+                std::string data;
+                if (!_scheduler.read(_current, text(value), data)) {
+                    return true;
+                }
+                args[0] = Value::fromString(_string(data, fp, pc));
+                return false;
+            }
+            case NATIVE_SYS_WRITE:
+                return !_scheduler.write(_current, text(value), text(args[2]));
+            default:
+                VM_VERIFIED(false);
+                throw RuntimeError("unknown native function " + std::to_string(id));
+        }
+    }
+
+    // 数组的元素在分配后由调用者写入，zero为true时清零。新生代的内存不会清零
+    ArrayData *Interpreter::_new_array(ElementType type, std::int64_t length, bool zero,
+                                       const Frame *fp, const Instruction *pc) {
+        if (length < 0) {
+            throw RuntimeError("negative array length " + std::to_string(length));
+        }
+        qword n = static_cast<qword>(length);
+        if (n > (std::numeric_limits<dword>::max() - sizeof(ArrayData)) / ArrayData::elementSize(type)) {
+            throw RuntimeError("array is too large");
+        }
+        std::size_t size = ArrayData::sizeFor(type, n);
+        ArrayData *array = static_cast<ArrayData *>(_allocate(size, 0, fp, pc));
+        array->length = n;
+        array->type = type;
+        array->reserved = 0;
+        if (zero) {
+            std::memset(array->elements(), 0, size - sizeof(ArrayData));
+        }
+        return array;
+    }
+
+    // array模块的内置函数，参数的类型标记不使用，由数组的元素类型选择内核。
+    // 参数不在栈映射中，分配结果之前把数组参数加入_protected，回收后重新读取
+    void Interpreter::_array(dword id, Value *args, const Frame *fp, const Instruction *pc) {
+        const ArrayKernels &kernels = arrayKernels();
+        ArrayData *a = ArrayData::of(args[0]);
+        ElementType type = a->elementType();
+        std::size_t n = static_cast<std::size_t>(a->length);
+        switch (id) {
+            case NATIVE_ARRAY_LENGTH:
+                args[0] = Value::fromUint(a->length);
+                return;
+            case NATIVE_ARRAY_SUM:
+                args[0] = kernels.sum[type](a->elements(), n);
+                return;
+            case NATIVE_ARRAY_MIN:
+            case NATIVE_ARRAY_MAX:
+                if (n == 0) {
+                    throw RuntimeError(std::string(id == NATIVE_ARRAY_MIN ? "min" : "max") + " of an empty array");
+                }
+                args[0] = (id == NATIVE_ARRAY_MIN ? kernels.min : kernels.max)[type](a->elements(), n);
+                return;
+            case NATIVE_ARRAY_SORT:
+                sortElements(type, a->elements(), n);
+                return;
+            default:
+                break;
+        }
+        bool zip = id == NATIVE_ARRAY_DOT || id == NATIVE_ARRAY_ADD || id == NATIVE_ARRAY_MUL;
+        if (zip) {
+            const ArrayData *b = ArrayData::of(args[2]);
+            if (b->elementType() != type) {
+                throw RuntimeError("array element types differ");
+            }
+            if (b->length != a->length) {
+                throw RuntimeError("array lengths differ: " + std::to_string(a->length) + " and " +
+                                   std::to_string(b->length));
+            }
+            if (id == NATIVE_ARRAY_DOT) {
+                args[0] = kernels.dot[type](a->elements(), b->elements(), n);
+                return;
+            }
+        }
+        _protected.push_back(&args[0]);
+        if (zip) {
+            _protected.push_back(&args[2]);
+        }
+        ArrayData *result = _new_array(type, static_cast<std::int64_t>(n), false, fp, pc);
+        _protected.resize(_protected.size() - (zip ? 2 : 1));
+        const void *x = ArrayData::of(args[0])->elements();
+        switch (id) {
+            case NATIVE_ARRAY_ADD:
+                kernels.add[type](result->elements(), x, ArrayData::of(args[2])->elements(), n);
+                break;
+            case NATIVE_ARRAY_MUL:
+                kernels.mul[type](result->elements(), x, ArrayData::of(args[2])->elements(), n);
+                break;
+            case NATIVE_ARRAY_SCALE:
+                kernels.scale[type](result->elements(), x, args[2], n);
+                break;
+            case NATIVE_ARRAY_OFFSET:
+                kernels.offset[type](result->elements(), x, args[2], n);
+                break;
+            default:
+                VM_VERIFIED(false);
+                throw RuntimeError("unknown native function " + std::to_string(id));
+        }
+        args[0] = result->value();
+    }
+
+    // 纤程的栈不足时加倍，超过主纤程的大小时栈溢出。寄存器栈移动后改写所有栈帧中的地址
+    void Interpreter::_grow(Fiber &fiber, std::size_t registers, std::size_t frames) {
+        if (registers > STACK_SIZE || frames > MAX_FRAMES) {
+            throw RuntimeError("stack overflow");
+        }
+        std::size_t depth = static_cast<std::size_t>(fiber.fp - fiber.frames.get());
+        if (frames > fiber.frame_count) {
+            std::size_t count = std::min(std::max(fiber.frame_count * 2, frames), MAX_FRAMES);
+            std::unique_ptr<Frame[]> grown(new Frame[count]);
+            std::copy(fiber.frames.get(), fiber.frames.get() + depth + 1, grown.get());
+            fiber.frames = std::move(grown);
+            fiber.frame_count = count;
+            fiber.fp = fiber.frames.get() + depth;
+        }
+        if (registers > fiber.stack_size) {
+            std::size_t size = std::min(std::max(fiber.stack_size * 2, registers), STACK_SIZE);
+            std::unique_ptr<Value[]> grown(new Value[size]);
+            std::copy(fiber.stack.get(), fiber.stack.get() + fiber.stack_size, grown.get());
+            for (Frame *frame = fiber.frames.get(); frame <= fiber.fp; ++frame) {
+                frame->base = grown.get() + (frame->base - fiber.stack.get());
+            }
+            fiber.stack = std::move(grown);
+            fiber.stack_size = size;
+        }
+    }
+
+    // 创建执行fn的纤程，参数复制到其栈的开头，返回其位置。优先复用已完成纤程的位置，没有可复用的位置且纤程数达到
+    // _sweep_at时先回收。当前纤程放在等待执行的队列的最前面，新纤程执行到挂起后即继续执行
+    dword Interpreter::_spawn(const FunctionEntry &fn, const Value *args, bool ref_result) {
+        if (_free.empty() && _fibers.size() >= _sweep_at) {
+            _sweep();
+        }
+        dword index;
+        dword generation = 1;
+        if (!_free.empty()) {
+            index = _free.back();
+            _free.pop_back();
+            generation = _fibers[index]->generation + 1;
+        } else {
+            if (_fibers.size() > std::numeric_limits<dword>::max()) {
+                throw RuntimeError("too many fibers");
+            }
+            index = static_cast<dword>(_fibers.size());
+            _fibers.emplace_back();
+        }
+        std::unique_ptr<Fiber> fiber(new Fiber(std::max<std::size_t>(FIBER_STACK_SIZE, fn.register_count), FIBER_FRAMES));
+        std::copy(args, args + fn.param_count, fiber->stack.get());
+        fiber->fp = fiber->frames.get();
+        *fiber->fp = Frame{&fn, nullptr, fiber->stack.get()};
+        fiber->pc = _image.code() + fn.code;
+        fiber->generation = generation;
+        fiber->ref_result = ref_result;
+        _fibers[index] = std::move(fiber);
+        _ready.push_front(_current);
+        return index;
+    }
+
+    // 纤程的句柄只会保存在未完成纤程的寄存器和已完成纤程的返回值中（数组的元素都是数值）。
+    // 保守地把其中等于某个纤程的句柄的值都看作对它的引用，没有被引用的已完成纤程不会再被等待，其位置可以复用。
+    // 句柄的高32位是位置被复用的次数，整数碰巧等于句柄时只会推迟复用
+    void Interpreter::_sweep() {
+        std::vector<bool> referenced(_fibers.size(), false);
+        auto mark = [this, &referenced](Value value) {
+            qword bits = value.asUint();
+            dword index = static_cast<dword>(bits);
+            if (index < _fibers.size() && _handle(index) == bits) {
+                referenced[index] = true;
+            }
+        };
+        for (const std::unique_ptr<Fiber> &fiber : _fibers) {
+            if (fiber->state == FiberState::DONE) {
+                mark(fiber->result);
+                continue;
+            }
+            if (fiber->state == FiberState::AWAITING) {
+                referenced[fiber->task] = true;
+            }
+            const Value *end = fiber->fp->base + fiber->fp->function->register_count;
+            for (const Value *value = fiber->stack.get(); value < end; ++value) {
+                mark(*value);
+            }
+        }
+        for (dword i = 1; i < _fibers.size(); ++i) {
+            Fiber &fiber = *_fibers[i];
+            if (fiber.state == FiberState::DONE && !referenced[i]) {
+                fiber.ref_result = false;
+                fiber.result = Value();
+                _free.push_back(i);
+            }
+        }
+        // 复用的位置用完之前不再回收，之后纤程数加倍时才再次回收，回收的代价均摊到每次SPAWN上
+        _sweep_at = std::max(SWEEP_MIN, 2 * (_fibers.size() - _free.size()));
+    }
+
+    // 当前纤程返回，唤醒等待它的纤程并释放其栈
+    void Interpreter::_finish(Value result) {
+        Fiber &fiber = *_fibers[_current];
+        fiber.state = FiberState::DONE;
+        fiber.result = result;
+        for (dword waiter : fiber.waiters) {
+            _ready.push_back(waiter);
+        }
+        fiber.waiters.clear();
+        fiber.waiters.shrink_to_fit();
+        fiber.stack.reset();
+        fiber.frames.reset();
+        fiber.fp = nullptr;
+    }
+
+    // 下一个执行的纤程：先收集已完成的I/O操作，没有可以执行的纤程时等待I/O
+    dword Interpreter::_next() {
+        for (;;) {
+            if (_scheduler.pending() != 0) {
+                _completions.clear();
+                _scheduler.poll(_ready.empty(), _completions);
+                for (Scheduler::Completion &completion : _completions) {
+                    Fiber &fiber = *_fibers[completion.fiber];
+                    fiber.data = std::move(completion.data);
+                    fiber.error = std::move(completion.error);
+                    _ready.push_back(completion.fiber);
+                }
+            }
+            if (!_ready.empty()) {
+                dword next = _ready.front();
+                _ready.pop_front();
+                return next;
+            }
+            if (_scheduler.pending() == 0) {
+                throw RuntimeError("deadlock: all fibers are waiting");
+            }
+        }
+    }
+
+    // 恢复执行前写入纤程等待的结果：AWAIT等待的纤程的返回值，或I/O操作读到的数据。
+    // 纤程停在AWAIT或NATIVE之后，结果写入该指令的R[A]
+    void Interpreter::_deliver(Fiber &fiber) {
+        FiberState state = fiber.state;
+        fiber.state = FiberState::RUNNING;
+        if (state == FiberState::AWAITING) {
+            fiber.fp->base[argA(fiber.pc[-1])] = _fibers[fiber.task]->result;
+        } else if (state == FiberState::BLOCKED) {
+            if (!fiber.error.empty()) {
+                std::string error = std::move(fiber.error);
+                fiber.error.clear();
+                throw RuntimeError(error);
+            }
+            dword id = argBx(fiber.pc[-1]);
+            if (id == NATIVE_SYS_READ) {
+                const StringData *s = _string(fiber.data, fiber.fp, fiber.pc);
+                fiber.fp->base[argA(fiber.pc[-1])] = Value::fromString(s);
+            }
+            std::string().swap(fiber.data);
+        }
+    }
+
+    // 大整数运算的慢速路径：有操作数在堆上，或小整数的运算溢出。
+    // 先算出结果再分配，分配时的回收可能移动a和b引用的对象，但之后不再读取它们
+    Value Interpreter::_big(Opcode op, Value a, Value b, const Frame *fp, const Instruction *pc) {
+        qword sa, sb;
+        BigInt::View x = BigInt::view(a, sa);
+        BigInt::View y = BigInt::view(b, sb);
+        switch (op) {
+            case Opcode::ADD_BIG:
+                _bigint.add(x, y);
+                break;
+            case Opcode::SUB_BIG:
+                _bigint.sub(x, y);
+                break;
+            case Opcode::MUL_BIG:
+                _bigint.mul(x, y);
+                break;
+            case Opcode::DIV_BIG:
+            case Opcode::MOD_BIG:
+                if (y.length == 0) {
+                    throw RuntimeError("integer division by zero");
+                }
+                if (op == Opcode::DIV_BIG) {
+                    _bigint.div(x, y);
+                } else {
+                    _bigint.mod(x, y);
+                }
+                break;
+            default:
+                _bigint.neg(x);
+                break;
+        }
+        return _box(fp, pc);
+    }
+
+    // _bigint中的结果：在小整数的范围内时不分配
+    Value Interpreter::_box(const Frame *fp, const Instruction *pc) {
+        std::int64_t value;
+        if (_bigint.small(value)) {
+            return Value::fromSmall(value);
+        }
+        if (_bigint.length() > std::numeric_limits<dword>::max()) {
+            throw RuntimeError("integer is too large");
+        }
+        BigData *data = static_cast<BigData *>(_allocate(BigData::sizeFor(_bigint.length()), 0, fp, pc));
+        data->length = static_cast<dword>(_bigint.length());
+        data->negative = _bigint.negative() ? 1 : 0;
+        std::copy(_bigint.limbs(), _bigint.limbs() + _bigint.length(), data->limbs());
+        return Value::fromBits(static_cast<qword>(reinterpret_cast<std::uintptr_t>(data)));
+    }
+
+    // 与_roots相同，当前栈帧正在执行pc的前一条指令，其他栈帧停在调用指令处
+    void Interpreter::_sample(Profiler &profiler, const Frame *fp, const Instruction *pc) {
+        const Instruction *code = _image.code();
+        const FunctionEntry *functions = &_image.function(0);
+        _sampled.clear();
+        for (const Frame *frame = _fibers[_current]->frames.get(); frame <= fp; ++frame) {
+            const Instruction *at = (frame == fp ? pc : frame[1].ret) - 1;
+            qword function = static_cast<qword>(frame->function - functions);
+            _sampled.push_back(function << 32 | static_cast<dword>(at - code - frame->function->code));
+        }
+        profiler.record(_sampled);
+    }
+
+    // 出错时先写出已缓冲的输出，再由调用者报告错误
+    void Interpreter::run() {
+        try {
+            _execute<false>(nullptr, nullptr);
+        } catch (const LettException &) {
+            _out.flush();
+            throw;
+        }
+        _out.flush();
+    }
+
+    void Interpreter::profile(std::vector<qword> &pairs, Profiler *profiler) {
+        pairs.assign(256 * 256, 0);
+        try {
+            _execute<true>(pairs.data(), profiler);
+        } catch (const LettException &) {
+            _out.flush();
+            throw;
+        }
+        _out.flush();
+    }
+
+    template <bool Profile>
+    void Interpreter::_execute([[maybe_unused]] qword *pairs, [[maybe_unused]] Profiler *profiler) {
+        const FunctionEntry &entry = _image.entry();
+        const Instruction *code = _image.code();
+        const qword *K = _image.constants();
+        [[maybe_unused]] const FunctionEntry *const functions = &_image.function(0);
+        // 上次执行留下的纤程和I/O操作
+        _fibers.resize(1);
+        _free.clear();
+        _sweep_at = SWEEP_MIN;
+        _ready.clear();
+        _scheduler.cancel();
+        _current = 0;
+        _protected.clear();
+        // 一个纤程的所有栈帧在其寄存器栈中连续存放，主纤程的栈预先分配，调用时不分配内存
+        Fiber *fiber = _fibers[0].get();
+        fiber->state = FiberState::RUNNING;
+        fiber->fp = fiber->frames.get();
+        *fiber->fp = Frame{&entry, nullptr, fiber->stack.get()};
+        fiber->pc = code + entry.code;
+        Frame *frames, *frames_end, *fp;
+        Value *stack_end, *R;
+        const Instruction *pc;
+        VM_LOAD();
+        Instruction ins;
+        [[maybe_unused]] byte last = static_cast<byte>(Opcode::NOP);
+
+#if defined(LETT_COMPUTED_GOTO)
+        // 以操作码为下标的跳转表，未定义的操作码跳到INVALID
+        const void *dispatch[256];
+        for (const void *&target : dispatch) {
+            target = &&L_INVALID;
+        }
+#define OPCODE(name, format) dispatch[static_cast<byte>(Opcode::name)] = &&L_##name;
+        LETT_OPCODES
+#undef OPCODE
+        VM_NEXT();
+        {
+#else
+        for (;;) {
+            ins = *pc++;
+            VM_COUNT();
+            switch (opOf(ins)) {
+#endif
+                VM_CASE(NOP)
+                    VM_NEXT();
+                VM_CASE(MOVE)
+                    RA = RB;
+                    VM_NEXT();
+                VM_CASE(LOADI)
+                    RA = Value::fromInt(argSBx(ins));
+                    VM_NEXT();
+                VM_CASE(LOADK)
+                    RA = Value::fromBits(K[argBx(ins)]);
+                    VM_NEXT();
+                VM_CASE(LOADS)
+                    RA = Value::fromString(_image.string(static_cast<dword>(K[argBx(ins)])));
+                    VM_NEXT();
+
+                // 整数运算按64位回绕
+                VM_CASE(ADD_I64)
+                    RA = Value::fromUint(RB.asUint() + RC.asUint());
+                    VM_NEXT();
+                VM_CASE(SUB_I64)
+                    RA = Value::fromUint(RB.asUint() - RC.asUint());
+                    VM_NEXT();
+                VM_CASE(MUL_I64)
+                    RA = Value::fromUint(RB.asUint() * RC.asUint());
+                    VM_NEXT();
+                VM_CASE(DIV_I64) {
+                    std::int64_t y = RC.asInt();
+                    if (y == 0) {
+                        throw RuntimeError("integer division by zero");
+                    }
+                    // 避免最小值除以-1溢出
+                    RA = y == -1 ? Value::fromUint(0 - RB.asUint()) : Value::fromInt(RB.asInt() / y);
+                    VM_NEXT();
+                }
+                VM_CASE(MOD_I64) {
+                    std::int64_t y = RC.asInt();
+                    if (y == 0) {
+                        throw RuntimeError("integer division by zero");
+                    }
+                    RA = Value::fromInt(y == -1 ? 0 : RB.asInt() % y);
+                    VM_NEXT();
+                }
+                VM_CASE(DIV_U64)
+                    if (RC.asUint() == 0) {
+                        throw RuntimeError("integer division by zero");
+                    }
+                    RA = Value::fromUint(RB.asUint() / RC.asUint());
+                    VM_NEXT();
+                VM_CASE(MOD_U64)
+                    if (RC.asUint() == 0) {
+                        throw RuntimeError("integer division by zero");
+                    }
+                    RA = Value::fromUint(RB.asUint() % RC.asUint());
+                    VM_NEXT();
+                VM_CASE(ADDI_I64)
+                    RA = Value::fromUint(RB.asUint() + static_cast<qword>(static_cast<std::int64_t>(argSC(ins))));
+                    VM_NEXT();
+                VM_CASE(NEG_I64)
+                    RA = Value::fromUint(0 - RB.asUint());
+                    VM_NEXT();
+                VM_CASE(BAND)
+                    RA = Value::fromUint(RB.asUint() & RC.asUint());
+                    VM_NEXT();
+                VM_CASE(BOR)
+                    RA = Value::fromUint(RB.asUint() | RC.asUint());
+                    VM_NEXT();
+                VM_CASE(BXOR)
+                    RA = Value::fromUint(RB.asUint() ^ RC.asUint());
+                    VM_NEXT();
+                VM_CASE(BNOT)
+                    RA = Value::fromUint(~RB.asUint());
+                    VM_NEXT();
+                VM_CASE(SHL)
+                    RA = Value::fromUint(shiftLeft(RB.asUint(), RC.asUint()));
+                    VM_NEXT();
+                VM_CASE(SHR_I64)
+                    RA = Value::fromUint(shiftRightArith(RB.asUint(), RC.asUint()));
+                    VM_NEXT();
+                VM_CASE(SHR_U64)
+                    RA = Value::fromUint(shiftRight(RB.asUint(), RC.asUint()));
+                    VM_NEXT();
+                VM_CASE(TRUNC_I)
+                    RA = Value::fromUint(truncSigned(RB.asUint(), argC(ins)));
+                    VM_NEXT();
+                VM_CASE(TRUNC_U)
+                    RA = Value::fromUint(truncUnsigned(RB.asUint(), argC(ins)));
+                    VM_NEXT();
+
+                // 浮点运算
+                VM_CASE(ADD_F64)
+                    RA = Value::fromFloat(RB.asFloat() + RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(SUB_F64)
+                    RA = Value::fromFloat(RB.asFloat() - RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(MUL_F64)
+                    RA = Value::fromFloat(RB.asFloat() * RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(DIV_F64)
+                    RA = Value::fromFloat(RB.asFloat() / RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(NEG_F64)
+                    RA = Value::fromFloat(-RB.asFloat());
+                    VM_NEXT();
+                VM_CASE(F64_TO_F32)
+                    RA = Value::fromFloat(static_cast<double>(static_cast<float>(RB.asFloat())));
+                    VM_NEXT();
+                VM_CASE(I64_TO_F64)
+                    RA = Value::fromFloat(static_cast<double>(RB.asInt()));
+                    VM_NEXT();
+                VM_CASE(U64_TO_F64)
+                    RA = Value::fromFloat(static_cast<double>(RB.asUint()));
+                    VM_NEXT();
+                VM_CASE(F64_TO_I64)
+                    RA = Value::fromInt(floatToInt(RB.asFloat()));
+                    VM_NEXT();
+                VM_CASE(F64_TO_U64)
+                    RA = Value::fromUint(floatToUint(RB.asFloat()));
+                    VM_NEXT();
+
+                // 比较，结果为0或1
+                VM_CASE(EQ)
+                    RA = Value::fromBool(RB == RC);
+                    VM_NEXT();
+                VM_CASE(NE)
+                    RA = Value::fromBool(RB != RC);
+                    VM_NEXT();
+                VM_CASE(LT_I64)
+                    RA = Value::fromBool(RB.asInt() < RC.asInt());
+                    VM_NEXT();
+                VM_CASE(LE_I64)
+                    RA = Value::fromBool(RB.asInt() <= RC.asInt());
+                    VM_NEXT();
+                VM_CASE(LT_U64)
+                    RA = Value::fromBool(RB.asUint() < RC.asUint());
+                    VM_NEXT();
+                VM_CASE(LE_U64)
+                    RA = Value::fromBool(RB.asUint() <= RC.asUint());
+                    VM_NEXT();
+                VM_CASE(EQ_F64)
+                    RA = Value::fromBool(RB.asFloat() == RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(NE_F64)
+                    RA = Value::fromBool(RB.asFloat() != RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(LT_F64)
+                    RA = Value::fromBool(RB.asFloat() < RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(LE_F64)
+                    RA = Value::fromBool(RB.asFloat() <= RC.asFloat());
+                    VM_NEXT();
+                VM_CASE(EQ_STR)
+                    RA = Value::fromBool(_equal(RB.asString(), RC.asString()));
+                    VM_NEXT();
+                VM_CASE(NE_STR)
+                    RA = Value::fromBool(!_equal(RB.asString(), RC.asString()));
+                    VM_NEXT();
+                VM_CASE(LT_STR)
+                    RA = Value::fromBool(compareStrings(_flatten(RB.asString()), _flatten(RC.asString())) < 0);
+                    VM_NEXT();
+                VM_CASE(LE_STR)
+                    RA = Value::fromBool(compareStrings(_flatten(RB.asString()), _flatten(RC.asString())) <= 0);
+                    VM_NEXT();
+                VM_CASE(NOT)
+                    RA = Value::fromBool(!RB.asBool());
+                    VM_NEXT();
+                VM_CASE(CONCAT)
+                    RA = Value::fromString(_concat(&RB, &RC, fp, pc));
+                    VM_NEXT();
+
+                // 大整数：小整数2x+1与2y相加减、x与2y相乘的溢出检查即结果是否超出小整数的范围，溢出时才进入慢速路径
+                VM_CASE(ADD_BIG) {
+                    std::int64_t r;
+                    if (RB.isSmall() && RC.isSmall() && !__builtin_add_overflow(RB.asInt(), RC.asInt() - 1, &r)) {
+                        RA = Value::fromInt(r);
+                    } else {
+                        RA = _big(Opcode::ADD_BIG, RB, RC, fp, pc);
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(SUB_BIG) {
+                    std::int64_t r;
+                    if (RB.isSmall() && RC.isSmall() && !__builtin_sub_overflow(RB.asInt(), RC.asInt() - 1, &r)) {
+                        RA = Value::fromInt(r);
+                    } else {
+                        RA = _big(Opcode::SUB_BIG, RB, RC, fp, pc);
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(MUL_BIG) {
+                    std::int64_t r;
+                    if (RB.isSmall() && RC.isSmall() && !__builtin_mul_overflow(RB.asSmall(), RC.asInt() - 1, &r)) {
+                        RA = Value::fromInt(r + 1);
+                    } else {
+                        RA = _big(Opcode::MUL_BIG, RB, RC, fp, pc);
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(DIV_BIG)
+                VM_CASE(MOD_BIG) {
+                    if (RB.isSmall() && RC.isSmall()) {
+                        std::int64_t x = RB.asSmall(), y = RC.asSmall();
+                        if (y == 0) {
+                            throw RuntimeError("integer division by zero");
+                        }
+                        // 只有最小的小整数除以-1超出范围
+                        std::int64_t r = opOf(ins) == Opcode::DIV_BIG ? x / y : x % y;
+                        if (Value::fitsSmall(r)) {
+                            RA = Value::fromSmall(r);
+                            VM_NEXT();
+                        }
+                    }
+                    RA = _big(opOf(ins), RB, RC, fp, pc);
+                    VM_NEXT();
+                }
+                VM_CASE(NEG_BIG) {
+                    std::int64_t r;
+                    if (RB.isSmall() && !__builtin_sub_overflow(static_cast<std::int64_t>(2), RB.asInt(), &r)) {
+                        RA = Value::fromInt(r);
+                    } else {
+                        RA = _big(Opcode::NEG_BIG, RB, RB, fp, pc);
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(I64_TO_BIG) {
+                    std::int64_t x = RB.asInt();
+                    if (Value::fitsSmall(x)) {
+                        RA = Value::fromSmall(x);
+                    } else {
+                        _bigint.assign(x < 0 ? 0 - RB.asUint() : RB.asUint(), x < 0);
+                        RA = _box(fp, pc);
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(U64_TO_BIG)
+                    if (RB.asUint() <= static_cast<qword>(Value::SMALL_MAX)) {
+                        RA = Value::fromSmall(RB.asInt());
+                    } else {
+                        _bigint.assign(RB.asUint(), false);
+                        RA = _box(fp, pc);
+                    }
+                    VM_NEXT();
+                VM_CASE(BIG_TO_I64)
+                    if (RB.isSmall()) {
+                        RA = Value::fromInt(RB.asSmall());
+                    } else {
+                        qword storage;
+                        RA = Value::fromUint(BigInt::low(BigInt::view(RB, storage)));
+                    }
+                    VM_NEXT();
+                VM_CASE(EQ_BIG)
+                    RA = Value::fromBool(equalBig(RB, RC));
+                    VM_NEXT();
+                VM_CASE(NE_BIG)
+                    RA = Value::fromBool(!equalBig(RB, RC));
+                    VM_NEXT();
+                VM_CASE(LT_BIG)
+                    RA = Value::fromBool(compareBig(RB, RC) < 0);
+                    VM_NEXT();
+                VM_CASE(LE_BIG)
+                    RA = Value::fromBool(compareBig(RB, RC) <= 0);
+                    VM_NEXT();
+
+                // 数组：下标按无符号数与长度比较，负数也越界
+                VM_CASE(NEWARR)
+                    VM_VERIFIED(argC(ins) < ELEMENT_COUNT);
+                    RA = _new_array(static_cast<ElementType>(argC(ins)), RB.asInt(), true, fp, pc)->value();
+                    VM_NEXT();
+                VM_CASE(LEN)
+                    RA = Value::fromUint(ArrayData::of(RB)->length);
+                    VM_NEXT();
+                VM_CASE(GETARR) {
+                    const ArrayData *array = ArrayData::of(RB);
+                    if (RC.asUint() >= array->length) {
+                        throw RuntimeError("array index " + std::to_string(RC.asInt()) + " out of range for length " +
+                                           std::to_string(array->length));
+                    }
+                    RA = array->load(RC.asUint());
+                    VM_NEXT();
+                }
+                VM_CASE(SETARR) {
+                    ArrayData *array = ArrayData::of(RA);
+                    if (RB.asUint() >= array->length) {
+                        throw RuntimeError("array index " + std::to_string(RB.asInt()) + " out of range for length " +
+                                           std::to_string(array->length));
+                    }
+                    array->store(RB.asUint(), RC);
+                    VM_NEXT();
+                }
+
+                // 跳转
+                VM_CASE(JMP)
+                    pc += argSBx(ins);
+                    if (argSBx(ins) < 0) {
+                        VM_BACKEDGE();
+                    }
+                    VM_NEXT();
+                VM_CASE(JMPT)
+                    if (RA.asBool()) {
+                        pc += argSBx(ins);
+                        if (argSBx(ins) < 0) {
+                            VM_BACKEDGE();
+                        }
+                    }
+                    VM_NEXT();
+                VM_CASE(JMPF)
+                    if (!RA.asBool()) {
+                        pc += argSBx(ins);
+                        if (argSBx(ins) < 0) {
+                            VM_BACKEDGE();
+                        }
+                    }
+                    VM_NEXT();
+
+                // 调用：被调用者的栈帧从R[A]开始，与调用者的栈帧重叠，参数不需要复制。返回值写入其第一个寄存器
+                VM_CASE(CALL) {
+                    const FunctionEntry &fn = _image.function(argBx(ins));
+                    Value *base = R + argA(ins);
+                    if (fp + 1 == frames_end || fn.register_count > stack_end - base) {
+                        VM_SAVE();
+                        _grow(*fiber, static_cast<std::size_t>(base - fiber->stack.get()) + fn.register_count,
+                              static_cast<std::size_t>(fp - frames) + 2);
+                        VM_LOAD();
+                        base = R + argA(ins);
+                    }
+                    *++fp = Frame{&fn, pc, base};
+                    R = base;
+                    pc = code + fn.code;
+                    VM_TIER_UP(argBx(ins));
+                    VM_NEXT();
+                }
+                // 尾调用：参数移到当前栈帧的开头，被调用者返回时直接返回到当前函数的调用者
+                VM_CASE(TAILCALL) {
+                    const FunctionEntry &fn = _image.function(argBx(ins));
+                    if (fn.register_count > stack_end - R) {
+                        VM_SAVE();
+                        _grow(*fiber, static_cast<std::size_t>(R - fiber->stack.get()) + fn.register_count,
+                              static_cast<std::size_t>(fp - frames) + 1);
+                        VM_LOAD();
+                    }
+                    std::copy(R + argA(ins), R + argA(ins) + fn.param_count, R);
+                    fp->function = &fn;
+                    pc = code + fn.code;
+                    VM_TIER_UP(argBx(ins));
+                    VM_NEXT();
+                }
+                VM_CASE(NATIVE)
+                    if (_native(argBx(ins), R + argA(ins), fp, pc)) {
+                        VM_SAVE();
+                        fiber->state = FiberState::BLOCKED;
+                        VM_SWITCH();
+                    }
+                    VM_NEXT();
+
+                // 纤程：SPAWN立即切换到新纤程，AWAIT在任务未完成时挂起当前纤程
+                VM_CASE(SPAWN)
+                VM_CASE(SPAWN_STR) {
+                    const FunctionEntry &fn = _image.function(argBx(ins));
+                    VM_SAVE();
+                    dword task = _spawn(fn, R + argA(ins), opOf(ins) == Opcode::SPAWN_STR);
+                    RA = Value::fromUint(_handle(task));
+                    _current = task;
+                    VM_LOAD();
+                    VM_TIER_UP(argBx(ins));
+                    VM_NEXT();
+                }
+                VM_CASE(AWAIT) {
+                    qword handle = RB.asUint();
+                    dword task = static_cast<dword>(handle);
+                    if (task == 0 || task >= _fibers.size() || _handle(task) != handle) {
+                        throw RuntimeError("invalid task " + std::to_string(handle));
+                    }
+                    if (_fibers[task]->state == FiberState::DONE) {
+                        RA = _fibers[task]->result;
+                        VM_NEXT();
+                    }
+                    VM_SAVE();
+                    fiber->state = FiberState::AWAITING;
+                    fiber->task = task;
+                    _fibers[task]->waiters.push_back(_current);
+                    VM_SWITCH();
+                    VM_NEXT();
+                }
+
+                // 超级指令：其后的指令作为操作数，执行完后跳过它们
+                VM_CASE(EQ_JMPF) {
+                    bool cond = RB == RC;
+                    RA = Value::fromBool(cond);
+                    pc += cond ? 1 : 1 + argSBx(*pc);
+                    VM_NEXT();
+                }
+                VM_CASE(NE_JMPF) {
+                    bool cond = RB != RC;
+                    RA = Value::fromBool(cond);
+                    pc += cond ? 1 : 1 + argSBx(*pc);
+                    VM_NEXT();
+                }
+                VM_CASE(LT_I64_JMPF) {
+                    bool cond = RB.asInt() < RC.asInt();
+                    RA = Value::fromBool(cond);
+                    pc += cond ? 1 : 1 + argSBx(*pc);
+                    VM_NEXT();
+                }
+                VM_CASE(LE_I64_JMPF) {
+                    bool cond = RB.asInt() <= RC.asInt();
+                    RA = Value::fromBool(cond);
+                    pc += cond ? 1 : 1 + argSBx(*pc);
+                    VM_NEXT();
+                }
+                VM_CASE(LOADI_LT_I64_JMPF) {
+                    std::int64_t k = argSBx(ins);
+                    RA = Value::fromInt(k);
+                    bool cond = R[argB(pc[0])].asInt() < k;
+                    R[argA(pc[0])] = Value::fromBool(cond);
+                    pc += cond ? 2 : 2 + argSBx(pc[1]);
+                    VM_NEXT();
+                }
+                VM_CASE(LOADI_LE_I64_JMPF) {
+                    std::int64_t k = argSBx(ins);
+                    RA = Value::fromInt(k);
+                    bool cond = R[argB(pc[0])].asInt() <= k;
+                    R[argA(pc[0])] = Value::fromBool(cond);
+                    pc += cond ? 2 : 2 + argSBx(pc[1]);
+                    VM_NEXT();
+                }
+                VM_CASE(ADDI_I64_JMP) {
+                    RA = Value::fromUint(RB.asUint() + static_cast<qword>(static_cast<std::int64_t>(argSC(ins))));
+                    int offset = argSBx(*pc);
+                    pc += 1 + offset;
+                    if (offset < 0) {
+                        VM_BACKEDGE();
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(ADD_I64_RET)
+                    // 其后的RET返回同一个寄存器，直接进入RET的处理代码
+                    RA = Value::fromUint(RB.asUint() + RC.asUint());
+                    VM_FALLTHROUGH;
+                VM_CASE(RET)
+                    R[0] = RA;
+                    VM_FALLTHROUGH;
+                VM_CASE(RET0)
+                    if (fp == frames) {
+                        // 主纤程返回时程序结束，其他纤程返回后切换到下一个纤程
+                        if (_current == 0) {
+                            _scheduler.cancel();
+                            return;
+                        }
+                        _finish(R[0]);
+                        VM_SWITCH();
+                        VM_NEXT();
+                    }
+                    pc = fp->ret;
+                    R = (--fp)->base;
+                    VM_RESUME();
+                    VM_NEXT();
+                VM_INVALID
+                    VM_VERIFIED(false);
+                    throw RuntimeError("invalid opcode " + std::to_string(static_cast<unsigned>(opOf(ins))));
+#if defined(LETT_COMPUTED_GOTO)
+        }
+#else
+            }
+        }
+#endif
+    }
+
+}   // namespace Lett.
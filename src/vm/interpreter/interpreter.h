@@ -0,0 +1,153 @@
+#ifndef __LETT_INTERPRETER_INTERPRETER_H__
+#define __LETT_INTERPRETER_INTERPRETER_H__
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "array.h"
+#include "bigint.h"
+#include "heap.h"
+#include "image.h"
+#include "jit.h"
+#include "output.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "value.h"
+
+namespace Lett {
+
+    struct InterpreterOptions {
+        bool jit;                       // 为false或平台不支持JIT时只解释执行
+        std::size_t nursery_size;       // 新生代的字节数
+
+        InterpreterOptions() : jit(true), nursery_size(Heap::NURSERY_SIZE) {}
+    };
+
+    // 字节码解释器，直接执行已加载的字节码文件中的指令
+    // 寄存器是不带类型标记的64位值(Value)，字符串寄存器中保存StringData的地址：
+    // 字符串常量指向字节码文件的字符串表，运行时产生的字符串在分代回收的堆(Heap)中分配，
+    // 回收时根据编译器生成的栈映射找到寄存器中的字符串。拼接得到的长字符串为rope，需要字符时才展开
+    // 数组(ArrayData)在堆上连续存放不装箱的元素，array模块的内置函数由按CPU选择的向量化内核执行
+    // 大整数的运算在两个操作数都是小整数时用溢出检查直接计算，溢出时才由BigInt计算并在堆上分配结果
+    // 分层执行：统计每个函数的调用与回边次数，达到JIT_THRESHOLD的函数由JitCompiler编译为机器码执行
+    // 纤程：SPAWN创建的纤程有自己的寄存器栈和调用栈，在同一个线程中协作式地切换。纤程只在SPAWN、AWAIT和
+    // 阻塞的内置函数处让出执行，阻塞的I/O由Scheduler等待，所有纤程都在等待时才阻塞线程
+    class Interpreter {
+    private:
+        // 调用栈帧
+        struct Frame {
+            const FunctionEntry *function;
+            const Instruction *ret;     // 返回后继续执行的指令
+            Value *base;                // 第一个寄存器
+        };
+
+        enum class FiberState {
+            RUNNING,                    // 正在执行或等待执行
+            AWAITING,                   // 等待另一个纤程完成
+            BLOCKED,                    // 等待I/O或定时器
+            DONE
+        };
+
+        // 主纤程的栈在创建解释器时按最大大小分配，其他纤程的栈从较小的大小开始，不足时加倍
+        struct Fiber {
+            std::unique_ptr<Value[]> stack;
+            std::unique_ptr<Frame[]> frames;
+            std::size_t stack_size;
+            std::size_t frame_count;
+            Frame *fp;                  // 挂起时的栈帧
+            const Instruction *pc;      // 挂起时下一条要执行的指令，即挂起处指令的下一条
+            FiberState state;
+            dword generation;           // 位置每被复用一次加1，是纤程的句柄的高32位
+            dword task;                 // AWAIT等待的纤程
+            bool ref_result;            // 返回值为字符串、大整数或数组，完成后作为回收的根
+            Value result;
+            std::vector<dword> waiters; // 等待该纤程完成的纤程
+            std::string data;           // 完成的I/O操作读到的数据
+            std::string error;
+
+            Fiber(std::size_t stack_size, std::size_t frame_count);
+        };
+
+        // 函数的执行次数与编译后的机器码
+        struct Tier {
+            dword counter;              // 调用与回边的次数
+            const JitFunction *code;    // 未编译时为空
+        };
+
+        const Image &_image;
+        Output _out;                                    // 内置函数的输出
+        std::vector<std::unique_ptr<Fiber>> _fibers;    // 以纤程的句柄的低32位为下标，0为主纤程
+        std::vector<dword> _free;                       // 可以复用的已完成纤程的位置
+        std::size_t _sweep_at;                          // 纤程数达到该值且没有可复用的位置时回收
+        std::deque<dword> _ready;                       // 等待执行的纤程
+        dword _current;                                 // 正在执行的纤程
+        Scheduler _scheduler;
+        std::vector<Scheduler::Completion> _completions;
+        Heap _heap;                                     // 运行时产生的字符串
+        std::vector<const StringData *> _pending;       // 展开rope时待处理的部分
+        BigInt _bigint;                                 // 大整数运算的结果
+        std::vector<Value *> _protected;                // 不在栈映射中、分配时仍需作为根的值
+        std::vector<qword> _sampled;                    // 采样时记录的调用栈
+        JitCompiler _jit;
+        bool _jit_enabled;
+        std::vector<Tier> _tiers;                       // 以函数的下标为下标
+
+        Interpreter(const Image &image, Output &&out, const InterpreterOptions &options);
+
+        template <bool Profile>
+        void _execute(qword *pairs, Profiler *profiler);
+        void _sample(Profiler &profiler, const Frame *fp, const Instruction *pc);
+        void *_allocate(std::size_t size, word refs, const Frame *fp, const Instruction *pc);
+        const StringData *_concat(const Value *a, const Value *b, const Frame *fp, const Instruction *pc);
+        const StringData *_string(std::string_view chars, const Frame *fp, const Instruction *pc);
+        void _roots(const Frame *fp, const Instruction *pc, std::vector<Value *> &roots);
+        void _frame_roots(const Frame *frames, const Frame *fp, const Instruction *pc, std::vector<Value *> &roots);
+        bool _rope(const StringData *s) const;
+        const StringData *_flatten(const StringData *s);
+        bool _equal(const StringData *a, const StringData *b);
+        Value _big(Opcode op, Value a, Value b, const Frame *fp, const Instruction *pc);
+        Value _box(const Frame *fp, const Instruction *pc);
+        bool _native(dword id, Value *args, const Frame *fp, const Instruction *pc);
+        ArrayData *_new_array(ElementType type, std::int64_t length, bool zero, const Frame *fp, const Instruction *pc);
+        void _array(dword id, Value *args, const Frame *fp, const Instruction *pc);
+        bool _compile(dword function);
+        void _grow(Fiber &fiber, std::size_t registers, std::size_t frames);
+        dword _spawn(const FunctionEntry &fn, const Value *args, bool ref_result);
+        void _sweep();
+        qword _handle(dword fiber) const { return static_cast<qword>(_fibers[fiber]->generation) << 32 | fiber; }
+        void _finish(Value result);
+        dword _next();
+        void _deliver(Fiber &fiber);
+    public:
+        static constexpr std::size_t STACK_SIZE = 1 << 20;
+        static constexpr std::size_t MAX_FRAMES = 100000;
+        static constexpr dword JIT_THRESHOLD = 1000;
+        static constexpr std::size_t ROPE_MIN = 64;    // 拼接的结果不短于该长度时为rope
+        static constexpr std::size_t FIBER_STACK_SIZE = 1024;   // 新纤程的寄存器个数
+        static constexpr std::size_t FIBER_FRAMES = 32;         // 新纤程的栈帧个数
+        static constexpr std::size_t SWEEP_MIN = 64;            // 开始回收已完成纤程的纤程数
+
+        // 输出写入out，执行结束时写出缓冲的输出并刷新out
+        Interpreter(const Image &image, std::ostream &out, const InterpreterOptions &options = InterpreterOptions());
+        // 输出写入文件描述符fd（如STDOUT_FILENO），fd是终端时按行缓冲
+        Interpreter(const Image &image, int fd, const InterpreterOptions &options = InterpreterOptions());
+
+        // 执行入口函数，出错时抛出RuntimeError。入口函数返回时程序结束，不等待其他纤程。
+        // 返回或出错前写出缓冲的输出
+        void run();
+        // 执行入口函数，同时统计相邻两条指令的执行次数：pairs[前一条的操作码 * 256 + 后一条的操作码]，不使用JIT。
+        // profiler不为空时在其定时器信号到达后记录调用栈
+        void profile(std::vector<qword> &pairs, Profiler *profiler = nullptr);
+
+        const Heap::Stats &gcStats() const { return _heap.stats(); }
+        // 纤程占用的位置数，包括主纤程和还未复用的已完成纤程
+        std::size_t fiberCount() const { return _fibers.size(); }
+    };  // class Interpreter
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_INTERPRETER_H__
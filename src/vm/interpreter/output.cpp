@@ -0,0 +1,128 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "exception.h"
+#include "output.h"
+
+namespace Lett {
+
+    Output::Output(int fd)
+        : _buffer(new char[CAPACITY]), _size(0), _fd(fd), _stream(nullptr), _line_buffered(::isatty(fd) != 0) {
+    }
+
+    Output::Output(std::ostream &stream)
+        : _buffer(new char[CAPACITY]), _size(0), _fd(-1), _stream(&stream), _line_buffered(false) {
+    }
+
+    Output::~Output() {
+        if (_buffer != nullptr) {
+            try {
+                flush();
+            } catch (const LettException &) {
+            }
+        }
+    }
+
+    Output::Output(Output &&other) noexcept
+        : _buffer(std::move(other._buffer)), _size(other._size), _fd(other._fd), _stream(other._stream),
+          _line_buffered(other._line_buffered) {
+        other._size = 0;
+    }
+
+    // 依次写出缓冲区和data（可以为空），写入文件描述符时两者由一次writev写出，部分写入时继续写剩余的部分
+    void Output::_write(const char *data, std::size_t size) {
+        if (_stream != nullptr) {
+            _stream->write(_buffer.get(), static_cast<std::streamsize>(_size));
+            _stream->write(data, static_cast<std::streamsize>(size));
+            _size = 0;
+            return;
+        }
+        struct iovec parts[2] = {{_buffer.get(), _size}, {const_cast<char *>(data), size}};
+        struct iovec *part = parts;
+        int count = size != 0 ? 2 : 1;
+        while (count > 0) {
+            ssize_t n = ::writev(_fd, part, count);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                _size = 0;
+                throw RuntimeError(std::string("cannot write output: ") + std::strerror(errno));
+            }
+            std::size_t written = static_cast<std::size_t>(n);
+            while (count > 0 && written >= part->iov_len) {
+                written -= part->iov_len;
+                ++part;
+                --count;
+            }
+            if (count > 0) {
+                part->iov_base = static_cast<char *>(part->iov_base) + written;
+                part->iov_len -= written;
+            }
+        }
+        _size = 0;
+    }
+
+    char *Output::_reserve(std::size_t size) {
+        if (CAPACITY - _size < size) {
+            _write(nullptr, 0);
+        }
+        return _buffer.get() + _size;
+    }
+
+    // 不短于半个缓冲区的数据不复制，与缓冲区一起写出
+    void Output::write(const char *data, std::size_t size) {
+        if (size >= CAPACITY / 2) {
+            _write(data, size);
+            return;
+        }
+        std::memcpy(_reserve(size), data, size);
+        _size += size;
+        if (_line_buffered && std::memchr(data, '\n', size) != nullptr) {
+            flush();
+        }
+    }
+
+    void Output::put(char ch) {
+        *_reserve(1) = ch;
+        _size++;
+        if (_line_buffered && ch == '\n') {
+            flush();
+        }
+    }
+
+    void Output::writeInt(std::int64_t value) {
+        char *first = _reserve(24);
+        _size = static_cast<std::size_t>(std::to_chars(first, first + 24, value).ptr - _buffer.get());
+    }
+
+    void Output::writeUint(std::uint64_t value) {
+        char *first = _reserve(24);
+        _size = static_cast<std::size_t>(std::to_chars(first, first + 24, value).ptr - _buffer.get());
+    }
+
+    void Output::writeFloat(double value) {
+        char *first = _reserve(32);
+        _size = static_cast<std::size_t>(std::to_chars(first, first + 32, value, std::chars_format::general, 6).ptr
+                                         - _buffer.get());
+    }
+
+    void Output::writeFloat(float value) {
+        char *first = _reserve(32);
+        _size = static_cast<std::size_t>(std::to_chars(first, first + 32, value, std::chars_format::general, 6).ptr
+                                         - _buffer.get());
+    }
+
+    void Output::flush() {
+        if (_size != 0) {
+            _write(nullptr, 0);
+        }
+        if (_stream != nullptr) {
+            _stream->flush();
+        }
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,56 @@
+#ifndef __LETT_INTERPRETER_OUTPUT_H__
+#define __LETT_INTERPRETER_OUTPUT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+namespace Lett {
+
+    // sys.print等内置函数的输出缓冲区，每个解释器（isolate）一个。
+    // 输出先写入缓冲区，缓冲区已满、显式调用flush或执行结束时才写出：写入文件描述符时用一次writev
+    // 同时写出缓冲区和不适合复制的长字符串。文件描述符是终端时按行缓冲，每个换行符之后写出，
+    // 写入管道或文件时不按行写出，大量输出只需要很少的系统调用。
+    // 整数和浮点数用std::to_chars直接格式化到缓冲区中，不产生临时字符串
+    class Output {
+    private:
+        std::unique_ptr<char[]> _buffer;
+        std::size_t _size;              // 缓冲区中的字节数
+        int _fd;                        // 输出到流时为-1
+        std::ostream *_stream;
+        bool _line_buffered;
+
+        void _write(const char *data, std::size_t size);
+        // 保证缓冲区中至少有size个空闲字节
+        char *_reserve(std::size_t size);
+    public:
+        static constexpr std::size_t CAPACITY = 64 * 1024;
+
+        // 写入文件描述符，不取得其所有权
+        explicit Output(int fd);
+        // 写入流，用于测试和在内存中收集输出的isolate，不按行缓冲
+        explicit Output(std::ostream &stream);
+        // 析构时写出缓冲区中剩余的输出，忽略错误
+        ~Output();
+        Output(Output &&other) noexcept;
+        Output(const Output&) = delete;
+        Output& operator=(const Output&) = delete;
+
+        void write(const char *data, std::size_t size);
+        void put(char ch);
+        void writeInt(std::int64_t value);
+        void writeUint(std::uint64_t value);
+        // 与printf("%g")相同：6位有效数字
+        void writeFloat(double value);
+        void writeFloat(float value);
+        // 写出缓冲区中的输出，出错时抛出RuntimeError
+        void flush();
+
+        bool lineBuffered() const { return _line_buffered; }
+        std::size_t buffered() const { return _size; }
+    };  // class Output
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_OUTPUT_H__
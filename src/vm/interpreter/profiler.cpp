@@ -0,0 +1,86 @@
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include "exception.h"
+#include "profiler.h"
+
+namespace Lett {
+
+    volatile std::sig_atomic_t Profiler::_pending = 0;
+
+    Profiler::Profiler(const Image &image)
+        : _image(image), _stacks(), _samples(0), _running(false), _previous() {
+    }
+
+    Profiler::~Profiler() {
+        stop();
+    }
+
+    void Profiler::_handler(int) {
+        _pending = 1;
+    }
+
+    void Profiler::start(long interval) {
+        if (_running) {
+            return;
+        }
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = _handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (::sigaction(SIGPROF, &action, &_previous) != 0) {
+            throw LettException("cannot install the profiling signal handler");
+        }
+        struct itimerval timer;
+        timer.it_interval.tv_sec = interval / 1000000;
+        timer.it_interval.tv_usec = interval % 1000000;
+        timer.it_value = timer.it_interval;
+        if (::setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+            ::sigaction(SIGPROF, &_previous, nullptr);
+            throw LettException("cannot start the profiling timer");
+        }
+        _pending = 0;
+        _running = true;
+    }
+
+    void Profiler::stop() {
+        if (!_running) {
+            return;
+        }
+        struct itimerval timer;
+        std::memset(&timer, 0, sizeof(timer));
+        ::setitimer(ITIMER_PROF, &timer, nullptr);
+        ::sigaction(SIGPROF, &_previous, nullptr);
+        _pending = 0;
+        _running = false;
+    }
+
+    void Profiler::record(const std::vector<qword> &stack) {
+        _pending = 0;
+        _stacks[stack]++;
+        _samples++;
+    }
+
+    // 不同的指令可能在同一行，按转换后的文本合并
+    void Profiler::writeFolded(std::ostream &os) const {
+        std::map<std::string, qword> folded;
+        for (const auto &[stack, count] : _stacks) {
+            std::string text;
+            for (qword frame : stack) {
+                const FunctionEntry &fn = _image.function(static_cast<dword>(frame >> 32));
+                if (!text.empty()) {
+                    text += ';';
+                }
+                text += _image.stringView(fn.name);
+                text += ':';
+                text += std::to_string(_image.line(fn, static_cast<dword>(frame)));
+            }
+            folded[text] += count;
+        }
+        for (const auto &[text, count] : folded) {
+            os << text << ' ' << count << '\n';
+        }
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,50 @@
+#ifndef __LETT_INTERPRETER_PROFILER_H__
+#define __LETT_INTERPRETER_PROFILER_H__
+
+#include <csignal>
+#include <map>
+#include <ostream>
+#include <vector>
+#include "image.h"
+
+namespace Lett {
+
+    // 采样分析器：定时器信号(SIGPROF)按进程的CPU时间周期性地到达，信号处理函数只设置一个标志，
+    // 解释器在执行下一条指令前检查该标志并记录当前的调用栈，因此信号处理函数中不需要访问解释器的状态。
+    // 调用栈中的每个栈帧为(函数的下标, 指令在函数中的下标)，输出时通过行号表转换为源代码的行号
+    class Profiler {
+    private:
+        static volatile std::sig_atomic_t _pending;
+
+        const Image &_image;
+        std::map<std::vector<qword>, qword> _stacks;    // 调用栈及其采样次数
+        qword _samples;
+        bool _running;
+        struct sigaction _previous;
+
+        static void _handler(int);
+    public:
+        static constexpr long INTERVAL = 1000;          // 默认的采样间隔(us)
+
+        explicit Profiler(const Image &image);
+        ~Profiler();
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        // 开始和停止定时器，同一时刻只能有一个分析器在运行
+        void start(long interval = INTERVAL);
+        void stop();
+
+        // 是否需要采样
+        static bool pending() { return _pending != 0; }
+        // 记录一次采样，stack从入口函数开始，每项为函数的下标 << 32 | 指令的下标
+        void record(const std::vector<qword> &stack);
+
+        qword samples() const { return _samples; }
+        // 按折叠栈（flamegraph.pl的输入）的格式输出：每行为分号分隔的"函数名:行号"，空格之后是采样次数
+        void writeFolded(std::ostream &os) const;
+    };  // class Profiler
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_PROFILER_H__
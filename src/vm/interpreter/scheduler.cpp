@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "exception.h"
+#include "scheduler.h"
+
+namespace Lett {
+
+    namespace {
+        std::string describe(const char *action, const std::string &path, int error) {
+            return std::string("cannot ") + action + " " + path + ": " + std::strerror(error);
+        }
+    }   // namespace
+
+    Scheduler::Scheduler()
+        : _epoll(-1), _operations(), _timers(), _retries() {
+    }
+
+    Scheduler::~Scheduler() {
+        cancel();
+        if (_epoll >= 0) {
+            ::close(_epoll);
+        }
+    }
+
+    // 不能由epoll等待的文件（普通文件、目录）返回false，由调用者同步读写
+    bool Scheduler::_watch(int fd, unsigned events, Operation operation) {
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            return false;
+        }
+        if (_epoll < 0) {
+            _epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            if (_epoll < 0) {
+                int error = errno;
+                ::close(fd);
+                throw RuntimeError(std::string("cannot create epoll instance: ") + std::strerror(error));
+            }
+        }
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            if (errno == EPERM) {
+                return false;
+            }
+            int error = errno;
+            ::close(fd);
+            throw RuntimeError(describe("wait for", operation.path, error));
+        }
+        _operations.emplace(fd, std::move(operation));
+        return true;
+    }
+
+    // 读写到需要等待(EAGAIN)为止，返回操作是否已结束（完成或出错）
+    bool Scheduler::_transfer(int fd, Operation &operation, std::string &error) {
+        if (operation.kind == Kind::WRITE) {
+            while (operation.written < operation.data.size()) {
+                ssize_t n = ::write(fd, operation.data.data() + operation.written, operation.data.size() - operation.written);
+                if (n >= 0) {
+                    operation.written += static_cast<std::size_t>(n);
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return false;
+                } else if (errno != EINTR) {
+                    error = describe("write", operation.path, errno);
+                    return true;
+                }
+            }
+            return true;
+        }
+        char buffer[65536];
+        for (;;) {
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                operation.data.append(buffer, static_cast<std::size_t>(n));
+            } else if (n == 0) {
+                return true;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            } else if (errno != EINTR) {
+                error = describe("read", operation.path, errno);
+                return true;
+            }
+        }
+    }
+
+    // 打开文件并开始写入。返回false表示操作还未结束：已由epoll等待，或FIFO还没有读者、已加入重试队列；
+    // 返回true表示已同步完成，出错时error为错误信息
+    bool Scheduler::_open(Operation &operation, std::string &error) {
+        int fd = ::open(operation.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK | O_CLOEXEC, 0666);
+        if (fd < 0 && errno == ENXIO) {
+            Clock::duration delay = operation.delay;
+            operation.delay = std::min(delay * 2, RETRY_MAX);
+            _retries.emplace(Clock::now() + delay, std::move(operation));
+            return false;
+        }
+        if (fd < 0) {
+            error = describe("write", operation.path, errno);
+            return true;
+        }
+        if (_watch(fd, EPOLLOUT, operation)) {
+            return false;
+        }
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        _transfer(fd, operation, error);
+        ::close(fd);
+        return true;
+    }
+
+    // 最早到期的定时器或重试，调用者保证至少有一个
+    Scheduler::Clock::time_point Scheduler::_deadline() const {
+        if (_timers.empty()) {
+            return _retries.begin()->first;
+        }
+        if (_retries.empty()) {
+            return _timers.begin()->first;
+        }
+        return std::min(_timers.begin()->first, _retries.begin()->first);
+    }
+
+    bool Scheduler::read(dword fiber, const std::string &path, std::string &data) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            throw RuntimeError(describe("read", path, errno));
+        }
+        Operation operation{Kind::READ, fiber, path, std::string(), 0, RETRY_MIN};
+        if (_watch(fd, EPOLLIN, operation)) {
+            return false;
+        }
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        std::string error;
+        _transfer(fd, operation, error);
+        ::close(fd);
+        if (!error.empty()) {
+            throw RuntimeError(error);
+        }
+        data = std::move(operation.data);
+        return true;
+    }
+
+    bool Scheduler::write(dword fiber, const std::string &path, const std::string &data) {
+        Operation operation{Kind::WRITE, fiber, path, data, 0, RETRY_MIN};
+        std::string error;
+        if (!_open(operation, error)) {
+            return false;
+        }
+        if (!error.empty()) {
+            throw RuntimeError(error);
+        }
+        return true;
+    }
+
+    void Scheduler::sleep(dword fiber, std::int64_t milliseconds) {
+        _timers.emplace(Clock::now() + std::chrono::milliseconds(std::max<std::int64_t>(milliseconds, 0)), fiber);
+    }
+
+    void Scheduler::poll(bool block, std::vector<Completion> &done) {
+        std::size_t completed = done.size();
+        for (;;) {
+            // 等待的时间：不阻塞时为0，否则到最早的定时器或重试到期，都没有时一直等待
+            bool timed = !_timers.empty() || !_retries.empty();
+            int timeout = 0;
+            if (block) {
+                timeout = -1;
+                if (timed) {
+                    auto wait = std::chrono::ceil<std::chrono::milliseconds>(_deadline() - Clock::now()).count();
+                    timeout = static_cast<int>(std::clamp<decltype(wait)>(wait, 0, INT_MAX));
+                }
+            }
+            if (!_operations.empty()) {
+                struct epoll_event events[64];
+                int count = ::epoll_wait(_epoll, events, 64, timeout);
+                if (count < 0 && errno != EINTR) {
+                    throw RuntimeError(std::string("cannot wait for I/O: ") + std::strerror(errno));
+                }
+                for (int i = 0; i < count; ++i) {
+                    int fd = events[i].data.fd;
+                    auto it = _operations.find(fd);
+                    std::string error;
+                    if (it == _operations.end() || !_transfer(fd, it->second, error)) {
+                        continue;
+                    }
+                    Operation &operation = it->second;
+                    done.push_back(Completion{operation.fiber,
+                                              operation.kind == Kind::WRITE ? std::string() : std::move(operation.data),
+                                              std::move(error)});
+                    ::close(fd);
+                    _operations.erase(it);
+                }
+            } else if (timeout != 0 && timed) {
+                std::this_thread::sleep_until(_deadline());
+            }
+            Clock::time_point now = Clock::now();
+            while (!_timers.empty() && _timers.begin()->first <= now) {
+                done.push_back(Completion{_timers.begin()->second, std::string(), std::string()});
+                _timers.erase(_timers.begin());
+            }
+            // 到期的重试：FIFO仍然没有读者时重新加入重试队列
+            while (!_retries.empty() && _retries.begin()->first <= now) {
+                Operation operation = std::move(_retries.begin()->second);
+                _retries.erase(_retries.begin());
+                std::string error;
+                if (_open(operation, error)) {
+                    done.push_back(Completion{operation.fiber, std::string(), std::move(error)});
+                }
+            }
+            if (!block || done.size() > completed || pending() == 0) {
+                return;
+            }
+        }
+    }
+
+    void Scheduler::cancel() {
+        for (auto &entry : _operations) {
+            ::close(entry.first);
+        }
+        _operations.clear();
+        _timers.clear();
+        _retries.clear();
+    }
+
+}   // namespace Lett.
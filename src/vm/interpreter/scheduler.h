@@ -0,0 +1,77 @@
+#ifndef __LETT_INTERPRETER_SCHEDULER_H__
+#define __LETT_INTERPRETER_SCHEDULER_H__
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace Lett {
+
+    // 纤程的阻塞I/O：发起操作的纤程挂起，文件描述符由epoll通知就绪后以非阻塞方式继续读写，
+    // 操作完成后交给解释器恢复该纤程。普通文件总是就绪（epoll也不支持普通文件），直接同步读写；
+    // 管道、FIFO、终端和套接字在等待时不占用线程，一个线程可以同时进行任意多个操作。
+    // 以非阻塞方式打开没有读者的FIFO写入时失败(ENXIO)，此时定时重试打开，直到有读者
+    class Scheduler {
+    public:
+        // 完成的操作：发起操作的纤程，读到的数据及错误信息（为空表示成功）
+        struct Completion {
+            dword fiber;
+            std::string data;
+            std::string error;
+        };
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        enum class Kind {
+            READ,
+            WRITE
+        };
+
+        struct Operation {
+            Kind kind;
+            dword fiber;
+            std::string path;           // 出错时报告的文件名
+            std::string data;           // 读到的数据，或待写入的数据
+            std::size_t written;
+            Clock::duration delay;      // 重试打开的间隔，每次加倍
+        };
+
+        static constexpr Clock::duration RETRY_MIN = std::chrono::milliseconds(1);
+        static constexpr Clock::duration RETRY_MAX = std::chrono::milliseconds(50);
+
+        int _epoll;                                     // 第一次需要等待时创建
+        std::map<int, Operation> _operations;           // 以文件描述符为键
+        std::multimap<Clock::time_point, dword> _timers;
+        std::multimap<Clock::time_point, Operation> _retries;   // 等待重试打开的写入
+
+        bool _watch(int fd, unsigned events, Operation operation);
+        bool _transfer(int fd, Operation &operation, std::string &error);
+        bool _open(Operation &operation, std::string &error);
+        Clock::time_point _deadline() const;
+    public:
+        Scheduler();
+        ~Scheduler();
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        // 读取文件的全部内容。返回true表示已同步完成，内容在data中；否则纤程需要挂起等待完成。无法打开时抛出RuntimeError
+        bool read(dword fiber, const std::string &path, std::string &data);
+        // 创建或截断文件并写入data，返回值与read相同
+        bool write(dword fiber, const std::string &path, const std::string &data);
+        // 挂起纤程milliseconds毫秒，不大于0时只让出执行
+        void sleep(dword fiber, std::int64_t milliseconds);
+
+        // 未完成的操作数
+        std::size_t pending() const { return _operations.size() + _timers.size() + _retries.size(); }
+        // 处理就绪的文件描述符和到期的定时器，完成的操作加入done。block为true时等待到至少完成一个操作
+        void poll(bool block, std::vector<Completion> &done);
+        // 放弃所有未完成的操作
+        void cancel();
+    };  // class Scheduler
+
+}   // namespace Lett.
+
+#endif // __LETT_INTERPRETER_SCHEDULER_H__
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "exception.h"
+#include "batch.h"
+#include "work_stealing_pool.h"
+
+namespace Lett {
+
+    Batch::Batch(const InterpreterOptions &options)
+        : _options(options), _images(), _load_errors(), _isolates() {
+    }
+
+    void Batch::add(const std::string &path) {
+        auto it = _images.find(path);
+        if (it == _images.end() && _load_errors.count(path) == 0) {
+            std::unique_ptr<Image> image(new Image());
+            try {
+                image->load(path);
+                it = _images.emplace(path, std::move(image)).first;
+            } catch (const LettException &e) {
+                _load_errors.emplace(path, e.what());
+            }
+        }
+        _isolates.push_back(Isolate{path, it != _images.end() ? it->second.get() : nullptr, std::string(),
+                                    it != _images.end() ? std::string() : _load_errors[path]});
+    }
+
+    // 在工作线程中执行，只访问自己的isolate和只读的字节码文件
+    void Batch::_run(Isolate &isolate) const {
+        if (isolate.image == nullptr) {
+            return;
+        }
+        std::ostringstream out;
+        try {
+            Interpreter interpreter(*isolate.image, out, _options);
+            interpreter.run();
+        } catch (const LettException &e) {
+            isolate.error = e.what();
+        } catch (const std::bad_alloc &) {
+            isolate.error = "out of memory";
+        }
+        isolate.output = out.str();
+    }
+
+    // 前面的isolate都已完成时立即写入其输出并释放，不需要保存所有isolate的输出
+    std::size_t Batch::run(std::size_t threads, std::ostream &out, std::ostream &err) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::vector<bool> done(_isolates.size(), false);
+        std::size_t failures = 0;
+        WorkStealingPool pool(std::min(threads, std::max<std::size_t>(_isolates.size(), 1)));
+        for (std::size_t i = 0; i < _isolates.size(); ++i) {
+            pool.submit([this, i, &mutex, &finished, &done]() {
+                _run(_isolates[i]);
+                std::lock_guard<std::mutex> lock(mutex);
+                done[i] = true;
+                finished.notify_one();
+            });
+        }
+        for (std::size_t i = 0; i < _isolates.size(); ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [&done, i]() { return done[i]; });
+            }
+            Isolate &isolate = _isolates[i];
+            out << isolate.output;
+            if (!isolate.error.empty()) {
+                err << isolate.path << ": " << isolate.error << '\n';
+                failures++;
+            }
+            std::string().swap(isolate.output);
+        }
+        return failures;
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,50 @@
+#ifndef __LETT_ISOLATE_BATCH_H__
+#define __LETT_ISOLATE_BATCH_H__
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "image.h"
+#include "interpreter.h"
+
+namespace Lett {
+
+    // 在一个进程中并行执行多个字节码文件。每次执行在自己的isolate中进行：
+    // isolate有独立的解释器（寄存器栈、调用栈、堆和JIT编译的机器码）与输出缓冲区，isolate之间不共享可变的状态。
+    // 加载后的字节码文件只读，相同路径的文件只加载（映射）一次，由执行它的所有isolate共享。
+    // isolate由工作窃取的线程池执行，执行时间不同的脚本也能使所有线程保持忙碌
+    class Batch {
+    private:
+        struct Isolate {
+            std::string path;
+            const Image *image;         // 加载失败时为空
+            std::string output;
+            std::string error;
+        };
+
+        InterpreterOptions _options;
+        std::map<std::string, std::unique_ptr<Image>> _images;
+        std::map<std::string, std::string> _load_errors;
+        std::vector<Isolate> _isolates;
+
+        void _run(Isolate &isolate) const;
+    public:
+        explicit Batch(const InterpreterOptions &options = InterpreterOptions());
+
+        // 添加一次执行，加载失败时记录错误，在run时报告
+        void add(const std::string &path);
+        // 使用threads个线程执行所有添加的脚本（0表示使用所有核心），
+        // 按添加的顺序把每次执行的输出写入out、错误（带文件名）写入err，返回失败的次数。只能调用一次
+        std::size_t run(std::size_t threads, std::ostream &out, std::ostream &err);
+
+        std::size_t size() const { return _isolates.size(); }
+        // 加载的字节码文件个数
+        std::size_t imageCount() const { return _images.size(); }
+    };  // class Batch
+
+}   // namespace Lett.
+
+#endif // __LETT_ISOLATE_BATCH_H__
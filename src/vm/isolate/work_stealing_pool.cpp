@@ -0,0 +1,100 @@
+#include <algorithm>
+#include "work_stealing_pool.h"
+
+namespace Lett {
+
+    namespace {
+        // 当前线程所属的线程池及其队列的下标
+        thread_local const WorkStealingPool *current_pool = nullptr;
+        thread_local std::size_t current_index = 0;
+    }   // namespace
+
+    WorkStealingPool::WorkStealingPool(std::size_t threads)
+        : _queues(), _threads(), _mutex(), _work(), _done(), _queued(0), _unfinished(0), _next(0), _steals(0),
+          _stop(false) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            _queues.emplace_back(new Queue());
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            _threads.emplace_back(&WorkStealingPool::_worker, this, i);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _work.notify_all();
+        for (std::thread &thread : _threads) {
+            thread.join();
+        }
+    }
+
+    // 在_mutex中放入任务并增加计数，等待中的线程不会错过通知。
+    // 加锁的顺序总是先_mutex后队列的锁，_take只持有队列的锁
+    void WorkStealingPool::submit(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::size_t index = current_pool == this ? current_index : _next++ % _queues.size();
+            std::lock_guard<std::mutex> queue_lock(_queues[index]->mutex);
+            _queues[index]->tasks.push_back(std::move(task));
+            _queued.fetch_add(1);
+            _unfinished++;
+        }
+        _work.notify_one();
+    }
+
+    void WorkStealingPool::wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this]() { return _unfinished == 0; });
+    }
+
+    // 先从自己的队尾取，再从其他队列的队首窃取
+    bool WorkStealingPool::_take(std::size_t index, Task &task) {
+        for (std::size_t i = 0; i < _queues.size(); ++i) {
+            Queue &queue = *_queues[(index + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                _steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            _queued.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    void WorkStealingPool::_worker(std::size_t index) {
+        current_pool = this;
+        current_index = index;
+        for (;;) {
+            Task task;
+            if (_take(index, task)) {
+                task();
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_unfinished == 0) {
+                    _done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _work.wait(lock, [this]() { return _stop || _queued.load() > 0; });
+            if (_stop && _queued.load() == 0) {
+                return;
+            }
+        }
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,61 @@
+#ifndef __LETT_ISOLATE_WORK_STEALING_POOL_H__
+#define __LETT_ISOLATE_WORK_STEALING_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Lett {
+
+    // 工作窃取的线程池：每个线程有自己的任务队列，从队尾取出自己的任务（后进先出，缓存中的数据较新），
+    // 自己的队列为空时从其他线程的队首窃取任务（先进先出，窃取最早提交、通常也最大的任务）。
+    // 任务的粒度为整个脚本的执行，每个队列使用一个互斥锁，锁的开销相对任务可以忽略
+    class WorkStealingPool {
+    public:
+        typedef std::function<void()> Task;
+
+        // threads为0时使用所有核心
+        explicit WorkStealingPool(std::size_t threads = 0);
+        // 等待所有任务完成后结束线程
+        ~WorkStealingPool();
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // 在池中的线程中调用时放入该线程的队列，否则依次放入各线程的队列。任务不应抛出异常
+        void submit(Task task);
+        // 等待已提交的任务（包括任务中提交的任务）全部完成，不能在任务中调用
+        void wait();
+
+        std::size_t size() const { return _threads.size(); }
+        // 从其他线程的队列中窃取的任务数
+        std::size_t steals() const { return _steals.load(std::memory_order_relaxed); }
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> _queues;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _work;          // 有新的任务或线程池结束
+        std::condition_variable _done;          // 所有任务都已完成
+        std::atomic<std::size_t> _queued;       // 队列中的任务数
+        std::size_t _unfinished;                // 已提交但未完成的任务数，由_mutex保护
+        std::size_t _next;                      // 从外部提交时放入的队列，由_mutex保护
+        std::atomic<std::size_t> _steals;
+        bool _stop;
+
+        void _worker(std::size_t index);
+        bool _take(std::size_t index, Task &task);
+    };  // class WorkStealingPool
+
+}   // namespace Lett.
+
+#endif // __LETT_ISOLATE_WORK_STEALING_POOL_H__
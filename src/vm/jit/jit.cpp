@@ -0,0 +1,403 @@
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include <sys/mman.h>
+#include "jit.h"
+
+namespace Lett {
+
+    namespace {
+        // 生成的代码只使用调用者保存的寄存器：rdi为栈帧的寄存器数组，rax、rcx、rdx和xmm0保存临时值
+        enum Reg : byte { RAX = 0, RCX = 1, RDX = 2, XMM0 = 0, RDI = 7 };
+
+        // 条件码，用于jcc与setcc
+        enum Cond : byte { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+                           CC_P = 0xA, CC_NP = 0xB, CC_L = 0xC, CC_LE = 0xE };
+
+        // 机器码的入口：rdi为栈帧的寄存器，rsi为开始执行的指令对应的机器码，返回解释器继续执行的指令下标
+        using Entry = dword (*)(Value *R, const void *target);
+
+        // x86-64机器码的缓冲区，只提供模板用到的指令
+        class Emitter {
+        private:
+            std::vector<byte> _code;
+        public:
+            std::size_t size() const { return _code.size(); }
+            const std::vector<byte> &code() const { return _code; }
+
+            void emit(std::initializer_list<byte> bytes) { _code.insert(_code.end(), bytes); }
+            void imm32(dword value) {
+                for (int i = 0; i < 4; ++i) {
+                    _code.push_back(static_cast<byte>(value >> (8 * i)));
+                }
+            }
+            void imm64(qword value) {
+                imm32(static_cast<dword>(value));
+                imm32(static_cast<dword>(value >> 32));
+            }
+
+            // op reg, [rdi + 8 * r]：寄存器数组中的第r个值
+            void mem(std::initializer_list<byte> op, byte reg, unsigned r) {
+                emit(op);
+                _code.push_back(static_cast<byte>(0x80 | reg << 3 | RDI));
+                imm32(r * sizeof(Value));
+            }
+            void load(Reg reg, unsigned r) { mem({0x48, 0x8B}, reg, r); }
+            void store(unsigned r, Reg reg) { mem({0x48, 0x89}, reg, r); }
+            void loadF64(unsigned r) { mem({0xF2, 0x0F, 0x10}, XMM0, r); }
+            void storeF64(unsigned r) { mem({0xF2, 0x0F, 0x11}, XMM0, r); }
+            // mov rax, imm64
+            void loadImm64(qword value) {
+                emit({0x48, 0xB8});
+                imm64(value);
+            }
+            // setcc al; movzx eax, al; mov [r], rax
+            void storeCond(Cond cc, unsigned r) {
+                emit({0x0F, static_cast<byte>(0x90 | cc), 0xC0, 0x0F, 0xB6, 0xC0});
+                store(r, RAX);
+            }
+
+            // 返回下一条要执行的指令的下标：mov eax, index; ret
+            void exit(dword index) {
+                _code.push_back(0xB8);
+                imm32(index);
+                _code.push_back(0xC3);
+            }
+
+            // 8位偏移的跳转，返回待回填的位置
+            std::size_t jcc8(Cond cc) {
+                emit({static_cast<byte>(0x70 | cc), 0});
+                return _code.size() - 1;
+            }
+            std::size_t jmp8() {
+                emit({0xEB, 0});
+                return _code.size() - 1;
+            }
+            void bind8(std::size_t at) { _code[at] = static_cast<byte>(_code.size() - at - 1); }
+
+            // 32位偏移的跳转，跳转到其他指令，所有指令生成之后回填
+            std::size_t jcc32(Cond cc) {
+                emit({0x0F, static_cast<byte>(0x80 | cc)});
+                imm32(0);
+                return _code.size() - 4;
+            }
+            std::size_t jmp32() {
+                _code.push_back(0xE9);
+                imm32(0);
+                return _code.size() - 4;
+            }
+            void patch32(std::size_t at, std::size_t target) {
+                dword rel = static_cast<dword>(target - (at + 4));
+                std::memcpy(&_code[at], &rel, sizeof(rel));
+            }
+        };
+    }   // namespace
+
+    JitFunction::JitFunction(const FunctionEntry *function, void *code, std::size_t size, std::vector<dword> offsets)
+        : function(function), code(code), size(size), offsets(std::move(offsets)) {
+    }
+
+    JitFunction::~JitFunction() {
+        ::munmap(code, size);
+    }
+
+    bool JitCompiler::supported() {
+#if defined(__x86_64__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    JitCompiler::JitCompiler(const Image &image) : _image(image), _functions() {
+    }
+
+    const JitFunction *JitCompiler::compile(const FunctionEntry &function) {
+        if (!supported()) {
+            return nullptr;
+        }
+        const Instruction *code = _image.code() + function.code;
+        const qword *K = _image.constants();
+        Emitter e;
+        std::vector<dword> offsets(function.code_size);
+        std::vector<std::pair<std::size_t, dword>> jumps;       // 待回填的跳转及其目标指令
+        bool loop = false;
+
+        // 入口：跳转到rsi指向的指令
+        e.emit({0xFF, 0xE6});
+        for (dword i = 0; i < function.code_size; ++i) {
+            offsets[i] = static_cast<dword>(e.size());
+            Instruction ins = code[i];
+            unsigned a = argA(ins), b = argB(ins), c = argC(ins);
+            // 跳转的目标在函数之外时交给解释器
+            long target = static_cast<long>(i) + 1 + argSBx(ins);
+            bool local = target >= 0 && target < static_cast<long>(function.code_size);
+            // 超级指令之后的指令保持不变，只需按序列的第一条指令翻译
+            switch (opOf(ins)) {
+                case Opcode::NOP:
+                    break;
+                case Opcode::MOVE:
+                    e.load(RAX, b);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::LOADI:
+                case Opcode::LOADI_LT_I64_JMPF:
+                case Opcode::LOADI_LE_I64_JMPF:
+                    // mov qword [r], simm32
+                    e.mem({0x48, 0xC7}, 0, a);
+                    e.imm32(static_cast<dword>(argSBx(ins)));
+                    break;
+                case Opcode::LOADK:
+                    e.loadImm64(K[argBx(ins)]);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::LOADS:
+                    e.loadImm64(Value::fromString(_image.string(static_cast<dword>(K[argBx(ins)]))).bits());
+                    e.store(a, RAX);
+                    break;
+
+                case Opcode::ADD_I64:
+                case Opcode::ADD_I64_RET:
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x03}, RAX, c);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::SUB_I64:
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x2B}, RAX, c);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::MUL_I64:
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x0F, 0xAF}, RAX, c);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::BAND:
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x23}, RAX, c);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::BOR:
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x0B}, RAX, c);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::BXOR:
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x33}, RAX, c);
+                    e.store(a, RAX);
+                    break;
+                case Opcode::DIV_I64:
+                case Opcode::MOD_I64: {
+                    // 除数为0或-1时交给解释器
+                    e.load(RCX, c);
+                    e.emit({0x48, 0x85, 0xC9});                 // test rcx, rcx
+                    std::size_t zero = e.jcc8(CC_E);
+                    e.emit({0x48, 0x83, 0xF9, 0xFF});           // cmp rcx, -1
+                    std::size_t minus_one = e.jcc8(CC_E);
+                    e.load(RAX, b);
+                    e.emit({0x48, 0x99, 0x48, 0xF7, 0xF9});     // cqo; idiv rcx
+                    e.store(a, opOf(ins) == Opcode::DIV_I64 ? RAX : RDX);
+                    std::size_t done = e.jmp8();
+                    e.bind8(zero);
+                    e.bind8(minus_one);
+                    e.exit(function.code + i);
+                    e.bind8(done);
+                    break;
+                }
+                case Opcode::DIV_U64:
+                case Opcode::MOD_U64: {
+                    e.load(RCX, c);
+                    e.emit({0x48, 0x85, 0xC9});                 // test rcx, rcx
+                    std::size_t zero = e.jcc8(CC_E);
+                    e.load(RAX, b);
+                    e.emit({0x31, 0xD2, 0x48, 0xF7, 0xF1});     // xor edx, edx; div rcx
+                    e.store(a, opOf(ins) == Opcode::DIV_U64 ? RAX : RDX);
+                    std::size_t done = e.jmp8();
+                    e.bind8(zero);
+                    e.exit(function.code + i);
+                    e.bind8(done);
+                    break;
+                }
+                case Opcode::ADDI_I64:
+                case Opcode::ADDI_I64_JMP:
+                    e.load(RAX, b);
+                    e.emit({0x48, 0x05});                       // add rax, simm32
+                    e.imm32(static_cast<dword>(argSC(ins)));
+                    e.store(a, RAX);
+                    break;
+                case Opcode::NEG_I64:
+                    e.load(RAX, b);
+                    e.emit({0x48, 0xF7, 0xD8});                 // neg rax
+                    e.store(a, RAX);
+                    break;
+                case Opcode::BNOT:
+                    e.load(RAX, b);
+                    e.emit({0x48, 0xF7, 0xD0});                 // not rax
+                    e.store(a, RAX);
+                    break;
+                // 移位的位数不小于64时，左移和逻辑右移的结果为0，算术右移按63位移动
+                case Opcode::SHL:
+                case Opcode::SHR_U64:
+                    e.load(RCX, c);
+                    e.load(RAX, b);
+                    e.emit({0x48, 0xD3, static_cast<byte>(opOf(ins) == Opcode::SHL ? 0xE0 : 0xE8)});   // shl/shr rax, cl
+                    e.emit({0x31, 0xD2, 0x48, 0x83, 0xF9, 0x40, 0x48, 0x0F, 0x43, 0xC2});  // xor edx, edx; cmp rcx, 64; cmovae rax, rdx
+                    e.store(a, RAX);
+                    break;
+                case Opcode::SHR_I64:
+                    e.load(RCX, c);
+                    e.load(RAX, b);
+                    e.emit({0xBA, 0x3F, 0x00, 0x00, 0x00});     // mov edx, 63
+                    e.emit({0x48, 0x83, 0xF9, 0x40, 0x48, 0x0F, 0x43, 0xCA});  // cmp rcx, 64; cmovae rcx, rdx
+                    e.emit({0x48, 0xD3, 0xF8});                 // sar rax, cl
+                    e.store(a, RAX);
+                    break;
+                case Opcode::TRUNC_I:
+                case Opcode::TRUNC_U:
+                    e.load(RAX, b);
+                    if (c > 0 && c < 64) {
+                        byte shift = static_cast<byte>(64 - c);
+                        e.emit({0x48, 0xC1, 0xE0, shift});      // shl rax, shift
+                        // sar/shr rax, shift
+                        e.emit({0x48, 0xC1, static_cast<byte>(opOf(ins) == Opcode::TRUNC_I ? 0xF8 : 0xE8), shift});
+                    }
+                    e.store(a, RAX);
+                    break;
+
+                // 浮点运算使用SSE2
+                case Opcode::ADD_F64:
+                case Opcode::SUB_F64:
+                case Opcode::MUL_F64:
+                case Opcode::DIV_F64: {
+                    // addsd/subsd/mulsd/divsd xmm0, [r]
+                    byte op = opOf(ins) == Opcode::ADD_F64 ? 0x58 : opOf(ins) == Opcode::SUB_F64 ? 0x5C
+                            : opOf(ins) == Opcode::MUL_F64 ? 0x59 : 0x5E;
+                    e.loadF64(b);
+                    e.mem({0xF2, 0x0F, op}, XMM0, c);
+                    e.storeF64(a);
+                    break;
+                }
+                case Opcode::NEG_F64:
+                    e.load(RAX, b);
+                    e.emit({0x48, 0x0F, 0xBA, 0xF8, 0x3F});     // btc rax, 63
+                    e.store(a, RAX);
+                    break;
+                case Opcode::F64_TO_F32:
+                    e.loadF64(b);
+                    e.emit({0xF2, 0x0F, 0x5A, 0xC0, 0xF3, 0x0F, 0x5A, 0xC0});  // cvtsd2ss xmm0, xmm0; cvtss2sd xmm0, xmm0
+                    e.storeF64(a);
+                    break;
+                case Opcode::I64_TO_F64:
+                    e.mem({0xF2, 0x48, 0x0F, 0x2A}, XMM0, b);  // cvtsi2sd xmm0, [r]
+                    e.storeF64(a);
+                    break;
+
+                // 比较
+                case Opcode::EQ:
+                case Opcode::NE:
+                case Opcode::LT_I64:
+                case Opcode::LE_I64:
+                case Opcode::LT_U64:
+                case Opcode::LE_U64:
+                case Opcode::EQ_JMPF:
+                case Opcode::NE_JMPF:
+                case Opcode::LT_I64_JMPF:
+                case Opcode::LE_I64_JMPF: {
+                    Cond cc;
+                    switch (opOf(ins)) {
+                        case Opcode::EQ: case Opcode::EQ_JMPF: cc = CC_E; break;
+                        case Opcode::NE: case Opcode::NE_JMPF: cc = CC_NE; break;
+                        case Opcode::LT_I64: case Opcode::LT_I64_JMPF: cc = CC_L; break;
+                        case Opcode::LE_I64: case Opcode::LE_I64_JMPF: cc = CC_LE; break;
+                        case Opcode::LT_U64: cc = CC_B; break;
+                        default: cc = CC_BE; break;
+                    }
+                    e.load(RAX, b);
+                    e.mem({0x48, 0x3B}, RAX, c);                // cmp rax, [r]
+                    e.storeCond(cc, a);
+                    break;
+                }
+                // ucomisd对NaN置ZF、PF和CF，相等要求PF为0，不等在PF为1时也成立
+                case Opcode::EQ_F64:
+                case Opcode::NE_F64:
+                    e.loadF64(b);
+                    e.mem({0x66, 0x0F, 0x2E}, XMM0, c);        // ucomisd xmm0, [r]
+                    if (opOf(ins) == Opcode::EQ_F64) {
+                        e.emit({0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8});  // sete al; setnp cl; and al, cl
+                    } else {
+                        e.emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8});  // setne al; setp cl; or al, cl
+                    }
+                    e.emit({0x0F, 0xB6, 0xC0});                 // movzx eax, al
+                    e.store(a, RAX);
+                    break;
+                // b < c即c > b，NaN时CF为1，结果为0
+                case Opcode::LT_F64:
+                case Opcode::LE_F64:
+                    e.loadF64(c);
+                    e.mem({0x66, 0x0F, 0x2E}, XMM0, b);        // ucomisd xmm0, [r]
+                    e.storeCond(opOf(ins) == Opcode::LT_F64 ? CC_A : CC_AE, a);
+                    break;
+                case Opcode::NOT:
+                    e.load(RAX, b);
+                    e.emit({0x48, 0x85, 0xC0});                 // test rax, rax
+                    e.storeCond(CC_E, a);
+                    break;
+
+                case Opcode::JMP:
+                    if (!local) {
+                        e.exit(function.code + i);
+                        break;
+                    }
+                    loop = loop || target <= static_cast<long>(i);
+                    jumps.emplace_back(e.jmp32(), static_cast<dword>(target));
+                    break;
+                case Opcode::JMPT:
+                case Opcode::JMPF:
+                    if (!local) {
+                        e.exit(function.code + i);
+                        break;
+                    }
+                    loop = loop || target <= static_cast<long>(i);
+                    e.mem({0x48, 0x83}, 7, a);                  // cmp qword [r], 0
+                    e.emit({0x00});
+                    jumps.emplace_back(e.jcc32(opOf(ins) == Opcode::JMPT ? CC_NE : CC_E), static_cast<dword>(target));
+                    break;
+
+                // 调用、返回、字符串运算及其他的指令由解释器执行
+                default:
+                    e.exit(function.code + i);
+                    break;
+            }
+        }
+        // 进入和退出机器码各需要一次间接跳转，没有循环的函数每次进入只执行几条指令，解释执行更快
+        if (!loop) {
+            return nullptr;
+        }
+        for (const auto &jump : jumps) {
+            e.patch32(jump.first, offsets[jump.second]);
+        }
+
+        // 写入机器码后改为只读可执行
+        std::size_t size = (e.size() + 4095) & ~static_cast<std::size_t>(4095);
+        void *memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        std::memcpy(memory, e.code().data(), e.size());
+        if (::mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+            ::munmap(memory, size);
+            return nullptr;
+        }
+        _functions.push_back(std::make_unique<JitFunction>(&function, memory, size, std::move(offsets)));
+        return _functions.back().get();
+    }
+
+    const Instruction *JitCompiler::execute(const JitFunction &function, Value *R, const Instruction *pc) const {
+        const byte *code = static_cast<const byte *>(function.code);
+        std::size_t index = static_cast<std::size_t>(pc - _image.code()) - function.function->code;
+        Entry entry = reinterpret_cast<Entry>(function.code);
+        return _image.code() + entry(R, code + function.offsets[index]);
+    }
+
+}   // namespace Lett.
@@ -0,0 +1,46 @@
+#ifndef __LETT_JIT_JIT_H__
+#define __LETT_JIT_JIT_H__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "image.h"
+#include "value.h"
+
+namespace Lett {
+
+    // 编译后的函数：可执行内存中的机器码，以及每条指令对应的机器码的位置
+    struct JitFunction {
+        const FunctionEntry *function;
+        void *code;                     // mmap得到的可执行内存
+        std::size_t size;               // 映射的字节数
+        std::vector<dword> offsets;     // 第i条指令的机器码相对code的偏移
+
+        JitFunction(const FunctionEntry *function, void *code, std::size_t size, std::vector<dword> offsets);
+        ~JitFunction();
+        JitFunction(const JitFunction&) = delete;
+        JitFunction& operator=(const JitFunction&) = delete;
+    };
+
+    // 基线JIT：按模板把一个函数的每条指令翻译为x86-64机器码，不做优化。
+    // 机器码直接读写栈帧的寄存器数组，不在机器寄存器中保存任何值，因此每条指令的开头都可以作为入口。
+    // 机器码不处理的指令（调用、返回、字符串运算等）翻译为出口：返回该指令的下标，由解释器执行该指令后继续解释执行
+    class JitCompiler {
+    private:
+        const Image &_image;
+        std::vector<std::unique_ptr<JitFunction>> _functions;
+    public:
+        // 当前平台是否支持JIT（x86-64）
+        static bool supported();
+
+        explicit JitCompiler(const Image &image);
+
+        // 编译函数，平台不支持或函数中没有循环时返回nullptr
+        const JitFunction *compile(const FunctionEntry &function);
+        // 从pc指向的指令开始执行编译后的函数，R为栈帧的寄存器，返回解释器继续执行的指令
+        const Instruction *execute(const JitFunction &function, Value *R, const Instruction *pc) const;
+    };  // class JitCompiler
+
+}   // namespace Lett.
+
+#endif // __LETT_JIT_JIT_H__
@@ -1,7 +1,203 @@
+/*
+ * 虚拟机主程序
+ * 加载lettc生成的字节码文件(.ltc)并执行
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <unistd.h>
+#include <vector>
 #include "common.h"
+#include "image.h"
+#include "interpreter/interpreter.h"
+#include "isolate/batch.h"
 
-int main() {
-    std::cout << "generate lett virtual machine: lettc" << std::endl;
+// 打印执行次数最多的指令对及其占执行的指令总数的比例，作为选择超级指令的依据
+static void printPairs(const std::vector<Lett::qword> &pairs, std::size_t limit) {
+    std::vector<std::size_t> order;
+    unsigned long long total = 0;
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        if (pairs[i] != 0) {
+            order.push_back(i);
+            total += pairs[i];
+        }
+    }
+    std::sort(order.begin(), order.end(), [&pairs](std::size_t a, std::size_t b) {
+        return pairs[a] != pairs[b] ? pairs[a] > pairs[b] : a < b;
+    });
+    order.resize(std::min(order.size(), limit));
+    std::fprintf(stderr, "%14llu  instructions\n", total);
+    for (std::size_t i : order) {
+        std::fprintf(stderr, "%14llu  %5.1f%%  %-18s %s\n", static_cast<unsigned long long>(pairs[i]),
+                     100.0 * static_cast<double>(pairs[i]) / static_cast<double>(total),
+                     Lett::getOpcodeName(static_cast<Lett::Opcode>(i / 256)),
+                     Lett::getOpcodeName(static_cast<Lett::Opcode>(i % 256)));
+    }
+}
+
+// 打印各操作码的执行次数（指令对按后一条指令合并）及其比例，即指令的直方图
+static void printOpcodes(const std::vector<Lett::qword> &pairs, std::size_t limit) {
+    std::vector<Lett::qword> counts(256, 0);
+    unsigned long long total = 0;
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        counts[i % 256] += pairs[i];
+        total += pairs[i];
+    }
+    std::vector<std::size_t> order;
+    for (std::size_t op = 0; op < counts.size(); ++op) {
+        if (counts[op] != 0) {
+            order.push_back(op);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&counts](std::size_t a, std::size_t b) {
+        return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+    });
+    order.resize(std::min(order.size(), limit));
+    std::fprintf(stderr, "%14llu  instructions\n", total);
+    for (std::size_t op : order) {
+        std::fprintf(stderr, "%14llu  %5.1f%%  %s\n", static_cast<unsigned long long>(counts[op]),
+                     100.0 * static_cast<double>(counts[op]) / static_cast<double>(total),
+                     Lett::getOpcodeName(static_cast<Lett::Opcode>(op)));
+    }
+}
+
+// 打印垃圾回收的次数、暂停时间和回收的字节数，elapsed为程序的执行时间(ns)
+static void printGcStats(const Lett::Heap::Stats &stats, Lett::qword elapsed) {
+    std::fprintf(stderr, "minor collections  %llu\n", static_cast<unsigned long long>(stats.minor_collections));
+    std::fprintf(stderr, "major collections  %llu\n", static_cast<unsigned long long>(stats.major_collections));
+    std::fprintf(stderr, "max pause          %.3f ms\n", static_cast<double>(stats.max_pause) / 1e6);
+    std::fprintf(stderr, "total pause        %.3f ms (%.1f%% of %.3f ms)\n", static_cast<double>(stats.total_pause) / 1e6,
+                 elapsed == 0 ? 0.0 : 100.0 * static_cast<double>(stats.total_pause) / static_cast<double>(elapsed),
+                 static_cast<double>(elapsed) / 1e6);
+    std::fprintf(stderr, "allocated          %llu bytes\n", static_cast<unsigned long long>(stats.allocated));
+    std::fprintf(stderr, "promoted           %llu bytes\n", static_cast<unsigned long long>(stats.promoted));
+    std::fprintf(stderr, "freed              %llu bytes\n", static_cast<unsigned long long>(stats.freed));
+}
+
+// 在并行的isolate中执行列表文件中的所有字节码文件（每行一个），返回失败的次数，列表文件无法读取时返回-1
+static int runBatch(const Lett::ArgumentParser &arg_parser, const Lett::InterpreterOptions &options) {
+    std::ifstream list(arg_parser.getValue("batch"));
+    if (!list) {
+        std::cerr << "cannot read " << arg_parser.getValue("batch") << std::endl;
+        return -1;
+    }
+    Lett::Batch batch(options);
+    std::string path;
+    while (std::getline(list, path)) {
+        if (!path.empty()) {
+            batch.add(path);
+        }
+    }
+    std::size_t jobs = 0;
+    if (arg_parser.givend("jobs")) {
+        jobs = static_cast<std::size_t>(std::strtoul(arg_parser.getValue("jobs").c_str(), nullptr, 10));
+    }
+    std::size_t failures = batch.run(jobs, std::cout, std::cerr);
+    std::cout.flush();
+    return static_cast<int>(failures);
+}
+
+// 快照的密钥文件：环境变量LETT_SNAPSHOT_KEY，默认为~/.lett/snapshot.key
+static std::string snapshotKeyPath() {
+    const char *path = std::getenv("LETT_SNAPSHOT_KEY");
+    if (path != nullptr && path[0] != '\0') {
+        return path;
+    }
+    const char *home = std::getenv("HOME");
+    return std::string(home != nullptr ? home : ".") + "/.lett/snapshot.key";
+}
+
+int main(int argc, char* argv[]) {
+    Lett::ArgumentParser arg_parser("lett");
+    arg_parser.addOption("file", "f", "run the bytecode file.", true, "filename");
+    arg_parser.addOption("dump", "d", "print the bytecode instead of running it.");
+    arg_parser.addOption("pairs", "P", "print the most executed instruction pairs to stderr.");
+    arg_parser.addOption("no-jit", "n", "interpret only, do not compile hot functions to machine code.");
+    arg_parser.addOption("gc-stats", "g", "print garbage collection statistics to stderr.");
+    arg_parser.addOption("profile", "p", "sample the call stacks into a folded-stack file and print the opcode "
+                         "histogram to stderr.", true, "filename");
+    arg_parser.addOption("batch", "b", "run every bytecode file listed in the file, one per line, in parallel "
+                         "isolates.", true, "filename");
+    arg_parser.addOption("jobs", "j", "run the batch with n threads, 0 for all cores.", true, "n");
+    arg_parser.addOption("snapshot", "s", "load and verify the bytecode file, then write a snapshot that starts "
+                         "without verification instead of running it.", true, "filename");
+    arg_parser.addOption("from-snapshot", "r", "run a snapshot written by --snapshot.", true, "filename");
+
+    try {
+        arg_parser.parse(argc, argv);
+        if (arg_parser.givend("batch")) {
+            Lett::InterpreterOptions options;
+            options.jit = !arg_parser.givend("no-jit");
+            return runBatch(arg_parser, options) == 0 ? 0 : -1;
+        }
+        Lett::Image image;
+        if (arg_parser.givend("from-snapshot")) {
+            // 快照中的字节码文件已经校验过，认证码正确时映射后即可执行
+            image.loadSnapshot(arg_parser.getValue("from-snapshot"), Lett::readSnapshotKey(snapshotKeyPath(), false));
+        } else if (arg_parser.givend("file")) {
+            image.load(arg_parser.getValue("file"));
+        } else {
+            arg_parser.printHelp();
+            return 0;
+        }
+        if (arg_parser.givend("snapshot")) {
+            std::string path = arg_parser.getValue("snapshot");
+            std::string snapshot = image.snapshot(Lett::readSnapshotKey(snapshotKeyPath(), true));
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(snapshot.data(), static_cast<std::streamsize>(snapshot.size()));
+            if (!file) {
+                std::cerr << "cannot write " << path << std::endl;
+                return -1;
+            }
+            return 0;
+        }
+        if (arg_parser.givend("dump")) {
+            Lett::disassemble(image, std::cout);
+            return 0;
+        }
+        Lett::InterpreterOptions options;
+        options.jit = !arg_parser.givend("no-jit");
+        // 输出由解释器缓冲，直接写入标准输出，不经过std::cout
+        Lett::Interpreter interpreter(image, STDOUT_FILENO, options);
+        if (arg_parser.givend("pairs")) {
+            std::vector<Lett::qword> pairs;
+            interpreter.profile(pairs);
+            printPairs(pairs, 20);
+            return 0;
+        }
+        if (arg_parser.givend("profile")) {
+            std::ofstream folded(arg_parser.getValue("profile"), std::ios::trunc);
+            if (!folded) {
+                std::cerr << "cannot write " << arg_parser.getValue("profile") << std::endl;
+                return -1;
+            }
+            Lett::Profiler profiler(image);
+            std::vector<Lett::qword> pairs;
+            profiler.start();
+            interpreter.profile(pairs, &profiler);
+            profiler.stop();
+            profiler.writeFolded(folded);
+            std::fprintf(stderr, "%14llu  samples\n", static_cast<unsigned long long>(profiler.samples()));
+            printOpcodes(pairs, 20);
+            return 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        interpreter.run();
+        if (arg_parser.givend("gc-stats")) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            printGcStats(interpreter.gcStats(), static_cast<Lett::qword>(elapsed.count()));
+        }
+    } catch (const Lett::InvalidOption &e) {
+        std::cerr << e.what() << std::endl;
+        arg_parser.printHelp();
+        return -1;
+    } catch (const Lett::LettException &e) {
+        std::cout.flush();
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
     return 0;
-}
\ No newline at end of file
+}
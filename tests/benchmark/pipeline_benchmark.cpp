@@ -0,0 +1,610 @@
+/*
+ * 端到端的流水线基准测试
+ * 对samples目录中的.let程序和按规模生成的程序依次执行 读取 → 词法分析 → 语法分析 → 编译 → 链接 → 加载 → 执行，
+ * 以JSON报告各阶段的耗时、执行的指令数和峰值内存，给出基线时与之比较，超出容差时返回1
+ */
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "arguments.h"
+#include "exception.h"
+#include "image.h"
+#include "driver.h"
+#include "interpreter.h"
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    enum Phase { READ, LEX, PARSE, CHECK, GENERATE, OPTIMIZE, LINK, LOAD, EXECUTE, PHASE_COUNT };
+
+    const char *const PHASE_NAMES[PHASE_COUNT] = {
+        "read", "lex", "parse", "check", "generate", "optimize", "link", "load", "execute"
+    };
+
+    // 基线中低于该值的耗时不参与比较，它们主要是计时的噪声
+    const std::uint64_t TIME_FLOOR = 1000000;
+    // 峰值内存的增长不超过该值(KB)时不算退化
+    const std::uint64_t MEMORY_FLOOR = 1024;
+
+    std::uint64_t since(Clock::time_point start) {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    // 一个基准程序的测量结果。耗时取多次执行中的最小值，指令数和分配的字节数是确定的
+    struct Sample {
+        std::uint64_t source_bytes;
+        std::uint64_t phases[PHASE_COUNT];      // ns
+        std::uint64_t total;                    // 单次执行各阶段之和的最小值(ns)
+        std::uint64_t instructions;             // 只解释执行时执行的指令数
+        std::uint64_t heap_bytes;               // 堆上分配的字节数
+        char error[256];                        // 不为空时测量失败
+    };
+
+    struct Result {
+        std::string name;
+        Sample sample;
+        std::uint64_t peak_rss;                 // 执行该程序的子进程的峰值常驻内存(KB)
+    };
+
+    struct Program {
+        std::string name;
+        std::string path;
+    };
+
+    std::string readFile(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw Lett::FileNotExsit(path);
+        }
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        return buffer.str();
+    }
+
+    std::string compile(const std::string &source, Lett::PhaseTimes *times) {
+        Lett::Driver driver{Lett::DriverOptions()};
+        bool compiled = driver.compileString(source);
+        std::string data;
+        if (!compiled || !driver.link(data)) {
+            std::vector<std::string> errors = driver.getErrors();
+            throw Lett::LettException(errors.empty() ? "compilation failed" : errors.front());
+        }
+        if (times != nullptr) {
+            *times = driver.phaseTimes();
+        }
+        return data;
+    }
+
+    // 执行一次完整的流水线，times为各阶段的耗时
+    void runOnce(const std::string &path, std::uint64_t times[PHASE_COUNT], std::uint64_t &source_bytes) {
+        Clock::time_point start = Clock::now();
+        std::string source = readFile(path);
+        times[READ] = since(start);
+        source_bytes = source.size();
+
+        Lett::PhaseTimes compiled;
+        std::string data = compile(source, &compiled);
+        times[LEX] = compiled.lex;
+        times[PARSE] = compiled.parse;
+        times[CHECK] = compiled.check;
+        times[GENERATE] = compiled.generate;
+        times[OPTIMIZE] = compiled.optimize;
+        times[LINK] = compiled.link;
+
+        start = Clock::now();
+        Lett::Image image;
+        image.loadFromMemory(data, path);
+        times[LOAD] = since(start);
+
+        std::ostringstream out;
+        start = Clock::now();
+        Lett::Interpreter interpreter(image, out);
+        interpreter.run();
+        times[EXECUTE] = since(start);
+    }
+
+    // 执行repeat次取各阶段的最小值，再关闭JIT执行一次统计指令数和分配的字节数
+    void measure(const std::string &path, int repeat, Sample &sample) {
+        std::fill(std::begin(sample.phases), std::end(sample.phases), UINT64_MAX);
+        sample.total = UINT64_MAX;
+        for (int i = 0; i < repeat; ++i) {
+            std::uint64_t times[PHASE_COUNT];
+            runOnce(path, times, sample.source_bytes);
+            std::uint64_t total = 0;
+            for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+                sample.phases[p] = std::min(sample.phases[p], times[p]);
+                total += times[p];
+            }
+            sample.total = std::min(sample.total, total);
+        }
+
+        Lett::Image image;
+        image.loadFromMemory(compile(readFile(path), nullptr), path);
+        std::ostringstream out;
+        Lett::InterpreterOptions options;
+        options.jit = false;
+        Lett::Interpreter interpreter(image, out, options);
+        std::vector<Lett::qword> pairs;
+        interpreter.profile(pairs);
+        sample.instructions = 0;
+        for (Lett::qword count : pairs) {
+            sample.instructions += count;
+        }
+        sample.heap_bytes = interpreter.gcStats().allocated;
+    }
+
+    // 在子进程中测量，使每个程序的峰值内存互不影响
+    Result measureInChild(const Program &program, int repeat) {
+        Result result;
+        result.name = program.name;
+        std::memset(&result.sample, 0, sizeof(result.sample));
+        result.peak_rss = 0;
+
+        int fds[2];
+        if (pipe(fds) != 0) {
+            throw Lett::RuntimeError("cannot create a pipe");
+        }
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw Lett::RuntimeError("cannot fork");
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            Sample sample;
+            std::memset(&sample, 0, sizeof(sample));
+            try {
+                measure(program.path, repeat, sample);
+            } catch (const std::exception &e) {
+                std::snprintf(sample.error, sizeof(sample.error), "%s", e.what());
+            }
+            const char *p = reinterpret_cast<const char *>(&sample);
+            std::size_t left = sizeof(sample);
+            while (left > 0) {
+                ssize_t n = write(fds[1], p, left);
+                if (n <= 0) {
+                    _exit(1);
+                }
+                p += n;
+                left -= static_cast<std::size_t>(n);
+            }
+            _exit(0);
+        }
+
+        close(fds[1]);
+        char *p = reinterpret_cast<char *>(&result.sample);
+        std::size_t got = 0;
+        while (got < sizeof(result.sample)) {
+            ssize_t n = read(fds[0], p + got, sizeof(result.sample) - got);
+            if (n <= 0) {
+                break;
+            }
+            got += static_cast<std::size_t>(n);
+        }
+        close(fds[0]);
+        int status = 0;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        result.peak_rss = static_cast<std::uint64_t>(usage.ru_maxrss);
+        if (got != sizeof(result.sample) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::snprintf(result.sample.error, sizeof(result.sample.error), "benchmark process terminated abnormally");
+        }
+        return result;
+    }
+
+    // 按规模生成的程序，分别侧重于编译、解释执行、调用、字符串和垃圾回收、数组
+    std::map<std::string, std::string> syntheticPrograms(int scale) {
+        std::map<std::string, std::string> programs;
+
+        std::ostringstream functions;
+        functions << "import sys;\n\n";
+        int count = 200 * scale;
+        for (int i = 0; i < count; ++i) {
+            functions << "fn f" << i << "(a:int, b:int):int {\n"
+                      << "    var x:int = a * " << (i % 17 + 1) << " + b;\n"
+                      << "    for (var j:int = 0; j < 3; j++) {\n"
+                      << "        if (x % 2 == 0) { x = x / 2; } else { x = x * 3 + 1; }\n"
+                      << "    }\n"
+                      << "    var y:float64 = float64(x) * 0.5 + " << i << ".25;\n"
+                      << "    return x - b + int(y);\n"
+                      << "}\n\n";
+        }
+        functions << "fn main() {\n    var sum:int = 0;\n";
+        for (int i = 0; i < count; ++i) {
+            functions << "    sum += f" << i << "(" << i << ", " << (i * 7 % 13) << ");\n";
+        }
+        functions << "    sys.println(sum);\n}\n";
+        programs["functions"] = functions.str();
+
+        std::ostringstream loops;
+        loops << "import sys;\n\n"
+              << "fn main() {\n"
+              << "    var s:int = 0;\n"
+              << "    var x:float64 = 0.0;\n"
+              << "    for (var i:int = 0; i < " << 300000 * scale << "; i++) {\n"
+              << "        if (i % 7 == 3) { s -= i / 3; } else { s += i << 2 >> 1; }\n"
+              << "        x = x * 0.999 + 0.5;\n"
+              << "    }\n"
+              << "    sys.println(s);\n"
+              << "    sys.println(x);\n"
+              << "}\n";
+        programs["loops"] = loops.str();
+
+        std::ostringstream calls;
+        calls << "import sys;\n\n"
+              << "fn fib(n:int):int {\n"
+              << "    if (n < 2) { return n; }\n"
+              << "    return fib(n - 1) + fib(n - 2);\n"
+              << "}\n\n"
+              << "fn main() {\n"
+              << "    var s:int = 0;\n"
+              << "    for (var i:int = 0; i < " << 4 * scale << "; i++) { s += fib(20); }\n"
+              << "    sys.println(s);\n"
+              << "}\n";
+        programs["calls"] = calls.str();
+
+        std::ostringstream strings;
+        strings << "import sys;\n\n"
+                << "fn main() {\n"
+                << "    var line:string = \"\";\n"
+                << "    var lines:int = 0;\n"
+                << "    for (var i:int = 0; i < " << 50000 * scale << "; i++) {\n"
+                << "        line = line + \"ab\";\n"
+                << "        if (i % 100 == 99) {\n"
+                << "            if (line == line + \"\") { lines++; }\n"
+                << "            line = \"\";\n"
+                << "        }\n"
+                << "    }\n"
+                << "    sys.println(lines);\n"
+                << "}\n";
+        programs["strings"] = strings.str();
+
+        std::ostringstream arrays;
+        arrays << "import sys;\n"
+               << "import array;\n\n"
+               << "fn main() {\n"
+               << "    var n:int = " << 200000 * scale << ";\n"
+               << "    var v:float64[] = float64[n];\n"
+               << "    var k:int32[] = int32[n];\n"
+               << "    for (var i:int = 0; i < n; i++) {\n"
+               << "        v[i] = float64(i % 10);\n"
+               << "        k[i] = int32((i * 7919) % 1000);\n"
+               << "    }\n"
+               << "    var mean:float64 = array.sum(v) / float64(n);\n"
+               << "    var d:float64[] = array.offset(v, -mean);\n"
+               << "    array.sort(k);\n"
+               << "    sys.println(array.dot(d, d) / float64(n));\n"
+               << "    sys.println(k[n - 1]);\n"
+               << "}\n";
+        programs["arrays"] = arrays.str();
+
+        return programs;
+    }
+
+    void writeReport(std::ostream &out, int scale, const std::vector<Result> &results) {
+        out << "{\n  \"version\": 1,\n  \"scale\": " << scale << ",\n  \"benchmarks\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result &result = results[i];
+            const Sample &sample = result.sample;
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name << "\", "
+                << "\"source_bytes\": " << sample.source_bytes << ", \"phases_ns\": {";
+            for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+                out << (p == 0 ? "" : ", ") << "\"" << PHASE_NAMES[p] << "\": " << sample.phases[p];
+            }
+            out << "}, \"total_ns\": " << sample.total
+                << ", \"instructions\": " << sample.instructions
+                << ", \"heap_bytes\": " << sample.heap_bytes
+                << ", \"peak_rss_kb\": " << result.peak_rss << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // 只支持本程序输出的JSON：对象、数组、字符串（不含转义）和非负整数
+    class JsonValue {
+    public:
+        enum Kind { NUMBER, STRING, ARRAY, OBJECT };
+        Kind kind = NUMBER;
+        std::uint64_t number = 0;
+        std::string string;
+        std::vector<JsonValue> elements;
+        std::map<std::string, JsonValue> members;
+
+        const JsonValue *get(const std::string &key) const {
+            auto it = members.find(key);
+            return it == members.end() ? nullptr : &it->second;
+        }
+        std::uint64_t numberOf(const std::string &key) const {
+            const JsonValue *value = get(key);
+            return value == nullptr ? 0 : value->number;
+        }
+
+        static JsonValue parse(const std::string &text, const std::string &path) {
+            std::size_t pos = 0;
+            JsonValue value = _parse(text, pos, path);
+            _skip(text, pos);
+            if (pos != text.size()) {
+                throw Lett::InvalidArgument(path, "unexpected characters after the JSON value");
+            }
+            return value;
+        }
+    private:
+        static void _skip(const std::string &text, std::size_t &pos) {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+                ++pos;
+            }
+        }
+        static void _expect(const std::string &text, std::size_t &pos, char c, const std::string &path) {
+            _skip(text, pos);
+            if (pos >= text.size() || text[pos] != c) {
+                throw Lett::InvalidArgument(path, std::string("expected '") + c + "' at offset " + std::to_string(pos));
+            }
+            ++pos;
+        }
+        static std::string _string(const std::string &text, std::size_t &pos, const std::string &path) {
+            _expect(text, pos, '"', path);
+            std::size_t end = text.find('"', pos);
+            if (end == std::string::npos) {
+                throw Lett::InvalidArgument(path, "unterminated string");
+            }
+            std::string s = text.substr(pos, end - pos);
+            pos = end + 1;
+            return s;
+        }
+        static JsonValue _parse(const std::string &text, std::size_t &pos, const std::string &path) {
+            JsonValue value;
+            _skip(text, pos);
+            if (pos >= text.size()) {
+                throw Lett::InvalidArgument(path, "unexpected end of the JSON text");
+            }
+            char c = text[pos];
+            if (c == '{') {
+                value.kind = OBJECT;
+                ++pos;
+                _skip(text, pos);
+                if (pos < text.size() && text[pos] == '}') {
+                    ++pos;
+                    return value;
+                }
+                do {
+                    std::string key = _string(text, pos, path);
+                    _expect(text, pos, ':', path);
+                    value.members[key] = _parse(text, pos, path);
+                    _skip(text, pos);
+                } while (pos < text.size() && text[pos] == ',' && ++pos);
+                _expect(text, pos, '}', path);
+            } else if (c == '[') {
+                value.kind = ARRAY;
+                ++pos;
+                _skip(text, pos);
+                if (pos < text.size() && text[pos] == ']') {
+                    ++pos;
+                    return value;
+                }
+                do {
+                    value.elements.push_back(_parse(text, pos, path));
+                    _skip(text, pos);
+                } while (pos < text.size() && text[pos] == ',' && ++pos);
+                _expect(text, pos, ']', path);
+            } else if (c == '"') {
+                value.kind = STRING;
+                value.string = _string(text, pos, path);
+            } else if (std::isdigit(static_cast<unsigned char>(c))) {
+                value.kind = NUMBER;
+                while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                    value.number = value.number * 10 + static_cast<std::uint64_t>(text[pos++] - '0');
+                }
+            } else {
+                throw Lett::InvalidArgument(path, "unexpected character at offset " + std::to_string(pos));
+            }
+            return value;
+        }
+    };
+
+    double change(std::uint64_t current, std::uint64_t base) {
+        return base == 0 ? 0.0 : 100.0 * (static_cast<double>(current) / static_cast<double>(base) - 1.0);
+    }
+
+    // 与基线比较，返回退化的项数。
+    // 耗时和峰值内存受机器和负载的影响，按tolerance比较；指令数和分配的字节数是确定的，按count_tolerance比较，
+    // 明显减少时提示更新基线。counts_only为真时只比较指令数和分配的字节数，结果与机器和构建类型无关。
+    // filtered为真时不要求基线中的每个程序都被测量
+    int compare(const std::vector<Result> &results, int scale, const JsonValue &baseline,
+                double tolerance, double count_tolerance, bool counts_only, bool filtered) {
+        if (baseline.numberOf("scale") != static_cast<std::uint64_t>(scale)) {
+            std::fprintf(stderr, "baseline was recorded with --scale %llu\n",
+                         static_cast<unsigned long long>(baseline.numberOf("scale")));
+            return 1;
+        }
+        std::map<std::string, const JsonValue *> entries;
+        if (const JsonValue *benchmarks = baseline.get("benchmarks")) {
+            for (const JsonValue &entry : benchmarks->elements) {
+                if (const JsonValue *name = entry.get("name")) {
+                    entries[name->string] = &entry;
+                }
+            }
+        }
+
+        int regressions = 0;
+        auto slower = [&](const std::string &name, const char *what, std::uint64_t current, std::uint64_t base) {
+            if (!counts_only && base >= TIME_FLOOR && static_cast<double>(current) > static_cast<double>(base) * (1.0 + tolerance)) {
+                std::fprintf(stderr, "regression  %-24s %-12s %10.3f ms  baseline %10.3f ms  (%+.1f%%)\n",
+                             name.c_str(), what, static_cast<double>(current) / 1e6,
+                             static_cast<double>(base) / 1e6, change(current, base));
+                ++regressions;
+            }
+        };
+        auto counted = [&](const std::string &name, const char *what, std::uint64_t current, std::uint64_t base) {
+            double limit = static_cast<double>(base) * count_tolerance;
+            if (static_cast<double>(current) > static_cast<double>(base) + limit) {
+                std::fprintf(stderr, "regression  %-24s %-12s %14llu  baseline %14llu  (%+.1f%%)\n",
+                             name.c_str(), what, static_cast<unsigned long long>(current),
+                             static_cast<unsigned long long>(base), change(current, base));
+                ++regressions;
+            } else if (static_cast<double>(current) < static_cast<double>(base) - limit) {
+                std::fprintf(stderr, "improved    %-24s %-12s %14llu  baseline %14llu  (%+.1f%%), update the baseline\n",
+                             name.c_str(), what, static_cast<unsigned long long>(current),
+                             static_cast<unsigned long long>(base), change(current, base));
+            }
+        };
+
+        for (const Result &result : results) {
+            auto it = entries.find(result.name);
+            if (it == entries.end()) {
+                std::fprintf(stderr, "new         %-24s not in the baseline\n", result.name.c_str());
+                continue;
+            }
+            const JsonValue &entry = *it->second;
+            entries.erase(it);
+            if (const JsonValue *phases = entry.get("phases_ns")) {
+                for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+                    slower(result.name, PHASE_NAMES[p], result.sample.phases[p], phases->numberOf(PHASE_NAMES[p]));
+                }
+            }
+            slower(result.name, "total", result.sample.total, entry.numberOf("total_ns"));
+            counted(result.name, "instructions", result.sample.instructions, entry.numberOf("instructions"));
+            counted(result.name, "heap_bytes", result.sample.heap_bytes, entry.numberOf("heap_bytes"));
+            std::uint64_t base_rss = entry.numberOf("peak_rss_kb");
+            if (!counts_only && result.peak_rss > base_rss + MEMORY_FLOOR &&
+                static_cast<double>(result.peak_rss) > static_cast<double>(base_rss) * (1.0 + tolerance)) {
+                std::fprintf(stderr, "regression  %-24s %-12s %10llu KB  baseline %10llu KB  (%+.1f%%)\n",
+                             result.name.c_str(), "peak_rss", static_cast<unsigned long long>(result.peak_rss),
+                             static_cast<unsigned long long>(base_rss), change(result.peak_rss, base_rss));
+                ++regressions;
+            }
+        }
+        if (!filtered) {
+            for (const auto &entry : entries) {
+                std::fprintf(stderr, "missing     %-24s in the baseline but not measured\n", entry.first.c_str());
+                ++regressions;
+            }
+        }
+        return regressions;
+    }
+
+    double toDouble(const std::string &option, const std::string &value) {
+        char *end = nullptr;
+        double d = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || d < 0) {
+            throw Lett::InvalidOption(option, "requires a non-negative number.\n");
+        }
+        return d;
+    }
+
+    int toInt(const std::string &option, const std::string &value) {
+        char *end = nullptr;
+        long n = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || n <= 0 || n > 1000) {
+            throw Lett::InvalidOption(option, "requires a positive integer.\n");
+        }
+        return static_cast<int>(n);
+    }
+
+}   // namespace
+
+int main(int argc, char *argv[]) {
+    Lett::ArgumentParser parser("lett_benchmark");
+    parser.addOption("output", "o", "Write the JSON report to the file instead of stdout", true, "<file>");
+    parser.addOption("baseline", "b", "Compare with a baseline report, exit with 1 on regressions", true, "<file>");
+    parser.addOption("tolerance", "t", "Allowed slowdown of times and peak memory, 1.0 means 2x (default 1.0)", true, "<x>");
+    parser.addOption("count-tolerance", "c", "Allowed change of instruction and allocation counts (default 0.02)", true, "<x>");
+    parser.addOption("counts-only", "n", "Compare only the instruction and allocation counts with the baseline");
+    parser.addOption("repeat", "r", "Run each program n times and keep the fastest (default 3)", true, "<n>");
+    parser.addOption("scale", "s", "Size of the generated programs (default 1)", true, "<n>");
+    parser.addOption("filter", "f", "Only run benchmarks whose name contains the text", true, "<text>");
+    parser.addOption("samples", "d", "Directory of the sample programs", true, "<dir>");
+
+    std::filesystem::path work;
+    try {
+        parser.parse(argc, argv);
+        int repeat = parser.givend("repeat") ? toInt("--repeat", parser.getValue("repeat")) : 3;
+        int scale = parser.givend("scale") ? toInt("--scale", parser.getValue("scale")) : 1;
+        double tolerance = parser.givend("tolerance") ? toDouble("--tolerance", parser.getValue("tolerance")) : 1.0;
+        double count_tolerance = parser.givend("count-tolerance")
+            ? toDouble("--count-tolerance", parser.getValue("count-tolerance")) : 0.02;
+        std::string filter = parser.givend("filter") ? parser.getValue("filter") : "";
+        std::string samples = parser.givend("samples") ? parser.getValue("samples") : LETT_SAMPLES_DIR;
+
+        std::vector<Program> programs;
+        for (const auto &entry : std::filesystem::directory_iterator(samples)) {
+            if (entry.path().extension() == ".let") {
+                programs.push_back({"samples/" + entry.path().stem().string(), entry.path().string()});
+            }
+        }
+        std::sort(programs.begin(), programs.end(), [](const Program &a, const Program &b) {
+            return a.name < b.name;
+        });
+        work = std::filesystem::temp_directory_path() / ("lett_benchmark." + std::to_string(getpid()));
+        std::filesystem::create_directories(work);
+        for (const auto &synthetic : syntheticPrograms(scale)) {
+            std::filesystem::path path = work / (synthetic.first + ".let");
+            std::ofstream(path, std::ios::binary) << synthetic.second;
+            programs.push_back({"synthetic/" + synthetic.first, path.string()});
+        }
+
+        std::vector<Result> results;
+        bool failed = false;
+        for (const Program &program : programs) {
+            if (program.name.find(filter) == std::string::npos) {
+                continue;
+            }
+            Result result = measureInChild(program, repeat);
+            if (result.sample.error[0] != '\0') {
+                std::fprintf(stderr, "%s: %s\n", program.name.c_str(), result.sample.error);
+                failed = true;
+                continue;
+            }
+            std::fprintf(stderr, "%-24s %10.3f ms %14llu instructions %8llu KB\n", result.name.c_str(),
+                         static_cast<double>(result.sample.total) / 1e6,
+                         static_cast<unsigned long long>(result.sample.instructions),
+                         static_cast<unsigned long long>(result.peak_rss));
+            results.push_back(result);
+        }
+        std::filesystem::remove_all(work);
+        work.clear();
+
+        if (parser.givend("output")) {
+            std::ofstream out(parser.getValue("output"));
+            if (!out) {
+                throw Lett::FileNotExsit(parser.getValue("output"));
+            }
+            writeReport(out, scale, results);
+        } else {
+            writeReport(std::cout, scale, results);
+        }
+
+        if (parser.givend("baseline")) {
+            std::string path = parser.getValue("baseline");
+            JsonValue baseline = JsonValue::parse(readFile(path), path);
+            int regressions = compare(results, scale, baseline, tolerance, count_tolerance,
+                                      parser.givend("counts-only"), !filter.empty());
+            if (regressions != 0) {
+                std::fprintf(stderr, "%d regression(s) against %s\n", regressions, path.c_str());
+                failed = true;
+            }
+        }
+        return failed ? 1 : 0;
+    } catch (const std::exception &e) {
+        if (!work.empty()) {
+            std::error_code ignored;
+            std::filesystem::remove_all(work, ignored);
+        }
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,328 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "natives.h"
+#include "reader.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "type_checker.h"
+#include "constant_folder.h"
+#include "code_generator.h"
+#include "peephole.h"
+
+using namespace Lett;
+
+class CodegenTest : public ::testing::Test {
+protected:
+    std::vector<Token> _tokens;
+    std::unique_ptr<Module> _module;
+    BytecodeModule _code;
+
+    void SetUp() override {
+        // 每个测试用例执行前的设置
+    }
+
+    void TearDown() override {
+        // 每个测试用例执行后的清理
+    }
+
+    // 辅助函数：完成语义分析与常量折叠后生成字节码，返回是否成功
+    bool generate(const std::string &source, CodeGenerator &generator) {
+        StringReader reader(source);
+        LexicalAnalyzer& analyzer = LexicalAnalyzer::getInstance(&reader);
+        analyzer.analyze();
+        _tokens = analyzer.getTokens();
+        Parser parser(_tokens);
+        _module = parser.parse();
+        EXPECT_FALSE(parser.hasErrors());
+        Resolver resolver;
+        EXPECT_TRUE(resolver.resolve(*_module));
+        TypeChecker checker;
+        EXPECT_TRUE(checker.check(*_module));
+        ConstantFolder folder;
+        folder.run(*_module);
+        return generator.generate(*_module, _code);
+    }
+
+    bool generate(const std::string &source) {
+        CodeGenerator generator;
+        return generate(source, generator);
+    }
+
+    static bool has(const FunctionCode &fn, Instruction ins) {
+        return std::find(fn.code.begin(), fn.code.end(), ins) != fn.code.end();
+    }
+};
+
+// 测试寄存器分配：参数和局部变量使用固定的寄存器，临时值分配在其上
+TEST_F(CodegenTest, Registers) {
+    ASSERT_TRUE(generate(
+        "fn add(a:int, b:int):int { return a + b; }\n"
+        "fn main() { var x:int = add(1, 2); }\n"));
+    ASSERT_EQ(_code.functions.size(), 2);
+    const FunctionCode &add = _code.functions[0];
+    EXPECT_EQ(add.name, "add");
+    EXPECT_EQ(add.param_count, 2);
+    EXPECT_EQ(add.register_count, 3);
+    std::vector<Instruction> expected = {
+        encodeABC(Opcode::ADD_I64, 2, 0, 1),
+        encodeABC(Opcode::RET, 2, 0, 0),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    };
+    EXPECT_EQ(add.code, expected);
+
+    // 参数求值到连续的临时寄存器，被调用者的栈帧从第一个参数开始
+    const FunctionCode &main = _code.functions[1];
+    expected = {
+        encodeAsBx(Opcode::LOADI, 1, 1),
+        encodeAsBx(Opcode::LOADI, 2, 2),
+        encodeABx(Opcode::CALL, 1, 0),
+        encodeABC(Opcode::MOVE, 0, 1, 0),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    };
+    EXPECT_EQ(main.code, expected);
+    ASSERT_EQ(_code.calls.size(), 1);
+    EXPECT_EQ(_code.calls[0].module, 0);
+    EXPECT_EQ(_code.calls[0].function, 0);
+    EXPECT_EQ(_code.calls[0].arity, 2);
+}
+
+// 测试按类型选择指令：窄整数截断、无符号运算、浮点数与字符串
+TEST_F(CodegenTest, TypedInstructions) {
+    ASSERT_TRUE(generate(
+        "fn f(a:int8, b:uint8, c:uint32, d:float32, s:string) {\n"
+        "    a = a * a;\n"
+        "    b = b + 200;\n"
+        "    c = c / c;\n"
+        "    d = d * d;\n"
+        "    s = s + s;\n"
+        "    var lt:bool = c > c;\n"
+        "}\n"));
+    const FunctionCode &fn = _code.functions[0];
+    EXPECT_TRUE(has(fn, encodeABC(Opcode::TRUNC_I, 0, 0, 8)));
+    EXPECT_TRUE(has(fn, encodeABC(Opcode::TRUNC_U, 1, 1, 8)));
+    EXPECT_TRUE(has(fn, encodeABC(Opcode::DIV_U64, 2, 2, 2)));
+    EXPECT_TRUE(has(fn, encodeABC(Opcode::F64_TO_F32, 3, 3, 0)));
+    EXPECT_TRUE(has(fn, encodeABC(Opcode::CONCAT, 4, 4, 4)));
+    EXPECT_TRUE(has(fn, encodeABC(Opcode::LT_U64, 5, 2, 2)));
+    // 不超过8位的常量直接作为ADDI_I64的操作数
+    ASSERT_TRUE(generate("fn f(i:int) { i += 1; i--; i = i + 1000; }\n"));
+    EXPECT_TRUE(has(_code.functions[0], encodeABC(Opcode::ADDI_I64, 0, 0, 1)));
+    EXPECT_TRUE(has(_code.functions[0], encodeABC(Opcode::ADDI_I64, 0, 0, 0xFF)));
+    EXPECT_TRUE(has(_code.functions[0], encodeAsBx(Opcode::LOADI, 1, 1000)));
+}
+
+// 测试跳转：所有跳转目标都在函数内，break和continue跳到正确的位置
+TEST_F(CodegenTest, ControlFlow) {
+    ASSERT_TRUE(generate(
+        "fn f(n:int):int {\n"
+        "    var s:int = 0;\n"
+        "    for (var i:int = 0; i < n; i++) {\n"
+        "        if (i == 3) { continue; } elif (i > 8) { break; }\n"
+        "        s += i;\n"
+        "    }\n"
+        "    while (true) { do { s--; } while (s > 100); break; }\n"
+        "    return s;\n"
+        "}\n"));
+    const FunctionCode &fn = _code.functions[0];
+    std::size_t jumps = 0;
+    for (std::size_t pc = 0; pc < fn.code.size(); ++pc) {
+        Opcode op = opOf(fn.code[pc]);
+        if (op == Opcode::JMP || op == Opcode::JMPT || op == Opcode::JMPF) {
+            long target = static_cast<long>(pc) + 1 + argSBx(fn.code[pc]);
+            EXPECT_GE(target, 0);
+            EXPECT_LT(target, static_cast<long>(fn.code.size()));
+            jumps++;
+        }
+    }
+    EXPECT_GE(jumps, 8);
+    EXPECT_EQ(opOf(fn.code.back()), Opcode::RET0);
+}
+
+// 测试尾调用：return f(...)生成TAILCALL，其后不需要RET
+TEST_F(CodegenTest, TailCall) {
+    ASSERT_TRUE(generate(
+        "fn f(n:int, acc:int):int { if (n == 0) { return acc; } return f(n - 1, acc + n); }\n"
+        "fn g(n:int):int { return f(n, 0) + 1; }\n"));
+    const FunctionCode &f = _code.functions[0];
+    std::vector<Instruction> tail = {
+        encodeABC(Opcode::ADDI_I64, 2, 0, 0xFF),
+        encodeABC(Opcode::ADD_I64, 3, 1, 0),
+        encodeABx(Opcode::TAILCALL, 2, 0),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    };
+    ASSERT_GE(f.code.size(), tail.size());
+    EXPECT_EQ(std::vector<Instruction>(f.code.end() - tail.size(), f.code.end()), tail);
+    // 调用的结果还要参与运算时不是尾调用
+    const FunctionCode &g = _code.functions[1];
+    EXPECT_FALSE(std::any_of(g.code.begin(), g.code.end(), [](Instruction ins) {
+        return opOf(ins) == Opcode::TAILCALL;
+    }));
+    EXPECT_EQ(_code.calls.size(), 1);
+}
+
+// 测试栈映射：在CONCAT和非尾调用处记录保存字符串的寄存器
+TEST_F(CodegenTest, StackMaps) {
+    ASSERT_TRUE(generate(
+        "fn f(s:string, n:int):string { var t:string = s + \"!\"; g(n); return t + s; }\n"
+        "fn g(n:int):int { return n; }\n"));
+    const FunctionCode &f = _code.functions[0];
+    std::vector<Instruction> expected = {
+        encodeABx(Opcode::LOADS, 3, 0),
+        encodeABC(Opcode::CONCAT, 2, 0, 3),
+        encodeABC(Opcode::MOVE, 3, 1, 0),
+        encodeABx(Opcode::CALL, 3, 0),
+        encodeABC(Opcode::CONCAT, 3, 2, 0),
+        encodeABC(Opcode::RET, 3, 0, 0),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    };
+    EXPECT_EQ(f.code, expected);
+    ASSERT_EQ(stackMapWords(f.register_count), 2);
+    // 每项为指令的下标和寄存器的位图，CONCAT的结果寄存器和调用的参数不在其中
+    std::vector<qword> maps = {1, 0x9, 3, 0x5, 4, 0x5};
+    EXPECT_EQ(f.stack_maps, maps);
+    EXPECT_TRUE(_code.functions[1].stack_maps.empty());
+}
+
+// 测试行号表：每条语句的指令对应其所在的行，循环末尾的跳转对应循环语句所在的行
+TEST_F(CodegenTest, Lines) {
+    ASSERT_TRUE(generate(
+        "fn f(n:int):int {\n"
+        "    var s:int = 0;\n"
+        "    while (s < n) {\n"
+        "        s += 2;\n"
+        "    }\n"
+        "    return s;\n"
+        "}\n"));
+    const FunctionCode &f = _code.functions[0];
+    ASSERT_EQ(f.code.size(), 7);
+    // LOADI; LT_I64; JMPF; ADDI_I64; JMP; RET; RET0
+    std::vector<std::pair<dword, dword>> lines;
+    for (const LineEntry &entry : f.lines) {
+        lines.emplace_back(entry.pc, entry.line);
+    }
+    std::vector<std::pair<dword, dword>> expected = {{0, 2}, {1, 3}, {3, 4}, {4, 3}, {5, 6}};
+    EXPECT_EQ(lines, expected);
+}
+
+// 测试内置函数的调用：每个参数之后是其类型标记
+TEST_F(CodegenTest, NativeCall) {
+    ASSERT_TRUE(generate("import sys;\nfn main() { sys.println(\"hi\"); sys.print(2.5); }\n"));
+    const FunctionCode &fn = _code.functions[0];
+    ASSERT_EQ(_code.strings.size(), 1);
+    EXPECT_EQ(_code.strings[0], "hi");
+    std::vector<Instruction> expected = {
+        encodeABx(Opcode::LOADS, 0, 0),
+        encodeAsBx(Opcode::LOADI, 1, TAG_STRING),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN),
+        encodeABx(Opcode::LOADK, 0, 0),
+        encodeAsBx(Opcode::LOADI, 1, TAG_FLOAT64),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINT),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    };
+    EXPECT_EQ(fn.code, expected);
+    ASSERT_EQ(_code.constants.size(), 1);
+    double value;
+    std::memcpy(&value, &_code.constants[0], sizeof(value));
+    EXPECT_DOUBLE_EQ(value, 2.5);
+}
+
+// 测试纤程的创建与等待：SPAWN与CALL的操作数相同，返回字符串的函数使用SPAWN_STR
+TEST_F(CodegenTest, SpawnAwait) {
+    ASSERT_TRUE(generate(
+        "fn f(a:int):int { return a; }\n"
+        "fn g():string { return \"s\"; }\n"
+        "fn main() { var t = spawn f(1); var u = spawn g(); var x = await t; }\n"));
+    const FunctionCode &fn = _code.functions[2];
+    std::vector<Instruction> expected = {
+        encodeAsBx(Opcode::LOADI, 3, 1),
+        encodeABx(Opcode::SPAWN, 3, 0),
+        encodeABC(Opcode::MOVE, 0, 3, 0),
+        encodeABx(Opcode::SPAWN_STR, 3, 1),
+        encodeABC(Opcode::MOVE, 1, 3, 0),
+        encodeABC(Opcode::AWAIT, 2, 0, 0),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    };
+    EXPECT_EQ(fn.code, expected);
+    EXPECT_EQ(_code.calls.size(), 2);
+}
+
+// 测试寄存器不足的错误
+TEST_F(CodegenTest, TooManyRegisters) {
+    std::string source = "fn main() {\n";
+    for (int i = 0; i < 300; ++i) {
+        source += "    var v" + std::to_string(i) + ":int = " + std::to_string(i) + ";\n";
+    }
+    source += "}\n";
+    CodeGenerator generator;
+    EXPECT_FALSE(generate(source, generator));
+    ASSERT_EQ(generator.getErrors().size(), 1);
+    EXPECT_NE(std::string(generator.getErrors()[0].what()).find("too many local variables"), std::string::npos);
+}
+
+// 测试字节码的序列化
+TEST_F(CodegenTest, Serialize) {
+    ASSERT_TRUE(generate("import sys;\nfn f(x:int):int { return x * 100000; }\nfn main() { sys.println(f(2)); }\n"));
+    std::string data = _code.serialize();
+    BytecodeModule loaded;
+    ASSERT_TRUE(BytecodeModule::deserialize(data, loaded));
+    ASSERT_EQ(loaded.functions.size(), 2);
+    EXPECT_EQ(loaded.functions[1].code, _code.functions[1].code);
+    EXPECT_EQ(loaded.constants, _code.constants);
+    EXPECT_EQ(loaded.calls.size(), 1);
+    EXPECT_EQ(loaded.serialize(), data);
+    for (std::size_t size = 0; size < data.size(); ++size) {
+        EXPECT_FALSE(BytecodeModule::deserialize(std::string_view(data).substr(0, size), loaded));
+    }
+    // 其他主版本的编译器写入的缓存中指令和内置函数的编号可能不同
+    std::string other = data;
+    other[4] = static_cast<char>(LTC_VERSION_MAJOR - 1);
+    EXPECT_FALSE(BytecodeModule::deserialize(other, loaded));
+}
+
+// 测试超级指令的融合：只替换序列第一条指令的操作码
+TEST_F(CodegenTest, Superinstructions) {
+    ASSERT_TRUE(generate(
+        "fn f(n:int):int {\n"
+        "    var s:int = 0;\n"
+        "    var i:int = 0;\n"
+        "    while (i < 100) { s += i; i++; }\n"
+        "    if (s == n) { return s + n; }\n"
+        "    return 0;\n"
+        "}\n"));
+    std::vector<Instruction> code = _code.functions[0].code;
+    std::size_t count = fuseSuperinstructions(code);
+    ASSERT_EQ(code.size(), _code.functions[0].code.size());
+    std::vector<Opcode> fused;
+    for (std::size_t pc = 0; pc < code.size(); ++pc) {
+        if (code[pc] != _code.functions[0].code[pc]) {
+            // 操作数不变
+            EXPECT_EQ(code[pc] >> 8, _code.functions[0].code[pc] >> 8);
+            fused.push_back(opOf(code[pc]));
+        }
+    }
+    EXPECT_EQ(fused.size(), count);
+    std::vector<Opcode> expected = {
+        Opcode::LOADI_LT_I64_JMPF, Opcode::LT_I64_JMPF, Opcode::ADDI_I64_JMP,
+        Opcode::EQ_JMPF, Opcode::ADD_I64_RET,
+    };
+    EXPECT_EQ(fused, expected);
+
+    // 寄存器不满足要求时不融合
+    code = {
+        encodeABC(Opcode::LT_I64, 2, 0, 1),
+        encodeAsBx(Opcode::JMPF, 3, 1),
+        encodeAsBx(Opcode::LOADI, 4, 10),
+        encodeABC(Opcode::LE_I64, 2, 0, 1),
+        encodeAsBx(Opcode::JMPF, 2, -5),
+    };
+    EXPECT_EQ(fuseSuperinstructions(code), 1);
+    EXPECT_EQ(opOf(code[3]), Opcode::LE_I64_JMPF);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
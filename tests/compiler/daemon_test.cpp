@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "exception.h"
+#include "protocol.h"
+#include "compile_server.h"
+
+using namespace Lett;
+
+class DaemonTest : public ::testing::Test {
+protected:
+    std::string _socket;
+
+    void SetUp() override {
+        const ::testing::TestInfo *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        _socket = (std::filesystem::temp_directory_path()
+            / (std::string("lett_daemon_test_") + info->name() + "_" + std::to_string(::getpid()) + ".sock")).string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(_socket);
+    }
+
+    // 辅助函数：把参数原样写回，退出码为参数的个数
+    static int echo(const CompileRequest &request, std::ostream &out, std::ostream &err) {
+        out << request.cwd;
+        for (const std::string &arg : request.args) {
+            out << "|" << arg;
+        }
+        err << "warning";
+        return static_cast<int>(request.args.size());
+    }
+};
+
+// 测试请求和响应的编码
+TEST_F(DaemonTest, Messages) {
+    CompileRequest request;
+    request.cwd = "/work";
+    request.args = {"-f", "app.let", "", "-s", std::string("a\0b", 3)};
+    CompileRequest decoded;
+    ASSERT_TRUE(decodeRequest(encodeRequest(request), decoded));
+    EXPECT_EQ(decoded.cwd, request.cwd);
+    EXPECT_EQ(decoded.args, request.args);
+
+    std::string data = encodeRequest(request);
+    EXPECT_FALSE(decodeRequest(data.substr(0, data.size() - 1), decoded));
+    data[0] = 9;                                    // 版本不同
+    EXPECT_FALSE(decodeRequest(data, decoded));
+
+    CompileResponse response;
+    response.status = -1;
+    response.out = "out";
+    response.err = "err";
+    CompileResponse back;
+    ASSERT_TRUE(decodeResponse(encodeResponse(response), back));
+    EXPECT_EQ(back.status, -1);
+    EXPECT_EQ(back.out, "out");
+    EXPECT_EQ(back.err, "err");
+}
+
+// 测试服务器：并发的请求各自得到自己的响应，stop后等待处理中的请求完成
+TEST_F(DaemonTest, Serve) {
+    CompileResponse response;
+    CompileRequest request;
+    request.cwd = "/work";
+    EXPECT_FALSE(requestCompile(_socket, request, response));       // 服务器尚未启动
+
+    CompileServer server(_socket, echo);
+    server.listen();
+    CompileServer second(_socket, echo);
+    EXPECT_THROW(second.listen(), RuntimeError);
+    std::thread serving([&server]() { server.serve(); });
+
+    std::atomic<int> matched(0);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 8; ++i) {
+        clients.emplace_back([this, i, &matched]() {
+            CompileRequest request;
+            request.cwd = "/dir" + std::to_string(i);
+            request.args.assign(static_cast<std::size_t>(i), "x");
+            CompileResponse response;
+            std::string expected = request.cwd;
+            for (int j = 0; j < i; ++j) {
+                expected += "|x";
+            }
+            if (requestCompile(_socket, request, response) && response.status == i
+                && response.out == expected && response.err == "warning") {
+                matched++;
+            }
+        });
+    }
+    for (std::thread &client : clients) {
+        client.join();
+    }
+    EXPECT_EQ(matched.load(), 8);
+
+    server.stop();
+    serving.join();
+    EXPECT_EQ(server.served(), 8);
+}
+
+// 测试套接字文件：只有所有者可以访问，残留的套接字被替换，路径上的其他文件不会被删除
+TEST_F(DaemonTest, SocketPath) {
+    namespace fs = std::filesystem;
+    {
+        CompileServer server(_socket, echo);
+        server.listen();
+        EXPECT_TRUE(fs::is_socket(_socket));
+        EXPECT_EQ(fs::status(_socket).permissions() & fs::perms::all, fs::perms::owner_read | fs::perms::owner_write);
+    }
+    EXPECT_FALSE(fs::exists(_socket));
+
+    // 没有正常退出的服务器留下的套接字文件被替换
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        _socket.copy(address.sun_path, sizeof(address.sun_path) - 1);
+        ASSERT_EQ(::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)), 0);
+        ::close(fd);
+        ASSERT_TRUE(fs::is_socket(_socket));
+        CompileServer server(_socket, echo);
+        EXPECT_NO_THROW(server.listen());
+    }
+    EXPECT_FALSE(fs::exists(_socket));
+
+    std::ofstream(_socket) << "precious";
+    CompileServer server(_socket, echo);
+    EXPECT_THROW(server.listen(), RuntimeError);
+    EXPECT_TRUE(fs::is_regular_file(_socket));
+    EXPECT_EQ(fs::file_size(_socket), 8u);
+}
+
+// 测试处理请求时抛出的异常作为错误输出返回给客户端
+TEST_F(DaemonTest, HandlerErrors) {
+    CompileServer server(_socket, [](const CompileRequest &, std::ostream &, std::ostream &) -> int {
+        throw FileNotExsit("missing.let");
+    });
+    server.listen();
+    std::thread serving([&server]() { server.serve(); });
+    CompileResponse response;
+    ASSERT_TRUE(requestCompile(_socket, CompileRequest(), response));
+    EXPECT_EQ(response.status, -1);
+    EXPECT_NE(response.err.find("missing.let"), std::string::npos);
+    server.stop();
+    serving.join();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "driver.h"
+#include "image.h"
+
+using namespace Lett;
+
+class DriverTest : public ::testing::Test {
+protected:
+    std::filesystem::path _dir;
+
+    void SetUp() override {
+        // 每个测试用例使用独立的临时目录
+        const ::testing::TestInfo *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        _dir = std::filesystem::temp_directory_path() / (std::string("lett_driver_test_") + info->name());
+        std::filesystem::remove_all(_dir);
+        std::filesystem::create_directories(_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(_dir);
+    }
+
+    void write(const std::string &name, const std::string &source) {
+        std::filesystem::path path = _dir / name;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << source;
+    }
+
+    // 辅助函数：编译入口文件app.let，返回是否成功
+    bool compile(Driver &driver) {
+        return driver.compileFile((_dir / "app.let").string());
+    }
+
+    DriverOptions cached() {
+        DriverOptions options;
+        options.cache_dir = (_dir / "cache").string();
+        options.jobs = 4;
+        return options;
+    }
+
+    void writeLibrary() {
+        write("util/math.let",
+            "fn square(x:int):int { return x * x; }\n"
+            "fn half(x:float):float { return x / 2; }\n");
+        write("text.let",
+            "import sys;\n"
+            "import util.math;\n"
+            "fn show(x:int) { sys.println(math.square(x)); }\n");
+        write("app.let",
+            "import text;\n"
+            "import util.math;\n"
+            "fn main() { text.show(math.square(3)); }\n");
+    }
+};
+
+// 测试依赖图的建立、拓扑序与跨模块的名字解析
+TEST_F(DriverTest, ImportGraph) {
+    writeLibrary();
+    DriverOptions options;
+    options.jobs = 4;
+    Driver driver(options);
+    ASSERT_TRUE(compile(driver)) << driver.getErrors()[0];
+
+    std::vector<const CompilationUnit *> units = driver.units();
+    ASSERT_EQ(units.size(), 3);
+    EXPECT_EQ(units[0]->name, "util.math");
+    EXPECT_EQ(units[1]->name, "text");
+    EXPECT_EQ(units[2]->name, "app");
+    EXPECT_EQ(driver.compiledCount(), 3);
+    EXPECT_EQ(units[0]->interface.functions.size(), 2);
+    EXPECT_EQ(units[1]->interface.find("show")->params[0], TYPE_INT);
+    EXPECT_EQ(driver.entry().interface.functions.size(), 0);   // main不导出
+
+    const Expr *call = driver.entry().module->functions[0]->body->stmts[0]->as<ExprStmt>()->expr;
+    const MemberExpr *show = call->as<CallExpr>()->callee->as<MemberExpr>();
+    EXPECT_EQ(show->binding, SymbolKind::FUNCTION);
+    EXPECT_EQ(show->slot, 0);
+    const MemberExpr *square = call->as<CallExpr>()->args[0]->as<CallExpr>()->callee->as<MemberExpr>();
+    EXPECT_EQ(square->binding, SymbolKind::FUNCTION);
+    EXPECT_EQ(square->type, driver.entry().module->types.function(TYPE_INT, {TYPE_INT}));
+}
+
+// 测试接口缓存：未修改的模块不重新编译，接口变化时重新编译导入它的模块
+TEST_F(DriverTest, InterfaceCache) {
+    writeLibrary();
+    {
+        Driver driver(cached());
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.compiledCount(), 3);
+        EXPECT_EQ(driver.cacheHits(), 0);
+    }
+    {
+        Driver driver(cached());
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.compiledCount(), 1);       // 只编译入口模块
+        EXPECT_EQ(driver.cacheHits(), 2);
+        EXPECT_EQ(driver.units()[1]->module, nullptr);
+        EXPECT_TRUE(driver.units()[1]->cached);
+    }
+    // 只修改函数体，被导入的util.math仍然命中缓存
+    write("text.let",
+        "import sys;\n"
+        "import util.math;\n"
+        "fn show(x:int) { sys.print(math.square(x)); }\n");
+    {
+        Driver driver(cached());
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.compiledCount(), 2);
+        EXPECT_EQ(driver.cacheHits(), 1);
+    }
+    // util.math的接口变化后，源代码未变的text也需要重新编译
+    write("util/math.let",
+        "fn cube(x:int):int { return x * x * x; }\n"
+        "fn square(x:int):int { return x * x; }\n");
+    {
+        Driver driver(cached());
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.compiledCount(), 3);
+        EXPECT_EQ(driver.cacheHits(), 0);
+        EXPECT_EQ(driver.units()[0]->interface.find("square")->index, 1);
+    }
+}
+
+// 测试内存中的模块缓存：多个Driver共享，命中时使用已经SSA优化的字节码，生成的字节码文件与不使用缓存时相同
+TEST_F(DriverTest, ModuleCache) {
+    writeLibrary();
+    auto image = [this](const DriverOptions &options) {
+        Driver driver(options);
+        EXPECT_TRUE(compile(driver));
+        std::string data;
+        EXPECT_TRUE(driver.link(data));
+        return data;
+    };
+    std::string expected = image(DriverOptions());
+    ModuleCache modules;
+    DriverOptions options;
+    options.modules = &modules;
+    EXPECT_EQ(image(options), expected);
+    EXPECT_EQ(modules.size(), 3);
+    EXPECT_EQ(modules.misses(), 2);
+    {
+        Driver driver(options);
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.compiledCount(), 1);
+        EXPECT_EQ(driver.cacheHits(), 2);
+        EXPECT_TRUE(driver.units()[1]->optimized);
+    }
+    EXPECT_EQ(image(options), expected);
+    EXPECT_EQ(modules.hits(), 4);
+
+    // 不进行SSA优化时使用缓存中优化之前的字节码
+    DriverOptions plain;
+    plain.ssa = false;
+    std::string unoptimized = image(plain);
+    plain.modules = &modules;
+    EXPECT_EQ(image(plain), unoptimized);
+
+    // 接口变化后重新编译，替换缓存中的结果
+    write("util/math.let",
+        "fn cube(x:int):int { return x * x * x; }\n"
+        "fn square(x:int):int { return x * x; }\n");
+    {
+        Driver driver(options);
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.compiledCount(), 3);
+        EXPECT_EQ(driver.cacheHits(), 0);
+    }
+    EXPECT_EQ(image(options), image(DriverOptions()));
+
+    // 超过容量时淘汰最久未使用的模块
+    ModuleCache small(2);
+    options.modules = &small;
+    image(options);
+    EXPECT_EQ(small.size(), 2);
+}
+
+// 测试模块接口的序列化
+TEST_F(DriverTest, InterfaceSerialize) {
+    ModuleInterface interface;
+    interface.name = "util.math";
+    interface.source_hash = 0x0123456789ABCDEFULL;
+    interface.imports = {"sys", "text"};
+    interface.dependencies = {0, 42};
+    interface.functions.push_back(ExportedFunction{"square", 3, TYPE_INT, {TYPE_INT, TYPE_FLOAT64}});
+
+    std::string data = interface.serialize();
+    ModuleInterface loaded;
+    ASSERT_TRUE(ModuleInterface::deserialize(data, loaded));
+    EXPECT_EQ(loaded.name, interface.name);
+    EXPECT_EQ(loaded.source_hash, interface.source_hash);
+    EXPECT_EQ(loaded.imports, interface.imports);
+    EXPECT_EQ(loaded.dependencies, interface.dependencies);
+    EXPECT_EQ(loaded.hash(), interface.hash());
+    EXPECT_EQ(loaded.find("square")->params[1], TYPE_FLOAT64);
+    // 不完整的数据
+    for (std::size_t size = 0; size < data.size(); ++size) {
+        EXPECT_FALSE(ModuleInterface::deserialize(std::string_view(data).substr(0, size), loaded));
+    }
+}
+
+// 测试导入的错误
+TEST_F(DriverTest, ImportErrors) {
+    write("app.let", "import a;\nfn main() { }\n");
+    write("a.let", "import b;\nfn f() { }\n");
+    write("b.let", "import a;\nfn g() { }\n");
+    {
+        Driver driver{DriverOptions()};
+        EXPECT_FALSE(compile(driver));
+        ASSERT_EQ(driver.getErrors().size(), 1);
+        EXPECT_EQ(driver.getErrors()[0], "import cycle: a -> b -> a");
+    }
+
+    write("app.let", "import missing;\nfn main() { }\n");
+    {
+        Driver driver{DriverOptions()};
+        EXPECT_FALSE(compile(driver));
+        ASSERT_EQ(driver.getErrors().size(), 1);
+        EXPECT_NE(driver.getErrors()[0].find("module 'missing' not found"), std::string::npos);
+    }
+
+    write("lib.let", "fn square(x:int):int { return x * x; }\n");
+    write("app.let", "import lib;\nfn main() { lib.square(\"x\"); lib.cube(1); }\n");
+    {
+        Driver driver{DriverOptions()};
+        EXPECT_FALSE(compile(driver));
+        ASSERT_EQ(driver.getErrors().size(), 2);
+        EXPECT_NE(driver.getErrors()[0].find("cannot convert 'string' to 'int'"), std::string::npos);
+        EXPECT_NE(driver.getErrors()[1].find("module 'lib' has no member 'cube'"), std::string::npos);
+    }
+}
+
+// 测试链接：跨模块的调用与缓存中的字节码
+TEST_F(DriverTest, Link) {
+    writeLibrary();
+    for (int round = 0; round < 2; ++round) {
+        Driver driver(cached());
+        ASSERT_TRUE(compile(driver));
+        EXPECT_EQ(driver.cacheHits(), round == 0 ? 0 : 2);
+        std::string data;
+        ASSERT_TRUE(driver.link(data));
+        Image image;
+        image.loadFromMemory(data);
+        ASSERT_EQ(image.functionCount(), 4);
+        EXPECT_EQ(image.stringView(image.function(0).name), "util.math.square");
+        EXPECT_EQ(image.stringView(image.function(2).name), "text.show");
+        EXPECT_EQ(image.stringView(image.entry().name), "main");
+    }
+
+    write("app.let", "fn start() { }\n");
+    Driver driver{DriverOptions()};
+    ASSERT_TRUE(compile(driver));
+    std::string data;
+    EXPECT_FALSE(driver.link(data));
+    ASSERT_EQ(driver.getErrors().size(), 1);
+    EXPECT_NE(driver.getErrors()[0].find("no function 'main' in entry module"), std::string::npos);
+}
+
+// 测试各阶段的耗时：各模块的耗时相加，链接之后才有链接的耗时
+TEST_F(DriverTest, PhaseTimes) {
+    writeLibrary();
+    Driver driver(cached());
+    ASSERT_TRUE(compile(driver));
+    PhaseTimes times = driver.phaseTimes();
+    EXPECT_GT(times.lex, 0u);
+    EXPECT_GT(times.parse, 0u);
+    EXPECT_GT(times.check, 0u);
+    EXPECT_GT(times.generate, 0u);
+    EXPECT_EQ(times.link, 0u);
+    std::string data;
+    ASSERT_TRUE(driver.link(data));
+    EXPECT_GT(driver.phaseTimes().link, 0u);
+    EXPECT_EQ(driver.phaseTimes().lex, times.lex);
+}
+
+// 测试流水线模式：词法分析与语法分析同时进行，生成的字节码文件和报告的错误与默认模式相同
+TEST_F(DriverTest, Pipeline) {
+    writeLibrary();
+    auto image = [this](const DriverOptions &options) {
+        Driver driver(options);
+        EXPECT_TRUE(compile(driver));
+        std::string data;
+        EXPECT_TRUE(driver.link(data));
+        return data;
+    };
+    DriverOptions pipelined;
+    pipelined.pipeline = true;
+    EXPECT_EQ(image(pipelined), image(DriverOptions()));
+
+    write("text.let",
+        "import sys;\n"
+        "fn show(x:int) { sys.println(x) }\n"
+        "fn broken( {\n}\n");
+    Driver expected{DriverOptions()};
+    EXPECT_FALSE(compile(expected));
+    Driver actual(pipelined);
+    EXPECT_FALSE(compile(actual));
+    EXPECT_FALSE(actual.getErrors().empty());
+    EXPECT_EQ(actual.getErrors(), expected.getErrors());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include "reader.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "type_checker.h"
+#include "constant_folder.h"
+#include "code_generator.h"
+#include "ssa_builder.h"
+#include "ssa_optimizer.h"
+
+using namespace Lett;
+
+class IrTest : public ::testing::Test {
+protected:
+    std::vector<Token> _tokens;
+    std::unique_ptr<Module> _module;
+    BytecodeModule _code;
+
+    void SetUp() override {
+        // 每个测试用例执行前的设置
+    }
+
+    void TearDown() override {
+        // 每个测试用例执行后的清理
+    }
+
+    // 辅助函数：完成语义分析与常量折叠后生成字节码
+    void generate(const std::string &source) {
+        StringReader reader(source);
+        LexicalAnalyzer& analyzer = LexicalAnalyzer::getInstance(&reader);
+        analyzer.analyze();
+        _tokens = analyzer.getTokens();
+        Parser parser(_tokens);
+        _module = parser.parse();
+        EXPECT_FALSE(parser.hasErrors());
+        Resolver resolver;
+        EXPECT_TRUE(resolver.resolve(*_module));
+        TypeChecker checker;
+        EXPECT_TRUE(checker.check(*_module));
+        ConstantFolder folder;
+        folder.run(*_module);
+        CodeGenerator generator;
+        EXPECT_TRUE(generator.generate(*_module, _code));
+    }
+
+    std::string dump(const IrFunction &fn) {
+        std::ostringstream oss;
+        fn.dump(oss);
+        return oss.str();
+    }
+
+    static std::size_t count(const FunctionCode &fn, Opcode op) {
+        return static_cast<std::size_t>(std::count_if(fn.code.begin(), fn.code.end(),
+                                                      [op](Instruction ins) { return opOf(ins) == op; }));
+    }
+
+    // 唯一的循环的范围：向后跳转的目标到跳转指令
+    static std::pair<std::size_t, std::size_t> loop(const FunctionCode &fn) {
+        for (std::size_t pc = 0; pc < fn.code.size(); ++pc) {
+            Instruction ins = fn.code[pc];
+            if (opOf(ins) >= Opcode::JMP && opOf(ins) <= Opcode::JMPF && argSBx(ins) < 0) {
+                return {pc + 1 + argSBx(ins), pc};
+            }
+        }
+        return {0, 0};
+    }
+
+    static std::size_t countIn(const FunctionCode &fn, std::pair<std::size_t, std::size_t> range, Opcode op) {
+        return static_cast<std::size_t>(std::count_if(fn.code.begin() + range.first, fn.code.begin() + range.second + 1,
+                                                      [op](Instruction ins) { return opOf(ins) == op; }));
+    }
+};
+
+// 测试提升为SSA形式：循环头为被改写的变量放置φ函数，未被改写的不放置
+TEST_F(IrTest, Build) {
+    generate(
+        "fn sum(n:int):int {\n"
+        "    var s:int = 0;\n"
+        "    var i:int = 0;\n"
+        "    while (i < n) { s = s + i; i++; }\n"
+        "    return s;\n"
+        "}\n");
+    SsaBuilder builder(_code);
+    IrFunction fn;
+    ASSERT_TRUE(builder.build(_code.functions[0], fn));
+    EXPECT_EQ(fn.param_count, 1);
+    std::size_t phis = static_cast<std::size_t>(
+        std::count_if(fn.insts.begin(), fn.insts.end(), [](const IrInst &inst) { return inst.kind == IrKind::PHI; }));
+    EXPECT_EQ(phis, 2);
+    std::string text = dump(fn);
+    EXPECT_NE(text.find("PARAM 0"), std::string::npos);
+    EXPECT_NE(text.find("ADDI_I64 #1"), std::string::npos);
+}
+
+// 测试复制传播与全局值编号：变量之间的复制和重复的乘法被删除
+TEST_F(IrTest, CopiesAndValueNumbering) {
+    generate(
+        "fn f(a:int, b:int):int {\n"
+        "    var x:int = a;\n"
+        "    var y:int = x * b;\n"
+        "    var z:int = a * b;\n"
+        "    return y + z;\n"
+        "}\n");
+    SsaOptimizer optimizer;
+    EXPECT_EQ(optimizer.run(_code), 1);
+    const FunctionCode &f = _code.functions[0];
+    EXPECT_EQ(count(f, Opcode::MUL_I64), 1);
+    EXPECT_EQ(count(f, Opcode::MOVE), 0);
+    EXPECT_GE(optimizer.propagatedCopies(), 1);
+    EXPECT_EQ(optimizer.numberedValues(), 1);
+}
+
+// 测试循环不变量外提：只依赖参数的乘法移到循环之前
+TEST_F(IrTest, HoistInvariants) {
+    generate(
+        "fn f(a:int, b:int, n:int):int {\n"
+        "    var s:int = 0;\n"
+        "    var i:int = 0;\n"
+        "    while (i < n) { s = s + a * b; i++; }\n"
+        "    return s;\n"
+        "}\n");
+    ASSERT_EQ(countIn(_code.functions[0], loop(_code.functions[0]), Opcode::MUL_I64), 1);
+    SsaOptimizer optimizer;
+    EXPECT_EQ(optimizer.run(_code), 1);
+    const FunctionCode &f = _code.functions[0];
+    EXPECT_EQ(count(f, Opcode::MUL_I64), 1);
+    EXPECT_EQ(countIn(f, loop(f), Opcode::MUL_I64), 0);
+    EXPECT_GE(optimizer.hoistedInsts(), 1);
+}
+
+// 测试强度削减：循环中归纳变量与常量的乘法改为每次迭代的加法
+TEST_F(IrTest, ReduceStrength) {
+    generate(
+        "fn f(n:int):int {\n"
+        "    var s:int = 0;\n"
+        "    var i:int = 0;\n"
+        "    while (i < n) { s = s + i * 3; i++; }\n"
+        "    return s;\n"
+        "}\n");
+    SsaOptimizer optimizer;
+    EXPECT_EQ(optimizer.run(_code), 1);
+    const FunctionCode &f = _code.functions[0];
+    EXPECT_EQ(countIn(f, loop(f), Opcode::MUL_I64), 0);
+    EXPECT_EQ(optimizer.reducedMuls(), 1);
+    bool stepped = std::any_of(f.code.begin(), f.code.end(), [](Instruction ins) {
+        return opOf(ins) == Opcode::ADDI_I64 && argSC(ins) == 3;
+    });
+    EXPECT_TRUE(stepped);
+}
+
+// 测试跨越调用的值：优化后仍不在调用的参数窗口中，字符串仍在栈映射中
+TEST_F(IrTest, CallsAndStackMaps) {
+    generate(
+        "import sys;\n"
+        "fn g(a:int):int { return a + 1; }\n"
+        "fn main() {\n"
+        "    var s:string = \"a\";\n"
+        "    var i:int = 0;\n"
+        "    while (i < 3) { s = s + \"b\"; sys.println(g(i)); i++; }\n"
+        "    sys.println(s);\n"
+        "}\n");
+    SsaOptimizer optimizer;
+    EXPECT_EQ(optimizer.run(_code), 2);
+    const FunctionCode &main = _code.functions[1];
+    std::size_t words = stackMapWords(main.register_count);
+    ASSERT_FALSE(main.stack_maps.empty());
+    ASSERT_EQ(main.stack_maps.size() % words, 0);
+    for (std::size_t at = 0; at < main.stack_maps.size(); at += words) {
+        Instruction ins = main.code[main.stack_maps[at]];
+        if (opOf(ins) == Opcode::CALL || opOf(ins) == Opcode::NATIVE) {
+            // 窗口中的寄存器不会在调用之后被读取，栈映射只标记窗口之下的字符串
+            for (unsigned reg = argA(ins); reg < main.register_count; ++reg) {
+                EXPECT_EQ(main.stack_maps[at + 1 + reg / 64] >> (reg % 64) & 1, 0);
+            }
+        }
+    }
+}
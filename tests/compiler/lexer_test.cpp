@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <thread>
+#include <vector>
 #include "reader.h"
 #include "lexer.h"
 
@@ -116,6 +118,87 @@ TEST_F(LexerTest, ErrorHandling) {
     verifyToken(tokens[3], TokenType::UNKNOWN, "'unclosed");
 }
 
+// 测试流式词法分析：发往TokenSink的token与analyze()得到的token相同
+TEST_F(LexerTest, Sink) {
+    class Collector : public TokenSink {
+    public:
+        std::vector<Token> tokens;
+        void put(Token &&token) override { tokens.push_back(std::move(token)); }
+    };
+    const char *source = "fn main() { var x:int = 0x1F; x += 'a'; sys.println(x); }";
+    StringReader reader(source);
+    LexicalAnalyzer& analyzer = LexicalAnalyzer::getInstance(&reader);
+    analyzer.analyze();
+    std::vector<Token> expected = analyzer.getTokens();
+
+    StringReader streamed(source);
+    Collector collector;
+    LexicalAnalyzer::getInstance(&streamed).analyze(collector);
+    ASSERT_EQ(collector.tokens.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        verifyToken(collector.tokens[i], expected[i].type(), expected[i].value());
+        EXPECT_EQ(collector.tokens[i].line(), expected[i].line());
+        EXPECT_EQ(collector.tokens[i].column(), expected[i].column());
+    }
+}
+
+// 测试环形队列：另一个线程入队的元素按顺序出队，不丢失也不重复
+TEST_F(LexerTest, SpscRing) {
+    constexpr std::size_t COUNT = 100000;
+    SpscRing<std::size_t, 8> ring;
+    std::thread producer([&ring]() {
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            std::size_t value = i;
+            while (!ring.tryPush(value)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::size_t expected = 0;
+    while (expected < COUNT) {
+        std::size_t value = 0;
+        if (ring.tryPop(value)) {
+            ASSERT_EQ(value, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    std::size_t value = 0;
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+// 测试词法单元流：按批次跨线程传递全部token，消费者提前退出时生产者不会阻塞
+TEST_F(LexerTest, TokenStream) {
+    constexpr std::size_t COUNT = TokenStream::BATCH_SIZE * TokenStream::RING_SIZE * 3 + 7;
+    TokenStream stream;
+    std::thread producer([&stream]() {
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            stream.put(Token(TokenType::IDENTIFIER, "x", i + 1, 1));
+        }
+        stream.close();
+    });
+    std::vector<Token> tokens;
+    while (stream.next(tokens)) {
+    }
+    producer.join();
+    ASSERT_EQ(tokens.size(), COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ASSERT_EQ(tokens[i].line(), i + 1);
+    }
+
+    TokenStream cancelled;
+    std::thread blocked([&cancelled]() {
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            cancelled.put(Token(TokenType::IDENTIFIER, "x", i + 1, 1));
+        }
+        cancelled.close();
+    });
+    cancelled.cancel();
+    blocked.join();
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
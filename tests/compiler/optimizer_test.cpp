@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "reader.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "type_checker.h"
+#include "constant_folder.h"
+
+using namespace Lett;
+
+class OptimizerTest : public ::testing::Test {
+protected:
+    std::vector<Token> _tokens;
+
+    void SetUp() override {
+        // 每个测试用例执行前的设置
+    }
+
+    void TearDown() override {
+        // 每个测试用例执行后的清理
+    }
+
+    // 辅助函数：解析并完成名字解析，typed为真时再进行类型检查
+    std::unique_ptr<Module> compile(const std::string &source, bool typed = false) {
+        StringReader reader(source);
+        LexicalAnalyzer& analyzer = LexicalAnalyzer::getInstance(&reader);
+        analyzer.analyze();
+        _tokens = analyzer.getTokens();
+        Parser parser(_tokens);
+        std::unique_ptr<Module> module = parser.parse();
+        EXPECT_FALSE(parser.hasErrors());
+        Resolver resolver;
+        EXPECT_TRUE(resolver.resolve(*module));
+        if (typed) {
+            TypeChecker checker;
+            EXPECT_TRUE(checker.check(*module));
+        }
+        return module;
+    }
+
+    std::string dump(const Module &module) {
+        std::ostringstream oss;
+        dumpModule(module, oss);
+        return oss.str();
+    }
+
+    const Expr *initOf(const Module &module, std::size_t stmt) {
+        return module.functions[0]->body->stmts[stmt]->as<VarStmt>()->decls[0]->init;
+    }
+};
+
+// 测试各种字面量的常量折叠
+TEST_F(OptimizerTest, FoldLiterals) {
+    std::unique_ptr<Module> module = compile(
+        "fn main() {\n"
+        "    var a:int = 0x10 + 0o10 * 0b10 - 1;\n"
+        "    var b:float = 1.5 * 2;\n"
+        "    var c:bool = !(3 > 2) || 1 == 1;\n"
+        "    var d:int = -(7 / 2) % 3;\n"
+        "    var e:string = \"ab\" + \"cd\";\n"
+        "    var f:int = 1 / 0;\n"
+        "}\n");
+    ConstantFolder folder;
+    folder.run(*module);
+
+    ASSERT_EQ(initOf(*module, 0)->kind, ExprKind::LITERAL);
+    EXPECT_EQ(initOf(*module, 0)->as<LiteralExpr>()->integer, 31);
+    EXPECT_DOUBLE_EQ(initOf(*module, 1)->as<LiteralExpr>()->real, 3.0);
+    EXPECT_TRUE(initOf(*module, 2)->as<LiteralExpr>()->boolean);
+    EXPECT_EQ(static_cast<long long>(initOf(*module, 3)->as<LiteralExpr>()->integer), 0);
+    EXPECT_EQ(initOf(*module, 4)->as<LiteralExpr>()->text, "abcd");
+    // 除零不折叠
+    EXPECT_EQ(initOf(*module, 5)->kind, ExprKind::BINARY);
+}
+
+// 测试按类型的位宽与符号折叠
+TEST_F(OptimizerTest, FoldTyped) {
+    std::unique_ptr<Module> module = compile(
+        "fn main() {\n"
+        "    var a:uint8 = 250 + 10;\n"
+        "    var b:int8 = -128 - 1;\n"
+        "    var c:uint64 = 0xFFFFFFFFFFFFFFFF >> 60;\n"
+        "    var d:bool = uint32(1) > uint32(-1 + 0);\n"
+        "    var e:float32 = float32(0.1);\n"
+        "    var f:int32 = int32(3.9) + int8(300 - 44);\n"
+        "}\n", true);
+    ConstantFolder folder;
+    folder.run(*module);
+
+    EXPECT_EQ(initOf(*module, 0)->as<LiteralExpr>()->integer, 4);
+    EXPECT_EQ(initOf(*module, 0)->type, TYPE_UINT8);
+    EXPECT_EQ(static_cast<long long>(initOf(*module, 1)->as<LiteralExpr>()->integer), 127);
+    EXPECT_EQ(initOf(*module, 2)->as<LiteralExpr>()->integer, 15);
+    ASSERT_EQ(initOf(*module, 3)->kind, ExprKind::LITERAL);
+    EXPECT_FALSE(initOf(*module, 3)->as<LiteralExpr>()->boolean);
+    EXPECT_EQ(initOf(*module, 4)->as<LiteralExpr>()->real, static_cast<double>(0.1f));
+    EXPECT_EQ(initOf(*module, 5)->as<LiteralExpr>()->integer, 3);
+}
+
+// 测试常量条件分支的删除
+TEST_F(OptimizerTest, PruneBranches) {
+    std::unique_ptr<Module> module = compile(
+        "fn f(x:int):int {\n"
+        "    if (1 > 2) { x = 1; } elif (true) { x = 2; } else { x = 3; }\n"
+        "    while (false) { x = 4; }\n"
+        "    if (false) { x = 5; }\n"
+        "    return x;\n"
+        "}\n");
+    std::unique_ptr<Module> expected = compile(
+        "fn f(x:int):int {\n"
+        "    { x = 2; }\n"
+        "    return x;\n"
+        "}\n");
+    ConstantFolder folder;
+    folder.run(*module);
+    EXPECT_EQ(folder.prunedBranches(), 4);
+    EXPECT_EQ(dump(*module), dump(*expected));
+}
+
+// 测试不可达语句的删除
+TEST_F(OptimizerTest, RemoveUnreachable) {
+    std::unique_ptr<Module> module = compile(
+        "fn f(x:int):int {\n"
+        "    while (x > 0) {\n"
+        "        if (x == 1) { break; x = 0; } else { continue; }\n"
+        "        x = 2;\n"
+        "    }\n"
+        "    if (true) { return x; }\n"
+        "    x = 3;\n"
+        "    return 0;\n"
+        "}\n");
+    std::unique_ptr<Module> expected = compile(
+        "fn f(x:int):int {\n"
+        "    while (x > 0) {\n"
+        "        if (x == 1) { break; } else { continue; }\n"
+        "    }\n"
+        "    { return x; }\n"
+        "}\n");
+    ConstantFolder folder;
+    folder.run(*module);
+    EXPECT_EQ(folder.removedStmts(), 4);
+    EXPECT_EQ(dump(*module), dump(*expected));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "exception.h"
+#include "reader.h"
+#include "lexer.h"
+#include "parser.h"
+
+using namespace Lett;
+
+class ParserTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // 每个测试用例执行前的设置
+    }
+
+    void TearDown() override {
+        // 每个测试用例执行后的清理
+    }
+
+    // 辅助函数：词法分析后返回token列表的拷贝
+    std::vector<Token> tokenize(Reader &reader) {
+        LexicalAnalyzer& analyzer = LexicalAnalyzer::getInstance(&reader);
+        analyzer.analyze();
+        return analyzer.getTokens();
+    }
+
+    std::string dump(const Module &module) {
+        std::ostringstream oss;
+        dumpModule(module, oss);
+        return oss.str();
+    }
+};
+
+// 测试表达式的优先级与结合性
+TEST_F(ParserTest, ExpressionPrecedence) {
+    StringReader reader("fn main() { x = a + b * c - d; }");
+    std::vector<Token> tokens = tokenize(reader);
+    Parser parser(tokens);
+    std::unique_ptr<Module> module = parser.parse();
+    ASSERT_FALSE(parser.hasErrors());
+    ASSERT_EQ(module->functions.size(), 1);
+
+    const BlockStmt *body = module->functions[0]->body;
+    ASSERT_EQ(body->stmts.size(), 1);
+    const Expr *expr = body->stmts[0]->as<ExprStmt>()->expr;
+    ASSERT_EQ(expr->kind, ExprKind::ASSIGN);
+    // (a + (b * c)) - d
+    const BinaryExpr *sub = expr->as<AssignExpr>()->value->as<BinaryExpr>();
+    EXPECT_EQ(sub->op, TokenType::OP_SUB);
+    const BinaryExpr *add = sub->left->as<BinaryExpr>();
+    EXPECT_EQ(add->op, TokenType::OP_ADD);
+    EXPECT_EQ(add->right->as<BinaryExpr>()->op, TokenType::OP_MUL);
+}
+
+// 测试数字字面量的解码
+TEST_F(ParserTest, Literals) {
+    StringReader reader("fn main() { f(123, 0x1F, 0o77, 0b101, 3.5, true, 'a', \"a\\tb\"); }");
+    std::vector<Token> tokens = tokenize(reader);
+    Parser parser(tokens);
+    std::unique_ptr<Module> module = parser.parse();
+    ASSERT_FALSE(parser.hasErrors());
+
+    const CallExpr *call = module->functions[0]->body->stmts[0]->as<ExprStmt>()->expr->as<CallExpr>();
+    ASSERT_EQ(call->args.size(), 8);
+    EXPECT_EQ(call->args[0]->as<LiteralExpr>()->integer, 123);
+    EXPECT_EQ(call->args[1]->as<LiteralExpr>()->integer, 0x1F);
+    EXPECT_EQ(call->args[2]->as<LiteralExpr>()->integer, 077);
+    EXPECT_EQ(call->args[3]->as<LiteralExpr>()->integer, 5);
+    EXPECT_DOUBLE_EQ(call->args[4]->as<LiteralExpr>()->real, 3.5);
+    EXPECT_TRUE(call->args[5]->as<LiteralExpr>()->boolean);
+    EXPECT_EQ(call->args[6]->as<LiteralExpr>()->integer, 'a');
+    EXPECT_EQ(call->args[7]->as<LiteralExpr>()->text, "a\tb");
+}
+
+// 测试spawn与await：spawn之后必须是函数调用，await是一元运算符
+TEST_F(ParserTest, SpawnAwait) {
+    StringReader reader("fn main() { x = await spawn f(1) + 2; spawn g; }");
+    std::vector<Token> tokens = tokenize(reader);
+    Parser parser(tokens);
+    std::unique_ptr<Module> module = parser.parse();
+    ASSERT_EQ(parser.getErrors().size(), 1);
+    EXPECT_STREQ(parser.getErrors()[0].what(), "Syntax error at 1:39, expected a function call after 'spawn'");
+    ASSERT_EQ(module->functions.size(), 0);
+
+    StringReader valid("fn main() { x = await spawn f(1) + 2; }");
+    tokens = tokenize(valid);
+    Parser second(tokens);
+    module = second.parse();
+    ASSERT_FALSE(second.hasErrors());
+    // (await (spawn f(1))) + 2
+    const BinaryExpr *add = module->functions[0]->body->stmts[0]->as<ExprStmt>()->expr->as<AssignExpr>()->value->as<BinaryExpr>();
+    ASSERT_EQ(add->left->kind, ExprKind::AWAIT);
+    const Expr *task = add->left->as<AwaitExpr>()->task;
+    ASSERT_EQ(task->kind, ExprKind::SPAWN);
+    EXPECT_EQ(task->as<SpawnExpr>()->call->args.size(), 1);
+}
+
+// 测试数组：类型名之后的[]为数组类型，类型名之后的[n]创建数组，后缀的[i]为下标
+TEST_F(ParserTest, Arrays) {
+    StringReader reader("fn f(a:int8[]):float64[] { a[i + 1] = a[0]; return float64[n * 2]; }");
+    std::vector<Token> tokens = tokenize(reader);
+    Parser parser(tokens);
+    std::unique_ptr<Module> module = parser.parse();
+    ASSERT_FALSE(parser.hasErrors());
+
+    const FunctionDecl *fn = module->functions[0];
+    EXPECT_TRUE(fn->params[0]->type->array);
+    EXPECT_TRUE(fn->ret->array);
+    const AssignExpr *assign = fn->body->stmts[0]->as<ExprStmt>()->expr->as<AssignExpr>();
+    ASSERT_EQ(assign->target->kind, ExprKind::INDEX);
+    EXPECT_EQ(assign->target->as<IndexExpr>()->index->kind, ExprKind::BINARY);
+    EXPECT_EQ(assign->value->kind, ExprKind::INDEX);
+    const Expr *value = fn->body->stmts[1]->as<ReturnStmt>()->value;
+    ASSERT_EQ(value->kind, ExprKind::NEW_ARRAY);
+    EXPECT_FALSE(value->as<NewArrayExpr>()->element->array);
+    EXPECT_EQ(value->as<NewArrayExpr>()->length->kind, ExprKind::BINARY);
+}
+
+// 测试错误恢复：出错的函数被跳过，后续函数继续解析
+TEST_F(ParserTest, ErrorRecovery) {
+    StringReader reader("import sys; fn bad() { var = 1; } fn good() { return; }");
+    std::vector<Token> tokens = tokenize(reader);
+    Parser parser(tokens);
+    std::unique_ptr<Module> module = parser.parse();
+    ASSERT_EQ(parser.getErrors().size(), 1);
+    EXPECT_EQ(parser.getErrors()[0].line(), 1);
+    ASSERT_EQ(module->imports.size(), 1);
+    ASSERT_EQ(module->functions.size(), 1);
+    EXPECT_EQ(module->functions[0]->name.name, "good");
+}
+
+// 测试顶层声明边界的扫描
+TEST_F(ParserTest, Skim) {
+    StringReader reader("import sys; fn a() { if (x) { } } fn b() { }");
+    std::vector<Token> tokens = tokenize(reader);
+    Parser parser(tokens);
+    std::vector<TopLevelChunk> chunks = parser.skim();
+    ASSERT_EQ(chunks.size(), 3);
+    EXPECT_EQ(chunks[0].kind, TopLevelChunk::IMPORT);
+    EXPECT_EQ(chunks[0].end, 3);
+    EXPECT_EQ(chunks[1].kind, TopLevelChunk::FUNCTION);
+    EXPECT_EQ(chunks[1].end, 15);
+    EXPECT_EQ(chunks[2].begin, 15);
+    EXPECT_EQ(chunks[2].end, tokens.size());
+}
+
+// 测试并行解析与串行解析的结果一致
+TEST_F(ParserTest, ParallelMatchesSerial) {
+    std::ostringstream source;
+    source << "import sys;\n";
+    for (int i = 0; i < 200; ++i) {
+        source << "fn f" << i << "(n:int):int {\n"
+               << "    var sum:int = 0;\n"
+               << "    for (var i:int = 0; i < n; i++) { if (i % 2 == 0) { sum += i; } else { continue; } }\n"
+               << "    return sum * " << i << ";\n"
+               << "}\n";
+        if (i == 100) {
+            source << "fn broken( {\n}\n";
+        }
+    }
+    StringReader reader(source.str());
+    std::vector<Token> tokens = tokenize(reader);
+
+    Parser serial(tokens);
+    std::unique_ptr<Module> expected = serial.parse(1);
+    Parser parallel(tokens);
+    std::unique_ptr<Module> actual = parallel.parse(4);
+
+    ASSERT_EQ(actual->functions.size(), 200);
+    EXPECT_EQ(dump(*actual), dump(*expected));
+    ASSERT_EQ(parallel.getErrors().size(), serial.getErrors().size());
+    ASSERT_EQ(parallel.getErrors().size(), 1);
+    EXPECT_STREQ(parallel.getErrors()[0].what(), serial.getErrors()[0].what());
+}
+
+// 测试增量扫描：逐个追加token时划分出的顶层声明与一次扫描相同
+TEST_F(ParserTest, IncrementalSkim) {
+    StringReader reader("import sys; fn a() { if (x) { } } fn b() { } fn broken( { fn c() { }");
+    std::vector<Token> tokens = tokenize(reader);
+    std::vector<TopLevelChunk> expected = Parser(tokens).skim();
+
+    std::vector<TopLevelChunk> chunks;
+    std::vector<Token> partial;
+    Skimmer skimmer;
+    TopLevelChunk chunk;
+    for (const Token &token : tokens) {
+        partial.push_back(token);
+        while (skimmer.next(partial, false, chunk)) {
+            chunks.push_back(chunk);
+        }
+    }
+    while (skimmer.next(partial, true, chunk)) {
+        chunks.push_back(chunk);
+    }
+    ASSERT_EQ(chunks.size(), expected.size());
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        EXPECT_EQ(chunks[i].kind, expected[i].kind);
+        EXPECT_EQ(chunks[i].begin, expected[i].begin);
+        EXPECT_EQ(chunks[i].end, expected[i].end);
+    }
+}
+
+// 测试流水线解析：词法分析在另一个线程中进行，结果与先得到全部token再解析相同
+TEST_F(ParserTest, PipelineMatchesSerial) {
+    std::ostringstream source;
+    source << "import sys;\n";
+    for (int i = 0; i < 200; ++i) {
+        source << "fn f" << i << "(n:int):int {\n"
+               << "    var sum:int = 0;\n"
+               << "    while (n > 0) { sum += n; n -= 1; }\n"
+               << "    return sum * " << i << ";\n"
+               << "}\n";
+        if (i == 150) {
+            source << "fn broken( {\n}\n";
+        }
+    }
+    StringReader reader(source.str());
+    std::vector<Token> tokens = tokenize(reader);
+    ASSERT_GT(tokens.size(), TokenStream::BATCH_SIZE * 10);
+    Parser serial(tokens);
+    std::unique_ptr<Module> expected = serial.parse();
+
+    StringReader streamed(source.str());
+    TokenStream stream;
+    std::thread lexer([&streamed, &stream]() {
+        LexicalAnalyzer::getInstance(&streamed).analyze(stream);
+        stream.close();
+    });
+    Parser pipelined(stream);
+    std::unique_ptr<Module> actual = pipelined.parse();
+    lexer.join();
+
+    ASSERT_EQ(actual->functions.size(), 200);
+    EXPECT_EQ(dump(*actual), dump(*expected));
+    ASSERT_EQ(pipelined.getErrors().size(), 1);
+    EXPECT_STREQ(pipelined.getErrors()[0].what(), serial.getErrors()[0].what());
+}
+
+// 测试词法分析线程失败时，语法分析线程收到同样的异常
+TEST_F(ParserTest, PipelineFailure) {
+    TokenStream stream;
+    std::thread lexer([&stream]() {
+        stream.put(Token(TokenType::KEYWORD, "fn", 1, 1));
+        stream.fail(std::make_exception_ptr(RuntimeError("lexer failed")));
+    });
+    Parser parser(stream);
+    EXPECT_THROW(parser.parse(), RuntimeError);
+    lexer.join();
+}
+
+// 测试示例程序均可正确解析
+TEST_F(ParserTest, Samples) {
+    const char *samples[] = {
+        "accumulation.let", "accumulation2.let", "calculation.let", "fabonacci.let",
+        "hello_world.let", "int_add.let", "number.let", "odd_even.let", "vector.let"
+    };
+    for (const char *sample : samples) {
+        FileReader reader(std::string(LETT_SAMPLES_DIR) + "/" + sample);
+        std::vector<Token> tokens = tokenize(reader);
+        Parser parser(tokens);
+        std::unique_ptr<Module> module = parser.parse();
+        EXPECT_FALSE(parser.hasErrors()) << sample;
+        EXPECT_FALSE(module->imports.empty()) << sample;
+        EXPECT_FALSE(module->functions.empty()) << sample;
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
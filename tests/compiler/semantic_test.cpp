@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "reader.h"
+#include "lexer.h"
+#include "parser.h"
+#include "symbol_table.h"
+#include "resolver.h"
+#include "type_checker.h"
+#include "natives.h"
+
+using namespace Lett;
+
+class SemanticTest : public ::testing::Test {
+protected:
+    std::vector<Token> _tokens;
+
+    void SetUp() override {
+        // 每个测试用例执行前的设置
+    }
+
+    void TearDown() override {
+        // 每个测试用例执行后的清理
+    }
+
+    // 辅助函数：解析源代码，要求没有语法错误
+    std::unique_ptr<Module> parse(Reader &reader) {
+        LexicalAnalyzer& analyzer = LexicalAnalyzer::getInstance(&reader);
+        analyzer.analyze();
+        _tokens = analyzer.getTokens();
+        Parser parser(_tokens);
+        std::unique_ptr<Module> module = parser.parse();
+        EXPECT_FALSE(parser.hasErrors());
+        return module;
+    }
+
+    std::unique_ptr<Module> parse(const std::string &source) {
+        StringReader reader(source);
+        return parse(reader);
+    }
+
+    static Identifier ident(const char *name) {
+        return Identifier{name, Identifier::hashOf(name)};
+    }
+};
+
+// 测试符号表的作用域遮蔽与回滚
+TEST_F(SemanticTest, SymbolTableScopes) {
+    SymbolTable table;
+    Node a(1, 1), b(2, 1), c(3, 1);
+    table.enterScope();
+    table.declare(ident("x"), SymbolKind::VARIABLE, 0, &a);
+    table.declare(ident("y"), SymbolKind::VARIABLE, 1, &b);
+
+    table.enterScope();
+    Symbol inner = table.declare(ident("x"), SymbolKind::VARIABLE, 2, &c);
+    EXPECT_EQ(inner.decl, &c);
+    EXPECT_EQ(table.lookup(ident("x"))->slot, 2);
+    // 同一作用域中的重复声明返回已存在的符号
+    EXPECT_EQ(table.declare(ident("x"), SymbolKind::VARIABLE, 3, &a).decl, &c);
+    table.leaveScope();
+
+    EXPECT_EQ(table.lookup(ident("x"))->slot, 0);
+    EXPECT_EQ(table.lookup(ident("y"))->slot, 1);
+    table.leaveScope();
+    EXPECT_EQ(table.lookup(ident("x")), nullptr);
+    EXPECT_EQ(table.size(), 0);
+}
+
+// 测试扩容及大量符号的回滚
+TEST_F(SemanticTest, SymbolTableGrow) {
+    SymbolTable table(16);
+    Node node(1, 1);
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; ++i) {
+        names.push_back("v" + std::to_string(i));
+    }
+    table.enterScope();
+    for (int i = 0; i < 500; ++i) {
+        table.declare(ident(names[i].c_str()), SymbolKind::VARIABLE, i, &node);
+    }
+    table.enterScope();
+    for (int i = 250; i < 1000; ++i) {
+        table.declare(ident(names[i].c_str()), SymbolKind::VARIABLE, 1000 + i, &node);
+    }
+    EXPECT_GE(table.capacity(), 2000);
+    EXPECT_EQ(table.lookup(ident("v300"))->slot, 1300);
+    table.leaveScope();
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_NE(table.lookup(ident(names[i].c_str())), nullptr);
+        EXPECT_EQ(table.lookup(ident(names[i].c_str()))->slot, i);
+    }
+    for (int i = 500; i < 1000; ++i) {
+        EXPECT_EQ(table.lookup(ident(names[i].c_str())), nullptr);
+    }
+}
+
+// 测试名字绑定与局部变量编号的复用
+TEST_F(SemanticTest, ResolveLocals) {
+    std::unique_ptr<Module> module = parse(
+        "fn f(a:int):int {\n"
+        "    { var x:int = a; }\n"
+        "    { var y:int = a; var z:int = y; }\n"
+        "    return f(a);\n"
+        "}\n");
+    Resolver resolver;
+    ASSERT_TRUE(resolver.resolve(*module));
+
+    FunctionDecl *fn = module->functions[0];
+    EXPECT_EQ(fn->local_count, 3);      // a, y, z，x与y共享编号
+    const BlockStmt *second = fn->body->stmts[1]->as<BlockStmt>();
+    EXPECT_EQ(second->stmts[0]->as<VarStmt>()->decls[0]->slot, 1);
+    const VarDecl *z = second->stmts[1]->as<VarStmt>()->decls[0];
+    EXPECT_EQ(z->slot, 2);
+    EXPECT_EQ(z->init->as<NameExpr>()->binding, SymbolKind::VARIABLE);
+    EXPECT_EQ(z->init->as<NameExpr>()->slot, 1);
+
+    const CallExpr *call = fn->body->stmts[2]->as<ReturnStmt>()->value->as<CallExpr>();
+    EXPECT_EQ(call->callee->as<NameExpr>()->binding, SymbolKind::FUNCTION);
+    EXPECT_EQ(call->args[0]->as<NameExpr>()->binding, SymbolKind::PARAM);
+}
+
+// 测试名字解析的错误
+TEST_F(SemanticTest, ResolveErrors) {
+    std::unique_ptr<Module> module = parse(
+        "fn f(a:int) {\n"
+        "    var a:int = 1;\n"
+        "    b = 2;\n"
+        "    break;\n"
+        "}\n"
+        "fn f() { }\n");
+    Resolver resolver;
+    EXPECT_FALSE(resolver.resolve(*module));
+    ASSERT_EQ(resolver.getErrors().size(), 4);
+    EXPECT_EQ(resolver.getErrors()[0].line(), 6);   // 重复定义的函数
+    EXPECT_EQ(resolver.getErrors()[1].line(), 2);   // 重复声明的变量
+    EXPECT_EQ(resolver.getErrors()[2].line(), 3);   // 未定义的名字
+    EXPECT_EQ(resolver.getErrors()[3].line(), 4);   // 循环外的break
+}
+
+// 测试函数类型的驻留
+TEST_F(SemanticTest, TypeTableIntern) {
+    TypeTable types;
+    EXPECT_EQ(TypeTable::lookup("int"), TYPE_INT);
+    EXPECT_EQ(TypeTable::lookup("float"), TYPE_FLOAT64);
+    EXPECT_EQ(TypeTable::lookup("object"), TYPE_ERROR);
+    TypeId f = types.function(TYPE_INT, {TYPE_INT, TYPE_STRING});
+    EXPECT_EQ(types.function(TYPE_INT, {TYPE_INT, TYPE_STRING}), f);
+    EXPECT_NE(types.function(TYPE_INT, {TYPE_STRING, TYPE_INT}), f);
+    EXPECT_NE(types.function(TYPE_VOID, {}), f);
+    EXPECT_EQ(types.param(f, 1), TYPE_STRING);
+    EXPECT_EQ(types.name(f), "fn(int, string):int");
+
+    EXPECT_TRUE(TypeChecker::widens(TYPE_INT8, TYPE_INT32));
+    EXPECT_TRUE(TypeChecker::widens(TYPE_UINT32, TYPE_INT64));
+    EXPECT_TRUE(TypeChecker::widens(TYPE_UINT64, TYPE_INT));
+    EXPECT_FALSE(TypeChecker::widens(TYPE_INT, TYPE_INT64));
+    EXPECT_FALSE(TypeChecker::widens(TYPE_INT8, TYPE_UINT16));
+    EXPECT_FALSE(TypeChecker::widens(TYPE_INT32, TYPE_FLOAT64));
+}
+
+// 测试表达式的类型标注与隐式类型转换
+TEST_F(SemanticTest, TypeAnnotations) {
+    std::unique_ptr<Module> module = parse(
+        "import sys;\n"
+        "fn f(a:int8, b:float32):float {\n"
+        "    var x:int32 = a + 1;\n"
+        "    var y = b * 2;\n"
+        "    sys.println(x < 0);\n"
+        "    return y + float(x);\n"
+        "}\n");
+    Resolver resolver;
+    ASSERT_TRUE(resolver.resolve(*module));
+    TypeChecker checker;
+    ASSERT_TRUE(checker.check(*module));
+
+    FunctionDecl *fn = module->functions[0];
+    EXPECT_EQ(module->types.name(fn->signature), "fn(int8, float32):float64");
+    const VarDecl *x = fn->body->stmts[0]->as<VarStmt>()->decls[0];
+    ASSERT_EQ(x->init->kind, ExprKind::CAST);   // int8拓宽为int32
+    EXPECT_EQ(x->init->type, TYPE_INT32);
+    const BinaryExpr *add = x->init->as<CastExpr>()->operand->as<BinaryExpr>();
+    EXPECT_EQ(add->type, TYPE_INT8);
+    EXPECT_EQ(add->right->type, TYPE_INT8);     // 整数常量采用另一个操作数的类型
+
+    const VarDecl *y = fn->body->stmts[1]->as<VarStmt>()->decls[0];
+    EXPECT_EQ(y->value_type, TYPE_FLOAT32);
+    EXPECT_EQ(y->init->as<BinaryExpr>()->right->as<LiteralExpr>()->token, TokenType::FLOAT);
+
+    const CallExpr *call = fn->body->stmts[2]->as<ExprStmt>()->expr->as<CallExpr>();
+    EXPECT_EQ(call->callee->as<MemberExpr>()->binding, SymbolKind::NATIVE);
+    EXPECT_EQ(call->callee->as<MemberExpr>()->slot, NATIVE_SYS_PRINTLN);
+    EXPECT_EQ(call->type, TYPE_VOID);
+    EXPECT_EQ(call->args[0]->type, TYPE_BOOL);
+
+    const BinaryExpr *ret = fn->body->stmts[3]->as<ReturnStmt>()->value->as<BinaryExpr>();
+    EXPECT_EQ(ret->type, TYPE_FLOAT64);
+    EXPECT_EQ(ret->left->kind, ExprKind::CAST);
+    EXPECT_EQ(ret->right->as<CastExpr>()->target->resolved, TYPE_FLOAT64);
+}
+
+// 测试类型错误
+TEST_F(SemanticTest, TypeErrors) {
+    std::unique_ptr<Module> module = parse(
+        "import sys;\n"
+        "fn f(a:int):int {\n"
+        "    var b:int8 = 300;\n"
+        "    var c:float = a;\n"
+        "    if (a) { }\n"
+        "    var s = \"n=\" + a;\n"
+        "    sys.print(f);\n"
+        "    sys.foo(1);\n"
+        "    f(1, 2);\n"
+        "    return;\n"
+        "}\n");
+    Resolver resolver;
+    ASSERT_TRUE(resolver.resolve(*module));
+    TypeChecker checker;
+    EXPECT_FALSE(checker.check(*module));
+    ASSERT_EQ(checker.getErrors().size(), 8);
+    for (std::size_t i = 0; i < checker.getErrors().size(); ++i) {
+        EXPECT_EQ(checker.getErrors()[i].line(), i + 3);
+    }
+}
+
+// 测试spawn与await的类型：spawn f(x)的类型为task<T>，await得到T
+TEST_F(SemanticTest, Tasks) {
+    std::unique_ptr<Module> module = parse(
+        "import sys;\n"
+        "fn f(a:int):string { return sys.read(\"x\"); }\n"
+        "fn main() {\n"
+        "    var t = spawn f(1);\n"
+        "    var s = await t;\n"
+        "    await t + 1;\n"
+        "    await 1;\n"
+        "    spawn sys.sleep(1);\n"
+        "    sys.println(t);\n"
+        "}\n");
+    Resolver resolver;
+    ASSERT_TRUE(resolver.resolve(*module));
+    TypeChecker checker;
+    EXPECT_FALSE(checker.check(*module));
+
+    const BlockStmt *body = module->functions[1]->body;
+    const VarDecl *t = body->stmts[0]->as<VarStmt>()->decls[0];
+    EXPECT_EQ(module->types.name(t->value_type), "task<string>");
+    EXPECT_EQ(module->types.task(TYPE_STRING), t->value_type);
+    EXPECT_EQ(body->stmts[1]->as<VarStmt>()->decls[0]->value_type, TYPE_STRING);
+    ASSERT_EQ(checker.getErrors().size(), 4);
+    for (std::size_t i = 0; i < checker.getErrors().size(); ++i) {
+        EXPECT_EQ(checker.getErrors()[i].line(), i + 6);
+    }
+}
+
+// 测试bigint：整数隐式拓宽为bigint，常量不受64位的限制，只支持算术运算和比较，显式转换只在整数之间
+TEST_F(SemanticTest, BigIntegers) {
+    std::unique_ptr<Module> module = parse(
+        "import sys;\n"
+        "fn f(a:int, b:bigint):bigint {\n"
+        "    var c:bigint = a * b + 18446744073709551615 - -1;\n"
+        "    var ok:bool = c % b == 0 && int8(c) < 0 && bigint(-a) <= c;\n"
+        "    c++;\n"
+        "    var d:int = b;\n"
+        "    var e = b & 1;\n"
+        "    var g = float(b);\n"
+        "    var h = \"n=\" + b;\n"
+        "    return c;\n"
+        "}\n");
+    Resolver resolver;
+    ASSERT_TRUE(resolver.resolve(*module));
+    TypeChecker checker;
+    EXPECT_FALSE(checker.check(*module));
+    const BlockStmt *body = module->functions[0]->body;
+    EXPECT_EQ(body->stmts[0]->as<VarStmt>()->decls[0]->init->type, TYPE_BIGINT);
+    ASSERT_EQ(checker.getErrors().size(), 4);
+    for (std::size_t i = 0; i < checker.getErrors().size(); ++i) {
+        EXPECT_EQ(checker.getErrors()[i].line(), i + 6);
+    }
+}
+
+// 测试数组：元素为定宽的数值类型，下标和长度为整数，array模块的函数按数组的元素类型检查参数和返回值
+TEST_F(SemanticTest, Arrays) {
+    std::unique_ptr<Module> module = parse(
+        "import array;\n"
+        "fn f(a:int32[], b:float64[]):int {\n"
+        "    var c:int32[] = array.add(a, array.scale(int32[4], 3));\n"
+        "    var s:int = array.sum(a) + array.dot(c, a);\n"
+        "    var m:float64 = array.max(b) + b[1];\n"
+        "    var d = bool[2];\n"
+        "    a[1.5] = 1;\n"
+        "    var e = s[0];\n"
+        "    array.add(a, b);\n"
+        "    array.offset(b, \"x\");\n"
+        "    array.sum(s);\n"
+        "    a[0] = b[0];\n"
+        "    return array.length(a);\n"
+        "}\n");
+    Resolver resolver;
+    ASSERT_TRUE(resolver.resolve(*module));
+    TypeChecker checker;
+    EXPECT_FALSE(checker.check(*module));
+    const BlockStmt *body = module->functions[0]->body;
+    EXPECT_EQ(module->types.name(body->stmts[0]->as<VarStmt>()->decls[0]->value_type), "int32[]");
+    EXPECT_EQ(body->stmts[1]->as<VarStmt>()->decls[0]->init->type, TYPE_INT);
+    ASSERT_EQ(checker.getErrors().size(), 7);
+    for (std::size_t i = 0; i < checker.getErrors().size(); ++i) {
+        EXPECT_EQ(checker.getErrors()[i].line(), i + 6);
+    }
+}
+
+// 测试示例程序均可通过名字解析与类型检查
+TEST_F(SemanticTest, Samples) {
+    const char *samples[] = {
+        "accumulation.let", "accumulation2.let", "calculation.let", "fabonacci.let",
+        "hello_world.let", "int_add.let", "number.let", "odd_even.let", "vector.let"
+    };
+    for (const char *sample : samples) {
+        FileReader reader(std::string(LETT_SAMPLES_DIR) + "/" + sample);
+        std::unique_ptr<Module> module = parse(reader);
+        Resolver resolver;
+        EXPECT_TRUE(resolver.resolve(*module)) << sample;
+        TypeChecker checker;
+        EXPECT_TRUE(checker.check(*module)) << sample;
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
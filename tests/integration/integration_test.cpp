@@ -1,4 +1,15 @@
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include "driver.h"
+#include "exception.h"
+#include "image.h"
+#include "interpreter.h"
+
+using namespace Lett;
 
 class IntegrationTest : public ::testing::Test {
 protected:
@@ -9,9 +20,440 @@ protected:
     void TearDown() override {
         // 每个测试用例执行后的清理
     }
+
+    // 辅助函数：编译、链接并执行，返回程序的输出
+    static std::string execute(Driver &driver, bool compiled, const InterpreterOptions &options = InterpreterOptions()) {
+        EXPECT_TRUE(compiled);
+        for (const std::string &error : driver.getErrors()) {
+            ADD_FAILURE() << error;
+        }
+        std::string data;
+        EXPECT_TRUE(driver.link(data));
+        Image image;
+        image.loadFromMemory(data);
+        std::ostringstream out;
+        Interpreter interpreter(image, out, options);
+        interpreter.run();
+        return out.str();
+    }
+
+    static std::string runFile(const std::string &name) {
+        Driver driver{DriverOptions()};
+        bool compiled = driver.compileFile(std::string(LETT_SAMPLES_DIR) + "/" + name);
+        return execute(driver, compiled);
+    }
+
+    // SSA优化与否、融合超级指令与否、使用JIT与否，程序的输出都相同。
+    // 第二次执行使用很小的新生代，使字符串运算频繁地触发垃圾回收
+    static std::string run(const std::string &source) {
+        DriverOptions options;
+        options.superinstructions = false;
+        options.ssa = false;
+        Driver plain(options);
+        bool compiled = plain.compileString(source);
+        InterpreterOptions interpreted;
+        interpreted.jit = false;
+        std::string expected = execute(plain, compiled, interpreted);
+        Driver driver{DriverOptions()};
+        compiled = driver.compileString(source);
+        InterpreterOptions small;
+        small.nursery_size = 1024;
+        std::string output = execute(driver, compiled, small);
+        EXPECT_EQ(output, expected);
+        return output;
+    }
 };
 
+// 测试示例程序
+TEST_F(IntegrationTest, Samples) {
+    EXPECT_EQ(runFile("hello_world.let"), "Hello world\n");
+    EXPECT_EQ(runFile("accumulation.let"), "5050\n");
+    EXPECT_EQ(runFile("accumulation2.let"), "5050\n");
+    EXPECT_EQ(runFile("int_add.let"), "21\n");
+    EXPECT_EQ(runFile("calculation.let"), "21\n");
+    EXPECT_EQ(runFile("number.let"), "x is a positive number.\n");
+    EXPECT_EQ(runFile("odd_even.let"), "x is an even number\n");
+    EXPECT_EQ(runFile("fabonacci.let"), "354224848179261915075\n");
+    EXPECT_EQ(runFile("vector.let"), "4.5\n8.25\n");
+}
+
+// 测试递归、循环控制与各种类型的运算
+TEST_F(IntegrationTest, Programs) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn fib(n:int):int { if (n <= 1) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+        "fn main() { sys.println(fib(20)); }\n"), "6765\n");
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn main() {\n"
+        "    var s:int = 0;\n"
+        "    for (var i:int = 0; i < 100; i++) {\n"
+        "        if (i % 3 == 0) { continue; } elif (i > 50) { break; }\n"
+        "        s += i;\n"
+        "    }\n"
+        "    sys.println(s);\n"
+        "}\n"), "867\n");
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn main() {\n"
+        "    var b:uint8 = 250;\n"
+        "    b = b + 10;\n"
+        "    var c:int8 = 127;\n"
+        "    c++;\n"
+        "    var u:uint = 0;\n"
+        "    u = u - 1;\n"
+        "    sys.println(b);\n"
+        "    sys.println(c);\n"
+        "    sys.println(u > 1);\n"
+        "    sys.println(-7 / 2);\n"
+        "    sys.println(7.0 / 2);\n"
+        "}\n"), "4\n-128\ntrue\n-3\n3.5\n");
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn greet(name:string):string { return \"Hello, \" + name + \"!\"; }\n"
+        "fn main() {\n"
+        "    var s:string = greet(\"Lett\");\n"
+        "    sys.println(s);\n"
+        "    sys.println(s == \"Hello, Lett!\" && \"a\" < \"b\");\n"
+        "}\n"), "Hello, Lett!\ntrue\n");
+    // 输出先写入缓冲区，sys.flush立即写出，不改变输出的内容
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn main() {\n"
+        "    for (var i:int = 0; i < 3; i++) { sys.print(i); sys.print(' '); sys.print(2.5 * float(i)); sys.flush(); }\n"
+        "    sys.println(float32(1) / float32(3));\n"
+        "}\n"), "0 01 2.52 50.333333\n");
+}
+
+// 测试JIT：循环的次数超过阈值后进入机器码执行，结果与只解释执行相同
+TEST_F(IntegrationTest, HotLoops) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn main() {\n"
+        "    var s:int = 0;\n"
+        "    var x:float = 0.0;\n"
+        "    for (var i:int = 0; i < 5000; i++) {\n"
+        "        if (i % 7 == 3) { s -= i / 3; } else { s += i << 2 >> 1; }\n"
+        "        x = x * 0.999 + 0.5;\n"
+        "    }\n"
+        "    sys.println(s);\n"
+        "    sys.println(x);\n"
+        "}\n"), "20832737\n496.639\n");
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn square(n:int):int { return n * n; }\n"
+        "fn main() {\n"
+        "    var s:int = 0;\n"
+        "    var i:int = 0;\n"
+        "    while (i < 3000) { s += square(i); i++; }\n"
+        "    do { s -= 1; } while (s % 1000 != 0);\n"
+        "    sys.println(s);\n"
+        "}\n"), "8995500000\n");
+}
+
+// 测试尾调用：递归的深度超过调用栈的上限
+TEST_F(IntegrationTest, TailCalls) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn sum(n:int, acc:int):int { if (n == 0) { return acc; } return sum(n - 1, acc + n); }\n"
+        "fn main() { sys.println(sum(1000000, 0)); }\n"), "500000500000\n");
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn odd(n:int):bool { if (n == 0) { return false; } return even(n - 1); }\n"
+        "fn even(n:int):bool { if (n == 0) { return true; } return odd(n - 1); }\n"
+        "fn main() { sys.println(even(300001)); }\n"), "false\n");
+}
+
+// 测试垃圾回收：字符串在调用、循环和递归中跨越回收存活，内容不变
+TEST_F(IntegrationTest, Strings) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn repeat(s:string, n:int):string {\n"
+        "    var r:string = \"\";\n"
+        "    for (var i:int = 0; i < n; i++) { r = r + s; }\n"
+        "    return r;\n"
+        "}\n"
+        "fn wrap(s:string, depth:int):string {\n"
+        "    if (depth == 0) { return s; }\n"
+        "    var inner:string = wrap(\"(\" + s + \")\", depth - 1);\n"
+        "    return \"<\" + inner;\n"
+        "}\n"
+        "fn main() {\n"
+        "    var keep:string = repeat(\"ab\", 300);\n"
+        "    var last:string = \"\";\n"
+        "    var same:int = 0;\n"
+        "    for (var i:int = 0; i < 2000; i++) {\n"
+        "        last = repeat(\"z\", i % 20) + \"!\";\n"
+        "        if (last == repeat(\"z\", i % 20) + \"!\") { same++; }\n"
+        "    }\n"
+        "    sys.println(same);\n"
+        "    sys.println(last);\n"
+        "    sys.println(keep == repeat(\"ab\", 300));\n"
+        "    sys.println(wrap(\"x\", 5));\n"
+        "}\n"), "2000\nzzzzzzzzzzzzzzzzzzz!\ntrue\n<<<<<(((((x)))))\n");
+    // 循环中追加得到的长字符串（rope）在比较和输出时展开
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn main() {\n"
+        "    var log:string = \"\";\n"
+        "    var twice:string = \"[ok] \";\n"
+        "    for (var i:int = 0; i < 20000; i++) { log = log + \"[ok] \"; }\n"
+        "    for (var i:int = 0; i < 4; i++) { twice = twice + twice; }\n"
+        "    for (var i:int = 0; i < 1249; i++) { twice = twice + \"[ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] \" + \"[ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] \"; }\n"
+        "    sys.println(log == twice);\n"
+        "    sys.println(log + \"!\" < twice + \"?\");\n"
+        "    var line:string = \"\";\n"
+        "    for (var i:int = 0; i < 13; i++) { line = line + \"[ok] \"; }\n"
+        "    sys.println(line);\n"
+        "    sys.println(line == \"[ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] \");\n"
+        "}\n"), "true\ntrue\n[ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] [ok] \ntrue\n");
+}
+
+// 测试大整数：小整数溢出时提升到堆上，结果回到小整数的范围时不再占用堆；循环与递归中跨越回收存活
+TEST_F(IntegrationTest, BigIntegers) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn power(b:bigint, n:int):bigint {\n"
+        "    var r:bigint = 1;\n"
+        "    for (var i:int = 0; i < n; i++) { r *= b; }\n"
+        "    return r;\n"
+        "}\n"
+        "fn factorial(n:int):bigint {\n"
+        "    if (n <= 1) { return 1; }\n"
+        "    return bigint(n) * factorial(n - 1);\n"
+        "}\n"
+        "fn main() {\n"
+        "    var x:bigint = 4611686018427387903;\n"
+        "    x++;\n"
+        "    sys.println(x);\n"
+        "    sys.println(-x - 1);\n"
+        "    sys.println(x * x);\n"
+        "    var big:bigint = power(3, 4000);\n"
+        "    var square:bigint = big * big;\n"
+        "    sys.println(square / big == big);\n"
+        "    sys.println(square % (big + 1));\n"
+        "    sys.println(-square % 1000000007);\n"
+        "    var f:bigint = factorial(40);\n"
+        "    var sum:bigint = 0;\n"
+        "    for (var i:int = 0; i < 3000; i++) { sum = sum + f / bigint(i + 1) - f / bigint(i + 2); }\n"
+        "    sys.println(f);\n"
+        "    sys.println(sum == f - f / 3001);\n"
+        "    sys.println(int(f));\n"
+        "    sys.println(uint8(f + 255));\n"
+        "    var t = spawn factorial(25);\n"
+        "    sys.println(await t > power(2, 83));\n"
+        "    sys.println(x - x * 2 + x);\n"
+        "}\n"),
+        "4611686018427387904\n-4611686018427387905\n21267647932558653966460912964485513216\n"
+        "true\n1\n-446540829\n"
+        "815915283247897734345611269596115894272000000000\ntrue\n-70609262346240000\n255\n"
+        "true\n0\n");
+    Driver driver{DriverOptions()};
+    ASSERT_TRUE(driver.compileString(
+        "import sys;\n"
+        "fn main() { var a:bigint = 1; sys.println(a / (a - 1)); }\n"));
+    std::string data;
+    ASSERT_TRUE(driver.link(data));
+    Image image;
+    image.loadFromMemory(data);
+    std::ostringstream out;
+    Interpreter interpreter(image, out);
+    EXPECT_THROW(interpreter.run(), RuntimeError);
+}
+
+// 测试数组：元素按类型截断与扩展，array模块的函数在回收之间存活的数组上计算，下标越界时报告运行时错误
+TEST_F(IntegrationTest, Arrays) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "import array;\n"
+        "fn ramp(n:int, step:float64):float64[] {\n"
+        "    var a:float64[] = float64[n];\n"
+        "    for (var i:int = 0; i < n; i++) { a[i] = float64(i) * step; }\n"
+        "    return a;\n"
+        "}\n"
+        "fn main() {\n"
+        "    var a:float64[] = ramp(100, 0.5);\n"
+        "    sys.println(array.sum(a));\n"
+        "    sys.println(array.dot(a, array.offset(a, 1.0)));\n"
+        "    var b:int8[] = int8[5];\n"
+        "    var empty:int8[];\n"
+        "    for (var i:int = 0; i < array.length(b); i++) { b[i] = int8(i * 60); }\n"
+        "    b[0] -= 1;\n"
+        "    b[1]++;\n"
+        "    sys.println(b[2]);\n"
+        "    sys.println(array.sum(b));\n"
+        "    sys.println(array.min(b));\n"
+        "    sys.println(array.max(array.mul(b, b)));\n"
+        "    array.sort(b);\n"
+        "    sys.println(b[0] + b[4]);\n"
+        "    sys.println(array.length(empty));\n"
+        "    var u:uint32[] = uint32[1000];\n"
+        "    var total:uint64 = 0;\n"
+        "    for (var r:int = 0; r < 200; r++) {\n"
+        "        var t:uint32[] = array.scale(array.offset(u, uint32(r)), 3);\n"
+        "        total += array.sum(array.add(t, u));\n"
+        "        u[r] = uint32(r);\n"
+        "    }\n"
+        "    sys.println(total);\n"
+        "    var f = spawn ramp(8, 0.25);\n"
+        "    var g:float32[] = float32[3];\n"
+        "    g[1] = float32(array.max(await f));\n"
+        "    g[2] = float32(-1.5);\n"
+        "    sys.println(array.sum(g));\n"
+        "}\n"),
+        "2475\n84562.5\n120\n88\n-76\n64\n44\n0\n"
+        "64953600\n0.25\n");
+    for (const char *body : {"var a:int[] = int[3]; a[3] = 1;", "var a:int[] = int[3]; sys.println(a[-1]);",
+                             "var n:int = -2; var a:uint8[] = uint8[n];",
+                             "var a:int[] = int[3]; var b:int[] = int[4]; array.add(a, b);"}) {
+        Driver driver{DriverOptions()};
+        ASSERT_TRUE(driver.compileString(std::string("import sys;\nimport array;\nfn main() { ") + body + " }\n"));
+        std::string data;
+        ASSERT_TRUE(driver.link(data));
+        Image image;
+        image.loadFromMemory(data);
+        std::ostringstream out;
+        Interpreter interpreter(image, out);
+        EXPECT_THROW(interpreter.run(), RuntimeError) << body;
+    }
+}
+
+// 测试只分配大对象的程序：大数组直接在老年代分配，老年代超过阈值时同样进行回收
+TEST_F(IntegrationTest, LargeObjects) {
+    Driver driver{DriverOptions()};
+    ASSERT_TRUE(driver.compileString(
+        "import sys;\n"
+        "import array;\n"
+        "fn main() {\n"
+        "    var total:float64 = 0.0;\n"
+        "    for (var i:int = 0; i < 200; i++) {\n"
+        "        var a:float64[] = float64[100000];\n"
+        "        a[i] = 1.5;\n"
+        "        total += array.sum(a);\n"
+        "    }\n"
+        "    sys.println(total);\n"
+        "}\n"));
+    std::string data;
+    ASSERT_TRUE(driver.link(data));
+    Image image;
+    image.loadFromMemory(data);
+    std::ostringstream out;
+    Interpreter interpreter(image, out);
+    interpreter.run();
+    EXPECT_EQ(out.str(), "300\n");
+    const Heap::Stats &stats = interpreter.gcStats();
+    EXPECT_GE(stats.allocated, 200u * 800000u);
+    EXPECT_GT(stats.major_collections, 0u);
+    EXPECT_LE(stats.allocated - stats.freed, 2 * Heap::MIN_MAJOR_THRESHOLD);
+}
+
+// 测试纤程：spawn立即执行新纤程，await得到其返回值；阻塞的内置函数只挂起当前纤程
+TEST_F(IntegrationTest, Fibers) {
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn fib(n:int):int { if (n <= 1) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+        "fn name(n:int):string { var s:string = \"\"; for (var i:int = 0; i < n; i++) { s = s + \"ab\"; } return s; }\n"
+        "fn main() {\n"
+        "    var a = spawn fib(15);\n"
+        "    var b = spawn name(40);\n"
+        "    var c = spawn fib(10);\n"
+        "    var keep:string = name(3);\n"
+        "    sys.println(await c);\n"
+        "    sys.println(await a + await c);\n"
+        "    sys.println(await b == name(40));\n"
+        "    sys.println(keep);\n"
+        "}\n"), "55\n665\ntrue\nababab\n");
+    // 纤程的栈从较小的大小开始，深度递归时扩容
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn depth(n:int):int { if (n == 0) { return 0; } return 1 + depth(n - 1); }\n"
+        "fn main() { var t = spawn depth(20000); sys.println(await t); }\n"), "20000\n");
+    // 三个纤程同时等待定时器，按到期的先后恢复
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn wait(ms:int, tag:string):string { sys.sleep(ms); sys.println(tag); return tag + \"!\"; }\n"
+        "fn main() {\n"
+        "    var slow = spawn wait(150, \"slow\");\n"
+        "    var fast = spawn wait(50, \"fast\");\n"
+        "    var middle = spawn wait(100, \"middle\");\n"
+        "    sys.println(await slow + await fast + await middle);\n"
+        "}\n"), "fast\nmiddle\nslow\nslow!fast!middle!\n");
+    // run执行两次，每次的等待互相重叠
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(600));
+    // FIFO由epoll等待；写入者先打开时还没有读者，重试到读者打开为止。普通文件同步读写
+    std::string fifo = ::testing::TempDir() + "lett_fibers.fifo";
+    std::string path = ::testing::TempDir() + "lett_fibers.txt";
+    std::remove(fifo.c_str());
+    ASSERT_EQ(::mkfifo(fifo.c_str(), 0600), 0);
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn put(data:string) { sys.sleep(20); sys.write(\"" + fifo + "\", data); }\n"
+        "fn get():string { return sys.read(\"" + fifo + "\"); }\n"
+        "fn main() {\n"
+        "    var w = spawn put(\"one\");\n"
+        "    var r = spawn get();\n"
+        "    sys.write(\"" + path + "\", await r + \"two\");\n"
+        "    await w;\n"
+        "    sys.println(sys.read(\"" + path + "\"));\n"
+        "}\n"), "onetwo\n");
+    EXPECT_EQ(run(
+        "import sys;\n"
+        "fn put(data:string) { sys.write(\"" + fifo + "\", data); }\n"
+        "fn get():string { sys.sleep(30); return sys.read(\"" + fifo + "\"); }\n"
+        "fn main() {\n"
+        "    var w = spawn put(\"three\");\n"
+        "    var r = spawn get();\n"
+        "    sys.println(await r);\n"
+        "    await w;\n"
+        "}\n"), "three\n");
+    std::remove(fifo.c_str());
+    std::remove(path.c_str());
+}
+
+// 测试已完成纤程的位置被复用：仍被引用的纤程可以再次等待，纤程数不随创建的纤程增长
+TEST_F(IntegrationTest, FiberReuse) {
+    Driver driver{DriverOptions()};
+    ASSERT_TRUE(driver.compileString(
+        "import sys;\n"
+        "fn square(n:int):int { return n * n; }\n"
+        "fn text(n:int):string { return \"#\" + sys.read(\"/dev/null\") + \"x\"; }\n"
+        "fn main() {\n"
+        "    var first = spawn square(7);\n"
+        "    var label = spawn text(1);\n"
+        "    var sum:int = 0;\n"
+        "    for (var i:int = 0; i < 20000; i++) { var t = spawn square(i % 10); sum += await t; }\n"
+        "    sys.println(sum);\n"
+        "    sys.println(await first + await first);\n"
+        "    sys.println(await label);\n"
+        "}\n"));
+    std::string data;
+    ASSERT_TRUE(driver.link(data));
+    Image image;
+    image.loadFromMemory(data);
+    std::ostringstream out;
+    Interpreter interpreter(image, out);
+    interpreter.run();
+    EXPECT_EQ(out.str(), "570000\n98\n#x\n");
+    EXPECT_LE(interpreter.fiberCount(), Interpreter::SWEEP_MIN);
+}
+
+// 测试阻塞的内置函数出错时报告运行时错误
+TEST_F(IntegrationTest, FiberErrors) {
+    Driver driver{DriverOptions()};
+    ASSERT_TRUE(driver.compileString(
+        "import sys;\n"
+        "fn main() { sys.println(sys.read(\"/nonexistent/lett\")); }\n"));
+    std::string data;
+    ASSERT_TRUE(driver.link(data));
+    Image image;
+    image.loadFromMemory(data);
+    std::ostringstream out;
+    Interpreter interpreter(image, out);
+    EXPECT_THROW(interpreter.run(), RuntimeError);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
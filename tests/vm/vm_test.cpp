@@ -1,4 +1,31 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <limits>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "exception.h"
+#include "natives.h"
+#include "image.h"
+#include "value.h"
+#include "heap.h"
+#include "bigint.h"
+#include "array.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "output.h"
+#include "profiler.h"
+#include "work_stealing_pool.h"
+#include "batch.h"
+
+using namespace Lett;
 
 class VmTest : public ::testing::Test {
 protected:
@@ -9,9 +36,1060 @@ protected:
     void TearDown() override {
         // 每个测试用例执行后的清理
     }
+
+    // 辅助函数：只有一个main函数的字节码文件
+    static std::string program(const std::vector<Instruction> &code, word registers) {
+        ImageBuilder builder;
+        builder.addFunction("main", 0, registers, code);
+        return builder.build();
+    }
+
+    // 辅助函数：执行字节码文件，返回输出
+    static std::string run(const std::string &data) {
+        Image image;
+        image.loadFromMemory(data);
+        std::ostringstream out;
+        Interpreter interpreter(image, out);
+        interpreter.run();
+        return out.str();
+    }
+
+    static Value ref(const void *object) {
+        return Value::fromBits(reinterpret_cast<std::uintptr_t>(object));
+    }
+
+    static const char *chars(Value value) {
+        return reinterpret_cast<const char *>(static_cast<std::uintptr_t>(value.bits()));
+    }
+
+    template <typename T>
+    static void patch(std::string &data, std::size_t offset, T value) {
+        std::memcpy(&data[offset], &value, sizeof(value));
+    }
 };
 
+// 测试值的表示：所有类型的值都是一个64位字，整数可以取到qword的整个范围
+TEST_F(VmTest, Value) {
+    EXPECT_EQ(sizeof(Value), 8);
+    EXPECT_EQ(Value::fromInt(std::numeric_limits<std::int64_t>::min()).asInt(), std::numeric_limits<std::int64_t>::min());
+    EXPECT_EQ(Value::fromInt(-1).asUint(), std::numeric_limits<qword>::max());
+    EXPECT_EQ(Value::fromUint(std::numeric_limits<qword>::max()).asUint(), std::numeric_limits<qword>::max());
+    EXPECT_TRUE(Value::fromBool(true).asBool());
+    EXPECT_EQ(Value::fromBool(true).bits(), 1);
+    EXPECT_EQ(Value::fromBool(false).bits(), 0);
+    EXPECT_EQ(Value::fromFloat(2.5).asFloat(), 2.5);
+    EXPECT_TRUE(std::signbit(Value::fromFloat(-0.0).asFloat()));
+    EXPECT_TRUE(std::isnan(Value::fromFloat(std::nan("")).asFloat()));
+    EXPECT_EQ(Value::fromFloat(1.0).bits(), 0x3FF0000000000000ULL);
+    alignas(8) char storage[16] = {};
+    const StringData *s = reinterpret_cast<const StringData *>(storage);
+    EXPECT_EQ(Value::fromString(s).asString(), s);
+    EXPECT_EQ(Value(), Value::fromUint(0));
+    // 大整数寄存器中的小整数为奇数，范围是63位有符号整数
+    EXPECT_TRUE(Value::fromSmall(Value::SMALL_MIN).isSmall());
+    EXPECT_EQ(Value::fromSmall(Value::SMALL_MIN).asSmall(), Value::SMALL_MIN);
+    EXPECT_EQ(Value::fromSmall(-1).asSmall(), -1);
+    EXPECT_EQ(Value::fromSmall(0).bits(), 1);
+    EXPECT_FALSE(Value::fitsSmall(Value::SMALL_MAX + 1));
+    EXPECT_FALSE(Value::fitsSmall(Value::SMALL_MIN - 1));
+}
+
+// 测试字节码文件的生成与加载
+TEST_F(VmTest, ImageLayout) {
+    ImageBuilder builder;
+    dword hello = builder.addStringConstant("hello");
+    EXPECT_EQ(builder.addStringConstant("hello"), hello);    // 相同的字符串只保存一份
+    dword big = builder.addConstant(0x123456789ULL);
+    builder.addFunction("f", 2, 4, {encodeABC(Opcode::RET, 1, 0, 0)});
+    builder.addFunction("main", 0, 1, {encodeABx(Opcode::LOADS, 0, hello), encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_FLUSH),
+                                       encodeABC(Opcode::RET0, 0, 0, 0)},
+                        {1, 0x1}, {{0, 3}, {1, 5}});
+    builder.setEntry(1);
+    std::string data = builder.build();
+
+    Image image;
+    image.loadFromMemory(data);
+    EXPECT_FALSE(image.mapped());
+    const ImageHeader &h = image.header();
+    EXPECT_EQ(h.version_major, LTC_VERSION_MAJOR);
+    EXPECT_EQ(h.file_size, data.size());
+    EXPECT_EQ(h.functions_offset % 8, 0);
+    EXPECT_EQ(h.code_offset % 8, 0);
+    EXPECT_EQ(h.constants_offset % 8, 0);
+    EXPECT_EQ(h.strings_offset % 8, 0);
+    EXPECT_EQ(image.functionCount(), 2);
+    EXPECT_EQ(image.stringView(image.entry().name), "main");
+    EXPECT_EQ(image.function(0).param_count, 2);
+    EXPECT_EQ(image.function(0).register_count, 4);
+    EXPECT_EQ(image.entry().code, 1);
+    EXPECT_EQ(opOf(image.code()[image.entry().code + 2]), Opcode::RET0);
+    EXPECT_EQ(image.constants()[big], 0x123456789ULL);
+    // 字符串可以直接作为运行时的字符串使用
+    const StringData *s = image.string(static_cast<dword>(image.constants()[hello]));
+    EXPECT_EQ(std::string(s->chars()), "hello");
+    EXPECT_EQ(s->hash, StringData::hashOf("hello", 5));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(s) % 8, 0);
+    EXPECT_TRUE(image.contains(s));
+    // 栈映射按指令的下标查找
+    EXPECT_EQ(h.stack_maps_size, 2);
+    ASSERT_NE(image.stackMap(image.entry(), 1), nullptr);
+    EXPECT_EQ(*image.stackMap(image.entry(), 1), 0x1);
+    EXPECT_EQ(image.stackMap(image.entry(), 0), nullptr);
+    EXPECT_EQ(image.stackMap(image.function(0), 0), nullptr);
+    // 行号表
+    EXPECT_EQ(h.line_count, 2);
+    EXPECT_EQ(image.line(image.entry(), 0), 3);
+    EXPECT_EQ(image.line(image.entry(), 1), 5);
+    EXPECT_EQ(image.line(image.function(0), 0), 0);
+}
+
+// 测试从文件映射加载
+TEST_F(VmTest, MapFile) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "lett_vm_test_map.ltc";
+    std::string data = program({encodeABC(Opcode::RET0, 0, 0, 0)}, 0);
+    std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    {
+        Image image;
+        image.load(path.string());
+        EXPECT_TRUE(image.mapped());
+        EXPECT_EQ(image.size(), data.size());
+        EXPECT_EQ(image.functionCount(), 1);
+    }
+    std::filesystem::remove(path);
+    Image image;
+    EXPECT_THROW(image.load(path.string()), FileNotExsit);
+}
+
+// 测试快照：映射后不再校验，执行结果与原来的字节码文件相同；损坏、篡改或以其他密钥生成的快照被拒绝
+TEST_F(VmTest, Snapshot) {
+    // SipHash-2-4的参考值：密钥为0到15，消息为0到7
+    SnapshotKey reference{0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+    qword message = 0x0706050403020100ULL;
+    EXPECT_EQ(snapshotMac(reference, &message, 1), 0x93f5f5799a932462ULL);
+
+    ImageBuilder builder;
+    dword hello = builder.addStringConstant("hello");
+    builder.addFunction("main", 0, 2, {
+        encodeABx(Opcode::LOADS, 0, hello),
+        encodeAsBx(Opcode::LOADI, 1, TAG_STRING),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    std::string data = builder.build();
+    Image original;
+    original.loadFromMemory(data);
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "lett_vm_test_snapshot";
+    std::filesystem::remove_all(dir);
+    std::filesystem::path key_path = dir / "keys" / "snapshot.key";
+    EXPECT_THROW(readSnapshotKey(key_path.string(), false), RuntimeError);
+    SnapshotKey key = readSnapshotKey(key_path.string(), true);
+    SnapshotKey again = readSnapshotKey(key_path.string(), false);
+    EXPECT_EQ(std::memcmp(&key, &again, sizeof(key)), 0);
+    EXPECT_EQ(std::filesystem::status(key_path).permissions() & std::filesystem::perms::all,
+              std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+    std::string snapshot = original.snapshot(key);
+
+    std::filesystem::path path = dir / "snapshot.img";
+    auto write = [&path](const std::string &content) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(content.data(), static_cast<std::streamsize>(content.size()));
+    };
+    write(snapshot);
+    Image image;
+    image.loadSnapshot(path.string(), key);
+    EXPECT_TRUE(image.mapped());
+    EXPECT_EQ(image.size(), data.size());
+    EXPECT_EQ(std::memcmp(&image.header(), data.data(), data.size()), 0);
+    EXPECT_TRUE(image.isString(original.constants()[hello]));
+    EXPECT_FALSE(image.isString(original.constants()[hello] + 8));
+    std::ostringstream out;
+    Interpreter(image, out).run();
+    EXPECT_EQ(out.str(), "hello\n");
+
+    // 字节码文件不是快照，快照中任何一个字节被改动时认证码不符，其他密钥生成的快照被拒绝
+    write(data);
+    EXPECT_THROW(image.loadSnapshot(path.string(), key), InvalidImage);
+    std::string corrupt = snapshot;
+    corrupt[sizeof(SnapshotHeader) + data.size() / 2] ^= 1;
+    write(corrupt);
+    EXPECT_THROW(image.loadSnapshot(path.string(), key), InvalidImage);
+    write(snapshot.substr(0, snapshot.size() - 8));
+    EXPECT_THROW(image.loadSnapshot(path.string(), key), InvalidImage);
+    SnapshotKey other{key.k0 ^ 1, key.k1};
+    write(original.snapshot(other));
+    EXPECT_THROW(image.loadSnapshot(path.string(), key), InvalidImage);
+
+    // 认证码正确但结构错误的快照（如函数的指令超出指令区）仍被拒绝
+    std::string forged = snapshot;
+    FunctionEntry fn = original.function(0);
+    fn.code_size = original.header().code_count + 1;
+    std::memcpy(&forged[sizeof(SnapshotHeader) + original.header().functions_offset], &fn, sizeof(fn));
+    SnapshotHeader header;
+    std::memcpy(&header, forged.data(), sizeof(header));
+    header.mac = snapshotMac(key, reinterpret_cast<const qword *>(forged.data() + sizeof(header)),
+                             (forged.size() - sizeof(header)) / sizeof(qword));
+    std::memcpy(&forged[0], &header, sizeof(header));
+    write(forged);
+    EXPECT_THROW(image.loadSnapshot(path.string(), key), InvalidImage);
+    std::filesystem::remove_all(dir);
+}
+
+// 测试加载时拒绝格式错误的文件
+TEST_F(VmTest, InvalidImage) {
+    std::string good = program({encodeABC(Opcode::RET0, 0, 0, 0)}, 1);
+    Image image;
+    EXPECT_NO_THROW(image.loadFromMemory(good));
+
+    std::string data = good;
+    data[0] = 'X';
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<word>(data, offsetof(ImageHeader, version_major), LTC_VERSION_MAJOR + 1);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<dword>(data, offsetof(ImageHeader, byte_order), 0x04030201);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<dword>(data, offsetof(ImageHeader, code_count), 1000);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<dword>(data, offsetof(ImageHeader, entry), 1);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<word>(data, sizeof(ImageHeader) + offsetof(FunctionEntry, register_count), 300);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<dword>(data, sizeof(ImageHeader) + offsetof(FunctionEntry, name), 4);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<dword>(data, sizeof(ImageHeader) + offsetof(FunctionEntry, stack_map_count), 1);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    // 字符串的哈希值错误，或两个字符串相同
+    ImageBuilder strings;
+    dword ab = static_cast<dword>(strings.addString("ab"));
+    dword ac = static_cast<dword>(strings.addString("ac"));
+    strings.addFunction("main", 0, 1, {encodeABC(Opcode::RET0, 0, 0, 0)});
+    good = strings.build();
+    EXPECT_NO_THROW(image.loadFromMemory(good));
+    std::size_t strings_offset = reinterpret_cast<const ImageHeader *>(good.data())->strings_offset;
+    data = good;
+    data[strings_offset + ac + sizeof(StringData) + 1] = 'b';
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    patch<dword>(data, strings_offset + ac + offsetof(StringData, hash), StringData::hashOf("ab", 2));
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    data = good;
+    patch<dword>(data, strings_offset + ab + offsetof(StringData, hash), 0);
+    EXPECT_THROW(image.loadFromMemory(data), InvalidImage);
+    // 栈映射中的指令下标超出函数的代码
+    ImageBuilder maps;
+    maps.addFunction("main", 0, 1, {encodeABC(Opcode::RET0, 0, 0, 0)}, {1, 0x1});
+    EXPECT_THROW(image.loadFromMemory(maps.build()), InvalidImage);
+    // 行号表中的指令下标超出函数的代码或没有递增
+    ImageBuilder lines;
+    lines.addFunction("main", 0, 1, {encodeABC(Opcode::RET0, 0, 0, 0)}, {}, {{1, 1}});
+    EXPECT_THROW(image.loadFromMemory(lines.build()), InvalidImage);
+    ImageBuilder order;
+    order.addFunction("main", 0, 1, {encodeABC(Opcode::NOP, 0, 0, 0), encodeABC(Opcode::RET0, 0, 0, 0)}, {},
+                      {{1, 1}, {0, 2}});
+    EXPECT_THROW(image.loadFromMemory(order.build()), InvalidImage);
+    // 截断的文件
+    for (std::size_t size = 0; size < good.size(); size += 7) {
+        EXPECT_THROW(image.loadFromMemory(std::string_view(good).substr(0, size)), InvalidImage);
+    }
+}
+
+// 测试加载时的字节码校验：操作数、跳转目标、调用的参数窗口以及寄存器中值的类型
+TEST_F(VmTest, Verifier) {
+    Image image;
+    auto verify = [&image](const std::vector<Instruction> &code, word registers) {
+        image.loadFromMemory(program(code, registers));
+    };
+    Instruction ret = encodeABC(Opcode::RET0, 0, 0, 0);
+    EXPECT_NO_THROW(verify({encodeAsBx(Opcode::LOADI, 1, 2), encodeABC(Opcode::ADD_I64, 0, 1, 1), ret}, 2));
+    // 寄存器超出栈帧，跳转到函数之外，执行到函数末尾之后
+    EXPECT_THROW(verify({encodeABC(Opcode::ADD_I64, 0, 1, 2), ret}, 2), InvalidImage);
+    EXPECT_THROW(verify({encodeAsBx(Opcode::JMP, 0, 1), ret}, 1), InvalidImage);
+    EXPECT_THROW(verify({encodeAsBx(Opcode::JMP, 0, -2), ret}, 1), InvalidImage);
+    EXPECT_THROW(verify({encodeAsBx(Opcode::LOADI, 0, 1)}, 1), InvalidImage);
+    // 常量池下标、函数下标、内置函数编号和截断的位数
+    EXPECT_THROW(verify({encodeABx(Opcode::LOADK, 0, 0), ret}, 1), InvalidImage);
+    EXPECT_THROW(verify({encodeABx(Opcode::CALL, 0, 1), ret}, 1), InvalidImage);
+    EXPECT_THROW(verify({encodeABx(Opcode::NATIVE, 0, NATIVE_COUNT), ret}, 1), InvalidImage);
+    EXPECT_THROW(verify({encodeAsBx(Opcode::LOADI, 0, 1), encodeABC(Opcode::TRUNC_I, 0, 0, 64), ret}, 1), InvalidImage);
+    // 超级指令之后不是它融合的指令
+    EXPECT_THROW(verify({encodeABC(Opcode::LT_I64_JMPF, 0, 0, 0), encodeAsBx(Opcode::JMPF, 1, 0), ret}, 2),
+                 InvalidImage);
+
+    ImageBuilder strings;
+    dword ab = strings.addStringConstant("ab");
+    dword number = strings.addConstant(1);
+    auto typed = [&strings, &image](const std::vector<Instruction> &code, const std::vector<qword> &maps = {}) {
+        ImageBuilder builder = strings;
+        builder.addFunction("main", 0, 4, code, maps);
+        image.loadFromMemory(builder.build());
+    };
+    Instruction load = encodeABx(Opcode::LOADS, 1, ab);
+    EXPECT_NO_THROW(typed({load, encodeABC(Opcode::MOVE, 2, 1, 0), encodeABC(Opcode::CONCAT, 0, 1, 2), ret}, {2, 0x6}));
+    // LOADS的常量不是字符串，字符串作为整数使用，整数作为字符串使用
+    EXPECT_THROW(typed({encodeABx(Opcode::LOADS, 1, number), ret}), InvalidImage);
+    EXPECT_THROW(typed({load, encodeABC(Opcode::ADD_I64, 0, 1, 1), ret}), InvalidImage);
+    EXPECT_THROW(typed({load, encodeAsBx(Opcode::LOADI, 2, 1), encodeABC(Opcode::CONCAT, 0, 1, 2), ret}, {2, 0x6}),
+                 InvalidImage);
+    // 只在一条路径上是字符串的寄存器
+    EXPECT_THROW(typed({encodeAsBx(Opcode::LOADI, 1, 0), encodeAsBx(Opcode::JMPF, 0, 1), load,
+                        encodeABC(Opcode::EQ_STR, 0, 1, 1), ret}), InvalidImage);
+    // CONCAT的操作数不在栈映射中，栈映射标记的寄存器不是字符串
+    EXPECT_THROW(typed({load, encodeABC(Opcode::CONCAT, 0, 1, 1), ret}), InvalidImage);
+    EXPECT_THROW(typed({load, encodeAsBx(Opcode::LOADI, 2, 1), encodeABC(Opcode::CONCAT, 0, 1, 1), ret}, {2, 0x6}),
+                 InvalidImage);
+    // 回收之后没有标记的字符串不能再使用
+    EXPECT_THROW(typed({load, encodeABC(Opcode::MOVE, 2, 1, 0), encodeABC(Opcode::CONCAT, 0, 1, 1),
+                        encodeABC(Opcode::EQ_STR, 0, 2, 2), ret}, {2, 0x2}), InvalidImage);
+    // 打印整数时类型标记不能是TAG_STRING
+    EXPECT_THROW(typed({encodeAsBx(Opcode::LOADI, 0, 1), encodeAsBx(Opcode::LOADI, 1, TAG_STRING),
+                        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN), ret}), InvalidImage);
+    EXPECT_THROW(typed({encodeAsBx(Opcode::LOADI, 0, 1), encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN), ret}),
+                 InvalidImage);
+
+    // 参数和返回值的类型在调用之间传递：f返回整数，调用者不能作为字符串使用
+    ImageBuilder calls;
+    calls.addFunction("f", 1, 1, {encodeABC(Opcode::RET, 0, 0, 0)});
+    dword main = calls.addFunction("main", 0, 2, {
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeABx(Opcode::CALL, 0, 0),
+        encodeABC(Opcode::EQ_STR, 1, 0, 0),
+        ret,
+    });
+    calls.setEntry(main);
+    EXPECT_THROW(image.loadFromMemory(calls.build()), InvalidImage);
+    // SPAWN_STR的函数必须返回字符串
+    ImageBuilder spawn;
+    spawn.addFunction("f", 1, 1, {encodeABC(Opcode::RET, 0, 0, 0)});
+    main = spawn.addFunction("main", 0, 2, {
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeABx(Opcode::SPAWN_STR, 0, 0),
+        encodeABC(Opcode::AWAIT, 1, 0, 0),
+        ret,
+    });
+    spawn.setEntry(main);
+    EXPECT_THROW(image.loadFromMemory(spawn.build()), InvalidImage);
+
+    // 大整数运算的操作数是大整数且在栈映射中，结果不能作为整数或字符串使用
+    Instruction one = encodeAsBx(Opcode::LOADI, 1, 1);
+    Instruction big = encodeABC(Opcode::I64_TO_BIG, 2, 1, 0);
+    EXPECT_NO_THROW(typed({one, big, encodeABC(Opcode::ADD_BIG, 0, 2, 2), encodeABC(Opcode::LT_BIG, 1, 0, 2),
+                           encodeABC(Opcode::BIG_TO_I64, 3, 0, 0), encodeABC(Opcode::ADD_I64, 3, 3, 1), ret}, {2, 0x4}));
+    EXPECT_THROW(typed({one, big, encodeABC(Opcode::ADD_BIG, 0, 2, 2), ret}), InvalidImage);
+    EXPECT_THROW(typed({one, encodeABC(Opcode::ADD_BIG, 0, 1, 1), ret}, {1, 0x2}), InvalidImage);
+    EXPECT_THROW(typed({one, big, encodeABC(Opcode::ADD_I64, 0, 2, 2), ret}), InvalidImage);
+    EXPECT_THROW(typed({one, big, encodeABC(Opcode::EQ_STR, 0, 2, 2), ret}), InvalidImage);
+    EXPECT_THROW(typed({one, big, encodeAsBx(Opcode::LOADI, 3, TAG_BIGINT), encodeABC(Opcode::MOVE, 0, 1, 0),
+                        encodeABC(Opcode::MOVE, 1, 3, 0), encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN), ret}),
+                 InvalidImage);
+
+    // 数组指令和array模块的数组参数是数组，NEWARR的元素类型有效，数组不能作为数值使用或打印
+    Instruction three = encodeAsBx(Opcode::LOADI, 1, 3);
+    Instruction array = encodeABC(Opcode::NEWARR, 2, 1, ELEMENT_INT32);
+    EXPECT_NO_THROW(typed({three, array, encodeABC(Opcode::SETARR, 2, 1, 1), encodeABC(Opcode::GETARR, 0, 2, 1),
+                           encodeABC(Opcode::LEN, 3, 2, 0), encodeABC(Opcode::ADD_I64, 0, 0, 3), ret}));
+    EXPECT_NO_THROW(typed({three, encodeABC(Opcode::NEWARR, 0, 1, ELEMENT_FLOAT64),
+                           encodeABx(Opcode::NATIVE, 0, NATIVE_ARRAY_SUM), ret}));
+    EXPECT_THROW(typed({three, encodeABC(Opcode::NEWARR, 2, 1, ELEMENT_COUNT), ret}), InvalidImage);
+    EXPECT_THROW(typed({three, encodeABC(Opcode::GETARR, 0, 1, 1), ret}), InvalidImage);
+    EXPECT_THROW(typed({three, array, encodeABC(Opcode::ADD_I64, 0, 2, 2), ret}), InvalidImage);
+    EXPECT_THROW(typed({three, array, encodeABC(Opcode::GETARR, 0, 2, 2), ret}), InvalidImage);
+    EXPECT_THROW(typed({three, encodeABC(Opcode::MOVE, 0, 1, 0), encodeABx(Opcode::NATIVE, 0, NATIVE_ARRAY_SUM), ret}),
+                 InvalidImage);
+    EXPECT_THROW(typed({three, encodeABC(Opcode::NEWARR, 0, 1, ELEMENT_INT8), encodeAsBx(Opcode::LOADI, 1, TAG_INT),
+                        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN), ret}), InvalidImage);
+}
+
+// 测试大整数运算：Karatsuba乘法与逐位乘法一致，除法满足a = q * b + r
+TEST_F(VmTest, BigInt) {
+    qword storage;
+    auto small = [&storage](std::int64_t value) { return BigInt::view(Value::fromSmall(value), storage); };
+    BigInt a, b, c, d, t;
+    // 反复平方再加上小整数，得到足够长的操作数
+    a.assign(0xFEDCBA9876543210ULL, false);
+    for (int i = 0; i < 7; ++i) {
+        t.mul(a.view(), a.view());
+        a.add(t.view(), small(1));
+    }
+    ASSERT_GE(a.length(), BigInt::KARATSUBA_THRESHOLD * 2);
+    b.assign(3, true);
+    for (int i = 0; i < 11; ++i) {
+        t.mul(b.view(), b.view());
+        b.sub(t.view(), small(12345));
+    }
+    ASSERT_GE(b.length(), BigInt::KARATSUBA_THRESHOLD);
+    // a * (b + 7) = a * b + a * 7，后者只用逐位乘法
+    c.add(b.view(), small(7));
+    t.mul(a.view(), c.view());
+    c.mul(a.view(), b.view());
+    d.mul(a.view(), small(7));
+    b.add(c.view(), d.view());
+    EXPECT_EQ(BigInt::compare(t.view(), b.view()), 0);
+    // 交换律
+    d.mul(t.view(), a.view());
+    b.mul(a.view(), t.view());
+    EXPECT_EQ(BigInt::toString(d.view()), BigInt::toString(b.view()));
+    // 商向零取整，余数与被除数同号
+    t.neg(d.view());
+    b.add(t.view(), small(-99));
+    c.div(b.view(), a.view());
+    d.mod(b.view(), a.view());
+    EXPECT_EQ(BigInt::compare(d.view(), small(-99)), 0);
+    t.mul(c.view(), a.view());
+    c.add(t.view(), d.view());
+    EXPECT_EQ(BigInt::compare(c.view(), b.view()), 0);
+    // 十进制输出、补码的低位以及回到小整数的范围
+    qword other;
+    a.sub(small(Value::SMALL_MIN), BigInt::view(Value::fromSmall(Value::SMALL_MAX), other));
+    EXPECT_EQ(BigInt::toString(a.view()), "-9223372036854775807");
+    EXPECT_EQ(BigInt::low(a.view()), 0x8000000000000001ULL);
+    std::int64_t result;
+    EXPECT_FALSE(a.small(result));
+    b.add(a.view(), small(Value::SMALL_MAX));
+    EXPECT_TRUE(b.small(result));
+    EXPECT_EQ(result, Value::SMALL_MIN);
+    b.assign(10, false);
+    for (int i = 0; i < 3; ++i) {
+        t.mul(b.view(), b.view());
+        b.mul(t.view(), t.view());
+    }
+    EXPECT_EQ(BigInt::toString(b.view()), "1" + std::string(64, '0'));
+    t.neg(b.view());
+    EXPECT_EQ(BigInt::toString(t.view()), "-1" + std::string(64, '0'));
+}
+
+// 测试解释器：循环、调用与内置函数
+TEST_F(VmTest, Interpreter) {
+    ImageBuilder builder;
+    dword text = builder.addStringConstant("sum=");
+    // fn add(a, b) { return a + b; }
+    builder.addFunction("add", 2, 3, {
+        encodeABC(Opcode::ADD_I64, 2, 0, 1),
+        encodeABC(Opcode::RET, 2, 0, 0),
+    });
+    // 计算1到10的和：R0为i，R1为sum
+    dword main = builder.addFunction("main", 0, 5, {
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeAsBx(Opcode::LOADI, 2, 10),
+        encodeABC(Opcode::LE_I64, 2, 0, 2),
+        encodeAsBx(Opcode::JMPF, 2, 6),
+        encodeABC(Opcode::MOVE, 2, 1, 0),
+        encodeABC(Opcode::MOVE, 3, 0, 0),
+        encodeABx(Opcode::CALL, 2, 0),
+        encodeABC(Opcode::MOVE, 1, 2, 0),
+        encodeABC(Opcode::ADDI_I64, 0, 0, 1),
+        encodeAsBx(Opcode::JMP, 0, -9),
+        encodeABx(Opcode::LOADS, 2, text),
+        encodeAsBx(Opcode::LOADI, 3, TAG_STRING),
+        encodeABx(Opcode::NATIVE, 2, NATIVE_SYS_PRINT),
+        encodeABC(Opcode::MOVE, 2, 1, 0),
+        encodeAsBx(Opcode::LOADI, 3, TAG_INT),
+        encodeABx(Opcode::NATIVE, 2, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    builder.setEntry(main);
+    EXPECT_EQ(run(builder.build()), "sum=55\n");
+
+    // 窄整数的截断与字符串拼接
+    ImageBuilder concat;
+    dword a = concat.addStringConstant("ab");
+    dword b = concat.addStringConstant("cd");
+    concat.addFunction("main", 0, 4, {
+        encodeAsBx(Opcode::LOADI, 0, 200),
+        encodeABC(Opcode::TRUNC_I, 0, 0, 8),
+        encodeAsBx(Opcode::LOADI, 1, TAG_INT),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN),
+        encodeABx(Opcode::LOADS, 1, a),
+        encodeABx(Opcode::LOADS, 2, b),
+        encodeABC(Opcode::CONCAT, 0, 1, 2),
+        encodeAsBx(Opcode::LOADI, 1, TAG_STRING),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    }, {6, 0x6});
+    EXPECT_EQ(run(concat.build()), "-56\nabcd\n");
+}
+
+// 测试超级指令：与原来的指令序列结果相同，跳转到序列中间时执行原来的指令
+TEST_F(VmTest, Superinstructions) {
+    // 计算1到10的和，i等于10时break。循环的回边跳到融合后的循环条件中间的LE_I64_JMPF
+    ImageBuilder builder;
+    builder.addFunction("main", 0, 5, {
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeAsBx(Opcode::LOADI_LE_I64_JMPF, 3, 10),
+        encodeABC(Opcode::LE_I64_JMPF, 2, 0, 3),
+        encodeAsBx(Opcode::JMPF, 2, 6),
+        encodeABC(Opcode::ADD_I64, 1, 1, 0),
+        encodeABC(Opcode::EQ_JMPF, 4, 0, 3),
+        encodeAsBx(Opcode::JMPF, 4, 1),
+        encodeAsBx(Opcode::JMP, 0, 2),
+        encodeABC(Opcode::ADDI_I64_JMP, 0, 0, 1),
+        encodeAsBx(Opcode::JMP, 0, -8),
+        encodeABC(Opcode::MOVE, 2, 1, 0),
+        encodeAsBx(Opcode::LOADI, 3, TAG_INT),
+        encodeABx(Opcode::NATIVE, 2, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    EXPECT_EQ(run(builder.build()), "55\n");
+
+    ImageBuilder call;
+    call.addFunction("add", 2, 3, {
+        encodeABC(Opcode::ADD_I64_RET, 2, 0, 1),
+        encodeABC(Opcode::RET, 2, 0, 0),
+    });
+    dword main = call.addFunction("main", 0, 2, {
+        encodeAsBx(Opcode::LOADI, 0, 20),
+        encodeAsBx(Opcode::LOADI, 1, 22),
+        encodeABx(Opcode::CALL, 0, 0),
+        encodeAsBx(Opcode::LOADI, 1, TAG_INT),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    call.setEntry(main);
+    EXPECT_EQ(run(call.build()), "42\n");
+}
+
+// 测试运行时错误
+TEST_F(VmTest, RuntimeErrors) {
+    std::string data = program({
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeABC(Opcode::DIV_I64, 0, 0, 1),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    }, 2);
+    EXPECT_THROW(run(data), RuntimeError);
+    // 未定义的操作码在加载时被拒绝
+    data = program({static_cast<Instruction>(200), encodeABC(Opcode::RET0, 0, 0, 0)}, 1);
+    EXPECT_THROW(run(data), InvalidImage);
+    // 无限递归
+    data = program({encodeABx(Opcode::CALL, 0, 0), encodeABC(Opcode::RET0, 0, 0, 0)}, 1);
+    EXPECT_THROW(run(data), RuntimeError);
+    // 数组下标越界（负数按无符号数比较）、长度为负、空数组的min
+    for (std::int32_t index : {3, -1}) {
+        data = program({
+            encodeAsBx(Opcode::LOADI, 1, 3),
+            encodeABC(Opcode::NEWARR, 0, 1, ELEMENT_INT16),
+            encodeAsBx(Opcode::LOADI, 1, index),
+            encodeABC(Opcode::GETARR, 1, 0, 1),
+            encodeABC(Opcode::RET0, 0, 0, 0),
+        }, 2);
+        EXPECT_THROW(run(data), RuntimeError);
+    }
+    data = program({
+        encodeAsBx(Opcode::LOADI, 1, -1),
+        encodeABC(Opcode::NEWARR, 0, 1, ELEMENT_INT16),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    }, 2);
+    EXPECT_THROW(run(data), RuntimeError);
+    data = program({
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeABC(Opcode::NEWARR, 0, 1, ELEMENT_UINT8),
+        encodeABx(Opcode::NATIVE, 0, NATIVE_ARRAY_MIN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    }, 2);
+    EXPECT_THROW(run(data), RuntimeError);
+}
+
+// 测试数组的内核：通用版本、AVX2版本与逐个元素计算的结果相同，长度覆盖向量之后剩余的元素
+template <typename T>
+static void checkKernels(const ArrayKernels &kernels, ElementType type, std::uint64_t seed) {
+    constexpr bool FLOAT = std::is_floating_point<T>::value;
+    for (std::size_t n = 1; n <= 75; n += 2) {
+        std::vector<T> a(n), b(n), out(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            a[i] = FLOAT ? static_cast<T>(static_cast<std::int64_t>(seed >> 40) % 1000) / 8 : static_cast<T>(seed >> 20);
+            b[i] = FLOAT ? static_cast<T>(static_cast<std::int64_t>(seed >> 50) % 100) / 4 - 10 : static_cast<T>(seed >> 33);
+        }
+        auto element = [](T x) {
+            return FLOAT ? Value::fromFloat(static_cast<double>(x)) : std::is_signed<T>::value
+                    ? Value::fromInt(static_cast<std::int64_t>(x)) : Value::fromUint(static_cast<qword>(x));
+        };
+        // 整数的累加按64位回绕
+        qword isum = 0, idot = 0;
+        double fsum = 0, fdot = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            isum += static_cast<qword>(static_cast<std::int64_t>(a[i]));
+            idot += static_cast<qword>(static_cast<std::int64_t>(a[i])) * static_cast<qword>(static_cast<std::int64_t>(b[i]));
+            fsum += static_cast<double>(a[i]);
+            fdot += static_cast<double>(a[i]) * static_cast<double>(b[i]);
+        }
+        if (FLOAT) {
+            // 元素都是较小的二进制小数，累加的顺序不影响结果
+            EXPECT_EQ(kernels.sum[type](a.data(), n).asFloat(), fsum);
+            EXPECT_EQ(kernels.dot[type](a.data(), b.data(), n).asFloat(), fdot);
+        } else {
+            EXPECT_EQ(kernels.sum[type](a.data(), n).asUint(), isum);
+            EXPECT_EQ(kernels.dot[type](a.data(), b.data(), n).asUint(), idot);
+        }
+        EXPECT_EQ(kernels.min[type](a.data(), n), element(*std::min_element(a.begin(), a.end())));
+        EXPECT_EQ(kernels.max[type](a.data(), n), element(*std::max_element(a.begin(), a.end())));
+        // 整数按元素的位宽回绕
+        auto add = [](T x, T y) {
+            return FLOAT ? static_cast<T>(x + y) : static_cast<T>(static_cast<qword>(x) + static_cast<qword>(y));
+        };
+        kernels.add[type](out.data(), a.data(), b.data(), n);
+        for (std::size_t i = 0; i < n; ++i) {
+            EXPECT_EQ(out[i], add(a[i], b[i]));
+        }
+        kernels.mul[type](out.data(), a.data(), b.data(), n);
+        for (std::size_t i = 0; i < n; ++i) {
+            EXPECT_EQ(out[i], FLOAT ? static_cast<T>(a[i] * b[i])
+                              : static_cast<T>(static_cast<qword>(a[i]) * static_cast<qword>(b[i])));
+        }
+        // 结果可以写回参数
+        out = a;
+        kernels.offset[type](out.data(), out.data(), element(b[0]), n);
+        for (std::size_t i = 0; i < n; ++i) {
+            EXPECT_EQ(out[i], add(a[i], b[0]));
+        }
+    }
+    if (FLOAT) {
+        std::vector<T> nan(40, 1);
+        nan[37] = std::numeric_limits<T>::quiet_NaN();
+        EXPECT_TRUE(std::isnan(kernels.min[type](nan.data(), nan.size()).asFloat()));
+        EXPECT_TRUE(std::isnan(kernels.max[type](nan.data(), nan.size()).asFloat()));
+        EXPECT_EQ(kernels.max[type](nan.data(), 37).asFloat(), 1.0);
+    }
+}
+
+TEST_F(VmTest, ArrayKernels) {
+    std::vector<const ArrayKernels *> variants = {&genericKernels()};
+    if (avx2Kernels() != nullptr) {
+        variants.push_back(avx2Kernels());
+    }
+    EXPECT_NE(std::find(variants.begin(), variants.end(), &arrayKernels()), variants.end());
+    for (const ArrayKernels *kernels : variants) {
+        SCOPED_TRACE(kernels->name);
+        checkKernels<std::int8_t>(*kernels, ELEMENT_INT8, 1);
+        checkKernels<std::int16_t>(*kernels, ELEMENT_INT16, 2);
+        checkKernels<std::int32_t>(*kernels, ELEMENT_INT32, 3);
+        checkKernels<std::int64_t>(*kernels, ELEMENT_INT64, 4);
+        checkKernels<std::uint8_t>(*kernels, ELEMENT_UINT8, 5);
+        checkKernels<std::uint16_t>(*kernels, ELEMENT_UINT16, 6);
+        checkKernels<std::uint32_t>(*kernels, ELEMENT_UINT32, 7);
+        checkKernels<std::uint64_t>(*kernels, ELEMENT_UINT64, 8);
+        checkKernels<float>(*kernels, ELEMENT_FLOAT32, 9);
+        checkKernels<double>(*kernels, ELEMENT_FLOAT64, 10);
+    }
+
+    // 整数按值排序，浮点数按全序排序：负的NaN在最前，正的NaN在最后，-0在+0之前
+    std::vector<std::int16_t> ints;
+    for (int i = 0; i < 1000; ++i) {
+        ints.push_back(static_cast<std::int16_t>(i * 7919 % 65536 - 32768));
+    }
+    std::vector<std::int16_t> expected = ints;
+    std::sort(expected.begin(), expected.end());
+    sortElements(ELEMENT_INT16, ints.data(), ints.size());
+    EXPECT_EQ(ints, expected);
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> floats = {3.5, nan, -0.0, -inf, 0.0, -nan, -2.0, inf, 1e-300};
+    sortElements(ELEMENT_FLOAT64, floats.data(), floats.size());
+    EXPECT_TRUE(std::isnan(floats[0]) && std::signbit(floats[0]));
+    EXPECT_EQ(floats[1], -inf);
+    EXPECT_EQ(floats[2], -2.0);
+    EXPECT_TRUE(floats[3] == 0 && std::signbit(floats[3]));
+    EXPECT_TRUE(floats[4] == 0 && !std::signbit(floats[4]));
+    EXPECT_EQ(floats[5], 1e-300);
+    EXPECT_EQ(floats[6], 3.5);
+    EXPECT_EQ(floats[7], inf);
+    EXPECT_TRUE(std::isnan(floats[8]) && !std::signbit(floats[8]));
+}
+
+// 测试基线JIT：机器码的结果与解释器相同，不支持的指令和除数为0时返回解释器
+TEST_F(VmTest, Jit) {
+    if (!JitCompiler::supported()) {
+        GTEST_SKIP() << "JIT is not supported on this platform";
+    }
+    ImageBuilder builder;
+    dword big = builder.addConstant(0x123456789ULL);
+    dword half = builder.addConstant(Value::fromFloat(2.5).bits());
+    dword nan = builder.addConstant(Value::fromFloat(std::nan("")).bits());
+    builder.addFunction("main", 0, 40, {
+        encodeABx(Opcode::LOADK, 0, big),
+        encodeAsBx(Opcode::LOADI, 1, -7),
+        encodeAsBx(Opcode::LOADI, 2, 2),
+        encodeABC(Opcode::ADD_I64, 3, 0, 1),
+        encodeABC(Opcode::SUB_I64, 4, 1, 0),
+        encodeABC(Opcode::MUL_I64, 5, 1, 1),
+        encodeABC(Opcode::DIV_I64, 6, 1, 2),
+        encodeABC(Opcode::MOD_I64, 7, 1, 2),
+        encodeABC(Opcode::DIV_U64, 8, 1, 2),
+        encodeABC(Opcode::SHL, 9, 2, 2),
+        encodeAsBx(Opcode::LOADI, 10, 70),
+        encodeABC(Opcode::SHL, 11, 2, 10),
+        encodeABC(Opcode::SHR_I64, 12, 1, 10),
+        encodeABC(Opcode::SHR_U64, 13, 1, 2),
+        encodeABC(Opcode::TRUNC_I, 14, 0, 8),
+        encodeABC(Opcode::TRUNC_U, 15, 1, 8),
+        encodeABC(Opcode::LT_I64, 16, 1, 2),
+        encodeABC(Opcode::LT_U64, 17, 1, 2),
+        encodeABC(Opcode::LE_I64, 18, 2, 2),
+        encodeABC(Opcode::NE, 19, 1, 2),
+        encodeABx(Opcode::LOADK, 20, half),
+        encodeABC(Opcode::I64_TO_F64, 21, 1, 0),
+        encodeABC(Opcode::MUL_F64, 22, 20, 21),
+        encodeABC(Opcode::DIV_F64, 23, 21, 20),
+        encodeABC(Opcode::NEG_F64, 24, 22, 0),
+        encodeABx(Opcode::LOADK, 25, nan),
+        encodeABC(Opcode::EQ_F64, 26, 25, 25),
+        encodeABC(Opcode::NE_F64, 27, 25, 25),
+        encodeABC(Opcode::LT_F64, 28, 21, 20),
+        encodeABC(Opcode::LE_F64, 29, 25, 20),
+        encodeABC(Opcode::ADDI_I64, 30, 1, 0xFF),
+        encodeABC(Opcode::NOT, 31, 30, 0),
+        encodeABC(Opcode::BXOR, 32, 1, 2),
+        encodeABC(Opcode::NEG_I64, 33, 0, 0),
+        encodeABC(Opcode::F64_TO_F32, 34, 23, 0),
+        // 循环：r36 = 5 + 4 + 3 + 2 + 1
+        encodeAsBx(Opcode::LOADI, 35, 5),
+        encodeAsBx(Opcode::LOADI, 36, 0),
+        encodeABC(Opcode::ADD_I64, 36, 36, 35),
+        encodeABC(Opcode::ADDI_I64, 35, 35, 0xFF),
+        encodeAsBx(Opcode::JMPT, 35, -3),
+        encodeAsBx(Opcode::LOADI, 37, 0),
+        encodeABC(Opcode::DIV_I64, 38, 1, 37),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    std::string data = builder.build();
+    Image image;
+    image.loadFromMemory(data);
+    JitCompiler jit(image);
+    const JitFunction *fn = jit.compile(image.entry());
+    ASSERT_NE(fn, nullptr);
+    Value R[40] = {};
+    const Instruction *code = image.code() + image.entry().code;
+    const Instruction *pc = jit.execute(*fn, R, code);
+    EXPECT_EQ(pc, code + 41);       // 除数为0，由解释器报告错误
+    EXPECT_EQ(R[3].asInt(), 0x123456789LL - 7);
+    EXPECT_EQ(R[4].asInt(), -7 - 0x123456789LL);
+    EXPECT_EQ(R[5].asInt(), 49);
+    EXPECT_EQ(R[6].asInt(), -3);
+    EXPECT_EQ(R[7].asInt(), -1);
+    EXPECT_EQ(R[8].asUint(), static_cast<qword>(-7) / 2);
+    EXPECT_EQ(R[9].asInt(), 8);
+    EXPECT_EQ(R[11].asInt(), 0);
+    EXPECT_EQ(R[12].asInt(), -1);
+    EXPECT_EQ(R[13].asUint(), static_cast<qword>(-7) >> 2);
+    EXPECT_EQ(R[14].asInt(), -119);
+    EXPECT_EQ(R[15].asInt(), 249);
+    EXPECT_EQ(R[16].bits(), 1);
+    EXPECT_EQ(R[17].bits(), 0);
+    EXPECT_EQ(R[18].bits(), 1);
+    EXPECT_EQ(R[19].bits(), 1);
+    EXPECT_EQ(R[21].asFloat(), -7.0);
+    EXPECT_EQ(R[22].asFloat(), -17.5);
+    EXPECT_EQ(R[23].asFloat(), -2.8);
+    EXPECT_EQ(R[24].asFloat(), 17.5);
+    EXPECT_EQ(R[26].bits(), 0);
+    EXPECT_EQ(R[27].bits(), 1);
+    EXPECT_EQ(R[28].bits(), 1);
+    EXPECT_EQ(R[29].bits(), 0);
+    EXPECT_EQ(R[30].asInt(), -8);
+    EXPECT_EQ(R[31].bits(), 0);
+    EXPECT_EQ(R[32].asInt(), -5);
+    EXPECT_EQ(R[33].asInt(), -0x123456789LL);
+    EXPECT_EQ(R[34].asFloat(), static_cast<double>(static_cast<float>(-2.8)));
+    EXPECT_EQ(R[36].asInt(), 15);
+    // 从任意一条指令进入，RET0由解释器执行
+    EXPECT_EQ(jit.execute(*fn, R, code + 42), code + 42);
+    R[37] = Value::fromInt(-1);
+    EXPECT_EQ(jit.execute(*fn, R, code + 41), code + 41);   // 除数为-1时也交给解释器
+
+    // 没有循环的函数不编译
+    ImageBuilder calls;
+    calls.addFunction("main", 0, 3, {
+        encodeABC(Opcode::ADD_I64, 2, 0, 1),
+        encodeAsBx(Opcode::JMPF, 2, 0),
+        encodeABC(Opcode::RET, 2, 0, 0),
+    });
+    data = calls.build();
+    Image empty;
+    empty.loadFromMemory(data);
+    JitCompiler none(empty);
+    EXPECT_EQ(none.compile(empty.entry()), nullptr);
+
+    // 解释器在循环的次数达到阈值后进入机器码，结果与只解释执行相同
+    ImageBuilder loop;
+    loop.addFunction("main", 0, 5, {
+        encodeAsBx(Opcode::LOADI, 0, 0),
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeAsBx(Opcode::LOADI_LT_I64_JMPF, 3, 20000),
+        encodeABC(Opcode::LT_I64_JMPF, 2, 0, 3),
+        encodeAsBx(Opcode::JMPF, 2, 3),
+        encodeABC(Opcode::ADD_I64, 1, 1, 0),
+        encodeABC(Opcode::ADDI_I64_JMP, 0, 0, 1),
+        encodeAsBx(Opcode::JMP, 0, -6),
+        encodeABC(Opcode::MOVE, 2, 1, 0),
+        encodeAsBx(Opcode::LOADI, 3, TAG_INT),
+        encodeABx(Opcode::NATIVE, 2, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    data = loop.build();
+    Image hot;
+    hot.loadFromMemory(data);
+    std::ostringstream jitted, interpreted;
+    InterpreterOptions options;
+    Interpreter(hot, jitted, options).run();
+    options.jit = false;
+    Interpreter(hot, interpreted, options).run();
+    EXPECT_EQ(jitted.str(), "199990000\n");
+    EXPECT_EQ(interpreted.str(), jitted.str());
+}
+
+// 测试分代回收的堆
+TEST_F(VmTest, Heap) {
+    Heap heap(1024);
+    void *a = heap.allocate(16);
+    std::memcpy(a, "young string...", 16);
+    void *b = heap.allocate(16);
+    EXPECT_TRUE(heap.isYoung(a));
+    EXPECT_EQ(static_cast<byte *>(b) - static_cast<byte *>(a), 24);  // 指针碰撞分配，对象头8字节
+    // 大对象直接在老年代分配
+    void *big = heap.allocate(512);
+    EXPECT_FALSE(heap.isYoung(big));
+    EXPECT_EQ(heap.oldSize(), 512);
+    while (heap.allocate(16) != nullptr) {
+    }
+
+    // minor GC把根引用的对象复制到老年代并改写根，同一个对象只复制一次
+    Value roots[] = {ref(a), ref(a), ref(big)};
+    heap.collect({&roots[0], &roots[1], &roots[2]});
+    EXPECT_FALSE(heap.isYoung(chars(roots[0])));
+    EXPECT_EQ(roots[1], roots[0]);
+    EXPECT_EQ(roots[2], ref(big));
+    EXPECT_STREQ(chars(roots[0]), "young string...");
+    EXPECT_EQ(heap.stats().minor_collections, 1);
+    EXPECT_EQ(heap.stats().promoted, 16);
+    EXPECT_EQ(heap.oldSize(), 528);
+    EXPECT_EQ(heap.allocate(16), a);      // 新生代整块重新使用
+
+    // 写屏障：老年代对象的字段引用新生代对象时，该字段在minor GC中作为根
+    Value *field = static_cast<Value *>(big);
+    *field = ref(a);
+    heap.writeBarrier(big, field);
+    std::memcpy(a, "remembered.....", 16);
+    heap.collect({&roots[2]});
+    EXPECT_FALSE(heap.isYoung(chars(*field)));
+    EXPECT_STREQ(chars(*field), "remembered.....");
+    EXPECT_EQ(heap.stats().major_collections, 0);
+
+    // 回收时沿对象末尾的引用复制对象，引用可以为0或指向静态区
+    static const char constant[16] = "static";
+    Heap traced(1024, constant, sizeof(constant));
+    Value *node = static_cast<Value *>(traced.allocate(24, 2));
+    void *leaf = traced.allocate(16);
+    std::memcpy(leaf, "leaf...........", 16);
+    node[0] = Value::fromUint(7);
+    node[1] = ref(leaf);
+    node[2] = ref(constant);
+    EXPECT_EQ(Heap::references(node), 2);
+    Value root = ref(node);
+    traced.collect({&root});
+    node = reinterpret_cast<Value *>(static_cast<std::uintptr_t>(root.bits()));
+    EXPECT_FALSE(traced.isYoung(node));
+    EXPECT_EQ(node[0].asUint(), 7);
+    EXPECT_FALSE(traced.isYoung(chars(node[1])));
+    EXPECT_STREQ(chars(node[1]), "leaf...........");
+    EXPECT_EQ(node[2], ref(constant));
+    EXPECT_EQ(traced.stats().promoted, 40);
+    node[1] = Value::fromBits(0);
+    traced.collect({&root});
+    EXPECT_EQ(traced.oldSize(), 40);
+
+    // 老年代超过阈值时major GC释放从根不能到达的对象
+    Heap old(1024);
+    std::vector<Value> objects;
+    for (std::size_t size = 0; size < Heap::MIN_MAJOR_THRESHOLD; size += 1 << 20) {
+        objects.push_back(ref(old.allocate(1 << 20)));
+    }
+    // 老年代达到阈值后直接在老年代分配的大对象和新生代的对象都要先回收
+    EXPECT_EQ(old.allocate(1 << 20), nullptr);
+    EXPECT_EQ(old.allocate(16), nullptr);
+    Value *holder = static_cast<Value *>(old.allocateOld(8, 1));
+    *holder = objects.front();
+    Value live = ref(holder);
+    old.collect({&live});
+    EXPECT_EQ(old.stats().major_collections, 1);
+    EXPECT_EQ(old.oldSize(), (1 << 20) + 8);
+    EXPECT_EQ(old.stats().freed, Heap::MIN_MAJOR_THRESHOLD - (1 << 20));
+    EXPECT_NE(old.allocate(1 << 20), nullptr);
+}
+
+// 测试采样分析器：定时器信号到达后，解释器在下一条指令处记录调用栈
+TEST_F(VmTest, Profiler) {
+    ImageBuilder builder;
+    // fn f() { return; } main在第一条指令处调用f
+    builder.addFunction("f", 0, 1, {encodeABC(Opcode::NOP, 0, 0, 0), encodeABC(Opcode::RET0, 0, 0, 0)}, {},
+                        {{0, 2}, {1, 3}});
+    builder.addFunction("main", 0, 1, {encodeABx(Opcode::CALL, 0, 0), encodeABC(Opcode::RET0, 0, 0, 0)}, {},
+                        {{0, 7}});
+    builder.setEntry(1);
+    std::string data = builder.build();
+    Image image;
+    image.loadFromMemory(data);
+    std::ostringstream out;
+    Interpreter interpreter(image, out);
+    Profiler profiler(image);
+    // 间隔足够长，只有手动发送的信号
+    profiler.start(100000000);
+    std::raise(SIGPROF);
+    EXPECT_TRUE(Profiler::pending());
+    std::vector<qword> pairs;
+    interpreter.profile(pairs, &profiler);
+    profiler.stop();
+    EXPECT_FALSE(Profiler::pending());
+    EXPECT_EQ(profiler.samples(), 1);
+    std::ostringstream folded;
+    profiler.writeFolded(folded);
+    EXPECT_EQ(folded.str(), "main:7 1\n");
+    EXPECT_EQ(pairs[static_cast<std::size_t>(Opcode::CALL) * 256 + static_cast<std::size_t>(Opcode::NOP)], 1);
+
+    // 被调用的函数中的采样包括调用者的栈帧
+    profiler.record({1ULL << 32, 1});
+    profiler.record({1ULL << 32, 1});
+    folded.str("");
+    profiler.writeFolded(folded);
+    EXPECT_EQ(folded.str(), "main:7 1\nmain:7;f:3 2\n");
+}
+
+// 测试工作窃取的线程池：所有任务（包括任务中提交的任务）执行且只执行一次，wait后可以继续提交
+TEST_F(VmTest, WorkStealingPool) {
+    WorkStealingPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    std::vector<std::atomic<int>> counts(1000);
+    for (std::size_t i = 0; i < 100; ++i) {
+        pool.submit([&pool, &counts, i]() {
+            for (std::size_t j = 0; j < 10; ++j) {
+                pool.submit([&counts, i, j]() { counts[i * 10 + j].fetch_add(1); });
+            }
+        });
+    }
+    pool.wait();
+    for (const std::atomic<int> &count : counts) {
+        EXPECT_EQ(count.load(), 1);
+    }
+
+    std::atomic<int> total(0);
+    for (int i = 0; i < 50; ++i) {
+        pool.submit([&total]() { total.fetch_add(1); });
+    }
+    pool.wait();
+    EXPECT_EQ(total.load(), 50);
+}
+
+// 测试输出缓冲区：数值直接格式化到缓冲区中，与printf("%g")相同；缓冲区满或flush时才写出，长数据不复制
+TEST_F(VmTest, Output) {
+    std::ostringstream stream;
+    {
+        Output out(stream);
+        EXPECT_FALSE(out.lineBuffered());
+        out.writeInt(-42);
+        out.put(' ');
+        out.writeUint(18446744073709551615ULL);
+        out.put(' ');
+        out.writeFloat(0.1 + 0.2);
+        out.put(' ');
+        out.writeFloat(1e20);
+        out.put(' ');
+        out.writeFloat(1.0f / 3.0f);
+        out.write("\n", 1);
+        EXPECT_TRUE(stream.str().empty());
+        out.flush();
+        EXPECT_EQ(stream.str(), "-42 18446744073709551615 0.3 1e+20 0.333333\n");
+        out.write("tail", 4);
+    }
+    EXPECT_EQ(stream.str(), "-42 18446744073709551615 0.3 1e+20 0.333333\ntail");
+
+    // 管道不是终端，不按行缓冲
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+    char buffer[1 << 17];
+    {
+        Output out(fds[1]);
+        EXPECT_FALSE(out.lineBuffered());
+        out.write("line\n", 5);
+        EXPECT_EQ(out.buffered(), 5);
+        EXPECT_LT(::read(fds[0], buffer, sizeof(buffer)), 0);
+        std::string large(Output::CAPACITY, 'x');
+        out.write(large.data(), large.size());
+        EXPECT_EQ(out.buffered(), 0);
+        EXPECT_EQ(::read(fds[0], buffer, sizeof(buffer)), static_cast<ssize_t>(5 + Output::CAPACITY));
+        EXPECT_EQ(std::string(buffer, 5), "line\n");
+        for (int i = 0; i < 10000; ++i) {
+            out.writeInt(i % 10);
+        }
+        EXPECT_EQ(out.buffered(), 10000);
+    }
+    EXPECT_EQ(::read(fds[0], buffer, sizeof(buffer)), 10000);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 测试并行的isolate：输出按添加的顺序，同一个文件只加载一次，加载失败和运行时错误只影响自己的执行
+TEST_F(VmTest, Batch) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::filesystem::path sum = dir / "lett_vm_test_batch_sum.ltc";
+    std::filesystem::path fail = dir / "lett_vm_test_batch_fail.ltc";
+    std::filesystem::path missing = dir / "lett_vm_test_batch_missing.ltc";
+    // 计算1到100000的和
+    ImageBuilder builder;
+    dword limit = builder.addConstant(100000);
+    builder.addFunction("main", 0, 4, {
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeABx(Opcode::LOADK, 2, limit),
+        encodeABC(Opcode::LE_I64, 3, 0, 2),
+        encodeAsBx(Opcode::JMPF, 3, 3),
+        encodeABC(Opcode::ADD_I64, 1, 1, 0),
+        encodeABC(Opcode::ADDI_I64, 0, 0, 1),
+        encodeAsBx(Opcode::JMP, 0, -5),
+        encodeAsBx(Opcode::LOADI, 2, TAG_INT),
+        encodeABx(Opcode::NATIVE, 1, NATIVE_SYS_PRINTLN),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    });
+    std::string data = builder.build();
+    std::ofstream(sum, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    data = program({
+        encodeAsBx(Opcode::LOADI, 0, 1),
+        encodeAsBx(Opcode::LOADI, 1, 0),
+        encodeABC(Opcode::DIV_I64, 0, 0, 1),
+        encodeABC(Opcode::RET0, 0, 0, 0),
+    }, 2);
+    std::ofstream(fail, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    std::filesystem::remove(missing);
+
+    Batch batch;
+    for (int i = 0; i < 20; ++i) {
+        batch.add(sum.string());
+    }
+    batch.add(fail.string());
+    batch.add(missing.string());
+    batch.add(sum.string());
+    EXPECT_EQ(batch.size(), 23);
+    EXPECT_EQ(batch.imageCount(), 2);
+    std::ostringstream out, err;
+    EXPECT_EQ(batch.run(4, out, err), 2);
+    std::string expected;
+    for (int i = 0; i < 21; ++i) {
+        expected += "5000050000\n";
+    }
+    EXPECT_EQ(out.str(), expected);
+    EXPECT_EQ(err.str().find(fail.string() + ": "), 0);
+    EXPECT_NE(err.str().find("\n" + missing.string() + ": "), std::string::npos);
+    std::filesystem::remove(sum);
+    std::filesystem::remove(fail);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}